@@ -0,0 +1,653 @@
+#pragma once
+
+#include <DS/NodePool.hxx>
+#include <IO/SIMD.hxx>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace AstralDB {
+/* Adaptive radix tree (ART) over the bytes of the key. Inner nodes come in four sizes (4, 16, 48 and
+256 children) and grow or shrink with their fan-out. Node16 is searched with one SIMD byte
+compare. Runs of single-child nodes collapse into a compressed prefix on the node below them. Up
+to MaxPrefix bytes of it are stored inline; longer prefixes are checked against a leaf underneath.
+Leaves hold the full key, so lookups can skip prefix bytes and check them once at the end. A key
+that ends inside the tree hangs off its node as the Terminal leaf.
+
+Iteration follows byte order, which is std::string order for strings. Integers are encoded
+big-endian with the sign bit flipped so they sort numerically. Keys are unique.*/
+template <typename Key, typename Value> class AdaptiveRadixTree {
+    static_assert(std::is_same_v<Key, std::string> || (std::is_integral_v<Key> && !std::is_same_v<Key, bool>),
+                  "ART keys are strings or integers");
+
+    static constexpr size_t MaxPrefix = 8;
+
+    enum class NodeType : uint8_t {
+        Node4,
+        Node16,
+        Node48,
+        Node256
+    };
+
+    struct Leaf {
+        std::string Bytes;
+        Value Val;
+    };
+
+    // Child slots hold an inner node or a leaf; leaves are tagged with the low pointer bit
+    using Ref = uintptr_t;
+
+    struct Inner {
+        const NodeType Type;
+        uint16_t Count = 0;
+        uint32_t PrefixLength = 0;
+        std::array<uint8_t, MaxPrefix> Prefix{};
+        Leaf *Terminal = nullptr;
+
+        explicit Inner(NodeType TypeIn) : Type(TypeIn) {}
+    };
+
+    struct Node4 : Inner {
+        std::array<uint8_t, 4> Keys{};
+        std::array<Ref, 4> Children{};
+
+        Node4() : Inner(NodeType::Node4) {}
+    };
+
+    struct Node16 : Inner {
+        alignas(16) std::array<uint8_t, 16> Keys{};
+        std::array<Ref, 16> Children{};
+
+        Node16() : Inner(NodeType::Node16) {}
+    };
+
+    struct Node48 : Inner {
+        // Child slot + 1 for every byte, 0 when the byte has no child
+        std::array<uint8_t, 256> Slots{};
+        std::array<Ref, 48> Children{};
+
+        Node48() : Inner(NodeType::Node48) {}
+    };
+
+    struct Node256 : Inner {
+        std::array<Ref, 256> Children{};
+
+        Node256() : Inner(NodeType::Node256) {}
+    };
+
+    DS::NodePool<Leaf> Leaves_;
+    DS::NodePool<Node4> Nodes4_;
+    DS::NodePool<Node16> Nodes16_;
+    DS::NodePool<Node48> Nodes48_;
+    DS::NodePool<Node256> Nodes256_;
+    Ref Root_ = 0;
+    size_t Size_ = 0;
+
+    static bool IsLeaf(Ref Node) { return Node & 1; }
+    static Leaf *AsLeaf(Ref Node) { return reinterpret_cast<Leaf*>(Node & ~Ref(1)); }
+    static Inner *AsInner(Ref Node) { return reinterpret_cast<Inner*>(Node); }
+    static Ref MakeRef(Leaf *Node) { return reinterpret_cast<Ref>(Node) | 1; }
+    static Ref MakeRef(Inner *Node) { return reinterpret_cast<Ref>(Node); }
+    static uint8_t ByteAt(std::string_view Bytes, size_t Index) { return static_cast<uint8_t>(Bytes[Index]); }
+
+    static std::string Encode(const Key &KeyValue) {
+        if constexpr(std::is_same_v<Key, std::string>) {
+            return KeyValue;
+        } else {
+            using Unsigned = std::make_unsigned_t<Key>;
+            Unsigned Bits = static_cast<Unsigned>(KeyValue);
+            if constexpr(std::is_signed_v<Key>) Bits ^= Unsigned(1) << (sizeof(Key) * 8 - 1);
+            std::string Bytes(sizeof(Key), '\0');
+            for(size_t i = 0; i < sizeof(Key); ++i) Bytes[i] = static_cast<char>(Bits >> (8 * (sizeof(Key) - 1 - i)));
+            return Bytes;
+        }
+    }
+
+    static decltype(auto) KeyOf(const Leaf &Node) {
+        if constexpr(std::is_same_v<Key, std::string>) {
+            return static_cast<const std::string&>(Node.Bytes);
+        } else {
+            using Unsigned = std::make_unsigned_t<Key>;
+            Unsigned Bits = 0;
+            for(size_t i = 0; i < sizeof(Key); ++i) Bits = static_cast<Unsigned>((Bits << 8) | ByteAt(Node.Bytes, i));
+            if constexpr(std::is_signed_v<Key>) Bits ^= Unsigned(1) << (sizeof(Key) * 8 - 1);
+            return static_cast<Key>(Bits);
+        }
+    }
+
+    // String keys are searched in place; integers are encoded into a short, SSO-sized buffer
+    template<typename Func> static decltype(auto) WithBytes(const Key &KeyValue, Func &&F) {
+        if constexpr(std::is_same_v<Key, std::string>) {
+            return F(std::string_view(KeyValue));
+        } else {
+            std::string Bytes = Encode(KeyValue);
+            return F(std::string_view(Bytes));
+        }
+    }
+
+    static Ref *FindChild(Inner *Node, uint8_t Byte) {
+        switch(Node->Type) {
+            case NodeType::Node4: {
+                auto *Current = static_cast<Node4*>(Node);
+                for(size_t i = 0; i < Current->Count; ++i)
+                    if(Current->Keys[i] == Byte) return &Current->Children[i];
+                return nullptr;
+            }
+            case NodeType::Node16: {
+                auto *Current = static_cast<Node16*>(Node);
+                size_t Index = SimdFindByte16(Current->Keys.data(), Current->Count, Byte);
+                return Index < Current->Count ? &Current->Children[Index] : nullptr;
+            }
+            case NodeType::Node48: {
+                auto *Current = static_cast<Node48*>(Node);
+                uint8_t Slot = Current->Slots[Byte];
+                return Slot ? &Current->Children[Slot - 1] : nullptr;
+            }
+            case NodeType::Node256: {
+                auto *Current = static_cast<Node256*>(Node);
+                return Current->Children[Byte] ? &Current->Children[Byte] : nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+    static const Ref *FindChild(const Inner *Node, uint8_t Byte) { return FindChild(const_cast<Inner*>(Node), Byte); }
+
+    // Calls F(Byte, Child) for every child in byte order
+    template<typename Func> static void ForEachChild(const Inner *Node, Func &&F) {
+        switch(Node->Type) {
+            case NodeType::Node4: {
+                auto *Current = static_cast<const Node4*>(Node);
+                for(size_t i = 0; i < Current->Count; ++i) F(Current->Keys[i], Current->Children[i]);
+                break;
+            }
+            case NodeType::Node16: {
+                auto *Current = static_cast<const Node16*>(Node);
+                for(size_t i = 0; i < Current->Count; ++i) F(Current->Keys[i], Current->Children[i]);
+                break;
+            }
+            case NodeType::Node48: {
+                auto *Current = static_cast<const Node48*>(Node);
+                for(size_t Byte = 0; Byte < 256; ++Byte)
+                    if(Current->Slots[Byte]) F(static_cast<uint8_t>(Byte), Current->Children[Current->Slots[Byte] - 1]);
+                break;
+            }
+            case NodeType::Node256: {
+                auto *Current = static_cast<const Node256*>(Node);
+                for(size_t Byte = 0; Byte < 256; ++Byte)
+                    if(Current->Children[Byte]) F(static_cast<uint8_t>(Byte), Current->Children[Byte]);
+                break;
+            }
+        }
+    }
+
+    // Smallest leaf below Node; every leaf there carries the node's full prefix
+    static const Leaf *MinimumLeaf(Ref Node) {
+        while(!IsLeaf(Node)) {
+            const Inner *Current = AsInner(Node);
+            if(Current->Terminal) return Current->Terminal;
+            Ref First = 0;
+            ForEachChild(Current, [&](uint8_t, Ref Child) {
+                if(!First) First = Child;
+            });
+            Node = First;
+        }
+        return AsLeaf(Node);
+    }
+
+    // Byte Index of Node's compressed prefix, which starts at key offset Depth
+    static uint8_t PrefixByte(const Inner *Node, size_t Depth, size_t Index) {
+        if(Node->PrefixLength <= MaxPrefix) return Node->Prefix[Index];
+        return ByteAt(MinimumLeaf(MakeRef(const_cast<Inner*>(Node)))->Bytes, Depth + Index);
+    }
+
+    static void SetPrefix(Inner *Node, std::string_view Bytes, size_t Depth, size_t Length) {
+        Node->PrefixLength = static_cast<uint32_t>(Length);
+        for(size_t i = 0; i < std::min(Length, MaxPrefix); ++i) Node->Prefix[i] = ByteAt(Bytes, Depth + i);
+    }
+
+    // Length of the common run of Node's prefix and Bytes[Depth..]
+    static size_t PrefixMismatch(const Inner *Node, std::string_view Bytes, size_t Depth) {
+        size_t Limit = std::min<size_t>(Node->PrefixLength, Bytes.size() - Depth);
+        size_t Stored = std::min(Limit, MaxPrefix);
+        for(size_t i = 0; i < Stored; ++i)
+            if(Node->Prefix[i] != ByteAt(Bytes, Depth + i)) return i;
+        if(Limit > MaxPrefix) {
+            std::string_view Full = MinimumLeaf(MakeRef(const_cast<Inner*>(Node)))->Bytes;
+            for(size_t i = MaxPrefix; i < Limit; ++i)
+                if(Full[Depth + i] != Bytes[Depth + i]) return i;
+        }
+        return Limit;
+    }
+
+    template<class Node> static void CopyHeader(Node &To, const Inner &From) {
+        To.Count = From.Count;
+        To.PrefixLength = From.PrefixLength;
+        To.Prefix = From.Prefix;
+        To.Terminal = From.Terminal;
+    }
+
+    // Adds a child under Byte, replacing the node at Slot with a larger one when it is full
+    void AddChild(Ref &Slot, uint8_t Byte, Ref Child) {
+        Inner *Node = AsInner(Slot);
+        switch(Node->Type) {
+            case NodeType::Node4: {
+                auto *Current = static_cast<Node4*>(Node);
+                if(Current->Count < 4) {
+                    size_t Position = 0;
+                    while(Position < Current->Count && Current->Keys[Position] < Byte) ++Position;
+                    for(size_t i = Current->Count; i > Position; --i) {
+                        Current->Keys[i] = Current->Keys[i - 1];
+                        Current->Children[i] = Current->Children[i - 1];
+                    }
+                    Current->Keys[Position] = Byte;
+                    Current->Children[Position] = Child;
+                    ++Current->Count;
+                    return;
+                }
+                Node16 *Grown = Nodes16_.Create();
+                CopyHeader(*Grown, *Current);
+                std::copy(Current->Keys.begin(), Current->Keys.end(), Grown->Keys.begin());
+                std::copy(Current->Children.begin(), Current->Children.end(), Grown->Children.begin());
+                Nodes4_.Destroy(Current);
+                Slot = MakeRef(Grown);
+                break;
+            }
+            case NodeType::Node16: {
+                auto *Current = static_cast<Node16*>(Node);
+                if(Current->Count < 16) {
+                    size_t Position = SimdByteLowerBound16(Current->Keys.data(), Current->Count, Byte);
+                    for(size_t i = Current->Count; i > Position; --i) {
+                        Current->Keys[i] = Current->Keys[i - 1];
+                        Current->Children[i] = Current->Children[i - 1];
+                    }
+                    Current->Keys[Position] = Byte;
+                    Current->Children[Position] = Child;
+                    ++Current->Count;
+                    return;
+                }
+                Node48 *Grown = Nodes48_.Create();
+                CopyHeader(*Grown, *Current);
+                for(size_t i = 0; i < 16; ++i) {
+                    Grown->Slots[Current->Keys[i]] = static_cast<uint8_t>(i + 1);
+                    Grown->Children[i] = Current->Children[i];
+                }
+                Nodes16_.Destroy(Current);
+                Slot = MakeRef(Grown);
+                break;
+            }
+            case NodeType::Node48: {
+                auto *Current = static_cast<Node48*>(Node);
+                if(Current->Count < 48) {
+                    size_t Free = 0;
+                    while(Current->Children[Free]) ++Free;
+                    Current->Children[Free] = Child;
+                    Current->Slots[Byte] = static_cast<uint8_t>(Free + 1);
+                    ++Current->Count;
+                    return;
+                }
+                Node256 *Grown = Nodes256_.Create();
+                CopyHeader(*Grown, *Current);
+                for(size_t i = 0; i < 256; ++i)
+                    if(Current->Slots[i]) Grown->Children[i] = Current->Children[Current->Slots[i] - 1];
+                Nodes48_.Destroy(Current);
+                Slot = MakeRef(Grown);
+                break;
+            }
+            case NodeType::Node256: {
+                auto *Current = static_cast<Node256*>(Node);
+                Current->Children[Byte] = Child;
+                ++Current->Count;
+                return;
+            }
+        }
+        AddChild(Slot, Byte, Child);
+    }
+
+    // Drops a Node4 that no longer branches, folding it into its only child or its terminal leaf
+    void Collapse(Ref &Slot) {
+        Inner *Node = AsInner(Slot);
+        if(Node->Type != NodeType::Node4) return;
+        auto *Current = static_cast<Node4*>(Node);
+        if(Current->Count == 0) {
+            Slot = Current->Terminal ? MakeRef(Current->Terminal) : 0;
+            Nodes4_.Destroy(Current);
+            return;
+        }
+        if(Current->Count > 1 || Current->Terminal) return;
+        Ref Child = Current->Children[0];
+        if(!IsLeaf(Child)) {
+            // The child's prefix becomes this prefix, the branch byte and its own prefix in a row
+            Inner *Below = AsInner(Child);
+            std::array<uint8_t, MaxPrefix> Merged{};
+            size_t Length = 0;
+            for(size_t i = 0; i < std::min<size_t>(Current->PrefixLength, MaxPrefix); ++i) Merged[Length++] = Current->Prefix[i];
+            if(Length < MaxPrefix) Merged[Length++] = Current->Keys[0];
+            for(size_t i = 0; Length < MaxPrefix && i < std::min<size_t>(Below->PrefixLength, MaxPrefix); ++i) Merged[Length++] = Below->Prefix[i];
+            Below->Prefix = Merged;
+            Below->PrefixLength += Current->PrefixLength + 1;
+        }
+        Slot = Child;
+        Nodes4_.Destroy(Current);
+    }
+
+    // Removes the child under Byte, shrinking the node at Slot once it is sparse enough
+    void RemoveChild(Ref &Slot, uint8_t Byte) {
+        Inner *Node = AsInner(Slot);
+        switch(Node->Type) {
+            case NodeType::Node4:
+            case NodeType::Node16: {
+                uint8_t *Keys;
+                Ref *Children;
+                if(Node->Type == NodeType::Node4) {
+                    Keys = static_cast<Node4*>(Node)->Keys.data();
+                    Children = static_cast<Node4*>(Node)->Children.data();
+                } else {
+                    Keys = static_cast<Node16*>(Node)->Keys.data();
+                    Children = static_cast<Node16*>(Node)->Children.data();
+                }
+                size_t Position = 0;
+                while(Keys[Position] != Byte) ++Position;
+                for(size_t i = Position; i + 1 < Node->Count; ++i) {
+                    Keys[i] = Keys[i + 1];
+                    Children[i] = Children[i + 1];
+                }
+                Children[--Node->Count] = 0;
+                if(Node->Type == NodeType::Node16 && Node->Count == 3) {
+                    auto *Current = static_cast<Node16*>(Node);
+                    Node4 *Shrunk = Nodes4_.Create();
+                    CopyHeader(*Shrunk, *Current);
+                    std::copy_n(Current->Keys.begin(), 3, Shrunk->Keys.begin());
+                    std::copy_n(Current->Children.begin(), 3, Shrunk->Children.begin());
+                    Nodes16_.Destroy(Current);
+                    Slot = MakeRef(Shrunk);
+                }
+                break;
+            }
+            case NodeType::Node48: {
+                auto *Current = static_cast<Node48*>(Node);
+                Current->Children[Current->Slots[Byte] - 1] = 0;
+                Current->Slots[Byte] = 0;
+                if(--Current->Count == 12) {
+                    Node16 *Shrunk = Nodes16_.Create();
+                    CopyHeader(*Shrunk, *Current);
+                    size_t Position = 0;
+                    for(size_t i = 0; i < 256; ++i) {
+                        if(!Current->Slots[i]) continue;
+                        Shrunk->Keys[Position] = static_cast<uint8_t>(i);
+                        Shrunk->Children[Position++] = Current->Children[Current->Slots[i] - 1];
+                    }
+                    Nodes48_.Destroy(Current);
+                    Slot = MakeRef(Shrunk);
+                }
+                break;
+            }
+            case NodeType::Node256: {
+                auto *Current = static_cast<Node256*>(Node);
+                Current->Children[Byte] = 0;
+                if(--Current->Count == 37) {
+                    Node48 *Shrunk = Nodes48_.Create();
+                    CopyHeader(*Shrunk, *Current);
+                    size_t Position = 0;
+                    for(size_t i = 0; i < 256; ++i) {
+                        if(!Current->Children[i]) continue;
+                        Shrunk->Children[Position] = Current->Children[i];
+                        Shrunk->Slots[i] = static_cast<uint8_t>(++Position);
+                    }
+                    Nodes256_.Destroy(Current);
+                    Slot = MakeRef(Shrunk);
+                }
+                break;
+            }
+        }
+        Collapse(Slot);
+    }
+
+    // Hangs Target below Node at key offset Depth: as the terminal when its key ends there, as a child otherwise
+    void Attach(Ref &Slot, Leaf *Target, size_t Depth) {
+        if(Depth == Target->Bytes.size()) AsInner(Slot)->Terminal = Target;
+        else AddChild(Slot, ByteAt(Target->Bytes, Depth), MakeRef(Target));
+    }
+
+    // Returns the leaf for Bytes below Slot, creating it when Created is set on return
+    Leaf *InsertAt(Ref &Slot, std::string_view Bytes, size_t Depth, bool &Created) {
+        if(!Slot) {
+            Leaf *NewLeaf = Leaves_.Create(Leaf{std::string(Bytes), Value()});
+            Slot = MakeRef(NewLeaf);
+            Created = true;
+            return NewLeaf;
+        }
+        if(IsLeaf(Slot)) {
+            Leaf *Existing = AsLeaf(Slot);
+            if(Existing->Bytes == Bytes) return Existing;
+            std::string_view Other = Existing->Bytes;
+            size_t Common = 0;
+            while(Depth + Common < Other.size() && Depth + Common < Bytes.size() && Other[Depth + Common] == Bytes[Depth + Common])
+                ++Common;
+            Node4 *Split = Nodes4_.Create();
+            SetPrefix(Split, Bytes, Depth, Common);
+            Slot = MakeRef(Split);
+            Leaf *NewLeaf = Leaves_.Create(Leaf{std::string(Bytes), Value()});
+            Attach(Slot, Existing, Depth + Common);
+            Attach(Slot, NewLeaf, Depth + Common);
+            Created = true;
+            return NewLeaf;
+        }
+        Inner *Node = AsInner(Slot);
+        size_t Mismatch = PrefixMismatch(Node, Bytes, Depth);
+        if(Mismatch < Node->PrefixLength) {
+            // The key leaves the compressed path early: split the prefix at the first differing byte
+            Node4 *Split = Nodes4_.Create();
+            SetPrefix(Split, Bytes, Depth, Mismatch);
+            uint8_t Branch = PrefixByte(Node, Depth, Mismatch);
+            std::array<uint8_t, MaxPrefix> Rest{};
+            size_t RestLength = Node->PrefixLength - Mismatch - 1;
+            for(size_t i = 0; i < std::min(RestLength, MaxPrefix); ++i) Rest[i] = PrefixByte(Node, Depth, Mismatch + 1 + i);
+            Node->Prefix = Rest;
+            Node->PrefixLength = static_cast<uint32_t>(RestLength);
+            Slot = MakeRef(Split);
+            AddChild(Slot, Branch, MakeRef(Node));
+            Leaf *NewLeaf = Leaves_.Create(Leaf{std::string(Bytes), Value()});
+            Attach(Slot, NewLeaf, Depth + Mismatch);
+            Created = true;
+            return NewLeaf;
+        }
+        Depth += Node->PrefixLength;
+        if(Depth == Bytes.size()) {
+            if(!Node->Terminal) {
+                Node->Terminal = Leaves_.Create(Leaf{std::string(Bytes), Value()});
+                Created = true;
+            }
+            return Node->Terminal;
+        }
+        if(Ref *Child = FindChild(Node, ByteAt(Bytes, Depth)))
+            return InsertAt(*Child, Bytes, Depth + 1, Created);
+        Leaf *NewLeaf = Leaves_.Create(Leaf{std::string(Bytes), Value()});
+        AddChild(Slot, ByteAt(Bytes, Depth), MakeRef(NewLeaf));
+        Created = true;
+        return NewLeaf;
+    }
+
+    bool EraseAt(Ref &Slot, std::string_view Bytes, size_t Depth) {
+        if(!Slot) return false;
+        if(IsLeaf(Slot)) {
+            if(AsLeaf(Slot)->Bytes != Bytes) return false;
+            Leaves_.Destroy(AsLeaf(Slot));
+            Slot = 0;
+            return true;
+        }
+        Inner *Node = AsInner(Slot);
+        if(PrefixMismatch(Node, Bytes, Depth) != Node->PrefixLength) return false;
+        Depth += Node->PrefixLength;
+        if(Depth == Bytes.size()) {
+            if(!Node->Terminal) return false;
+            Leaves_.Destroy(Node->Terminal);
+            Node->Terminal = nullptr;
+            Collapse(Slot);
+            return true;
+        }
+        uint8_t Byte = ByteAt(Bytes, Depth);
+        Ref *Child = FindChild(Node, Byte);
+        if(!Child) return false;
+        if(IsLeaf(*Child)) {
+            if(AsLeaf(*Child)->Bytes != Bytes) return false;
+            Leaves_.Destroy(AsLeaf(*Child));
+            RemoveChild(Slot, Byte);
+            return true;
+        }
+        return EraseAt(*Child, Bytes, Depth + 1);
+    }
+
+    const Leaf *FindLeaf(std::string_view Bytes) const {
+        Ref Node = Root_;
+        size_t Depth = 0;
+        while(Node) {
+            if(IsLeaf(Node)) return AsLeaf(Node)->Bytes == Bytes ? AsLeaf(Node) : nullptr;
+            const Inner *Current = AsInner(Node);
+            // Only the stored prefix bytes are compared here; the leaf comparison settles the rest
+            if(Depth + Current->PrefixLength > Bytes.size()) return nullptr;
+            for(size_t i = 0; i < std::min<size_t>(Current->PrefixLength, MaxPrefix); ++i)
+                if(Current->Prefix[i] != ByteAt(Bytes, Depth + i)) return nullptr;
+            Depth += Current->PrefixLength;
+            if(Depth == Bytes.size())
+                return Current->Terminal && Current->Terminal->Bytes == Bytes ? Current->Terminal : nullptr;
+            const Ref *Child = FindChild(Current, ByteAt(Bytes, Depth));
+            if(!Child) return nullptr;
+            Node = *Child;
+            ++Depth;
+        }
+        return nullptr;
+    }
+
+    template<typename Func> static void Walk(Ref Node, Func &F) {
+        if(!Node) return;
+        if(IsLeaf(Node)) {
+            F(KeyOf(*AsLeaf(Node)), static_cast<const Value&>(AsLeaf(Node)->Val));
+            return;
+        }
+        const Inner *Current = AsInner(Node);
+        if(Current->Terminal) F(KeyOf(*Current->Terminal), static_cast<const Value&>(Current->Terminal->Val));
+        ForEachChild(Current, [&](uint8_t, Ref Child) { Walk(Child, F); });
+    }
+
+    void DestroyNode(Ref Node) {
+        if(!Node) return;
+        if(IsLeaf(Node)) {
+            Leaves_.Destroy(AsLeaf(Node));
+            return;
+        }
+        Inner *Current = AsInner(Node);
+        if(Current->Terminal) Leaves_.Destroy(Current->Terminal);
+        ForEachChild(Current, [&](uint8_t, Ref Child) { DestroyNode(Child); });
+        switch(Current->Type) {
+            case NodeType::Node4: Nodes4_.Destroy(static_cast<Node4*>(Current)); break;
+            case NodeType::Node16: Nodes16_.Destroy(static_cast<Node16*>(Current)); break;
+            case NodeType::Node48: Nodes48_.Destroy(static_cast<Node48*>(Current)); break;
+            case NodeType::Node256: Nodes256_.Destroy(static_cast<Node256*>(Current)); break;
+        }
+    }
+
+public:
+    AdaptiveRadixTree() = default;
+    ~AdaptiveRadixTree() { DestroyNode(Root_); }
+
+    AdaptiveRadixTree(const AdaptiveRadixTree&) = delete;
+    AdaptiveRadixTree &operator=(const AdaptiveRadixTree&) = delete;
+
+    AdaptiveRadixTree(AdaptiveRadixTree &&Other) noexcept
+        : Leaves_(std::move(Other.Leaves_)), Nodes4_(std::move(Other.Nodes4_)), Nodes16_(std::move(Other.Nodes16_)),
+          Nodes48_(std::move(Other.Nodes48_)), Nodes256_(std::move(Other.Nodes256_)),
+          Root_(std::exchange(Other.Root_, 0)), Size_(std::exchange(Other.Size_, 0)) {}
+
+    AdaptiveRadixTree &operator=(AdaptiveRadixTree &&Other) noexcept {
+        if(this != &Other) {
+            DestroyNode(Root_);
+            Leaves_ = std::move(Other.Leaves_);
+            Nodes4_ = std::move(Other.Nodes4_);
+            Nodes16_ = std::move(Other.Nodes16_);
+            Nodes48_ = std::move(Other.Nodes48_);
+            Nodes256_ = std::move(Other.Nodes256_);
+            Root_ = std::exchange(Other.Root_, 0);
+            Size_ = std::exchange(Other.Size_, 0);
+        }
+        return *this;
+    }
+
+    // Replaces the contents with Entries; the tree's shape does not depend on insertion order
+    void BulkLoad(std::vector<std::pair<Key, Value>> &&Entries) {
+        Clear();
+        for(auto &[KeyValue, Val] : Entries) Insert(KeyValue, std::move(Val));
+        Entries.clear();
+    }
+
+    // Inserts or overwrites; returns true if KeyValue was new
+    bool Insert(const Key &KeyValue, Value Val) {
+        return WithBytes(KeyValue, [&](std::string_view Bytes) {
+            bool Created = false;
+            InsertAt(Root_, Bytes, 0, Created)->Val = std::move(Val);
+            Size_ += Created;
+            return Created;
+        });
+    }
+
+    bool Delete(const Key &KeyValue) {
+        bool Erased = WithBytes(KeyValue, [&](std::string_view Bytes) { return EraseAt(Root_, Bytes, 0); });
+        Size_ -= Erased;
+        return Erased;
+    }
+
+    void Remove(const Key &KeyValue) { Delete(KeyValue); }
+
+    const Value *Find(const Key &KeyValue) const {
+        const Leaf *Found = WithBytes(KeyValue, [&](std::string_view Bytes) { return FindLeaf(Bytes); });
+        return Found ? &Found->Val : nullptr;
+    }
+
+    Value *GetPointer(const Key &KeyValue) { return const_cast<Value*>(Find(KeyValue)); }
+    bool Contains(const Key &KeyValue) const { return Find(KeyValue) != nullptr; }
+
+    // Calls F(Key, Value) for every entry in key order
+    template<typename Func> void ForEach(Func &&F) const { Walk(Root_, F); }
+
+    // Calls F(Key, Value) in key order for every string key that starts with Prefix
+    template<typename Func> void ForEachPrefix(const Key &Prefix, Func &&F) const {
+        static_assert(std::is_same_v<Key, std::string>, "Prefix scans need string keys");
+        std::string_view Bytes = Prefix;
+        Ref Node = Root_;
+        size_t Depth = 0;
+        while(Node) {
+            if(IsLeaf(Node)) {
+                if(std::string_view(AsLeaf(Node)->Bytes).starts_with(Bytes)) Walk(Node, F);
+                return;
+            }
+            const Inner *Current = AsInner(Node);
+            size_t Matched = PrefixMismatch(Current, Bytes, Depth);
+            // Everything below matches once the query runs out inside or right after this prefix
+            if(Depth + Matched == Bytes.size()) {
+                Walk(Node, F);
+                return;
+            }
+            if(Matched < Current->PrefixLength) return;
+            Depth += Current->PrefixLength;
+            const Ref *Child = FindChild(Current, ByteAt(Bytes, Depth));
+            if(!Child) return;
+            Node = *Child;
+            ++Depth;
+        }
+    }
+
+    void Clear() {
+        DestroyNode(Root_);
+        Root_ = 0;
+        Size_ = 0;
+    }
+
+    size_t Size() const { return Size_; }
+    bool Empty() const { return Size_ == 0; }
+};
+} // namespace AstralDB
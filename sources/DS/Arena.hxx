@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace AstralDB {
+namespace DS {
+/* Bump-pointer arena. Allocations are never freed individually; every block is released at once
+when the arena is destroyed or reset, so only trivially destructible objects may live in it.*/
+class Arena {
+	struct Block {
+		std::unique_ptr<std::byte[]> Data;
+		size_t Size;
+	};
+
+	std::vector<Block> Blocks_;
+	std::byte *Cursor_ = nullptr;
+	std::byte *End_ = nullptr;
+	size_t BlockSize_;
+	size_t Used_ = 0;
+
+	void Grow(size_t MinSize) {
+		size_t Size = MinSize > BlockSize_ ? MinSize : BlockSize_;
+		Blocks_.push_back({std::make_unique<std::byte[]>(Size), Size});
+		Cursor_ = Blocks_.back().Data.get();
+		End_ = Cursor_ + Size;
+	}
+
+public:
+	static constexpr size_t DefaultBlockSize = 64 * 1024;
+
+	explicit Arena(size_t BlockSize = DefaultBlockSize) : BlockSize_(BlockSize ? BlockSize : DefaultBlockSize) {}
+	Arena(const Arena&) = delete;
+	Arena &operator=(const Arena&) = delete;
+	Arena(Arena&&) noexcept = default;
+	Arena &operator=(Arena&&) noexcept = default;
+
+	void *Allocate(size_t Size, size_t Align = alignof(std::max_align_t)) {
+		auto Address = reinterpret_cast<uintptr_t>(Cursor_);
+		size_t Padding = (Align - (Address & (Align - 1))) & (Align - 1);
+		if(!Cursor_ || static_cast<size_t>(End_ - Cursor_) < Size + Padding) {
+			Grow(Size + Align);
+			Address = reinterpret_cast<uintptr_t>(Cursor_);
+			Padding = (Align - (Address & (Align - 1))) & (Align - 1);
+		}
+		std::byte *Result = Cursor_ + Padding;
+		Cursor_ = Result + Size;
+		Used_ += Size + Padding;
+		return Result;
+	}
+
+	template<class T, class... Args> T *Create(Args&&... Arguments) {
+		static_assert(std::is_trivially_destructible_v<T>, "Arena objects are never destroyed");
+		return ::new(Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(Arguments)...);
+	}
+
+	// Copies a contiguous range into the arena and returns a view of the copy
+	template<class T> std::span<const T> Copy(std::span<const T> Items) {
+		static_assert(std::is_trivially_copyable_v<T>, "Arena arrays are copied bytewise");
+		if(Items.empty()) return {};
+		T *Data = static_cast<T*>(Allocate(sizeof(T) * Items.size(), alignof(T)));
+		std::memcpy(Data, Items.data(), sizeof(T) * Items.size());
+		return {Data, Items.size()};
+	}
+
+	// Copies a string into the arena so the view outlives its source buffer
+	std::string_view Intern(std::string_view Text) {
+		if(Text.empty()) return {};
+		char *Data = static_cast<char*>(Allocate(Text.size(), 1));
+		std::memcpy(Data, Text.data(), Text.size());
+		return {Data, Text.size()};
+	}
+
+	// Drops every allocation but keeps the first block around for reuse
+	void Reset() {
+		if(Blocks_.empty()) return;
+		Blocks_.resize(1);
+		Cursor_ = Blocks_.front().Data.get();
+		End_ = Cursor_ + Blocks_.front().Size;
+		Used_ = 0;
+	}
+
+	size_t BytesUsed() const { return Used_; }
+	size_t BlockCount() const { return Blocks_.size(); }
+};
+}
+}
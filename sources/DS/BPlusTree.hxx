@@ -1,281 +1,506 @@
 #pragma once
 
+#include <DS/NodePool.hxx>
+#include <IO/SIMD.hxx>
+#include <array>
+#include <cstdint>
 #include <vector>
 #include <memory>
 #include <optional>
+#include <string>
 #include <algorithm>
 #include <functional>
+#include <type_traits>
+#include <utility>
 
 namespace AstralDB {
-template <typename Key, typename Value, size_t Order = 4, typename Compare = std::less<Key>>
+/* B+Tree with wide nodes. Keys sit inline in each node, and the order defaults to whatever fills
+~512 bytes of keys for the key type. Nodes come from pools and link through raw pointers. Integer
+keys are searched with SIMD compares. String keys keep a big-endian 8-byte prefix per slot that
+narrows the search to the few keys sharing the needle's prefix. Duplicate keys are allowed.*/
+template <typename Key, typename Value, size_t Order = 0, typename Compare = std::less<Key>>
 class BPlusTree {
-    static constexpr size_t MinKeys = (Order + 1) / 2;
-    Compare Compare_;
+    static constexpr bool DefaultCompare = std::is_same_v<Compare, std::less<Key>> || std::is_same_v<Compare, std::less<>>;
+    static constexpr bool SimdKeys = DefaultCompare && std::is_integral_v<Key> && !std::is_same_v<Key, bool> &&
+                                     (sizeof(Key) == 4 || sizeof(Key) == 8);
+    static constexpr bool PrefixKeys = DefaultCompare && std::is_same_v<Key, std::string>;
+    static constexpr size_t NodeKeyBytes = 512;
+
+    static constexpr size_t AutoOrder() {
+        size_t Bytes = sizeof(Key) + (PrefixKeys ? sizeof(uint64_t) : 0);
+        return std::clamp<size_t>(NodeKeyBytes / Bytes, 8, 128);
+    }
+
+public:
+    static constexpr size_t MaxKeys = Order ? Order : AutoOrder();
+
+private:
+    static_assert(MaxKeys >= 3, "B+Tree order must be at least 3");
+    static constexpr size_t MinKeys = MaxKeys / 2;
+    // One spare slot lets a node overflow before it is split
+    static constexpr size_t Capacity = MaxKeys + 1;
 
-    struct Node {
+    struct NoPrefixes {};
+    using PrefixArray = std::conditional_t<PrefixKeys, std::array<uint64_t, Capacity>, NoPrefixes>;
+
+    struct NodeBase {
         bool IsLeaf;
-        std::vector<Key> Keys;
-        std::vector<Value> Values;
-        std::vector<std::shared_ptr<Node>> Children;
-        std::shared_ptr<Node> Next;
+        uint16_t Count = 0;
+        [[no_unique_address]] PrefixArray Prefixes;
+        std::array<Key, Capacity> Keys;
+
+        explicit NodeBase(bool IsLeafFlag) : IsLeaf(IsLeafFlag) {}
+    };
+
+    struct Leaf : NodeBase {
+        std::array<Value, Capacity> Values;
+        Leaf *Next = nullptr;
+
+        Leaf() : NodeBase(true) {}
+    };
 
-        explicit Node(bool isLeafFlag)
-            : IsLeaf(isLeafFlag) {}
+    struct Inner : NodeBase {
+        std::array<NodeBase*, Capacity + 1> Children{};
+
+        Inner() : NodeBase(false) {}
+    };
+
+    struct Split {
+        Key Separator;
+        NodeBase *Right;
     };
 
-    std::shared_ptr<Node> Root;
-
-    void BorrowFromLeft(const std::shared_ptr<Node>& Parent, int ChildIndex) {
-        auto Child = Parent->Children[ChildIndex];
-        auto LeftSibling = Parent->Children[ChildIndex - 1];
-        if (Child->IsLeaf) {
-            Child->Keys.insert(Child->Keys.begin(), LeftSibling->Keys.back());
-            Child->Values.insert(Child->Values.begin(), LeftSibling->Values.back());
-            LeftSibling->Keys.pop_back();
-            LeftSibling->Values.pop_back();
-            Parent->Keys[ChildIndex - 1] = Child->Keys.front();
+    Compare Compare_;
+    DS::NodePool<Leaf> Leaves_;
+    DS::NodePool<Inner> Inners_;
+    NodeBase *Root_ = nullptr;
+    size_t Size_ = 0;
+
+    static Leaf *AsLeaf(NodeBase *Node) { return static_cast<Leaf*>(Node); }
+    static const Leaf *AsLeaf(const NodeBase *Node) { return static_cast<const Leaf*>(Node); }
+    static Inner *AsInner(NodeBase *Node) { return static_cast<Inner*>(Node); }
+    static const Inner *AsInner(const NodeBase *Node) { return static_cast<const Inner*>(Node); }
+
+    static uint64_t KeyPrefix(const std::string &KeyValue) {
+        uint64_t Prefix = 0;
+        size_t Length = std::min<size_t>(KeyValue.size(), 8);
+        for(size_t i = 0; i < Length; ++i)
+            Prefix |= static_cast<uint64_t>(static_cast<uint8_t>(KeyValue[i])) << (56 - 8 * i);
+        return Prefix;
+    }
+
+    static void SetKey(NodeBase &Node, size_t Index, Key KeyValue) {
+        Node.Keys[Index] = std::move(KeyValue);
+        if constexpr(PrefixKeys) Node.Prefixes[Index] = KeyPrefix(Node.Keys[Index]);
+    }
+
+    static void MoveKey(NodeBase &To, size_t ToIndex, NodeBase &From, size_t FromIndex) {
+        To.Keys[ToIndex] = std::move(From.Keys[FromIndex]);
+        if constexpr(PrefixKeys) To.Prefixes[ToIndex] = From.Prefixes[FromIndex];
+    }
+
+    // Shifts keys [Index, Count) one slot right (Delta = 1) or left onto Index (Delta = -1)
+    static void ShiftKeys(NodeBase &Node, size_t Index, int Delta) {
+        if(Delta > 0) {
+            for(size_t i = Node.Count; i > Index; --i) MoveKey(Node, i, Node, i - 1);
         } else {
-            Child->Keys.insert(Child->Keys.begin(), Parent->Keys[ChildIndex - 1]);
-            Child->Children.insert(Child->Children.begin(), LeftSibling->Children.back());
-            LeftSibling->Children.pop_back();
-            Parent->Keys[ChildIndex - 1] = LeftSibling->Keys.back();
-            LeftSibling->Keys.pop_back();
+            for(size_t i = Index; i + 1 < Node.Count; ++i) MoveKey(Node, i, Node, i + 1);
         }
     }
 
-    void BorrowFromRight(const std::shared_ptr<Node>& Parent, int ChildIndex) {
-        auto Child = Parent->Children[ChildIndex];
-        auto RightSibling = Parent->Children[ChildIndex + 1];
-        if (Child->IsLeaf) {
-            Child->Keys.push_back(RightSibling->Keys.front());
-            Child->Values.push_back(RightSibling->Values.front());
-            RightSibling->Keys.erase(RightSibling->Keys.begin());
-            RightSibling->Values.erase(RightSibling->Values.begin());
-            Parent->Keys[ChildIndex] = RightSibling->Keys.front();
+    bool Equivalent(const Key &A, const Key &B) const { return !Compare_(A, B) && !Compare_(B, A); }
+
+    // Index of the first key not less than KeyValue
+    size_t LowerBound(const NodeBase &Node, const Key &KeyValue) const {
+        if constexpr(SimdKeys) {
+            return SimdLowerBound(Node.Keys.data(), Node.Count, KeyValue);
+        } else if constexpr(PrefixKeys) {
+            uint64_t Prefix = KeyPrefix(KeyValue);
+            size_t Low = SimdLowerBound(Node.Prefixes.data(), Node.Count, Prefix);
+            size_t High = SimdUpperBound(Node.Prefixes.data(), Node.Count, Prefix);
+            return std::lower_bound(Node.Keys.begin() + Low, Node.Keys.begin() + High, KeyValue, Compare_) - Node.Keys.begin();
         } else {
-            Child->Keys.push_back(Parent->Keys[ChildIndex]);
-            Child->Children.push_back(RightSibling->Children.front());
-            RightSibling->Children.erase(RightSibling->Children.begin());
-            Parent->Keys[ChildIndex] = RightSibling->Keys.front();
-            RightSibling->Keys.erase(RightSibling->Keys.begin());
+            return std::lower_bound(Node.Keys.begin(), Node.Keys.begin() + Node.Count, KeyValue, Compare_) - Node.Keys.begin();
         }
     }
 
-    void MergeNodes(const std::shared_ptr<Node>& Parent, int LeftIndex, int RightIndex) {
-        auto LeftNode = Parent->Children[LeftIndex];
-        auto RightNode = Parent->Children[RightIndex];
-        if (LeftNode->IsLeaf) {
-            LeftNode->Keys.insert(LeftNode->Keys.end(), RightNode->Keys.begin(), RightNode->Keys.end());
-            LeftNode->Values.insert(LeftNode->Values.end(), RightNode->Values.begin(), RightNode->Values.end());
-            LeftNode->Next = RightNode->Next;
+    // Index of the first key greater than KeyValue
+    size_t UpperBound(const NodeBase &Node, const Key &KeyValue) const {
+        if constexpr(SimdKeys) {
+            return SimdUpperBound(Node.Keys.data(), Node.Count, KeyValue);
+        } else if constexpr(PrefixKeys) {
+            uint64_t Prefix = KeyPrefix(KeyValue);
+            size_t Low = SimdLowerBound(Node.Prefixes.data(), Node.Count, Prefix);
+            size_t High = SimdUpperBound(Node.Prefixes.data(), Node.Count, Prefix);
+            return std::upper_bound(Node.Keys.begin() + Low, Node.Keys.begin() + High, KeyValue, Compare_) - Node.Keys.begin();
         } else {
-            LeftNode->Keys.push_back(Parent->Keys[LeftIndex]);
-            LeftNode->Keys.insert(LeftNode->Keys.end(), RightNode->Keys.begin(), RightNode->Keys.end());
-            LeftNode->Children.insert(LeftNode->Children.end(), RightNode->Children.begin(), RightNode->Children.end());
+            return std::upper_bound(Node.Keys.begin(), Node.Keys.begin() + Node.Count, KeyValue, Compare_) - Node.Keys.begin();
         }
-        Parent->Keys.erase(Parent->Keys.begin() + LeftIndex);
-        Parent->Children.erase(Parent->Children.begin() + RightIndex);
     }
 
-    bool DeleteHelper(const std::shared_ptr<Node>& CurrentNode, const Key& KeyValue, bool IsRoot, bool& Deleted) {
-        if (CurrentNode->IsLeaf) {
-            auto It = std::lower_bound(CurrentNode->Keys.begin(), CurrentNode->Keys.end(), KeyValue, Compare_);
-            if(It == CurrentNode->Keys.end() || (*It != KeyValue))
-            {
-                Deleted = false;
-                return false;
+    // Leaf and slot of the first entry not less than KeyValue; the slot may be past the last leaf's end
+    std::pair<const Leaf*, size_t> SeekFirst(const Key &KeyValue) const {
+        const NodeBase *Node = Root_;
+        while(!Node->IsLeaf)
+            Node = AsInner(Node)->Children[LowerBound(*Node, KeyValue)];
+        const Leaf *Current = AsLeaf(Node);
+        size_t Index = LowerBound(*Current, KeyValue);
+        // Separators may equal keys that live further right, so the first match can start the next leaf
+        while(Index == Current->Count && Current->Next) {
+            Current = Current->Next;
+            Index = LowerBound(*Current, KeyValue);
+        }
+        return {Current, Index};
+    }
+
+    const Value *FindValue(const Key &KeyValue) const {
+        auto [Current, Index] = SeekFirst(KeyValue);
+        if(Index < Current->Count && Equivalent(Current->Keys[Index], KeyValue))
+            return &Current->Values[Index];
+        return nullptr;
+    }
+
+    const Leaf *FirstLeaf() const {
+        const NodeBase *Node = Root_;
+        while(!Node->IsLeaf) Node = AsInner(Node)->Children[0];
+        return AsLeaf(Node);
+    }
+
+    std::optional<Split> InsertInternal(NodeBase *Node, const Key &KeyValue, Value &&Val) {
+        if(Node->IsLeaf) {
+            Leaf *Current = AsLeaf(Node);
+            size_t Index = LowerBound(*Current, KeyValue);
+            ShiftKeys(*Current, Index, 1);
+            for(size_t i = Current->Count; i > Index; --i) Current->Values[i] = std::move(Current->Values[i - 1]);
+            SetKey(*Current, Index, KeyValue);
+            Current->Values[Index] = std::move(Val);
+            if(++Current->Count <= MaxKeys) return std::nullopt;
+            size_t Mid = Current->Count / 2;
+            Leaf *NewLeaf = Leaves_.Create();
+            for(size_t i = Mid; i < Current->Count; ++i) {
+                MoveKey(*NewLeaf, i - Mid, *Current, i);
+                NewLeaf->Values[i - Mid] = std::move(Current->Values[i]);
             }
-            size_t Index = It - CurrentNode->Keys.begin();
-            CurrentNode->Keys.erase(It);
-            CurrentNode->Values.erase(CurrentNode->Values.begin() + Index);
-            Deleted = true;
-            if(!IsRoot && CurrentNode->Keys.size() < MinKeys)
-                return true;
-            return false;
+            NewLeaf->Count = static_cast<uint16_t>(Current->Count - Mid);
+            Current->Count = static_cast<uint16_t>(Mid);
+            NewLeaf->Next = Current->Next;
+            Current->Next = NewLeaf;
+            return Split{NewLeaf->Keys[0], NewLeaf};
+        }
+        Inner *Current = AsInner(Node);
+        size_t ChildIndex = UpperBound(*Current, KeyValue);
+        auto Result = InsertInternal(Current->Children[ChildIndex], KeyValue, std::move(Val));
+        if(!Result) return std::nullopt;
+        ShiftKeys(*Current, ChildIndex, 1);
+        for(size_t i = Current->Count + 1; i > ChildIndex + 1; --i) Current->Children[i] = Current->Children[i - 1];
+        SetKey(*Current, ChildIndex, std::move(Result->Separator));
+        Current->Children[ChildIndex + 1] = Result->Right;
+        if(++Current->Count <= MaxKeys) return std::nullopt;
+        size_t Mid = Current->Count / 2;
+        Inner *NewInner = Inners_.Create();
+        Key Promote = std::move(Current->Keys[Mid]);
+        for(size_t i = Mid + 1; i < Current->Count; ++i)
+            MoveKey(*NewInner, i - Mid - 1, *Current, i);
+        for(size_t i = Mid + 1; i <= Current->Count; ++i)
+            NewInner->Children[i - Mid - 1] = Current->Children[i];
+        NewInner->Count = static_cast<uint16_t>(Current->Count - Mid - 1);
+        Current->Count = static_cast<uint16_t>(Mid);
+        return Split{std::move(Promote), NewInner};
+    }
+
+    void BorrowFromLeft(Inner *Parent, size_t ChildIndex) {
+        NodeBase *Child = Parent->Children[ChildIndex];
+        NodeBase *LeftSibling = Parent->Children[ChildIndex - 1];
+        ShiftKeys(*Child, 0, 1);
+        if(Child->IsLeaf) {
+            Leaf *ChildLeaf = AsLeaf(Child);
+            Leaf *LeftLeaf = AsLeaf(LeftSibling);
+            for(size_t i = ChildLeaf->Count; i > 0; --i) ChildLeaf->Values[i] = std::move(ChildLeaf->Values[i - 1]);
+            MoveKey(*ChildLeaf, 0, *LeftLeaf, LeftLeaf->Count - 1);
+            ChildLeaf->Values[0] = std::move(LeftLeaf->Values[LeftLeaf->Count - 1]);
+            SetKey(*Parent, ChildIndex - 1, ChildLeaf->Keys[0]);
         } else {
-            int ChildIndex = 0;
-            while (ChildIndex < static_cast<int>(CurrentNode->Keys.size()) && KeyValue >= CurrentNode->Keys[ChildIndex])
-                ++ChildIndex;
-            bool ChildUnderflow = DeleteHelper(CurrentNode->Children[ChildIndex], KeyValue, false, Deleted);
-            if(!Deleted)
-                return false;
-            if(ChildUnderflow) {
-                if(ChildIndex > 0 && CurrentNode->Children[ChildIndex - 1]->Keys.size() > MinKeys) {
-                    BorrowFromLeft(CurrentNode, ChildIndex);
-                    ChildUnderflow = false;
-                }
-                else if(ChildIndex < static_cast<int>(CurrentNode->Children.size()) - 1 &&
-                         CurrentNode->Children[ChildIndex + 1]->Keys.size() > MinKeys) {
-                    BorrowFromRight(CurrentNode, ChildIndex);
-                    ChildUnderflow = false;
-                } else {
-                    if(ChildIndex > 0)
-                        MergeNodes(CurrentNode, ChildIndex - 1, ChildIndex);
-                    else
-                        MergeNodes(CurrentNode, ChildIndex, ChildIndex + 1);
-                }
+            Inner *ChildInner = AsInner(Child);
+            Inner *LeftInner = AsInner(LeftSibling);
+            for(size_t i = ChildInner->Count + 1; i > 0; --i) ChildInner->Children[i] = ChildInner->Children[i - 1];
+            MoveKey(*ChildInner, 0, *Parent, ChildIndex - 1);
+            ChildInner->Children[0] = LeftInner->Children[LeftInner->Count];
+            MoveKey(*Parent, ChildIndex - 1, *LeftInner, LeftInner->Count - 1);
+        }
+        ++Child->Count;
+        --LeftSibling->Count;
+    }
+
+    void BorrowFromRight(Inner *Parent, size_t ChildIndex) {
+        NodeBase *Child = Parent->Children[ChildIndex];
+        NodeBase *RightSibling = Parent->Children[ChildIndex + 1];
+        if(Child->IsLeaf) {
+            Leaf *ChildLeaf = AsLeaf(Child);
+            Leaf *RightLeaf = AsLeaf(RightSibling);
+            MoveKey(*ChildLeaf, ChildLeaf->Count, *RightLeaf, 0);
+            ChildLeaf->Values[ChildLeaf->Count] = std::move(RightLeaf->Values[0]);
+            ShiftKeys(*RightLeaf, 0, -1);
+            for(size_t i = 0; i + 1 < RightLeaf->Count; ++i) RightLeaf->Values[i] = std::move(RightLeaf->Values[i + 1]);
+            --RightLeaf->Count;
+            SetKey(*Parent, ChildIndex, RightLeaf->Keys[0]);
+        } else {
+            Inner *ChildInner = AsInner(Child);
+            Inner *RightInner = AsInner(RightSibling);
+            MoveKey(*ChildInner, ChildInner->Count, *Parent, ChildIndex);
+            ChildInner->Children[ChildInner->Count + 1] = RightInner->Children[0];
+            MoveKey(*Parent, ChildIndex, *RightInner, 0);
+            ShiftKeys(*RightInner, 0, -1);
+            for(size_t i = 0; i < RightInner->Count; ++i) RightInner->Children[i] = RightInner->Children[i + 1];
+            --RightInner->Count;
+        }
+        ++Child->Count;
+    }
+
+    // Folds Children[LeftIndex + 1] into Children[LeftIndex] and drops their separator
+    void MergeNodes(Inner *Parent, size_t LeftIndex) {
+        NodeBase *LeftNode = Parent->Children[LeftIndex];
+        NodeBase *RightNode = Parent->Children[LeftIndex + 1];
+        if(LeftNode->IsLeaf) {
+            Leaf *LeftLeaf = AsLeaf(LeftNode);
+            Leaf *RightLeaf = AsLeaf(RightNode);
+            for(size_t i = 0; i < RightLeaf->Count; ++i) {
+                MoveKey(*LeftLeaf, LeftLeaf->Count + i, *RightLeaf, i);
+                LeftLeaf->Values[LeftLeaf->Count + i] = std::move(RightLeaf->Values[i]);
             }
-            if(!IsRoot && CurrentNode->Keys.size() < MinKeys)
-                return true;
-            return false;
+            LeftLeaf->Count += RightLeaf->Count;
+            LeftLeaf->Next = RightLeaf->Next;
+            Leaves_.Destroy(RightLeaf);
+        } else {
+            Inner *LeftInner = AsInner(LeftNode);
+            Inner *RightInner = AsInner(RightNode);
+            MoveKey(*LeftInner, LeftInner->Count, *Parent, LeftIndex);
+            for(size_t i = 0; i < RightInner->Count; ++i)
+                MoveKey(*LeftInner, LeftInner->Count + 1 + i, *RightInner, i);
+            for(size_t i = 0; i <= RightInner->Count; ++i)
+                LeftInner->Children[LeftInner->Count + 1 + i] = RightInner->Children[i];
+            LeftInner->Count += RightInner->Count + 1;
+            Inners_.Destroy(RightInner);
         }
+        ShiftKeys(*Parent, LeftIndex, -1);
+        for(size_t i = LeftIndex + 1; i < Parent->Count; ++i) Parent->Children[i] = Parent->Children[i + 1];
+        --Parent->Count;
+    }
+
+    void Rebalance(Inner *Parent, size_t ChildIndex) {
+        if(ChildIndex > 0 && Parent->Children[ChildIndex - 1]->Count > MinKeys)
+            BorrowFromLeft(Parent, ChildIndex);
+        else if(ChildIndex < Parent->Count && Parent->Children[ChildIndex + 1]->Count > MinKeys)
+            BorrowFromRight(Parent, ChildIndex);
+        else if(ChildIndex > 0)
+            MergeNodes(Parent, ChildIndex - 1);
+        else
+            MergeNodes(Parent, ChildIndex);
+    }
+
+    // Removes one entry equal to KeyValue below Node; Underflow reports whether Node dropped below MinKeys
+    bool DeleteHelper(NodeBase *Node, const Key &KeyValue, bool &Underflow) {
+        if(Node->IsLeaf) {
+            Leaf *Current = AsLeaf(Node);
+            size_t Index = LowerBound(*Current, KeyValue);
+            if(Index == Current->Count || !Equivalent(Current->Keys[Index], KeyValue))
+                return false;
+            ShiftKeys(*Current, Index, -1);
+            for(size_t i = Index; i + 1 < Current->Count; ++i) Current->Values[i] = std::move(Current->Values[i + 1]);
+            --Current->Count;
+            Underflow = Current->Count < MinKeys;
+            return true;
+        }
+        Inner *Current = AsInner(Node);
+        // Duplicates can straddle separators, so every child that may hold the key is tried in order
+        size_t First = LowerBound(*Current, KeyValue);
+        size_t Last = UpperBound(*Current, KeyValue);
+        for(size_t ChildIndex = First; ChildIndex <= Last; ++ChildIndex) {
+            bool ChildUnderflow = false;
+            if(!DeleteHelper(Current->Children[ChildIndex], KeyValue, ChildUnderflow))
+                continue;
+            if(ChildUnderflow) Rebalance(Current, ChildIndex);
+            Underflow = Current->Count < MinKeys;
+            return true;
+        }
+        return false;
+    }
+
+    void DestroyNode(NodeBase *Node) {
+        if(!Node) return;
+        if(Node->IsLeaf) {
+            Leaves_.Destroy(AsLeaf(Node));
+            return;
+        }
+        Inner *Current = AsInner(Node);
+        for(size_t i = 0; i <= Current->Count; ++i) DestroyNode(Current->Children[i]);
+        Inners_.Destroy(Current);
     }
 
 public:
-    BPlusTree() { Root = std::make_shared<Node>(true); }
+    BPlusTree() { Root_ = Leaves_.Create(); }
+    ~BPlusTree() { DestroyNode(Root_); }
 
-    void Insert(const Key& KeyValue, Value Val) {
-        auto InsertResult = InsertInternal(Root, KeyValue, std::move(Val));
-        if(InsertResult.has_value()) {
-            auto NewRoot = std::make_shared<Node>(false);
-            NewRoot->Keys.push_back(InsertResult->first);
-            NewRoot->Children.push_back(Root);
-            NewRoot->Children.push_back(InsertResult->second);
-            Root = NewRoot;
+    BPlusTree(const BPlusTree&) = delete;
+    BPlusTree &operator=(const BPlusTree&) = delete;
+
+    BPlusTree(BPlusTree &&Other) noexcept
+        : Compare_(std::move(Other.Compare_)), Leaves_(std::move(Other.Leaves_)), Inners_(std::move(Other.Inners_)),
+          Root_(std::exchange(Other.Root_, nullptr)), Size_(std::exchange(Other.Size_, 0)) {
+        Other.Root_ = Other.Leaves_.Create();
+    }
+
+    BPlusTree &operator=(BPlusTree &&Other) noexcept {
+        if(this != &Other) {
+            DestroyNode(Root_);
+            Compare_ = std::move(Other.Compare_);
+            Leaves_ = std::move(Other.Leaves_);
+            Inners_ = std::move(Other.Inners_);
+            Root_ = std::exchange(Other.Root_, nullptr);
+            Size_ = std::exchange(Other.Size_, 0);
+            Other.Root_ = Other.Leaves_.Create();
         }
+        return *this;
     }
 
-    std::optional<std::pair<Key, std::shared_ptr<Node>>>
-    InsertInternal(const std::shared_ptr<Node>& CurrentNode, const Key& KeyValue, Value Val) {
-        if (CurrentNode->IsLeaf) {
-            auto It = std::lower_bound(CurrentNode->Keys.begin(), CurrentNode->Keys.end(), KeyValue, Compare_);
-            size_t Index = It - CurrentNode->Keys.begin();
-            CurrentNode->Keys.insert(It, KeyValue);
-            CurrentNode->Values.insert(CurrentNode->Values.begin() + Index, std::move(Val));
-            if (CurrentNode->Keys.size() > Order) {
-                size_t Mid = CurrentNode->Keys.size() / 2;
-                auto NewLeaf = std::make_shared<Node>(true);
-                NewLeaf->Keys.assign(CurrentNode->Keys.begin() + Mid, CurrentNode->Keys.end());
-                NewLeaf->Values.assign(
-                    std::make_move_iterator(CurrentNode->Values.begin() + Mid),
-                    std::make_move_iterator(CurrentNode->Values.end())
-                );
-                CurrentNode->Values.erase(CurrentNode->Values.begin() + Mid, CurrentNode->Values.end());
-                CurrentNode->Keys.erase(CurrentNode->Keys.begin() + Mid, CurrentNode->Keys.end());
-                NewLeaf->Next = CurrentNode->Next;
-                CurrentNode->Next = NewLeaf;
-                return std::make_optional(std::make_pair(NewLeaf->Keys.front(), NewLeaf));
+    /* Replaces the contents with Entries, which must already be sorted by key. Leaves are packed
+    bottom-up and each inner level is built from the first keys of the level below, so no node is
+    ever split.*/
+    void BulkLoad(std::vector<std::pair<Key, Value>> &&Entries) {
+        DestroyNode(Root_);
+        Root_ = nullptr;
+        Size_ = Entries.size();
+        if(Entries.empty()) {
+            Root_ = Leaves_.Create();
+            return;
+        }
+        // Spreading entries evenly keeps every node at least half full
+        std::vector<std::pair<NodeBase*, Key>> Level;
+        size_t LeafCount = (Entries.size() + MaxKeys - 1) / MaxKeys;
+        Leaf *Previous = nullptr;
+        for(size_t i = 0, Offset = 0; i < LeafCount; ++i) {
+            size_t End = Entries.size() * (i + 1) / LeafCount;
+            Leaf *Current = Leaves_.Create();
+            for(size_t j = Offset; j < End; ++j) {
+                SetKey(*Current, j - Offset, std::move(Entries[j].first));
+                Current->Values[j - Offset] = std::move(Entries[j].second);
             }
-            return std::nullopt;
-        } else {
-            size_t Index = std::upper_bound(CurrentNode->Keys.begin(), CurrentNode->Keys.end(), KeyValue, Compare_) - CurrentNode->Keys.begin();
-            auto Child = CurrentNode->Children[Index];
-            auto Result = InsertInternal(Child, KeyValue, std::move(Val));
-            if (Result.has_value()) {
-                Key PromoteKey = Result->first;
-                auto NewChild = Result->second;
-                auto It = std::upper_bound(CurrentNode->Keys.begin(), CurrentNode->Keys.end(), PromoteKey, Compare_);
-                size_t Pos = It - CurrentNode->Keys.begin();
-                CurrentNode->Keys.insert(It, PromoteKey);
-                CurrentNode->Children.insert(CurrentNode->Children.begin() + Pos + 1, NewChild);
-                if(CurrentNode->Keys.size() > Order) {
-                    size_t Mid = CurrentNode->Keys.size() / 2;
-                    Key NewPromoteKey = CurrentNode->Keys[Mid];
-                    auto NewInternal = std::make_shared<Node>(false);
-                    NewInternal->Keys.assign(CurrentNode->Keys.begin() + Mid + 1, CurrentNode->Keys.end());
-                    NewInternal->Children.assign(CurrentNode->Children.begin() + Mid + 1, CurrentNode->Children.end());
-                    CurrentNode->Keys.erase(CurrentNode->Keys.begin() + Mid, CurrentNode->Keys.end());
-                    CurrentNode->Children.erase(CurrentNode->Children.begin() + Mid + 1, CurrentNode->Children.end());
-                    return std::make_optional(std::make_pair(NewPromoteKey, NewInternal));
+            Current->Count = static_cast<uint16_t>(End - Offset);
+            if(Previous) Previous->Next = Current;
+            Previous = Current;
+            Level.emplace_back(Current, Current->Keys[0]);
+            Offset = End;
+        }
+        while(Level.size() > 1) {
+            std::vector<std::pair<NodeBase*, Key>> Parents;
+            size_t ParentCount = (Level.size() + MaxKeys) / (MaxKeys + 1);
+            for(size_t i = 0, Offset = 0; i < ParentCount; ++i) {
+                size_t End = Level.size() * (i + 1) / ParentCount;
+                Inner *Current = Inners_.Create();
+                Current->Children[0] = Level[Offset].first;
+                for(size_t j = Offset + 1; j < End; ++j) {
+                    SetKey(*Current, j - Offset - 1, Level[j].second);
+                    Current->Children[j - Offset] = Level[j].first;
                 }
+                Current->Count = static_cast<uint16_t>(End - Offset - 1);
+                Parents.emplace_back(Current, std::move(Level[Offset].second));
+                Offset = End;
             }
-            return std::nullopt;
+            Level = std::move(Parents);
         }
+        Root_ = Level.front().first;
+        Entries.clear();
     }
 
-    bool Search(const Key& KeyValue, Value& OutValue) const {
-        auto CurrentNode = Root;
-        while(!CurrentNode->IsLeaf) {
-            size_t Index = std::upper_bound(CurrentNode->Keys.begin(), CurrentNode->Keys.end(), KeyValue, Compare_) - CurrentNode->Keys.begin();
-            CurrentNode = CurrentNode->Children[Index];
+    void Insert(const Key& KeyValue, Value Val) {
+        auto InsertResult = InsertInternal(Root_, KeyValue, std::move(Val));
+        ++Size_;
+        if(InsertResult.has_value()) {
+            Inner *NewRoot = Inners_.Create();
+            SetKey(*NewRoot, 0, std::move(InsertResult->Separator));
+            NewRoot->Children[0] = Root_;
+            NewRoot->Children[1] = InsertResult->Right;
+            NewRoot->Count = 1;
+            Root_ = NewRoot;
         }
-        auto It = std::lower_bound(CurrentNode->Keys.begin(), CurrentNode->Keys.end(), KeyValue, Compare_);
-        if(It != CurrentNode->Keys.end() && *It == KeyValue) {
-            size_t Index = It - CurrentNode->Keys.begin();
-            OutValue = CurrentNode->Values[Index];
+    }
+
+    bool Search(const Key& KeyValue, Value& OutValue) const {
+        if(const Value *Found = FindValue(KeyValue)) {
+            OutValue = *Found;
             return true;
         }
         return false;
     }
 
     bool Update(const Key& KeyValue, const Value& NewValue) {
-        auto CurrentNode = Root;
-        while(!CurrentNode->IsLeaf) {
-            size_t Index = std::upper_bound(CurrentNode->Keys.begin(), CurrentNode->Keys.end(), KeyValue, Compare_) - CurrentNode->Keys.begin();
-            CurrentNode = CurrentNode->Children[Index];
-        }
-        auto It = std::lower_bound(CurrentNode->Keys.begin(), CurrentNode->Keys.end(), KeyValue, Compare_);
-        if(It != CurrentNode->Keys.end() && *It == KeyValue) {
-            size_t Index = It - CurrentNode->Keys.begin();
-            CurrentNode->Values[Index] = NewValue;
+        if(Value *Found = GetPointer(KeyValue)) {
+            *Found = NewValue;
             return true;
         }
         return false;
     }
 
     bool Delete(const Key& KeyValue) {
-        bool Deleted = false;
-        bool Underflow = DeleteHelper(Root, KeyValue, true, Deleted);
-        if(!Root->IsLeaf && Root->Children.size() == 1)
-            Root = Root->Children.front();
-        // Use Underflow to indicate if the root became empty (after deletion)
-        if(Underflow && Root->IsLeaf && Root->Keys.empty())
-            Root = std::make_shared<Node>(true);
-        return Deleted;
+        bool Underflow = false;
+        if(!DeleteHelper(Root_, KeyValue, Underflow))
+            return false;
+        --Size_;
+        if(!Root_->IsLeaf && Root_->Count == 0) {
+            Inner *OldRoot = AsInner(Root_);
+            Root_ = OldRoot->Children[0];
+            Inners_.Destroy(OldRoot);
+        }
+        return true;
     }
 
-    std::vector<Value> RangeSearch(const Key& LowerBound, const Key& UpperBound) const {
+    std::vector<Value> RangeSearch(const Key& LowerBoundKey, const Key& UpperBoundKey) const {
         std::vector<Value> Results;
-        auto CurrentNode = Root;
-        while(!CurrentNode->IsLeaf) {
-            size_t Index = std::upper_bound(CurrentNode->Keys.begin(), CurrentNode->Keys.end(), LowerBound, Compare_) - CurrentNode->Keys.begin();
-            CurrentNode = CurrentNode->Children[Index];
-        }
-        while(CurrentNode) {
-            for (size_t i = 0; i < CurrentNode->Keys.size(); ++i) {
-                if (!Compare_(CurrentNode->Keys[i], LowerBound) && !Compare_(UpperBound, CurrentNode->Keys[i]))
-                    Results.push_back(CurrentNode->Values[i]);
-                else if (Compare_(UpperBound, CurrentNode->Keys[i]))
+        auto [Current, Index] = SeekFirst(LowerBoundKey);
+        for(; Current; Current = Current->Next, Index = 0) {
+            for(; Index < Current->Count; ++Index) {
+                if(Compare_(UpperBoundKey, Current->Keys[Index]))
                     return Results;
+                Results.push_back(Current->Values[Index]);
             }
-            CurrentNode = CurrentNode->Next;
         }
         return Results;
     }
 
+    // Calls F(Key, Value) in key order from the first key not less than LowerBoundKey until F returns false
+    template<typename Func> void ForEachFrom(const Key &LowerBoundKey, Func &&F) const {
+        auto [Current, Index] = SeekFirst(LowerBoundKey);
+        for(; Current; Current = Current->Next, Index = 0)
+            for(; Index < Current->Count; ++Index)
+                if(!F(Current->Keys[Index], Current->Values[Index])) return;
+    }
+
+    // Calls F(Key, Value) for every entry in key order
+    template<typename Func> void ForEach(Func &&F) const {
+        for(const Leaf *Current = FirstLeaf(); Current; Current = Current->Next)
+            for(size_t i = 0; i < Current->Count; ++i)
+                F(Current->Keys[i], Current->Values[i]);
+    }
+
     std::vector<Key> GetAllKeys() const {
         std::vector<Key> KeysOut;
-        auto CurrentNode = Root;
-        while(!CurrentNode->IsLeaf)
-            CurrentNode = CurrentNode->Children.front();
-        while(CurrentNode) {
-            KeysOut.insert(KeysOut.end(), CurrentNode->Keys.begin(), CurrentNode->Keys.end());
-            CurrentNode = CurrentNode->Next;
-        }
+        KeysOut.reserve(Size_);
+        for(const Leaf *Current = FirstLeaf(); Current; Current = Current->Next)
+            KeysOut.insert(KeysOut.end(), Current->Keys.begin(), Current->Keys.begin() + Current->Count);
         return KeysOut;
     }
 
-    bool Contains(const Key& KeyValue) const {
-        Value Dummy;
-        return Search(KeyValue, Dummy);
-    }
+    bool Contains(const Key& KeyValue) const { return FindValue(KeyValue) != nullptr; }
+
+    // Value of the first entry equal to KeyValue without copying it out
+    const Value *Find(const Key& KeyValue) const { return FindValue(KeyValue); }
 
-    std::shared_ptr<Node> GetRoot() const { return Root; }
+    size_t Size() const { return Size_; }
+    bool Empty() const { return Size_ == 0; }
+
+    const NodeBase *GetRoot() const { return Root_; }
 
     void Remove(const Key& KeyValue) { Delete(KeyValue); }
 
-    Value* GetPointer(const Key& KeyValue) {
-        auto CurrentNode = Root;
-        while(!CurrentNode->IsLeaf) {
-            size_t Index = std::upper_bound(CurrentNode->Keys.begin(), CurrentNode->Keys.end(), KeyValue, Compare_) - CurrentNode->Keys.begin();
-            CurrentNode = CurrentNode->Children[Index];
-        }
-        auto It = std::lower_bound(CurrentNode->Keys.begin(), CurrentNode->Keys.end(), KeyValue, Compare_);
-        if(It != CurrentNode->Keys.end() && *It == KeyValue) {
-            size_t Index = It - CurrentNode->Keys.begin();
-            return &CurrentNode->Values[Index];
-        }
-        return nullptr;
-    }
+    Value* GetPointer(const Key& KeyValue) { return const_cast<Value*>(FindValue(KeyValue)); }
 };
 } // namespace AstralDB
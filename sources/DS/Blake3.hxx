@@ -1,31 +1,64 @@
 #pragma once
 
 #include <IO/Task.hxx>
-#include <IO/SIMD.hxx>
-#include <vector>
+#include <algorithm>
 #include <array>
-#include <future>
+#include <cstdint>
 #include <cstring>
+#include <future>
+#include <span>
+#include <string_view>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace AstralDB {
+/* BLAKE3. Input is cut into 1 KiB chunks of 64-byte blocks; each chunk is compressed into a chaining
+value, and those are merged pairwise up a binary tree whose left subtrees are always complete. The root
+node is compressed once more with the ROOT flag, which also gives any output length.
+
+Independent chunks and parents are compressed several at once: 8 with AVX2, 4 with SSE2, otherwise 1.
+Each vector holds one state word of every input, as in XChaCha20. Hash over a large buffer computes the
+chunk values on every core and then folds the tree a level at a time; Hasher takes input in pieces and
+keeps the left edge of the tree on a stack.*/
 namespace Blake3 {
-template<class T> T Rotate(T V, int C) {
-    return (V << C) | (V >> (sizeof(T) * 8 - C));
-}
+using Digest = std::array<uint8_t, 32>;
+
+inline constexpr size_t KeySize = 32;
+inline constexpr size_t BlockSize = 64;
+inline constexpr size_t ChunkSize = 1024;
+// Buffers from this size on are hashed on every core
+inline constexpr size_t ParallelMinimum = 1 << 22;
+
+enum Flag : uint8_t {
+	ChunkStart = 1 << 0,
+	ChunkEnd = 1 << 1,
+	Parent = 1 << 2,
+	Root = 1 << 3,
+	Keyed = 1 << 4,
+	DeriveKeyContext = 1 << 5,
+	DeriveKeyMaterial = 1 << 6
+};
 
 // BLAKE3 IV (from SHA-256 IV)
-static constexpr std::array<uint32_t, 8> IV = {
+inline constexpr std::array<uint32_t, 8> IV = {
 	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
 	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
 };
 
-inline void Prefetch(const void* Pointer) {
-#if defined(__GNUC__)
-	__builtin_prefetch(Pointer);
-#endif
-	(void)Pointer;
-    return;
-}
+// Message words used by each round, the fixed permutation applied round after round
+inline constexpr uint8_t Schedule[7][16] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,10,11,12,13,14,15 },
+	{ 2, 6, 3,10, 7, 0, 4,13, 1,11,12, 5, 9,14,15, 8 },
+	{ 3, 4,10,12,13, 2, 7,14, 6, 5, 9, 0,11,15, 8, 1 },
+	{10, 7,12, 9,14, 3,13,15, 4, 0,11, 2, 5, 8, 1, 6 },
+	{12,13, 9,11,15,10,14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+	{ 9,14,11, 5, 8,12,15, 1,13, 3, 0,10, 2, 6, 4, 7 },
+	{11,15, 5, 0, 1, 9, 8, 6,14,10, 2,12, 3, 4, 7,13 }
+};
 
 inline uint32_t Load32LE(const uint8_t* Src) {
 	return (uint32_t(Src[0])      ) |
@@ -41,6 +74,10 @@ inline void Store32LE(uint8_t* Dst, uint32_t V) {
 	Dst[3] = (V >> 24) & 0xFF;
 }
 
+inline uint32_t Rotate(uint32_t V, int C) {
+	return (V >> C) | (V << (32 - C));
+}
+
 inline void G(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d, uint32_t x, uint32_t y) {
 	a = a + b + x;
 	d = Rotate(d ^ a, 16);
@@ -52,26 +89,17 @@ inline void G(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d, uint32_t x, ui
 	b = Rotate(b ^ c, 7);
 }
 
-inline void Compress(const uint32_t* ChainingValue, const uint8_t* Block, uint64_t Counter, uint32_t Flags, uint32_t Out[8]) {
-	// Minimal BLAKE3 compression for a single 64-byte block
-	static constexpr uint32_t MSG_SCHEDULE[7][16] = {
-		{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,10,11,12,13,14,15 },
-		{ 2, 6, 3,10, 7, 0, 4,13, 1,11,12, 5, 9,14,15, 8 },
-		{ 3, 4,10,12,13, 2, 7,14, 6, 5, 9, 0,11,15, 8, 1 },
-		{10, 7,12, 9,14, 3,13,15, 4, 0,11, 6, 5, 8, 1, 2 },
-		{12,13, 9,11,15,10,14, 8, 7, 6, 5, 3, 0, 1, 2, 4 },
-		{ 9,15,11, 5, 8,12, 1, 2, 3, 7, 6,10,13,14, 4, 0 },
-		{11, 8, 5, 0, 2, 9, 3, 4,10, 6, 7,12,14,15, 1,13 }
+// Compresses one block into the full 16-word state; the first 8 words are the new chaining value
+inline void Compress(const uint32_t ChainingValue[8], const uint8_t Block[BlockSize], uint32_t BlockLength, uint64_t Counter, uint32_t Flags, uint32_t Out[16]) {
+	uint32_t State[16] = {
+		ChainingValue[0], ChainingValue[1], ChainingValue[2], ChainingValue[3],
+		ChainingValue[4], ChainingValue[5], ChainingValue[6], ChainingValue[7],
+		IV[0], IV[1], IV[2], IV[3],
+		static_cast<uint32_t>(Counter), static_cast<uint32_t>(Counter >> 32), BlockLength, Flags
 	};
-	uint32_t State[16];
-	for(int i = 0; i < 8; ++i) State[i] = ChainingValue[i];
-	for(int i = 0; i < 8; ++i) State[8 + i] = IV[i];
-	State[12] ^= (uint32_t)Counter;
-	State[14] ^= Flags;
 	uint32_t M[16];
 	for(int i = 0; i < 16; ++i) M[i] = Load32LE(Block + i * 4);
-	for(int round = 0; round < 7; ++round) {
-		const uint32_t* S = MSG_SCHEDULE[round];
+	for(const auto &S : Schedule) {
 		G(State[0], State[4], State[8], State[12], M[S[0]], M[S[1]]);
 		G(State[1], State[5], State[9], State[13], M[S[2]], M[S[3]]);
 		G(State[2], State[6], State[10], State[14], M[S[4]], M[S[5]]);
@@ -81,30 +109,474 @@ inline void Compress(const uint32_t* ChainingValue, const uint8_t* Block, uint64
 		G(State[2], State[7], State[8], State[13], M[S[12]], M[S[13]]);
 		G(State[3], State[4], State[9], State[14], M[S[14]], M[S[15]]);
 	}
-	for(int i = 0; i < 8; ++i) Out[i] = State[i] ^ State[i + 8];
+	for(int i = 0; i < 8; ++i) {
+		Out[i] = State[i] ^ State[i + 8];
+		Out[i + 8] = State[i + 8] ^ ChainingValue[i];
+	}
+}
+
+inline void CompressInPlace(uint32_t ChainingValue[8], const uint8_t Block[BlockSize], uint32_t BlockLength, uint64_t Counter, uint32_t Flags) {
+	uint32_t Out[16];
+	Compress(ChainingValue, Block, BlockLength, Counter, Flags, Out);
+	std::memcpy(ChainingValue, Out, 32);
+}
+
+namespace Detail {
+#if defined(__AVX2__)
+inline constexpr size_t Lanes = 8;
+using Vector = __m256i;
+
+inline Vector Add(Vector A, Vector B) { return _mm256_add_epi32(A, B); }
+inline Vector Xor(Vector A, Vector B) { return _mm256_xor_si256(A, B); }
+inline Vector Set(uint32_t V) { return _mm256_set1_epi32(static_cast<int>(V)); }
+inline Vector Load(const void *Source) { return _mm256_loadu_si256(static_cast<const __m256i*>(Source)); }
+inline void Store(void *Dest, Vector V) { _mm256_storeu_si256(static_cast<__m256i*>(Dest), V); }
+
+template<int C> inline Vector RotateRight(Vector V) {
+	// 16 and 8 bit rotations are byte shuffles
+	if constexpr(C == 16)
+		return _mm256_shuffle_epi8(V, _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+													   2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+	else if constexpr(C == 8)
+		return _mm256_shuffle_epi8(V, _mm256_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+													   1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12));
+	else
+		return _mm256_or_si256(_mm256_srli_epi32(V, C), _mm256_slli_epi32(V, 32 - C));
 }
 
-// Synchronous BLAKE3 hash for std::vector<uint8_t> input, 32-byte output
-inline std::array<uint8_t, 32> Hash(const std::vector<uint8_t>& Input) {
-	Prefetch(Input.data());
-	constexpr uint32_t CHUNK_LEN = 64;
-	constexpr uint32_t CHUNK_START = 1 << 0;
-	constexpr uint32_t CHUNK_END = 1 << 1;
-	constexpr uint32_t ROOT = 1 << 3;
-	uint32_t Flags = CHUNK_START | CHUNK_END | ROOT;
-	uint32_t Out[8] = {};
-	uint8_t Block[CHUNK_LEN] = {};
-	SimdMemset(Block, 0, CHUNK_LEN);
-	SimdMemcpy(Block, Input.data(), std::min<size_t>(Input.size(), CHUNK_LEN));
-	Compress(IV.data(), Block, 0, Flags, Out);
-	std::array<uint8_t, 32> HashOut;
-	for(int i = 0; i < 8; ++i) Store32LE(HashOut.data() + i * 4, Out[i]);
-	return HashOut;
+// Turns 8 rows of 8 words into 8 columns, in place
+inline void Transpose(Vector V[8]) {
+	Vector T[8], U[8];
+	for(int i = 0; i < 8; i += 2) {
+		T[i] = _mm256_unpacklo_epi32(V[i], V[i + 1]);
+		T[i + 1] = _mm256_unpackhi_epi32(V[i], V[i + 1]);
+	}
+	for(int i = 0; i < 8; i += 4) {
+		U[i] = _mm256_unpacklo_epi64(T[i], T[i + 2]);
+		U[i + 1] = _mm256_unpackhi_epi64(T[i], T[i + 2]);
+		U[i + 2] = _mm256_unpacklo_epi64(T[i + 1], T[i + 3]);
+		U[i + 3] = _mm256_unpackhi_epi64(T[i + 1], T[i + 3]);
+	}
+	for(int i = 0; i < 4; ++i) {
+		V[i] = _mm256_permute2x128_si256(U[i], U[i + 4], 0x20);
+		V[i + 4] = _mm256_permute2x128_si256(U[i], U[i + 4], 0x31);
+	}
+}
+
+inline void LoadMessage(const uint8_t *const Inputs[Lanes], size_t Offset, Vector M[16]) {
+	for(int Half = 0; Half < 2; ++Half) {
+		for(size_t i = 0; i < Lanes; ++i) M[8 * Half + i] = Load(Inputs[i] + Offset + 32 * Half);
+		Transpose(M + 8 * Half);
+	}
+}
+
+inline void StoreChainingValues(Vector H[8], uint8_t *Out) {
+	Transpose(H);
+	for(size_t i = 0; i < Lanes; ++i) Store(Out + 32 * i, H[i]);
+}
+#elif defined(__SSE2__)
+inline constexpr size_t Lanes = 4;
+using Vector = __m128i;
+
+inline Vector Add(Vector A, Vector B) { return _mm_add_epi32(A, B); }
+inline Vector Xor(Vector A, Vector B) { return _mm_xor_si128(A, B); }
+inline Vector Set(uint32_t V) { return _mm_set1_epi32(static_cast<int>(V)); }
+inline Vector Load(const void *Source) { return _mm_loadu_si128(static_cast<const __m128i*>(Source)); }
+inline void Store(void *Dest, Vector V) { _mm_storeu_si128(static_cast<__m128i*>(Dest), V); }
+
+template<int C> inline Vector RotateRight(Vector V) {
+	return _mm_or_si128(_mm_srli_epi32(V, C), _mm_slli_epi32(V, 32 - C));
+}
+
+// Turns 4 rows of 4 words into 4 columns, in place
+inline void Transpose(Vector V[4]) {
+	Vector T0 = _mm_unpacklo_epi32(V[0], V[1]), T1 = _mm_unpacklo_epi32(V[2], V[3]);
+	Vector T2 = _mm_unpackhi_epi32(V[0], V[1]), T3 = _mm_unpackhi_epi32(V[2], V[3]);
+	V[0] = _mm_unpacklo_epi64(T0, T1);
+	V[1] = _mm_unpackhi_epi64(T0, T1);
+	V[2] = _mm_unpacklo_epi64(T2, T3);
+	V[3] = _mm_unpackhi_epi64(T2, T3);
+}
+
+inline void LoadMessage(const uint8_t *const Inputs[Lanes], size_t Offset, Vector M[16]) {
+	for(int Quarter = 0; Quarter < 4; ++Quarter) {
+		for(size_t i = 0; i < Lanes; ++i) M[4 * Quarter + i] = Load(Inputs[i] + Offset + 16 * Quarter);
+		Transpose(M + 4 * Quarter);
+	}
+}
+
+inline void StoreChainingValues(Vector H[8], uint8_t *Out) {
+	Transpose(H);
+	Transpose(H + 4);
+	for(size_t i = 0; i < Lanes; ++i) {
+		Store(Out + 32 * i, H[i]);
+		Store(Out + 32 * i + 16, H[i + 4]);
+	}
+}
+#else
+inline constexpr size_t Lanes = 1;
+#endif
+
+#if defined(__SSE2__)
+inline void G(Vector &A, Vector &B, Vector &C, Vector &D, Vector X, Vector Y) {
+	A = Add(Add(A, B), X);
+	D = RotateRight<16>(Xor(D, A));
+	C = Add(C, D);
+	B = RotateRight<12>(Xor(B, C));
+	A = Add(Add(A, B), Y);
+	D = RotateRight<8>(Xor(D, A));
+	C = Add(C, D);
+	B = RotateRight<7>(Xor(B, C));
+}
+
+// Compresses Blocks blocks of Lanes inputs side by side into one chaining value each
+inline void HashLanes(const uint8_t *const Inputs[Lanes], size_t Blocks, const uint32_t Key[8], uint64_t Counter, bool IncrementCounter,
+					  uint8_t Flags, uint8_t FlagsStart, uint8_t FlagsEnd, uint8_t *Out) {
+	alignas(32) uint32_t Low[Lanes], High[Lanes];
+	for(size_t i = 0; i < Lanes; ++i) {
+		uint64_t LaneCounter = Counter + (IncrementCounter ? i : 0);
+		Low[i] = static_cast<uint32_t>(LaneCounter);
+		High[i] = static_cast<uint32_t>(LaneCounter >> 32);
+	}
+	Vector H[8];
+	for(int i = 0; i < 8; ++i) H[i] = Set(Key[i]);
+	for(size_t Block = 0; Block < Blocks; ++Block) {
+		uint32_t BlockFlags = Flags | (Block == 0 ? FlagsStart : 0) | (Block + 1 == Blocks ? FlagsEnd : 0);
+		Vector M[16];
+		LoadMessage(Inputs, Block * BlockSize, M);
+		Vector V[16] = {
+			H[0], H[1], H[2], H[3], H[4], H[5], H[6], H[7],
+			Set(IV[0]), Set(IV[1]), Set(IV[2]), Set(IV[3]),
+			Load(Low), Load(High), Set(BlockSize), Set(BlockFlags)
+		};
+		for(const auto &S : Schedule) {
+			G(V[0], V[4], V[8], V[12], M[S[0]], M[S[1]]);
+			G(V[1], V[5], V[9], V[13], M[S[2]], M[S[3]]);
+			G(V[2], V[6], V[10], V[14], M[S[4]], M[S[5]]);
+			G(V[3], V[7], V[11], V[15], M[S[6]], M[S[7]]);
+			G(V[0], V[5], V[10], V[15], M[S[8]], M[S[9]]);
+			G(V[1], V[6], V[11], V[12], M[S[10]], M[S[11]]);
+			G(V[2], V[7], V[8], V[13], M[S[12]], M[S[13]]);
+			G(V[3], V[4], V[9], V[14], M[S[14]], M[S[15]]);
+		}
+		for(int i = 0; i < 8; ++i) H[i] = Xor(V[i], V[i + 8]);
+	}
+	StoreChainingValues(H, Out);
+}
+#endif
+
+inline void HashOne(const uint8_t *Input, size_t Blocks, const uint32_t Key[8], uint64_t Counter,
+					uint8_t Flags, uint8_t FlagsStart, uint8_t FlagsEnd, uint8_t Out[32]) {
+	uint32_t ChainingValue[8];
+	std::memcpy(ChainingValue, Key, 32);
+	for(size_t Block = 0; Block < Blocks; ++Block) {
+		uint32_t BlockFlags = Flags | (Block == 0 ? FlagsStart : 0) | (Block + 1 == Blocks ? FlagsEnd : 0);
+		CompressInPlace(ChainingValue, Input + Block * BlockSize, BlockSize, Counter, BlockFlags);
+	}
+	for(int i = 0; i < 8; ++i) Store32LE(Out + 4 * i, ChainingValue[i]);
+}
+}
+
+/* Compresses Count inputs of Blocks full blocks each, writing a 32-byte chaining value per input to Out.
+Input i gets counter Counter + i when IncrementCounter is set (chunks) and Counter otherwise (parents).
+A short last batch still goes through the vector path, repeating its last input in the spare lanes.*/
+inline void HashMany(const uint8_t *const *Inputs, size_t Count, size_t Blocks, const uint32_t Key[8], uint64_t Counter, bool IncrementCounter,
+					 uint8_t Flags, uint8_t FlagsStart, uint8_t FlagsEnd, uint8_t *Out) {
+	using namespace Detail;
+#if defined(__SSE2__)
+	for(; Count >= 2; Inputs += Lanes, Out += 32 * Lanes, Counter += IncrementCounter ? Lanes : 0) {
+		if(Count >= Lanes) {
+			HashLanes(Inputs, Blocks, Key, Counter, IncrementCounter, Flags, FlagsStart, FlagsEnd, Out);
+			Count -= Lanes;
+			continue;
+		}
+		const uint8_t *Padded[Lanes];
+		for(size_t i = 0; i < Lanes; ++i) Padded[i] = Inputs[std::min(i, Count - 1)];
+		uint8_t Values[32 * Lanes];
+		HashLanes(Padded, Blocks, Key, Counter, IncrementCounter, Flags, FlagsStart, FlagsEnd, Values);
+		std::memcpy(Out, Values, 32 * Count);
+		return;
+	}
+#endif
+	for(size_t i = 0; i < Count; ++i)
+		HashOne(Inputs[i], Blocks, Key, Counter + (IncrementCounter ? i : 0), Flags, FlagsStart, FlagsEnd, Out + 32 * i);
 }
 
-// Async BLAKE3 hash
-inline std::future<std::array<uint8_t, 32>> HashAsync(const std::vector<uint8_t>& Input) {
-	return RunAsync([Input]() { return Hash(Input); });
+// A node waiting for its final compression: as a chaining value for its parent, or as the root
+struct Output {
+	uint32_t InputChainingValue[8];
+	uint8_t Block[BlockSize];
+	uint32_t BlockLength;
+	uint64_t Counter;
+	uint32_t Flags;
+
+	void ChainingValue(uint32_t Out[8]) const {
+		std::memcpy(Out, InputChainingValue, 32);
+		CompressInPlace(Out, Block, BlockLength, Counter, Flags);
+	}
+
+	// Any length may be read; each 64 bytes of output compresses the root again with the next counter
+	void RootBytes(uint8_t *Out, size_t Length) const {
+		for(uint64_t OutputCounter = 0; Length; ++OutputCounter) {
+			uint32_t Words[16];
+			Compress(InputChainingValue, Block, BlockLength, OutputCounter, Flags | Root, Words);
+			uint8_t Bytes[BlockSize];
+			for(int i = 0; i < 16; ++i) Store32LE(Bytes + 4 * i, Words[i]);
+			size_t Count = std::min(Length, BlockSize);
+			std::memcpy(Out, Bytes, Count);
+			Out += Count;
+			Length -= Count;
+		}
+	}
+};
+
+inline Output ParentOutput(const uint8_t Children[BlockSize], const uint32_t Key[8], uint32_t Flags) {
+	Output Node;
+	std::memcpy(Node.InputChainingValue, Key, 32);
+	std::memcpy(Node.Block, Children, BlockSize);
+	Node.BlockLength = BlockSize;
+	Node.Counter = 0;
+	Node.Flags = Flags | Parent;
+	return Node;
+}
+
+// Compresses one chunk a block at a time; the last block is held back until the chunk is known to end
+class ChunkState {
+	uint32_t ChainingValue_[8];
+	uint64_t Counter_;
+	uint8_t Block_[BlockSize] = {};
+	uint8_t BlockLength_ = 0;
+	uint8_t BlocksCompressed_ = 0;
+	uint32_t Flags_;
+
+	uint32_t StartFlag() const { return BlocksCompressed_ == 0 ? ChunkStart : 0; }
+
+public:
+	ChunkState(const uint32_t Key[8], uint64_t Counter, uint32_t Flags) : Counter_(Counter), Flags_(Flags) {
+		std::memcpy(ChainingValue_, Key, 32);
+	}
+
+	size_t Length() const { return BlockSize * BlocksCompressed_ + BlockLength_; }
+	uint64_t Counter() const { return Counter_; }
+
+	void Update(const uint8_t *Input, size_t Size) {
+		while(Size) {
+			if(BlockLength_ == BlockSize) {
+				CompressInPlace(ChainingValue_, Block_, BlockSize, Counter_, Flags_ | StartFlag());
+				++BlocksCompressed_;
+				std::memset(Block_, 0, BlockSize);
+				BlockLength_ = 0;
+			}
+			size_t Count = std::min(BlockSize - BlockLength_, Size);
+			std::memcpy(Block_ + BlockLength_, Input, Count);
+			BlockLength_ += static_cast<uint8_t>(Count);
+			Input += Count;
+			Size -= Count;
+		}
+	}
+
+	Output Finish() const {
+		Output Node;
+		std::memcpy(Node.InputChainingValue, ChainingValue_, 32);
+		std::memcpy(Node.Block, Block_, BlockSize);
+		Node.BlockLength = BlockLength_;
+		Node.Counter = Counter_;
+		Node.Flags = Flags_ | StartFlag() | ChunkEnd;
+		return Node;
+	}
+};
+
+/* Incremental hashing. A chunk is only finished once more input shows it is not the last one, which
+matters because the last node is the root. Runs of whole chunks that arrive together skip the chunk
+state and go through HashMany. The stack holds the roots of the complete subtrees so far, one per bit
+of the chunk count, so 54 entries cover any input below 2^64 bytes.*/
+class Hasher {
+	uint32_t Key_[8];
+	uint32_t Flags_;
+	ChunkState Chunk_;
+	uint8_t Stack_[54][32];
+	uint8_t StackSize_ = 0;
+
+	Hasher(const uint32_t Key[8], uint32_t Flags) : Flags_(Flags), Chunk_(Key, 0, Flags) {
+		std::memcpy(Key_, Key, 32);
+	}
+
+	// Pushes the value of chunk TotalChunks - 1, merging every subtree it completes first
+	void PushChunk(const uint8_t Value[32], uint64_t TotalChunks) {
+		uint8_t Merged[BlockSize];
+		std::memcpy(Merged + 32, Value, 32);
+		for(; (TotalChunks & 1) == 0; TotalChunks >>= 1) {
+			std::memcpy(Merged, Stack_[--StackSize_], 32);
+			uint32_t Words[8];
+			ParentOutput(Merged, Key_, Flags_).ChainingValue(Words);
+			for(int i = 0; i < 8; ++i) Store32LE(Merged + 32 + 4 * i, Words[i]);
+		}
+		std::memcpy(Stack_[StackSize_++], Merged + 32, 32);
+	}
+
+public:
+	Hasher() : Hasher(IV.data(), 0) {}
+
+	static Hasher Keyed(std::span<const uint8_t, KeySize> Key) {
+		uint32_t Words[8];
+		for(int i = 0; i < 8; ++i) Words[i] = Load32LE(Key.data() + 4 * i);
+		return Hasher(Words, Flag::Keyed);
+	}
+
+	// Keys derived for different purposes differ as long as their context strings do
+	static Hasher DeriveKey(std::string_view Context) {
+		Hasher ContextHasher(IV.data(), DeriveKeyContext);
+		ContextHasher.Update(Context);
+		uint8_t ContextKey[KeySize];
+		ContextHasher.Finalize(ContextKey);
+		uint32_t Words[8];
+		for(int i = 0; i < 8; ++i) Words[i] = Load32LE(ContextKey + 4 * i);
+		return Hasher(Words, DeriveKeyMaterial);
+	}
+
+	Hasher &Update(std::span<const uint8_t> Input) {
+		const uint8_t *Data = Input.data();
+		size_t Size = Input.size();
+		while(Size) {
+			if(Chunk_.Length() == ChunkSize) {
+				Output Node = Chunk_.Finish();
+				uint32_t Words[8];
+				Node.ChainingValue(Words);
+				uint8_t Value[32];
+				for(int i = 0; i < 8; ++i) Store32LE(Value + 4 * i, Words[i]);
+				uint64_t Total = Chunk_.Counter() + 1;
+				PushChunk(Value, Total);
+				Chunk_ = ChunkState(Key_, Total, Flags_);
+			}
+			if(Chunk_.Length() == 0 && Size > ChunkSize) {
+				size_t Count = std::min(Detail::Lanes, (Size - 1) / ChunkSize);
+				const uint8_t *Inputs[Detail::Lanes];
+				for(size_t i = 0; i < Count; ++i) Inputs[i] = Data + i * ChunkSize;
+				uint8_t Values[32 * Detail::Lanes];
+				uint64_t First = Chunk_.Counter();
+				HashMany(Inputs, Count, ChunkSize / BlockSize, Key_, First, true, Flags_, ChunkStart, ChunkEnd, Values);
+				for(size_t i = 0; i < Count; ++i) PushChunk(Values + 32 * i, First + i + 1);
+				Chunk_ = ChunkState(Key_, First + Count, Flags_);
+				Data += Count * ChunkSize;
+				Size -= Count * ChunkSize;
+				continue;
+			}
+			size_t Count = std::min(ChunkSize - Chunk_.Length(), Size);
+			Chunk_.Update(Data, Count);
+			Data += Count;
+			Size -= Count;
+		}
+		return *this;
+	}
+
+	Hasher &Update(std::string_view Input) {
+		return Update(std::span(reinterpret_cast<const uint8_t*>(Input.data()), Input.size()));
+	}
+
+	// Writes Out.size() bytes of output; the hasher is left as it was, so more input may follow
+	void Finalize(std::span<uint8_t> Out) const {
+		Output Node = Chunk_.Finish();
+		uint8_t Children[BlockSize];
+		for(size_t i = StackSize_; i-- > 0;) {
+			uint32_t Words[8];
+			Node.ChainingValue(Words);
+			std::memcpy(Children, Stack_[i], 32);
+			for(int j = 0; j < 8; ++j) Store32LE(Children + 32 + 4 * j, Words[j]);
+			Node = ParentOutput(Children, Key_, Flags_);
+		}
+		Node.RootBytes(Out.data(), Out.size());
+	}
+
+	Digest Finalize() const {
+		Digest Out;
+		Finalize(Out);
+		return Out;
+	}
+};
+
+namespace Detail {
+/* One-shot hashing of a whole buffer. Every chunk but the last is compressed by HashMany, in groups
+spread over the cores for large inputs; the last goes through a chunk state since it may be short.
+The chaining values are then paired off a level at a time, an odd one out moving up unchanged, which
+builds the same tree as Hasher, until two are left for the root.*/
+inline void HashTree(std::span<const uint8_t> Input, const uint32_t Key[8], uint32_t Flags, std::span<uint8_t> Out) {
+	size_t Chunks = std::max<size_t>(1, (Input.size() + ChunkSize - 1) / ChunkSize);
+	if(Chunks == 1) {
+		ChunkState Chunk(Key, 0, Flags);
+		Chunk.Update(Input.data(), Input.size());
+		Chunk.Finish().RootBytes(Out.data(), Out.size());
+		return;
+	}
+	std::vector<uint8_t> Values(32 * Chunks), Next(16 * Chunks + 32);
+	constexpr size_t GroupChunks = 64;
+	size_t Groups = (Chunks - 1 + GroupChunks - 1) / GroupChunks;
+	auto HashGroup = [&](size_t Group) {
+		size_t First = Group * GroupChunks, Count = std::min(GroupChunks, Chunks - 1 - First);
+		const uint8_t *Inputs[GroupChunks];
+		for(size_t i = 0; i < Count; ++i) Inputs[i] = Input.data() + (First + i) * ChunkSize;
+		HashMany(Inputs, Count, ChunkSize / BlockSize, Key, First, true, Flags, ChunkStart, ChunkEnd, Values.data() + 32 * First);
+	};
+	if(Input.size() >= ParallelMinimum)
+		ParallelFor(Groups, HashGroup);
+	else
+		for(size_t Group = 0; Group < Groups; ++Group) HashGroup(Group);
+	ChunkState Last(Key, Chunks - 1, Flags);
+	Last.Update(Input.data() + (Chunks - 1) * ChunkSize, Input.size() - (Chunks - 1) * ChunkSize);
+	uint32_t Words[8];
+	Last.Finish().ChainingValue(Words);
+	for(int i = 0; i < 8; ++i) Store32LE(Values.data() + 32 * (Chunks - 1) + 4 * i, Words[i]);
+	std::vector<const uint8_t*> Inputs(Chunks / 2);
+	for(size_t Count = Chunks; Count > 2; Count = (Count + 1) / 2) {
+		size_t Pairs = Count / 2;
+		for(size_t i = 0; i < Pairs; ++i) Inputs[i] = Values.data() + 64 * i;
+		HashMany(Inputs.data(), Pairs, 1, Key, 0, false, Flags | Parent, 0, 0, Next.data());
+		if(Count % 2) std::memcpy(Next.data() + 32 * Pairs, Values.data() + 32 * (Count - 1), 32);
+		Values.swap(Next);
+	}
+	ParentOutput(Values.data(), Key, Flags).RootBytes(Out.data(), Out.size());
+}
+}
+
+inline Digest Hash(std::span<const uint8_t> Input) {
+	Digest Out;
+	Detail::HashTree(Input, IV.data(), 0, Out);
+	return Out;
+}
+
+inline Digest Hash(std::string_view Input) {
+	return Hash(std::span(reinterpret_cast<const uint8_t*>(Input.data()), Input.size()));
+}
+
+inline Digest Hash(const std::vector<uint8_t>& Input) {
+	return Hash(std::span<const uint8_t>(Input));
+}
+
+// A 32-byte tag that only holders of Key can compute or check
+inline Digest KeyedHash(std::span<const uint8_t, KeySize> Key, std::span<const uint8_t> Input) {
+	uint32_t Words[8];
+	for(int i = 0; i < 8; ++i) Words[i] = Load32LE(Key.data() + 4 * i);
+	Digest Out;
+	Detail::HashTree(Input, Words, Flag::Keyed, Out);
+	return Out;
+}
+
+inline Digest KeyedHash(std::span<const uint8_t, KeySize> Key, std::string_view Input) {
+	return KeyedHash(Key, std::span(reinterpret_cast<const uint8_t*>(Input.data()), Input.size()));
+}
+
+// Derives a key for the purpose named by Context from Material, which should itself be secret
+inline Digest DeriveKey(std::string_view Context, std::span<const uint8_t> Material) {
+	Digest ContextKey, Out;
+	Detail::HashTree(std::span(reinterpret_cast<const uint8_t*>(Context.data()), Context.size()), IV.data(), DeriveKeyContext, ContextKey);
+	uint32_t Words[8];
+	for(int i = 0; i < 8; ++i) Words[i] = Load32LE(ContextKey.data() + 4 * i);
+	Detail::HashTree(Material, Words, DeriveKeyMaterial, Out);
+	return Out;
+}
+
+// The input is moved into the task, so pass an rvalue to avoid copying it
+inline std::future<Digest> HashAsync(std::vector<uint8_t> Input) {
+	return RunAsync([Input = std::move(Input)]() { return Hash(Input); });
+}
 }
 }
-}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+namespace AstralDB {
+namespace DS {
+/* Split-block Bloom filter. Every key lands in one 32-byte block, picked by the high half of its
+hash, and sets one bit in each of the block's eight words. A lookup costs a single cache line, and
+the eight word updates vectorize. Around ten bits per key gives about a 1% false positive rate.
+Bits are never cleared; owners rebuild the filter once removed keys pile up.*/
+class BloomFilter {
+	struct alignas(32) Block {
+		std::array<uint32_t, 8> Words{};
+	};
+
+	static constexpr std::array<uint32_t, 8> Salt = {0x47B6137Bu, 0x44974D91u, 0x8824AD5Bu, 0xA2B7289Du,
+	                                                0x705495C7u, 0x2DF1424Bu, 0x9EFC4947u, 0x5C6BFB31u};
+
+	std::vector<Block> Blocks_;
+	size_t Capacity_ = 0;
+
+	const Block &BlockFor(uint64_t Hash) const {
+		return Blocks_[((Hash >> 32) * Blocks_.size()) >> 32];
+	}
+
+	static std::array<uint32_t, 8> Mask(uint64_t Hash) {
+		std::array<uint32_t, 8> Bits;
+		for(size_t I = 0; I < 8; ++I) Bits[I] = 1u << ((static_cast<uint32_t>(Hash) * Salt[I]) >> 27);
+		return Bits;
+	}
+
+public:
+	static constexpr size_t DefaultBitsPerKey = 10;
+
+	explicit BloomFilter(size_t ExpectedKeys = 0, size_t BitsPerKey = DefaultBitsPerKey) { Reset(ExpectedKeys, BitsPerKey); }
+
+	// Empties the filter and sizes it for ExpectedKeys
+	void Reset(size_t ExpectedKeys, size_t BitsPerKey = DefaultBitsPerKey) {
+		Capacity_ = std::max<size_t>(ExpectedKeys, 64);
+		Blocks_.assign((Capacity_ * BitsPerKey + 255) / 256, Block());
+	}
+
+	// std::hash leaves short keys poorly mixed, so its result gets a 64-bit finalizer
+	template<class T> static uint64_t Hash(const T &Key) {
+		uint64_t Hash = std::hash<T>{}(Key);
+		Hash ^= Hash >> 33;
+		Hash *= 0xFF51AFD7ED558CCDull;
+		Hash ^= Hash >> 33;
+		Hash *= 0xC4CEB9FE1A85EC53ull;
+		Hash ^= Hash >> 33;
+		return Hash;
+	}
+
+	void Insert(uint64_t Hash) {
+		Block &Target = const_cast<Block&>(BlockFor(Hash));
+		auto Bits = Mask(Hash);
+		for(size_t I = 0; I < 8; ++I) Target.Words[I] |= Bits[I];
+	}
+
+	// False means the key was never inserted; true means it probably was
+	bool MayContain(uint64_t Hash) const {
+		const Block &Target = BlockFor(Hash);
+		auto Bits = Mask(Hash);
+		uint32_t Missing = 0;
+		for(size_t I = 0; I < 8; ++I) Missing |= Bits[I] & ~Target.Words[I];
+		return Missing == 0;
+	}
+
+	void Insert(std::string_view Key) { Insert(Hash(Key)); }
+	bool MayContain(std::string_view Key) const { return MayContain(Hash(Key)); }
+
+	// Keys the filter was sized for; past this the false positive rate climbs
+	size_t Capacity() const { return Capacity_; }
+	size_t SizeInBytes() const { return Blocks_.size() * sizeof(Block); }
+};
+}
+}
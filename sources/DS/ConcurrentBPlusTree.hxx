@@ -0,0 +1,454 @@
+#pragma once
+
+#include <DS/Epoch.hxx>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace AstralDB {
+namespace Detail {
+template<class T, bool = std::is_trivially_copyable_v<T>> struct LockFreeAtomic : std::false_type {};
+template<class T> struct LockFreeAtomic<T, true> : std::bool_constant<std::atomic<T>::is_always_lock_free> {};
+}
+
+/* Unique-key B+Tree for concurrent use, built on optimistic lock coupling. Every node carries a
+version word whose low bit is the write latch. Readers descend without writing shared memory and
+restart when a version they passed through has moved. Writers latch only the nodes they change.
+Full nodes are split on the way down, so a split never has to climb back up the tree.
+
+Keys that fit a lock-free atomic are stored inline. Other keys are stored behind immutable pointers
+and freed through DS::Epoch, so an optimistic reader can always dereference what it loaded. In the
+same way, point reads of small trivially copyable values are latch-free. Larger values are only
+touched under their leaf's latch. Erasing never merges nodes; emptied leaves stay linked until the
+tree is destroyed.*/
+template <typename Key, typename Value, size_t Order = 0, typename Compare = std::less<Key>>
+class ConcurrentBPlusTree {
+    static constexpr bool InlineKeys = Detail::LockFreeAtomic<Key>::value;
+    static constexpr bool OptimisticValues = Detail::LockFreeAtomic<Value>::value;
+    using KeySlot = std::conditional_t<InlineKeys, Key, const Key*>;
+    using ValueSlot = std::conditional_t<OptimisticValues, std::atomic<Value>, Value>;
+
+public:
+    static constexpr size_t MaxKeys = Order ? Order : std::clamp<size_t>(512 / sizeof(KeySlot), 8, 128);
+
+private:
+    static_assert(MaxKeys >= 3, "B+Tree order must be at least 3");
+
+    // Version word: bit 0 is the write latch, the remaining bits count completed writes
+    class VersionLock {
+        std::atomic<uint64_t> Word_{0};
+
+    public:
+        // Fails while a writer holds the node
+        bool ReadLock(uint64_t &Version) const {
+            Version = Word_.load(std::memory_order_acquire);
+            return !(Version & 1);
+        }
+
+        // True if nothing was written since ReadLock handed out Version
+        bool Validate(uint64_t Version) const {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return Word_.load(std::memory_order_relaxed) == Version;
+        }
+
+        bool Upgrade(uint64_t Version) {
+            if(!Word_.compare_exchange_strong(Version, Version + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return false;
+            std::atomic_thread_fence(std::memory_order_release);
+            return true;
+        }
+
+        void Lock() {
+            uint64_t Version;
+            while(!ReadLock(Version) || !Upgrade(Version)) std::this_thread::yield();
+        }
+
+        // Clears the latch and bumps the version in one add
+        void Unlock() { Word_.fetch_add(1, std::memory_order_release); }
+    };
+
+    struct NodeBase {
+        VersionLock Lock;
+        const bool IsLeaf;
+        std::atomic<uint16_t> Count{0};
+        std::array<std::atomic<KeySlot>, MaxKeys> Keys{};
+
+        explicit NodeBase(bool IsLeafFlag) : IsLeaf(IsLeafFlag) {}
+    };
+
+    struct Leaf : NodeBase {
+        std::array<ValueSlot, MaxKeys> Values{};
+        std::atomic<Leaf*> Next{nullptr};
+
+        Leaf() : NodeBase(true) {}
+    };
+
+    struct Inner : NodeBase {
+        std::array<std::atomic<NodeBase*>, MaxKeys + 1> Children{};
+
+        Inner() : NodeBase(false) {}
+    };
+
+    Compare Compare_;
+    std::atomic<NodeBase*> Root_;
+    // Full nodes split their upper half to the right, so the leftmost leaf never changes
+    Leaf *First_;
+    std::atomic<size_t> Size_{0};
+
+    static Leaf *AsLeaf(NodeBase *Node) { return static_cast<Leaf*>(Node); }
+    static Inner *AsInner(NodeBase *Node) { return static_cast<Inner*>(Node); }
+
+    static decltype(auto) KeyOf(KeySlot Slot) {
+        if constexpr(InlineKeys) return Slot;
+        else return static_cast<const Key&>(*Slot);
+    }
+
+    static KeySlot MakeKey(const Key &KeyValue) {
+        if constexpr(InlineKeys) return KeyValue;
+        else return new Key(KeyValue);
+    }
+
+    /* Optimistic readers dereference a key pointer before they validate the node, so the pointer is
+    published with release and loaded with acquire to make the key's construction visible first.*/
+    static constexpr auto KeyLoadOrder = InlineKeys ? std::memory_order_relaxed : std::memory_order_acquire;
+    static constexpr auto KeyStoreOrder = InlineKeys ? std::memory_order_relaxed : std::memory_order_release;
+
+    static KeySlot LoadKey(const NodeBase &Node, size_t Index) { return Node.Keys[Index].load(KeyLoadOrder); }
+    static void StoreKey(NodeBase &Node, size_t Index, KeySlot Slot) { Node.Keys[Index].store(Slot, KeyStoreOrder); }
+
+    static void MoveValue(Leaf &To, size_t ToIndex, Leaf &From, size_t FromIndex) {
+        if constexpr(OptimisticValues)
+            To.Values[ToIndex].store(From.Values[FromIndex].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        else
+            To.Values[ToIndex] = std::move(From.Values[FromIndex]);
+    }
+
+    static void ResetValue(Leaf &Node, size_t Index) {
+        if constexpr(OptimisticValues) Node.Values[Index].store(Value(), std::memory_order_relaxed);
+        else Node.Values[Index] = Value();
+    }
+
+    // Runs Modify on a value of a latched leaf and reports what it returned
+    template<typename Func> static decltype(auto) ApplyValue(Leaf &Node, size_t Index, Func &&Modify) {
+        if constexpr(OptimisticValues) {
+            Value Copy = Node.Values[Index].load(std::memory_order_relaxed);
+            struct StoreBack {
+                std::atomic<Value> &Slot;
+                Value &Copy;
+                ~StoreBack() { Slot.store(Copy, std::memory_order_relaxed); }
+            } Writer{Node.Values[Index], Copy};
+            return Modify(Copy);
+        } else {
+            return Modify(Node.Values[Index]);
+        }
+    }
+
+    bool Equivalent(const Key &A, const Key &B) const { return !Compare_(A, B) && !Compare_(B, A); }
+
+    // First slot in [0, Count) whose key is not less than (Upper: greater than) KeyValue
+    template<bool Upper> size_t Bound(const NodeBase &Node, size_t Count, const Key &KeyValue) const {
+        size_t Low = 0, High = std::min(Count, MaxKeys);
+        while(Low < High) {
+            size_t Mid = (Low + High) / 2;
+            const auto &Probe = KeyOf(LoadKey(Node, Mid));
+            if(Upper ? !Compare_(KeyValue, Probe) : Compare_(Probe, KeyValue)) Low = Mid + 1;
+            else High = Mid;
+        }
+        return Low;
+    }
+
+    // Optimistic descent to the leaf owning KeyValue; nullptr means a concurrent writer forced a restart
+    Leaf *FindLeaf(const Key &KeyValue, uint64_t &LeafVersion) const {
+        NodeBase *Node = Root_.load(std::memory_order_acquire);
+        uint64_t Version;
+        if(!Node->Lock.ReadLock(Version) || Node != Root_.load(std::memory_order_acquire)) return nullptr;
+        while(!Node->IsLeaf) {
+            Inner *Current = AsInner(Node);
+            size_t Count = Current->Count.load(std::memory_order_acquire);
+            NodeBase *Child = Current->Children[Bound<true>(*Current, Count, KeyValue)].load(std::memory_order_acquire);
+            if(!Current->Lock.Validate(Version)) return nullptr;
+            uint64_t ChildVersion;
+            if(!Child->Lock.ReadLock(ChildVersion) || !Current->Lock.Validate(Version)) return nullptr;
+            Node = Child;
+            Version = ChildVersion;
+        }
+        LeafVersion = Version;
+        return AsLeaf(Node);
+    }
+
+    // Puts Separator and its right child into a latched inner node that has room for them
+    static void InsertChild(Inner &Parent, size_t Index, KeySlot Separator, NodeBase *Right) {
+        size_t Count = Parent.Count.load(std::memory_order_relaxed);
+        for(size_t i = Count; i > Index; --i) {
+            StoreKey(Parent, i, LoadKey(Parent, i - 1));
+            Parent.Children[i + 1].store(Parent.Children[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        StoreKey(Parent, Index, Separator);
+        Parent.Children[Index + 1].store(Right, std::memory_order_release);
+        Parent.Count.store(static_cast<uint16_t>(Count + 1), std::memory_order_release);
+    }
+
+    // Splits the full, latched Node; Parent is latched too, or null when Node is the root
+    void SplitNode(Inner *Parent, NodeBase *Node) {
+        size_t Count = Node->Count.load(std::memory_order_relaxed);
+        size_t Mid = Count / 2;
+        KeySlot Separator;
+        NodeBase *Right;
+        if(Node->IsLeaf) {
+            Leaf *Current = AsLeaf(Node);
+            Leaf *NewLeaf = new Leaf();
+            for(size_t i = Mid; i < Count; ++i) {
+                StoreKey(*NewLeaf, i - Mid, LoadKey(*Current, i));
+                MoveValue(*NewLeaf, i - Mid, *Current, i);
+            }
+            NewLeaf->Count.store(static_cast<uint16_t>(Count - Mid), std::memory_order_relaxed);
+            NewLeaf->Next.store(Current->Next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            // Leaf keys are retired independently, so the separator gets its own copy
+            Separator = MakeKey(KeyOf(LoadKey(*NewLeaf, 0)));
+            Current->Next.store(NewLeaf, std::memory_order_release);
+            Current->Count.store(static_cast<uint16_t>(Mid), std::memory_order_release);
+            Right = NewLeaf;
+        } else {
+            Inner *Current = AsInner(Node);
+            Inner *NewInner = new Inner();
+            Separator = LoadKey(*Current, Mid);
+            for(size_t i = Mid + 1; i < Count; ++i)
+                StoreKey(*NewInner, i - Mid - 1, LoadKey(*Current, i));
+            for(size_t i = Mid + 1; i <= Count; ++i)
+                NewInner->Children[i - Mid - 1].store(Current->Children[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            NewInner->Count.store(static_cast<uint16_t>(Count - Mid - 1), std::memory_order_relaxed);
+            Current->Count.store(static_cast<uint16_t>(Mid), std::memory_order_release);
+            Right = NewInner;
+        }
+        if(Parent) {
+            size_t Index = Bound<true>(*Parent, Parent->Count.load(std::memory_order_relaxed), KeyOf(Separator));
+            InsertChild(*Parent, Index, Separator, Right);
+            return;
+        }
+        Inner *NewRoot = new Inner();
+        StoreKey(*NewRoot, 0, Separator);
+        NewRoot->Children[0].store(Node, std::memory_order_relaxed);
+        NewRoot->Children[1].store(Right, std::memory_order_relaxed);
+        NewRoot->Count.store(1, std::memory_order_relaxed);
+        Root_.store(NewRoot, std::memory_order_release);
+    }
+
+    // Latches and returns the leaf owning KeyValue, splitting full nodes on the way; nullptr means restart
+    Leaf *LockLeafForWrite(const Key &KeyValue) {
+        NodeBase *Node = Root_.load(std::memory_order_acquire);
+        uint64_t Version;
+        if(!Node->Lock.ReadLock(Version) || Node != Root_.load(std::memory_order_acquire)) return nullptr;
+        Inner *Parent = nullptr;
+        uint64_t ParentVersion = 0;
+        for(;;) {
+            if(Node->Count.load(std::memory_order_relaxed) == MaxKeys) {
+                if(Parent && !Parent->Lock.Upgrade(ParentVersion)) return nullptr;
+                if(!Node->Lock.Upgrade(Version)) {
+                    if(Parent) Parent->Lock.Unlock();
+                    return nullptr;
+                }
+                SplitNode(Parent, Node);
+                Node->Lock.Unlock();
+                if(Parent) Parent->Lock.Unlock();
+                return nullptr;
+            }
+            if(Node->IsLeaf) break;
+            Inner *Current = AsInner(Node);
+            size_t Count = Current->Count.load(std::memory_order_acquire);
+            NodeBase *Child = Current->Children[Bound<true>(*Current, Count, KeyValue)].load(std::memory_order_acquire);
+            if(!Current->Lock.Validate(Version)) return nullptr;
+            uint64_t ChildVersion;
+            if(!Child->Lock.ReadLock(ChildVersion) || !Current->Lock.Validate(Version)) return nullptr;
+            Parent = Current;
+            ParentVersion = Version;
+            Node = Child;
+            Version = ChildVersion;
+        }
+        // The leaf version was read while its parent still routed KeyValue here, so a successful upgrade settles it
+        return Node->Lock.Upgrade(Version) ? AsLeaf(Node) : nullptr;
+    }
+
+    // Latches the leaf owning KeyValue without splitting anything on the way
+    Leaf *LockLeaf(const Key &KeyValue) const {
+        for(;;) {
+            uint64_t Version;
+            Leaf *Current = FindLeaf(KeyValue, Version);
+            if(Current && Current->Lock.Upgrade(Version)) return Current;
+            std::this_thread::yield();
+        }
+    }
+
+    // Slot holding KeyValue in a leaf, or nullopt
+    std::optional<size_t> Locate(const Leaf &Node, const Key &KeyValue) const {
+        size_t Count = Node.Count.load(std::memory_order_acquire);
+        size_t Index = Bound<false>(Node, Count, KeyValue);
+        if(Index < Count && Equivalent(KeyOf(LoadKey(Node, Index)), KeyValue)) return Index;
+        return std::nullopt;
+    }
+
+    void EraseAt(Leaf &Node, size_t Index) {
+        size_t Count = Node.Count.load(std::memory_order_relaxed);
+        KeySlot Removed = LoadKey(Node, Index);
+        for(size_t i = Index; i + 1 < Count; ++i) {
+            StoreKey(Node, i, LoadKey(Node, i + 1));
+            MoveValue(Node, i, Node, i + 1);
+        }
+        ResetValue(Node, Count - 1);
+        Node.Count.store(static_cast<uint16_t>(Count - 1), std::memory_order_release);
+        Size_.fetch_sub(1, std::memory_order_relaxed);
+        if constexpr(!InlineKeys) DS::Epoch::Retire(Removed);
+    }
+
+    void DestroyNode(NodeBase *Node) {
+        size_t Count = Node->Count.load(std::memory_order_relaxed);
+        if constexpr(!InlineKeys)
+            for(size_t i = 0; i < Count; ++i) delete LoadKey(*Node, i);
+        if(Node->IsLeaf) {
+            delete AsLeaf(Node);
+            return;
+        }
+        for(size_t i = 0; i <= Count; ++i) DestroyNode(AsInner(Node)->Children[i].load(std::memory_order_relaxed));
+        delete AsInner(Node);
+    }
+
+public:
+    ConcurrentBPlusTree() : First_(new Leaf()) { Root_.store(First_, std::memory_order_relaxed); }
+    ~ConcurrentBPlusTree() {
+        if(NodeBase *Root = Root_.load(std::memory_order_relaxed)) DestroyNode(Root);
+    }
+
+    ConcurrentBPlusTree(const ConcurrentBPlusTree&) = delete;
+    ConcurrentBPlusTree &operator=(const ConcurrentBPlusTree&) = delete;
+
+    // Moves are not concurrent operations; no other thread may be using either tree
+    ConcurrentBPlusTree(ConcurrentBPlusTree &&Other) noexcept
+        : Compare_(std::move(Other.Compare_)), Root_(Other.Root_.load(std::memory_order_relaxed)), First_(Other.First_),
+          Size_(Other.Size_.load(std::memory_order_relaxed)) {
+        Other.First_ = new Leaf();
+        Other.Root_.store(Other.First_, std::memory_order_relaxed);
+        Other.Size_.store(0, std::memory_order_relaxed);
+    }
+
+    ConcurrentBPlusTree &operator=(ConcurrentBPlusTree &&Other) noexcept {
+        if(this != &Other) {
+            DestroyNode(Root_.load(std::memory_order_relaxed));
+            Compare_ = std::move(Other.Compare_);
+            Root_.store(Other.Root_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            First_ = Other.First_;
+            Size_.store(Other.Size_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            Other.First_ = new Leaf();
+            Other.Root_.store(Other.First_, std::memory_order_relaxed);
+            Other.Size_.store(0, std::memory_order_relaxed);
+        }
+        return *this;
+    }
+
+    /* Calls Modify(Value&) on the entry for KeyValue under its leaf latch, creating the entry with a
+    default value first if absent. Returns true if the entry was created.*/
+    template<typename Func> bool Upsert(const Key &KeyValue, Func &&Modify) {
+        DS::Epoch::Guard Pin;
+        Leaf *Current;
+        while(!(Current = LockLeafForWrite(KeyValue))) std::this_thread::yield();
+        auto Index = Locate(*Current, KeyValue);
+        bool Created = !Index;
+        if(Created) {
+            size_t Count = Current->Count.load(std::memory_order_relaxed);
+            Index = Bound<false>(*Current, Count, KeyValue);
+            for(size_t i = Count; i > *Index; --i) {
+                StoreKey(*Current, i, LoadKey(*Current, i - 1));
+                MoveValue(*Current, i, *Current, i - 1);
+            }
+            StoreKey(*Current, *Index, MakeKey(KeyValue));
+            ResetValue(*Current, *Index);
+            Current->Count.store(static_cast<uint16_t>(Count + 1), std::memory_order_release);
+            Size_.fetch_add(1, std::memory_order_relaxed);
+        }
+        ApplyValue(*Current, *Index, Modify);
+        Current->Lock.Unlock();
+        return Created;
+    }
+
+    // Inserts or overwrites; returns true if KeyValue was new
+    bool Insert(const Key &KeyValue, Value Val) {
+        return Upsert(KeyValue, [&](Value &Slot) { Slot = std::move(Val); });
+    }
+
+    /* Calls Modify(Value&) on the entry for KeyValue under its leaf latch and erases the entry when
+    Modify returns true. Returns false if the key is absent.*/
+    template<typename Func> bool Update(const Key &KeyValue, Func &&Modify) {
+        DS::Epoch::Guard Pin;
+        Leaf *Current = LockLeaf(KeyValue);
+        auto Index = Locate(*Current, KeyValue);
+        if(Index && ApplyValue(*Current, *Index, Modify)) EraseAt(*Current, *Index);
+        Current->Lock.Unlock();
+        return Index.has_value();
+    }
+
+    bool Erase(const Key &KeyValue) {
+        return Update(KeyValue, [](Value&) { return true; });
+    }
+
+    // Calls F(const Value&) for the entry of KeyValue; returns false if there is none
+    template<typename Func> bool Visit(const Key &KeyValue, Func &&F) const {
+        DS::Epoch::Guard Pin;
+        if constexpr(OptimisticValues) {
+            for(;;) {
+                uint64_t Version;
+                Leaf *Current = FindLeaf(KeyValue, Version);
+                if(!Current) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                auto Index = Locate(*Current, KeyValue);
+                Value Copy = Index ? Current->Values[*Index].load(std::memory_order_relaxed) : Value();
+                if(!Current->Lock.Validate(Version)) continue;
+                if(Index) F(static_cast<const Value&>(Copy));
+                return Index.has_value();
+            }
+        } else {
+            Leaf *Current = LockLeaf(KeyValue);
+            auto Index = Locate(*Current, KeyValue);
+            if(Index) F(static_cast<const Value&>(Current->Values[*Index]));
+            Current->Lock.Unlock();
+            return Index.has_value();
+        }
+    }
+
+    std::optional<Value> Find(const Key &KeyValue) const {
+        std::optional<Value> Result;
+        Visit(KeyValue, [&](const Value &Found) { Result = Found; });
+        return Result;
+    }
+
+    bool Contains(const Key &KeyValue) const {
+        return Visit(KeyValue, [](const Value&) {});
+    }
+
+    /* Calls F(Key, Value) for every entry in key order. Each leaf is latched while it is visited,
+    so F must not call back into the tree. Writes landing in leaves not yet reached are seen.*/
+    template<typename Func> void ForEach(Func &&F) const {
+        DS::Epoch::Guard Pin;
+        for(Leaf *Current = First_; Current;) {
+            Current->Lock.Lock();
+            size_t Count = Current->Count.load(std::memory_order_relaxed);
+            for(size_t i = 0; i < Count; ++i) {
+                if constexpr(OptimisticValues) F(KeyOf(LoadKey(*Current, i)), Current->Values[i].load(std::memory_order_relaxed));
+                else F(KeyOf(LoadKey(*Current, i)), static_cast<const Value&>(Current->Values[i]));
+            }
+            Leaf *Next = Current->Next.load(std::memory_order_acquire);
+            Current->Lock.Unlock();
+            Current = Next;
+        }
+    }
+
+    size_t Size() const { return Size_.load(std::memory_order_relaxed); }
+    bool Empty() const { return Size() == 0; }
+};
+} // namespace AstralDB
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <IO/Spinlock.hxx>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace AstralDB {
+namespace DS {
+/* Epoch-based reclamation for latch-free structures. Every operation pins the global epoch through a
+Guard. Memory a writer has unlinked is retired with the epoch it was retired in and is freed only
+after the global epoch has moved two steps past it. By then no pinned thread can still hold it.*/
+class Epoch {
+	struct Retired {
+		void *Pointer;
+		void (*Deleter)(void*);
+		uint64_t RetiredIn;
+	};
+
+	struct alignas(64) Participant {
+		std::atomic<uint64_t> Pinned{0}; // 0 while the thread is outside every guard
+		std::atomic<bool> InUse{true};
+		uint32_t Depth = 0;
+		std::vector<Retired> Limbo;
+		Participant *Next = nullptr;
+	};
+
+	struct Domain {
+		std::atomic<uint64_t> Global{1};
+		std::atomic<Participant*> Head{nullptr};
+		// Garbage left behind by exited threads
+		Spinlock OrphansLock;
+		std::vector<Retired> Orphans;
+
+		~Domain() {
+			for(auto &Item : Orphans) Item.Deleter(Item.Pointer);
+		}
+	};
+
+	static constexpr size_t CollectThreshold = 64;
+
+	static Domain &Shared() {
+		static Domain Instance;
+		return Instance;
+	}
+
+	// Participants are recycled rather than freed, so walking the list never races with a thread exit
+	static Participant *Acquire() {
+		Domain &State = Shared();
+		for(Participant *Current = State.Head.load(std::memory_order_acquire); Current; Current = Current->Next) {
+			bool Expected = false;
+			if(!Current->InUse.load(std::memory_order_relaxed) &&
+			   Current->InUse.compare_exchange_strong(Expected, true, std::memory_order_acq_rel))
+				return Current;
+		}
+		auto *Created = new Participant;
+		Created->Next = State.Head.load(std::memory_order_relaxed);
+		while(!State.Head.compare_exchange_weak(Created->Next, Created, std::memory_order_release, std::memory_order_relaxed)) {}
+		return Created;
+	}
+
+	static void Release(Participant *Self) {
+		Domain &State = Shared();
+		{
+			SpinlockGuard Guard(State.OrphansLock);
+			State.Orphans.insert(State.Orphans.end(), Self->Limbo.begin(), Self->Limbo.end());
+		}
+		Self->Limbo.clear();
+		Self->Depth = 0;
+		Self->Pinned.store(0, std::memory_order_release);
+		Self->InUse.store(false, std::memory_order_release);
+	}
+
+	struct LocalHandle {
+		Participant *Self = Acquire();
+		~LocalHandle() { Release(Self); }
+	};
+
+	static Participant &Local() {
+		thread_local LocalHandle Handle;
+		return *Handle.Self;
+	}
+
+	// Frees every entry retired at least two epochs before Safe
+	static void FreeExpired(std::vector<Retired> &Items, uint64_t Safe) {
+		auto Expired = std::partition(Items.begin(), Items.end(), [Safe](const Retired &Item) { return Item.RetiredIn + 2 > Safe; });
+		for(auto It = Expired; It != Items.end(); ++It) It->Deleter(It->Pointer);
+		Items.erase(Expired, Items.end());
+	}
+
+public:
+	static void Enter() {
+		Participant &Self = Local();
+		if(Self.Depth++ == 0) {
+			Self.Pinned.store(Shared().Global.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+	}
+
+	static void Exit() {
+		Participant &Self = Local();
+		if(--Self.Depth == 0) Self.Pinned.store(0, std::memory_order_release);
+	}
+
+	// Pins the current epoch for the guard's lifetime; guards nest
+	class Guard {
+	public:
+		Guard() { Enter(); }
+		~Guard() { Exit(); }
+		Guard(const Guard&) = delete;
+		Guard &operator=(const Guard&) = delete;
+	};
+
+	static void Retire(void *Pointer, void (*Deleter)(void*)) {
+		Participant &Self = Local();
+		Self.Limbo.push_back({Pointer, Deleter, Shared().Global.load(std::memory_order_acquire)});
+		if(Self.Limbo.size() >= CollectThreshold) Collect();
+	}
+
+	template<class T> static void Retire(T *Pointer) {
+		Retire(const_cast<void*>(static_cast<const void*>(Pointer)), [](void *Object) { delete static_cast<T*>(Object); });
+	}
+
+	// Advances the global epoch when every pinned thread has caught up, then frees what became safe
+	static void Collect() {
+		Domain &State = Shared();
+		uint64_t Current = State.Global.load(std::memory_order_acquire);
+		bool CaughtUp = true;
+		for(Participant *It = State.Head.load(std::memory_order_acquire); It && CaughtUp; It = It->Next) {
+			uint64_t Pinned = It->Pinned.load(std::memory_order_acquire);
+			CaughtUp = Pinned == 0 || Pinned == Current;
+		}
+		if(CaughtUp) State.Global.compare_exchange_strong(Current, Current + 1, std::memory_order_acq_rel);
+		uint64_t Safe = State.Global.load(std::memory_order_acquire);
+		FreeExpired(Local().Limbo, Safe);
+		SpinlockGuard Guard(State.OrphansLock);
+		FreeExpired(State.Orphans, Safe);
+	}
+};
+}
+}
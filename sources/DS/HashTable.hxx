@@ -1,102 +1,226 @@
 #pragma once
 
-#include <vector>
-#include <optional>
+#include <IO/SIMD.hxx>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <utility>
+#include <vector>
 
 namespace AstralDB {
 namespace DS {
+/* Open-addressing hash table in the Swiss-table layout. Slots come in groups of 16, each with a
+control byte holding 7 bits of the key's hash (or Empty/Deleted). A lookup compares a whole group's
+control bytes in one SIMD step and only touches slots whose tag matches, so a probe usually costs
+one miss for the control group and one for the entry.
+
+Erasing leaves a tombstone only when the group is full, because a probe may have passed it.
+Tombstones are purged by rehashing in place once they crowd the table.*/
 template<class Key, class Value> class HashTable {
 	struct Entry {
 		Key KeyValue;
 		Value ValueData;
-		bool Occupied = false;
-		bool Deleted = false;
-		Entry() = default;
-		Entry(const Key& K, const Value& V) : KeyValue(K), ValueData(V), Occupied(true), Deleted(false) {}
 	};
 
-	std::vector<Entry> Data_;
-	std::size_t Size_ = 0;
-	static constexpr float LoadFactor = 0.7f;
+	static constexpr size_t GroupWidth = 16;
+	static constexpr uint8_t EmptyTag = 0x80;
+	static constexpr uint8_t DeletedTag = 0xFE;
+	static constexpr size_t NotFound = SIZE_MAX;
+
+	std::unique_ptr<uint8_t[]> Control_;
+	Entry *Slots_ = nullptr;
+	size_t Capacity_ = 0;
+	size_t Size_ = 0;
+	size_t Tombstones_ = 0;
 
-	uint32_t Hash(const Key& K) const {
-		// FNV-1a hash for generality
-		uint32_t Hash = 2166136261u;
-		const uint8_t* Ptr = reinterpret_cast<const uint8_t*>(&K);
-		for(size_t i = 0; i < sizeof(Key); ++i)
-			Hash = (Hash ^ Ptr[i]) * 16777619u;
+	// std::hash is the identity for integers, so the result is mixed before its bits pick group and tag
+	static uint64_t Hash(const Key &K) {
+		uint64_t Hash = std::hash<Key>{}(K);
+		Hash ^= Hash >> 33;
+		Hash *= 0xFF51AFD7ED558CCDull;
+		Hash ^= Hash >> 33;
+		Hash *= 0xC4CEB9FE1A85EC53ull;
+		Hash ^= Hash >> 33;
 		return Hash;
 	}
 
-	void Resize(std::size_t NewCap) {
-		std::vector<Entry> NewData(NewCap);
-		for(const auto& Entry : Data_) {
-			if(Entry.Occupied && !Entry.Deleted) {
-				std::size_t Index = Hash(Entry.KeyValue) & (NewCap - 1);
-				while(NewData[Index].Occupied) Index = (Index + 1) & (NewCap - 1);
-				NewData[Index] = Entry;
+	static uint8_t Tag(uint64_t Hash) { return static_cast<uint8_t>(Hash & 0x7F); }
+	size_t FirstGroup(uint64_t Hash) const { return (Hash >> 7) & (Capacity_ / GroupWidth - 1); }
+	// Triangular steps over a power-of-two group count visit every group once
+	size_t NextGroup(size_t Group, size_t Step) const { return (Group + Step) & (Capacity_ / GroupWidth - 1); }
+
+	size_t FindIndex(const Key &K, uint64_t Hash) const {
+		if(!Capacity_) return NotFound;
+		size_t Group = FirstGroup(Hash);
+		for(size_t Step = 1;; ++Step) {
+			const uint8_t *Control = Control_.get() + Group * GroupWidth;
+			for(uint32_t Match = SimdMatchByte16(Control, Tag(Hash)); Match; Match &= Match - 1) {
+				size_t Index = Group * GroupWidth + __builtin_ctz(Match);
+				if(Slots_[Index].KeyValue == K) return Index;
 			}
+			if(SimdMatchByte16(Control, EmptyTag)) return NotFound;
+			Group = NextGroup(Group, Step);
 		}
-		Data_ = std::move(NewData);
 	}
 
+	// First empty or deleted slot on Hash's probe sequence; the load limit guarantees one exists
+	size_t FindFree(uint64_t Hash) const {
+		size_t Group = FirstGroup(Hash);
+		for(size_t Step = 1;; ++Step) {
+			if(uint32_t Free = SimdMatchHighBit16(Control_.get() + Group * GroupWidth))
+				return Group * GroupWidth + __builtin_ctz(Free);
+			Group = NextGroup(Group, Step);
+		}
+	}
+
+	void Release() {
+		if(!Slots_) return;
+		for(size_t I = 0; I < Capacity_; ++I)
+			if(!(Control_[I] & 0x80)) std::destroy_at(&Slots_[I]);
+		std::allocator<Entry>().deallocate(Slots_, Capacity_);
+		Slots_ = nullptr;
+		Control_.reset();
+	}
+
+	void Rehash(size_t NewCapacity) {
+		auto NewControl = std::make_unique<uint8_t[]>(NewCapacity);
+		std::fill_n(NewControl.get(), NewCapacity, EmptyTag);
+		Entry *NewSlots = std::allocator<Entry>().allocate(NewCapacity);
+		auto OldControl = std::move(Control_);
+		Entry *OldSlots = std::exchange(Slots_, NewSlots);
+		size_t OldCapacity = std::exchange(Capacity_, NewCapacity);
+		Control_ = std::move(NewControl);
+		Tombstones_ = 0;
+		for(size_t I = 0; I < OldCapacity; ++I) {
+			if(OldControl[I] & 0x80) continue;
+			uint64_t EntryHash = Hash(OldSlots[I].KeyValue);
+			size_t Index = FindFree(EntryHash);
+			Control_[Index] = Tag(EntryHash);
+			std::construct_at(&Slots_[Index], std::move(OldSlots[I]));
+			std::destroy_at(&OldSlots[I]);
+		}
+		if(OldSlots) std::allocator<Entry>().deallocate(OldSlots, OldCapacity);
+	}
+
+	// Keeps live entries plus tombstones under 7/8 of the slots; purges tombstones when growth is not needed
 	void EnsureCapacity() {
-		if(Size_ + 1 > Data_.size() * LoadFactor) {
-			std::size_t NewCap = Data_.empty() ? 8 : Data_.size() * 2;
-			Resize(NewCap);
+		if(!Capacity_) {
+			Rehash(GroupWidth);
+			return;
+		}
+		if((Size_ + Tombstones_ + 1) * 8 <= Capacity_ * 7) return;
+		Rehash((Size_ + 1) * 16 > Capacity_ * 7 ? Capacity_ * 2 : Capacity_);
+	}
+
+	void EraseAt(size_t Index) {
+		std::destroy_at(&Slots_[Index]);
+		size_t Group = Index / GroupWidth * GroupWidth;
+		// A group that still has an empty slot ends every probe reaching it, so no probe can be broken here
+		if(SimdMatchByte16(Control_.get() + Group, EmptyTag)) {
+			Control_[Index] = EmptyTag;
+		} else {
+			Control_[Index] = DeletedTag;
+			++Tombstones_;
 		}
+		--Size_;
 	}
 
 public:
-	HashTable() { Data_.resize(8); }
+	HashTable() = default;
+	explicit HashTable(size_t Expected) { Reserve(Expected); }
+	~HashTable() { Release(); }
 
-	void Insert(const Key& K, const Value& V) {
-		EnsureCapacity();
-		std::size_t Cap = Data_.size();
-		std::size_t Index = Hash(K) & (Cap - 1);
-		while(Data_[Index].Occupied && !Data_[Index].Deleted) {
-			if(Data_[Index].KeyValue == K) {
-				Data_[Index].ValueData = V;
-				return;
-			}
-			Index = (Index + 1) & (Cap - 1);
+	HashTable(const HashTable&) = delete;
+	HashTable &operator=(const HashTable&) = delete;
+
+	HashTable(HashTable &&Other) noexcept
+		: Control_(std::move(Other.Control_)), Slots_(std::exchange(Other.Slots_, nullptr)),
+		  Capacity_(std::exchange(Other.Capacity_, 0)), Size_(std::exchange(Other.Size_, 0)),
+		  Tombstones_(std::exchange(Other.Tombstones_, 0)) {}
+
+	HashTable &operator=(HashTable &&Other) noexcept {
+		if(this != &Other) {
+			Release();
+			Control_ = std::move(Other.Control_);
+			Slots_ = std::exchange(Other.Slots_, nullptr);
+			Capacity_ = std::exchange(Other.Capacity_, 0);
+			Size_ = std::exchange(Other.Size_, 0);
+			Tombstones_ = std::exchange(Other.Tombstones_, 0);
 		}
-		Data_[Index] = Entry(K, V);
-		++Size_;
+		return *this;
+	}
+
+	// Sizes the table so Expected entries fit without rehashing
+	void Reserve(size_t Expected) {
+		size_t Needed = GroupWidth;
+		while(Needed * 7 < Expected * 8) Needed *= 2;
+		if(Needed > Capacity_) Rehash(Needed);
 	}
 
-	std::optional<Value> Get(const Key& K) const {
-		std::size_t Cap = Data_.size();
-		std::size_t Index = Hash(K) & (Cap - 1);
-		std::size_t Start = Index;
-		while(Data_[Index].Occupied) {
-			if(!Data_[Index].Deleted && Data_[Index].KeyValue == K)
-				return Data_[Index].ValueData;
-			Index = (Index + 1) & (Cap - 1);
-			if(Index == Start) break;
+	// Inserts or overwrites; returns true if K was new
+	bool Insert(const Key &K, Value V) {
+		uint64_t KeyHash = Hash(K);
+		size_t Index = FindIndex(K, KeyHash);
+		if(Index != NotFound) {
+			Slots_[Index].ValueData = std::move(V);
+			return false;
 		}
+		EnsureCapacity();
+		Index = FindFree(KeyHash);
+		Tombstones_ -= Control_[Index] == DeletedTag;
+		Control_[Index] = Tag(KeyHash);
+		std::construct_at(&Slots_[Index], Entry{K, std::move(V)});
+		++Size_;
+		return true;
+	}
+
+	std::optional<Value> Get(const Key &K) const {
+		if(const Value *Found = Find(K)) return *Found;
 		return std::nullopt;
 	}
 
-	void Remove(const Key& K) {
-		std::size_t Cap = Data_.size();
-		std::size_t Index = Hash(K) & (Cap - 1);
-		std::size_t Start = Index;
-		while(Data_[Index].Occupied) {
-			if(!Data_[Index].Deleted && Data_[Index].KeyValue == K) {
-				Data_[Index].Deleted = true;
-				--Size_;
-				return;
-			}
-			Index = (Index + 1) & (Cap - 1);
-			if(Index == Start) break;
-		}
+	const Value *Find(const Key &K) const {
+		size_t Index = FindIndex(K, Hash(K));
+		return Index == NotFound ? nullptr : &Slots_[Index].ValueData;
 	}
 
-	std::size_t Size() const { return Size_; }
-	std::size_t Capacity() const { return Data_.size(); }
+	Value *GetPointer(const Key &K) { return const_cast<Value*>(Find(K)); }
+	bool Contains(const Key &K) const { return Find(K) != nullptr; }
+
+	bool Delete(const Key &K) {
+		size_t Index = FindIndex(K, Hash(K));
+		if(Index == NotFound) return false;
+		EraseAt(Index);
+		return true;
+	}
+
+	void Remove(const Key &K) { Delete(K); }
+
+	// Replaces the contents with Entries, sized up front so the load never rehashes
+	void BulkLoad(std::vector<std::pair<Key, Value>> &&Entries) {
+		Clear();
+		Reserve(Entries.size());
+		for(auto &[K, V] : Entries) Insert(K, std::move(V));
+		Entries.clear();
+	}
+
+	// Calls F(Key, Value) for every entry, in no particular order
+	template<typename Func> void ForEach(Func &&F) const {
+		for(size_t I = 0; I < Capacity_; ++I)
+			if(!(Control_[I] & 0x80)) F(static_cast<const Key&>(Slots_[I].KeyValue), static_cast<const Value&>(Slots_[I].ValueData));
+	}
+
+	void Clear() {
+		Release();
+		Capacity_ = 0;
+		Size_ = 0;
+		Tombstones_ = 0;
+	}
+
+	size_t Size() const { return Size_; }
+	size_t Capacity() const { return Capacity_; }
+	bool Empty() const { return Size_ == 0; }
 };
 }
-}
\ No newline at end of file
+}
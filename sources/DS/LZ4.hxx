@@ -1,70 +1,336 @@
 #pragma once
 
-#include <DS/HashTable.hxx>
-#include <string>
+#include <DS/XXHash.hxx>
+#include <algorithm>
+#include <bit>
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 
 namespace AstralDB {
 namespace DS {
-static constexpr int MAX_SLIDING_WINDOW_SIZE = 64 * 1024; // 64 kB
-
-inline std::string LZ4Compress(const std::string &Data) {
-	if(Data.empty()) return "";
-	constexpr int MinMatch = 4;
-	std::string Output;
-	HashTable<uint32_t, int> Hashes;
-	int I = 0;
-	while(I < static_cast<int>(Data.size())) {
-		int BestLen = 0, BestOffset = 0;
-		if(I + MinMatch <= static_cast<int>(Data.size())) {
-			uint32_t Hash = 0;
-			for(int k = 0; k < MinMatch; ++k)
-				Hash = (Hash * 257) + static_cast<uint8_t>(Data[I + k]);
-			auto Match = Hashes.Get(Hash);
-			if(Match && I - *Match <= MAX_SLIDING_WINDOW_SIZE) {
-				int J = *Match;
-				int Len = 0;
-				while(I + Len < static_cast<int>(Data.size()) && Data[J + Len] == Data[I + Len] && Len < 255) ++Len;
-				if(Len >= MinMatch) {
-					BestLen = Len;
-					BestOffset = I - J;
-				}
+/* LZ4 block and frame format, compatible with the reference implementation.
+
+A block is a run of sequences. Each sequence has a token, whose high nibble is the literal count and
+low nibble the match length minus 4, with 15 meaning more length bytes follow. Then come the literals,
+a 2-byte little-endian offset back into the output, and the extra match length bytes. The last
+sequence has literals only. The compressor finds matches through a table of the last position seen
+for each multiplicatively hashed 4-byte word, and skips ahead faster the longer it goes without one.
+
+A frame wraps blocks with a magic number, a descriptor, and an XXH32 checksum of the whole content.
+Blocks that do not shrink are stored raw.*/
+namespace LZ4Detail {
+	inline constexpr uint32_t FrameMagic = 0x184D2204u;
+	inline constexpr size_t MinMatch = 4;
+	// Spec limits: the last 5 bytes are always literals and no match starts in the last 12
+	inline constexpr size_t LastLiterals = 5;
+	inline constexpr size_t MatchFindLimit = 12;
+	inline constexpr size_t MaxOffset = 65535;
+	inline constexpr int HashLog = 14;
+	inline constexpr size_t WildCopyLength = 8;
+
+	inline uint32_t Read32(const char *Source) {
+		uint32_t Value;
+		std::memcpy(&Value, Source, sizeof(Value));
+		return Value;
+	}
+
+	inline uint64_t Read64(const char *Source) {
+		uint64_t Value;
+		std::memcpy(&Value, Source, sizeof(Value));
+		return Value;
+	}
+
+	inline uint32_t ReadLittle32(const char *Source) {
+		uint32_t Value = Read32(Source);
+		return std::endian::native == std::endian::little ? Value : std::byteswap(Value);
+	}
+
+	inline void AppendLittle32(std::string &Out, uint32_t Value) {
+		for(int Shift = 0; Shift < 32; Shift += 8) Out += static_cast<char>(Value >> Shift);
+	}
+
+	inline uint32_t Hash(uint32_t Word) { return (Word * 2654435761u) >> (32 - HashLog); }
+
+	// Number of equal bytes at Left and Right, reading no further than Limit on the right
+	inline size_t MatchLength(const char *Left, const char *Right, const char *Limit) {
+		const char *Start = Right;
+		while(Right + 8 <= Limit) {
+			uint64_t Difference = Read64(Left) ^ Read64(Right);
+			if(Difference) {
+				size_t Bytes = std::endian::native == std::endian::little ? std::countr_zero(Difference) / 8 : std::countl_zero(Difference) / 8;
+				return Right - Start + Bytes;
 			}
-			Hashes.Insert(Hash, I);
+			Left += 8;
+			Right += 8;
 		}
-		if(BestLen >= MinMatch) {
-			Output.push_back(0); // Marker for match
-			Output.push_back(static_cast<char>(BestLen));
-			Output.push_back(static_cast<char>(BestOffset >> 8));
-			Output.push_back(static_cast<char>(BestOffset & 0xFF));
-			I += BestLen;
-		} else {
-			Output.push_back(Data[I]);
-			++I;
+		while(Right < Limit && *Left == *Right) {
+			++Left;
+			++Right;
+		}
+		return Right - Start;
+	}
+
+	inline char *WriteLength(char *Out, size_t Length) {
+		for(; Length >= 255; Length -= 255) *Out++ = static_cast<char>(255);
+		*Out++ = static_cast<char>(Length);
+		return Out;
+	}
+
+	inline char *WriteLiterals(char *Out, unsigned MatchNibble, const char *Literals, size_t LiteralCount) {
+		*Out++ = static_cast<char>((std::min<size_t>(LiteralCount, 15) << 4) | MatchNibble);
+		if(LiteralCount >= 15) Out = WriteLength(Out, LiteralCount - 15);
+		std::memcpy(Out, Literals, LiteralCount);
+		return Out + LiteralCount;
+	}
+
+	inline char *WriteSequence(char *Out, const char *Literals, size_t LiteralCount, size_t Offset, size_t MatchCount) {
+		size_t ExtraMatch = MatchCount - MinMatch;
+		Out = WriteLiterals(Out, static_cast<unsigned>(std::min<size_t>(ExtraMatch, 15)), Literals, LiteralCount);
+		*Out++ = static_cast<char>(Offset);
+		*Out++ = static_cast<char>(Offset >> 8);
+		if(ExtraMatch >= 15) Out = WriteLength(Out, ExtraMatch - 15);
+		return Out;
+	}
+
+	// Copies Length bytes 8 at a time; may write up to 7 bytes past the end, which callers leave room for
+	inline void WildCopy(char *Destination, const char *Source, size_t Length) {
+		char *End = Destination + Length;
+		do {
+			std::memcpy(Destination, Source, 8);
+			Destination += 8;
+			Source += 8;
+		} while(Destination < End);
+	}
+
+	[[noreturn]] inline void Corrupt() { throw std::runtime_error("Corrupt LZ4 data"); }
+
+	inline size_t ReadLength(const char *&Cursor, const char *End) {
+		size_t Length = 0;
+		unsigned char Byte;
+		do {
+			if(Cursor >= End) Corrupt();
+			Byte = static_cast<unsigned char>(*Cursor++);
+			Length += Byte;
+		} while(Byte == 255);
+		return Length;
+	}
+}
+
+// Largest size a block of Size bytes can compress to
+inline constexpr size_t LZ4CompressBound(size_t Size) { return Size + Size / 255 + 16; }
+
+// Appends Data compressed as one LZ4 block to Out; Table is scratch of 1 << 14 entries the caller may reuse
+inline void LZ4CompressBlock(std::string_view Data, std::string &Out, uint32_t *Table) {
+	using namespace LZ4Detail;
+	const char *Base = Data.data();
+	const char *Anchor = Base;
+	const char *End = Base + Data.size();
+	size_t Start = Out.size();
+	Out.resize(Start + LZ4CompressBound(Data.size()));
+	char *Op = Out.data() + Start;
+	if(Data.size() >= MatchFindLimit + 1) {
+		std::fill_n(Table, size_t(1) << HashLog, 0);
+		const char *MatchLimit = End - LastLiterals;
+		const char *SearchLimit = End - MatchFindLimit;
+		const char *Cursor = Base + 1;
+		while(Cursor < SearchLimit) {
+			// Skip faster through data that does not compress
+			size_t Attempts = 1 << 6;
+			const char *Match = nullptr;
+			for(const char *Next = Cursor; Next < SearchLimit; Cursor = Next) {
+				Next = Cursor + (Attempts++ >> 6);
+				uint32_t Word = Read32(Cursor);
+				uint32_t &Slot = Table[Hash(Word)];
+				const char *Candidate = Base + Slot;
+				Slot = static_cast<uint32_t>(Cursor - Base);
+				if(Candidate < Cursor && static_cast<size_t>(Cursor - Candidate) <= MaxOffset && Read32(Candidate) == Word) {
+					Match = Candidate;
+					break;
+				}
+			}
+			if(!Match) break;
+			// Extend backwards over literals that also match
+			while(Cursor > Anchor && Match > Base && Cursor[-1] == Match[-1]) {
+				--Cursor;
+				--Match;
+			}
+			size_t Length = MinMatch + MatchLength(Match + MinMatch, Cursor + MinMatch, MatchLimit);
+			Op = WriteSequence(Op, Anchor, Cursor - Anchor, Cursor - Match, Length);
+			Cursor += Length;
+			Anchor = Cursor;
+			if(Cursor >= SearchLimit) break;
+			// Positions inside the match are worth finding again
+			Table[Hash(Read32(Cursor - 2))] = static_cast<uint32_t>(Cursor - 2 - Base);
 		}
 	}
-	return Output;
+	Op = WriteLiterals(Op, 0, Anchor, End - Anchor);
+	Out.resize(Op - Out.data());
 }
 
-inline std::string LZ4Decompress(const std::string &Data) {
-	if(Data.empty()) return "";
-	std::string Output;
-	for(size_t I = 0; I < Data.size();) {
-		if(Data[I] == 0 && I + 3 < Data.size()) {
-			int Len = static_cast<uint8_t>(Data[I + 1]);
-			int Offset = (static_cast<uint8_t>(Data[I + 2]) << 8) | static_cast<uint8_t>(Data[I + 3]);
-			if(Offset > 0 && Output.size() >= static_cast<size_t>(Offset)) {
-				size_t Start = Output.size() - Offset;
-				for(int k = 0; k < Len; ++k)
-					Output.push_back(Output[Start + k]);
-				I += 4;
+/* Decodes the block in Source into Destination and returns the bytes written. Matches may reach back
+as far as Prefix, which is Destination for an independent block or the start of earlier output for a
+linked one. Capacity counts from Destination; copies run ahead in 8-byte steps while they stay inside
+it and fall back to exact copies near the end. Malformed input throws instead of reading or writing
+out of bounds.*/
+inline size_t LZ4DecompressBlock(std::string_view Source, char *Destination, size_t Capacity, const char *Prefix) {
+	using namespace LZ4Detail;
+	const char *Cursor = Source.data();
+	const char *End = Cursor + Source.size();
+	char *Out = Destination;
+	char *OutEnd = Destination + Capacity;
+	while(true) {
+		if(Cursor >= End) Corrupt();
+		unsigned Token = static_cast<unsigned char>(*Cursor++);
+		size_t Literals = Token >> 4;
+		/* Shortcut for the common short sequence: with room to spare on both sides, 16 bytes of literals
+		and 18 of match are copied blindly, whatever the real lengths, and the excess is overwritten later.*/
+		if(Literals < 15 && (Token & 15) < 15 && End - Cursor >= 32 && OutEnd - Out >= 40) {
+			std::memcpy(Out, Cursor, 16);
+			Out += Literals;
+			Cursor += Literals;
+			size_t Offset = static_cast<unsigned char>(Cursor[0]) | static_cast<size_t>(static_cast<unsigned char>(Cursor[1])) << 8;
+			const char *Match = Out - Offset;
+			if(Offset >= WildCopyLength && Offset <= static_cast<size_t>(Out - Prefix)) {
+				Cursor += 2;
+				std::memcpy(Out, Match, 8);
+				std::memcpy(Out + 8, Match + 8, 8);
+				std::memcpy(Out + 16, Match + 16, 2);
+				Out += (Token & 15) + MinMatch;
 				continue;
 			}
+			// Let the careful path below deal with the match
+			Token &= 15;
+			Literals = 0;
+		}
+		if(Literals == 15) Literals += ReadLength(Cursor, End);
+		if(Literals > static_cast<size_t>(End - Cursor) || Literals > static_cast<size_t>(OutEnd - Out)) Corrupt();
+		if(Literals + WildCopyLength <= static_cast<size_t>(End - Cursor) && Literals + WildCopyLength <= static_cast<size_t>(OutEnd - Out)) {
+			if(Literals) WildCopy(Out, Cursor, Literals);
+		} else {
+			std::memcpy(Out, Cursor, Literals);
+		}
+		Out += Literals;
+		Cursor += Literals;
+		if(Cursor == End) break;
+		if(End - Cursor < 2) Corrupt();
+		size_t Offset = static_cast<unsigned char>(Cursor[0]) | static_cast<size_t>(static_cast<unsigned char>(Cursor[1])) << 8;
+		Cursor += 2;
+		if(!Offset || Offset > static_cast<size_t>(Out - Prefix)) Corrupt();
+		size_t Length = Token & 15;
+		if(Length == 15) Length += ReadLength(Cursor, End);
+		Length += MinMatch;
+		if(Length > static_cast<size_t>(OutEnd - Out)) Corrupt();
+		const char *Match = Out - Offset;
+		if(Offset >= WildCopyLength && Length + WildCopyLength <= static_cast<size_t>(OutEnd - Out)) {
+			WildCopy(Out, Match, Length);
+		} else {
+			// Overlapping matches repeat their last Offset bytes, so they go one byte at a time
+			for(size_t i = 0; i < Length; ++i) Out[i] = Match[i];
 		}
-		Output.push_back(Data[I]);
-		++I;
+		Out += Length;
 	}
-	return Output;
+	return Out - Destination;
+}
+
+/* Compresses Data into a single LZ4 frame. Blocks are independent and at most BlockSize bytes; the
+descriptor records the content size, and the frame ends with an XXH32 of the content.*/
+inline std::string LZ4Compress(std::string_view Data) {
+	using namespace LZ4Detail;
+	constexpr size_t BlockSize = 4 << 20;
+	std::string Out;
+	Out.reserve(LZ4CompressBound(Data.size()) + 32);
+	AppendLittle32(Out, FrameMagic);
+	size_t Descriptor = Out.size();
+	// Version 01, independent blocks, content size, content checksum; 4 MB blocks
+	Out += static_cast<char>(0x40 | 0x20 | 0x08 | 0x04);
+	Out += static_cast<char>(7 << 4);
+	uint64_t ContentSize = Data.size();
+	for(int Shift = 0; Shift < 64; Shift += 8) Out += static_cast<char>(ContentSize >> Shift);
+	Out += static_cast<char>(XXHash32(std::string_view(Out).substr(Descriptor)) >> 8);
+	auto Table = std::make_unique<uint32_t[]>(size_t(1) << HashLog);
+	for(size_t Start = 0; Start < Data.size(); Start += BlockSize) {
+		std::string_view Block = Data.substr(Start, BlockSize);
+		size_t Header = Out.size();
+		AppendLittle32(Out, 0);
+		LZ4CompressBlock(Block, Out, Table.get());
+		size_t Compressed = Out.size() - Header - 4;
+		uint32_t Size = static_cast<uint32_t>(Compressed);
+		if(Compressed >= Block.size()) {
+			// Did not shrink: stored as is, flagged by the high bit of its size
+			Out.resize(Header + 4);
+			Out.append(Block);
+			Size = static_cast<uint32_t>(Block.size()) | 0x80000000u;
+		}
+		for(int i = 0; i < 4; ++i) Out[Header + i] = static_cast<char>(Size >> (8 * i));
+	}
+	AppendLittle32(Out, 0);
+	AppendLittle32(Out, XXHash32(Data));
+	return Out;
+}
+
+/* Decodes one LZ4 frame, verifying whichever checksums it carries. Linked blocks and frames without a
+content size are accepted too, so frames from other LZ4 encoders decode.*/
+inline std::string LZ4Decompress(std::string_view Data) {
+	using namespace LZ4Detail;
+	if(Data.size() < 7 || ReadLittle32(Data.data()) != FrameMagic) Corrupt();
+	unsigned Flags = static_cast<unsigned char>(Data[4]);
+	unsigned BlockDescriptor = static_cast<unsigned char>(Data[5]);
+	if((Flags >> 6) != 1 || (Flags & 0x02) || (BlockDescriptor & 0x8F)) Corrupt();
+	bool Linked = !(Flags & 0x20), BlockChecksums = Flags & 0x10, HasSize = Flags & 0x08, ContentChecksum = Flags & 0x04;
+	if(Flags & 0x01) throw std::runtime_error("LZ4 frames with a dictionary are not supported");
+	unsigned SizeCode = BlockDescriptor >> 4;
+	if(SizeCode < 4) Corrupt();
+	size_t MaxBlock = size_t(1) << (8 + 2 * SizeCode);
+	size_t Cursor = 6;
+	uint64_t ContentSize = 0;
+	if(HasSize) {
+		if(Data.size() < Cursor + 9) Corrupt();
+		for(int i = 7; i >= 0; --i) ContentSize = ContentSize << 8 | static_cast<unsigned char>(Data[Cursor + i]);
+		Cursor += 8;
+		// No sequence expands past 255 times its size, so a larger claim is damage, not data to allocate for
+		if(ContentSize / 256 > Data.size()) Corrupt();
+	}
+	if(Cursor >= Data.size() || static_cast<unsigned char>(Data[Cursor]) != ((XXHash32(Data.substr(4, Cursor - 4)) >> 8) & 0xFF)) Corrupt();
+	++Cursor;
+	std::string Out;
+	size_t Produced = 0;
+	if(HasSize) Out.resize(ContentSize + WildCopyLength);
+	while(true) {
+		if(Data.size() - Cursor < 4) Corrupt();
+		uint32_t Size = ReadLittle32(Data.data() + Cursor);
+		Cursor += 4;
+		if(!Size) break;
+		bool Raw = Size & 0x80000000u;
+		Size &= 0x7FFFFFFFu;
+		if(Size > MaxBlock || Data.size() - Cursor < Size + (BlockChecksums ? 4 : 0)) Corrupt();
+		std::string_view Block = Data.substr(Cursor, Size);
+		Cursor += Size;
+		if(BlockChecksums) {
+			if(ReadLittle32(Data.data() + Cursor) != XXHash32(Block)) Corrupt();
+			Cursor += 4;
+		}
+		if(!HasSize && Out.size() - Produced < MaxBlock + WildCopyLength)
+			Out.resize(std::max(Out.size() * 2, Produced + MaxBlock + WildCopyLength));
+		size_t Room = Out.size() - Produced;
+		if(Raw) {
+			if(Block.size() > Room) Corrupt();
+			std::memcpy(Out.data() + Produced, Block.data(), Block.size());
+			Produced += Block.size();
+		} else {
+			Produced += LZ4DecompressBlock(Block, Out.data() + Produced, Room, Linked ? Out.data() : Out.data() + Produced);
+		}
+	}
+	if(HasSize && Produced != ContentSize) Corrupt();
+	Out.resize(Produced);
+	if(ContentChecksum) {
+		if(Data.size() - Cursor < 4 || ReadLittle32(Data.data() + Cursor) != XXHash32(Out)) Corrupt();
+		Cursor += 4;
+	}
+	return Out;
+}
 }
 }
-}
\ No newline at end of file
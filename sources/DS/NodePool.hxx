@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace AstralDB {
+namespace DS {
+/* Fixed-size object pool for tree nodes. Nodes are carved out of chunks that never move, so raw
+pointers between nodes stay valid, and destroyed nodes are recycled through an intrusive free list.*/
+template<class T, size_t ChunkNodes = 64> class NodePool {
+	struct alignas(T) Slot {
+		std::byte Storage[sizeof(T) < sizeof(void*) ? sizeof(void*) : sizeof(T)];
+	};
+
+	std::vector<std::unique_ptr<Slot[]>> Chunks_;
+	size_t Used_ = ChunkNodes;
+	Slot *FreeList_ = nullptr;
+	size_t Live_ = 0;
+
+public:
+	NodePool() = default;
+	NodePool(const NodePool&) = delete;
+	NodePool &operator=(const NodePool&) = delete;
+	NodePool(NodePool &&Other) noexcept
+		: Chunks_(std::move(Other.Chunks_)), Used_(std::exchange(Other.Used_, ChunkNodes)),
+		  FreeList_(std::exchange(Other.FreeList_, nullptr)), Live_(std::exchange(Other.Live_, 0)) {}
+	NodePool &operator=(NodePool &&Other) noexcept {
+		if(this != &Other) {
+			Chunks_ = std::move(Other.Chunks_);
+			Used_ = std::exchange(Other.Used_, ChunkNodes);
+			FreeList_ = std::exchange(Other.FreeList_, nullptr);
+			Live_ = std::exchange(Other.Live_, 0);
+		}
+		return *this;
+	}
+
+	// Objects still alive when the pool goes away are not destroyed; owners must Destroy them first
+	template<class... Args> T *Create(Args&&... Arguments) {
+		Slot *Memory;
+		if(FreeList_) {
+			Memory = FreeList_;
+			FreeList_ = *reinterpret_cast<Slot**>(Memory);
+		} else {
+			if(Used_ == ChunkNodes) {
+				Chunks_.push_back(std::make_unique<Slot[]>(ChunkNodes));
+				Used_ = 0;
+			}
+			Memory = &Chunks_.back()[Used_++];
+		}
+		T *Object = ::new(static_cast<void*>(Memory)) T(std::forward<Args>(Arguments)...);
+		++Live_;
+		return Object;
+	}
+
+	void Destroy(T *Object) {
+		if(!Object) return;
+		Object->~T();
+		Slot *Memory = reinterpret_cast<Slot*>(Object);
+		*reinterpret_cast<Slot**>(Memory) = FreeList_;
+		FreeList_ = Memory;
+		--Live_;
+	}
+
+	size_t Live() const { return Live_; }
+	size_t Capacity() const { return Chunks_.size() * ChunkNodes; }
+};
+}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace AstralDB {
+namespace DS {
+/* Sorted set of ids stored under one index key. The first few ids live inline so unique and
+near-unique keys never allocate; longer lists (low-cardinality columns) spill to one sorted vector.*/
+template<class T, size_t InlineCapacity = 2> class PostingList {
+	std::array<T, InlineCapacity> Inline_{};
+	uint32_t InlineSize_ = 0;
+	std::vector<T> Spilled_;
+
+	bool IsSpilled() const { return !Spilled_.empty(); }
+
+public:
+	PostingList() = default;
+	explicit PostingList(const T &Id) { Insert(Id); }
+
+	// Returns false if the id was already present
+	bool Insert(const T &Id) {
+		if(IsSpilled()) {
+			auto It = std::lower_bound(Spilled_.begin(), Spilled_.end(), Id);
+			if(It != Spilled_.end() && *It == Id) return false;
+			Spilled_.insert(It, Id);
+			return true;
+		}
+		auto Begin = Inline_.begin(), End = Inline_.begin() + InlineSize_;
+		auto It = std::lower_bound(Begin, End, Id);
+		if(It != End && *It == Id) return false;
+		if(InlineSize_ < InlineCapacity) {
+			std::move_backward(It, End, End + 1);
+			*It = Id;
+			++InlineSize_;
+			return true;
+		}
+		Spilled_.reserve(InlineCapacity * 2);
+		Spilled_.insert(Spilled_.end(), Begin, It);
+		Spilled_.push_back(Id);
+		Spilled_.insert(Spilled_.end(), It, End);
+		InlineSize_ = 0;
+		return true;
+	}
+
+	bool Erase(const T &Id) {
+		if(IsSpilled()) {
+			auto It = std::lower_bound(Spilled_.begin(), Spilled_.end(), Id);
+			if(It == Spilled_.end() || !(*It == Id)) return false;
+			Spilled_.erase(It);
+			// Fall back inline once the list is short again
+			if(Spilled_.size() <= InlineCapacity) {
+				std::copy(Spilled_.begin(), Spilled_.end(), Inline_.begin());
+				InlineSize_ = static_cast<uint32_t>(Spilled_.size());
+				std::vector<T>().swap(Spilled_);
+			}
+			return true;
+		}
+		auto Begin = Inline_.begin(), End = Inline_.begin() + InlineSize_;
+		auto It = std::lower_bound(Begin, End, Id);
+		if(It == End || !(*It == Id)) return false;
+		std::move(It + 1, End, It);
+		--InlineSize_;
+		return true;
+	}
+
+	bool Contains(const T &Id) const {
+		auto Ids = Items();
+		return std::binary_search(Ids.begin(), Ids.end(), Id);
+	}
+
+	std::span<const T> Items() const {
+		if(IsSpilled()) return {Spilled_.data(), Spilled_.size()};
+		return {Inline_.data(), InlineSize_};
+	}
+
+	const T *begin() const { return Items().data(); }
+	const T *end() const { return Items().data() + Items().size(); }
+
+	size_t Size() const { return IsSpilled() ? Spilled_.size() : InlineSize_; }
+	bool Empty() const { return Size() == 0; }
+};
+}
+}
@@ -143,12 +143,20 @@ public:
 		});
 	}
 
-	// Return the raw pointer type for unique_ptr values
-	using RawPtrType = typename std::pointer_traits<decltype(std::declval<ValueType>().get())>::element_type*;
+	// Return the raw pointer type for smart pointer values; raw pointer values are returned as is
+	template<class T> struct RawPointer {
+		using Type = typename std::pointer_traits<decltype(std::declval<T>().get())>::element_type*;
+		static Type Get(const T &Value) { return Value.get(); }
+	};
+	template<class T> struct RawPointer<T*> {
+		using Type = T*;
+		static Type Get(T *Value) { return Value; }
+	};
+	using RawPtrType = typename RawPointer<ValueType>::Type;
 	RawPtrType Find(const KeyType& Key, size_t Depth = 0) const {
 		SpinlockGuard lock(Mutex_);
 		if (Depth == Key.size()) {
-			if (Value_) return Value_->get();
+			if (Value_) return RawPointer<ValueType>::Get(*Value_);
 			return nullptr;
 		}
 		const std::string_view RemainingKey = std::string_view(Key).substr(Depth);
@@ -1,194 +1,307 @@
 #pragma once
 
-#include <vector>
+#include <DS/Epoch.hxx>
+#include <IO/Spinlock.hxx>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <optional>
+#include <thread>
 #include <utility>
 
 namespace AstralDB {
-template<class Key, class Value> class SkipList {
-    std::vector<std::vector<std::pair<Key, Value>>> Nodes_;
-public:
-    SkipList() {}
-
-    void Insert(const Key &key, const Value &value) {
-        std::vector<std::pair<Key, Value>> new_node;
-        new_node.push_back(std::make_pair(key, value));
-        for(int i = 0; i < 16; i++) {
-            if(i >= static_cast<int>(Nodes_.size())) {
-                Nodes_.push_back(new_node);
-                break;
-            }
-            if(Nodes_[i].empty()) {
-                Nodes_[i] = new_node;
-                break;
-            }
-            if(Nodes_[i][0].first > key)
-                std::swap(Nodes_[i], new_node);
+/* Lock-free ordered map. Every node owns a tower of next links, one per level it reaches, and all
+links are changed with CAS. Erasing first marks the low bit of each link in the node's tower, top
+to bottom. Any traversal that meets a marked link unlinks that node. A node is handed to DS::Epoch
+only after both its inserter has stopped building the tower and its remover has finished marking
+it, so it is never reachable once it is freed.
+
+Values may be arbitrary objects. Each node guards its value with a small latch, so the structure of
+the list stays lock-free while two writers to the same key still serialize.*/
+template<class Key, class Value, class Compare = std::less<Key>> class SkipList {
+    static constexpr size_t MaxHeight = 16;
+
+    struct Node {
+        const Key KeyValue;
+        Value Val;
+        Spinlock ValueLock;
+        bool Deleted = false;
+        // Released once by the inserter and once by the remover; the last one retires the node
+        std::atomic<uint8_t> Owners{2};
+        const uint8_t Height;
+        std::atomic<uintptr_t> *const Tower;
+
+        Node(const Key &KeyValueIn, uint8_t HeightIn)
+            : KeyValue(KeyValueIn), Height(HeightIn), Tower(reinterpret_cast<std::atomic<uintptr_t>*>(this + 1)) {
+            for(size_t i = 0; i < Height; ++i) ::new(static_cast<void*>(Tower + i)) std::atomic<uintptr_t>(0);
         }
-    }
-
-    void Erase(const Key &key) {
-        for(int i = 0; i < 16; i++) {
-            if(i >= static_cast<int>(Nodes_.size()))
-                break;
-            if(Nodes_[i].empty())
-                break;
-            if(Nodes_[i][0].first == key) {
-                Nodes_[i].clear();
-                break;
+    };
+
+    static_assert(alignof(Node) >= alignof(std::atomic<uintptr_t>));
+
+    Compare Compare_;
+    Node *Head_;
+    std::atomic<size_t> Size_{0};
+
+    static Node *Create(const Key &KeyValue, uint8_t Height) {
+        void *Memory = ::operator new(sizeof(Node) + Height * sizeof(std::atomic<uintptr_t>));
+        return ::new(Memory) Node(KeyValue, Height);
+    }
+
+    static void Destroy(void *Pointer) {
+        Node *Target = static_cast<Node*>(Pointer);
+        Target->~Node();
+        ::operator delete(Pointer);
+    }
+
+    static Node *Pointer(uintptr_t Link) { return reinterpret_cast<Node*>(Link & ~uintptr_t(1)); }
+    static bool Marked(uintptr_t Link) { return Link & 1; }
+    static uintptr_t LinkTo(Node *Target) { return reinterpret_cast<uintptr_t>(Target); }
+
+    // Each level is reached with probability 1/4, which keeps towers short and scans cache friendly
+    static uint8_t RandomHeight() {
+        thread_local uint64_t State = 0x9E3779B97F4A7C15ull ^ reinterpret_cast<uintptr_t>(&State);
+        State ^= State << 13;
+        State ^= State >> 7;
+        State ^= State << 17;
+        return static_cast<uint8_t>(std::min<size_t>(1 + std::countr_zero(State | (uint64_t(1) << 62)) / 2, MaxHeight));
+    }
+
+    bool Equivalent(const Key &A, const Key &B) const { return !Compare_(A, B) && !Compare_(B, A); }
+
+    /* Records the last node before KeyValue and the first one at or after it on every level,
+    unlinking marked nodes in the way. Returns false when a CAS lost a race and the walk must restart.*/
+    bool TrySearch(const Key &KeyValue, std::array<Node*, MaxHeight> &Preds, std::array<Node*, MaxHeight> &Succs) {
+        Node *Pred = Head_;
+        for(size_t Level = MaxHeight; Level-- > 0;) {
+            Node *Current = Pointer(Pred->Tower[Level].load(std::memory_order_acquire));
+            while(Current) {
+                uintptr_t Next = Current->Tower[Level].load(std::memory_order_acquire);
+                if(Marked(Next)) {
+                    uintptr_t Expected = LinkTo(Current);
+                    if(!Pred->Tower[Level].compare_exchange_strong(Expected, Next & ~uintptr_t(1), std::memory_order_acq_rel))
+                        return false;
+                    Current = Pointer(Next);
+                    continue;
+                }
+                if(!Compare_(Current->KeyValue, KeyValue)) break;
+                Pred = Current;
+                Current = Pointer(Next);
             }
+            Preds[Level] = Pred;
+            Succs[Level] = Current;
         }
+        return true;
     }
 
-    Value Find(const Key &key) {
-        for(int i = 0; i < 16; i++) {
-            if(i >= static_cast<int>(Nodes_.size()))
-                break;
-            if(Nodes_[i].empty())
-                break;
-            if(Nodes_[i][0].first == key)
-                return Nodes_[i][0].second;
-        }
-        return Value();
+    // Node holding KeyValue after a successful search, or null
+    Node *Search(const Key &KeyValue, std::array<Node*, MaxHeight> &Preds, std::array<Node*, MaxHeight> &Succs) {
+        while(!TrySearch(KeyValue, Preds, Succs)) std::this_thread::yield();
+        Node *Found = Succs[0];
+        return Found && Equivalent(Found->KeyValue, KeyValue) ? Found : nullptr;
     }
 
-    void Clear() {
-        Nodes_.clear();
-    }
-
-    size_t Size() {
-        size_t size = 0;
-        for(int i = 0; i < 16; i++) {
-            if(i >= static_cast<int>(Nodes_.size()))
-                break;
-            if(Nodes_[i].empty())
-                break;
-            size++;
+    // Read-only descent that neither helps unlink nor restarts; may return a node that is being erased
+    Node *Lookup(const Key &KeyValue) const {
+        Node *Pred = Head_;
+        Node *Current = nullptr;
+        for(size_t Level = MaxHeight; Level-- > 0;) {
+            Current = Pointer(Pred->Tower[Level].load(std::memory_order_acquire));
+            while(Current && Compare_(Current->KeyValue, KeyValue)) {
+                Pred = Current;
+                Current = Pointer(Current->Tower[Level].load(std::memory_order_acquire));
+            }
         }
-        return size;
-    }
-
-    bool Empty() {
-        return Size() == 0;
-    }
-
-    std::vector<std::pair<Key, Value>> Nodes() const {
-        return Nodes_;
-    }
-
-    void SetNodes(const std::vector<std::pair<Key, Value>> &Nodes) {
-        Nodes_ = Nodes;
-    }
-
-    std::vector<std::pair<Key, Value>> &operator[](size_t Index) {
-        return Nodes_[Index];
-    }
-
-    const std::vector<std::pair<Key, Value>> &operator[](size_t Index) const {
-        return Nodes_[Index];
-    }
-
-    std::vector<std::pair<Key, Value>> &At(size_t Index) {
-        return Nodes_.at(Index);
-    }
-
-    const std::vector<std::pair<Key, Value>> &At(size_t Index) const {
-        return Nodes_.at(Index);
-    }
-
-    std::vector<std::pair<Key, Value>> &Front() {
-        return Nodes_.front();
-    }
-
-    const std::vector<std::pair<Key, Value>> &Front() const {
-        return Nodes_.front();
+        return Current && Equivalent(Current->KeyValue, KeyValue) ? Current : nullptr;
     }
 
-    std::vector<std::pair<Key, Value>> &Back() {
-        return Nodes_.back();
-    }
-
-    const std::vector<std::pair<Key, Value>> &Back() const {
-        return Nodes_.back();
-    }
-
-    std::vector<std::pair<Key, Value>> &First() {
-        return Nodes_.front();
-    }
-
-    const std::vector<std::pair<Key, Value>> &First() const {
-        return Nodes_.front();
-    }
-
-    std::vector<std::pair<Key, Value>> &Last() {
-        return Nodes_.back();
-    }
-
-    const std::vector<std::pair<Key, Value>> &Last() const {
-        return Nodes_.back();
-    }
-
-    std::vector<std::pair<Key, Value>> &Top() {
-        return Nodes_.front();
-    }
-
-    const std::vector<std::pair<Key, Value>> &Top() const {
-        return Nodes_.front();
-    }
-
-    std::vector<std::pair<Key, Value>> &Bottom() {
-        return Nodes_.back();
-    }
-
-    const std::vector<std::pair<Key, Value>> &Bottom() const {
-        return Nodes_.back();
+    // First node not less than KeyValue on the bottom level
+    Node *LowerBound(const Key &KeyValue) const {
+        Node *Pred = Head_;
+        for(size_t Level = MaxHeight; Level-- > 0;) {
+            Node *Current = Pointer(Pred->Tower[Level].load(std::memory_order_acquire));
+            while(Current && Compare_(Current->KeyValue, KeyValue)) {
+                Pred = Current;
+                Current = Pointer(Current->Tower[Level].load(std::memory_order_acquire));
+            }
+        }
+        return Pointer(Pred->Tower[0].load(std::memory_order_acquire));
+    }
+
+    // Drops one ownership; the last owner makes sure the node is unlinked everywhere, then retires it
+    void Release(Node *Target) {
+        if(Target->Owners.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        std::array<Node*, MaxHeight> Preds, Succs;
+        Search(Target->KeyValue, Preds, Succs);
+        DS::Epoch::Retire(Target, &Destroy);
+    }
+
+    // Marks the tower top-down; the bottom mark is what makes the erase visible to traversals
+    void Unlink(Node *Target) {
+        for(size_t Level = Target->Height; Level-- > 0;)
+            Target->Tower[Level].fetch_or(1, std::memory_order_acq_rel);
+        std::array<Node*, MaxHeight> Preds, Succs;
+        Search(Target->KeyValue, Preds, Succs);
+        Size_.fetch_sub(1, std::memory_order_relaxed);
+        Release(Target);
+    }
+
+    // Links the upper levels of a node already published on level 0
+    void BuildTower(Node *Target, std::array<Node*, MaxHeight> &Preds, std::array<Node*, MaxHeight> &Succs) {
+        for(size_t Level = 1; Level < Target->Height; ++Level) {
+            for(;;) {
+                uintptr_t Own = Target->Tower[Level].load(std::memory_order_acquire);
+                // A remover got here first; the tower stays as tall as it is
+                if(Marked(Own)) return;
+                if(Pointer(Own) != Succs[Level] &&
+                   !Target->Tower[Level].compare_exchange_strong(Own, LinkTo(Succs[Level]), std::memory_order_acq_rel))
+                    continue;
+                uintptr_t Expected = LinkTo(Succs[Level]);
+                if(Preds[Level]->Tower[Level].compare_exchange_strong(Expected, LinkTo(Target), std::memory_order_acq_rel))
+                    break;
+                if(Search(Target->KeyValue, Preds, Succs) != Target) return;
+            }
+        }
     }
 
-    std::vector<std::pair<Key, Value>> &begin() {
-        return Nodes_.front();
-    }
+public:
+    SkipList() : Head_(Create(Key(), MaxHeight)) {}
 
-    const std::vector<std::pair<Key, Value>> &eegin() const {
-        return Nodes_.front();
+    ~SkipList() {
+        for(Node *Current = Head_; Current;) {
+            Node *Next = Pointer(Current->Tower[0].load(std::memory_order_relaxed));
+            Destroy(Current);
+            Current = Next;
+        }
     }
 
-    std::vector<std::pair<Key, Value>> &end() {
-        return Nodes_.back();
-    }
+    SkipList(const SkipList&) = delete;
+    SkipList &operator=(const SkipList&) = delete;
 
-    const std::vector<std::pair<Key, Value>> &end() const {
-        return Nodes_.back();
-    }
+    // Moves are not concurrent operations; no other thread may be using either list
+    SkipList(SkipList &&Other) noexcept
+        : Compare_(std::move(Other.Compare_)), Head_(std::exchange(Other.Head_, Create(Key(), MaxHeight))),
+          Size_(Other.Size_.exchange(0, std::memory_order_relaxed)) {}
 
-    std::vector<std::pair<Key, Value>> &rbegin() {
-        return Nodes_.back();
+    SkipList &operator=(SkipList &&Other) noexcept {
+        if(this != &Other) {
+            std::swap(Compare_, Other.Compare_);
+            std::swap(Head_, Other.Head_);
+            Size_.store(Other.Size_.exchange(Size_.load(std::memory_order_relaxed), std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        return *this;
+    }
+
+    /* Calls Modify(Value&) on the entry for KeyValue under its latch, creating the entry with a
+    default value first if absent. Returns true if the entry was created.*/
+    template<typename Func> bool Upsert(const Key &KeyValue, Func &&Modify) {
+        DS::Epoch::Guard Pin;
+        std::array<Node*, MaxHeight> Preds, Succs;
+        Node *Created = nullptr;
+        for(;;) {
+            if(Node *Found = Search(KeyValue, Preds, Succs)) {
+                {
+                    SpinlockGuard Guard(Found->ValueLock);
+                    if(!Found->Deleted) {
+                        Modify(Found->Val);
+                        if(Created) Destroy(Created);
+                        return false;
+                    }
+                }
+                // Erased but not unlinked yet; a later search helps it out of the way
+                std::this_thread::yield();
+                continue;
+            }
+            if(!Created) {
+                Created = Create(KeyValue, RandomHeight());
+                // Held until the value is initialized, so nobody sees the default-constructed one
+                Created->ValueLock.Lock();
+            }
+            for(size_t Level = 0; Level < Created->Height; ++Level)
+                Created->Tower[Level].store(LinkTo(Succs[Level]), std::memory_order_relaxed);
+            uintptr_t Expected = LinkTo(Succs[0]);
+            if(Preds[0]->Tower[0].compare_exchange_strong(Expected, LinkTo(Created), std::memory_order_acq_rel))
+                break;
+        }
+        Size_.fetch_add(1, std::memory_order_relaxed);
+        Modify(Created->Val);
+        Created->ValueLock.Unlock();
+        BuildTower(Created, Preds, Succs);
+        Release(Created);
+        return true;
+    }
+
+    // Inserts or overwrites; returns true if KeyValue was new
+    bool Insert(const Key &KeyValue, Value Val) {
+        return Upsert(KeyValue, [&](Value &Slot) { Slot = std::move(Val); });
+    }
+
+    /* Calls Modify(Value&) on the entry for KeyValue under its latch and erases the entry when
+    Modify returns true. Returns false if the key is absent.*/
+    template<typename Func> bool Update(const Key &KeyValue, Func &&Modify) {
+        DS::Epoch::Guard Pin;
+        Node *Found = Lookup(KeyValue);
+        if(!Found) return false;
+        {
+            SpinlockGuard Guard(Found->ValueLock);
+            if(Found->Deleted) return false;
+            if(!Modify(Found->Val)) return true;
+            Found->Deleted = true;
+        }
+        Unlink(Found);
+        return true;
     }
 
-    const std::vector<std::pair<Key, Value>> &rbegin() const {
-        return Nodes_.back();
+    bool Erase(const Key &KeyValue) {
+        return Update(KeyValue, [](Value&) { return true; });
     }
 
-    std::vector<std::pair<Key, Value>> &rend() {
-        return Nodes_.front();
+    // Calls F(const Value&) for the entry of KeyValue; returns false if there is none
+    template<typename Func> bool Visit(const Key &KeyValue, Func &&F) const {
+        DS::Epoch::Guard Pin;
+        Node *Found = Lookup(KeyValue);
+        if(!Found) return false;
+        SpinlockGuard Guard(Found->ValueLock);
+        if(Found->Deleted) return false;
+        F(static_cast<const Value&>(Found->Val));
+        return true;
     }
 
-    const std::vector<std::pair<Key, Value>> &rend() const {
-        return Nodes_.front();
+    std::optional<Value> Find(const Key &KeyValue) const {
+        std::optional<Value> Result;
+        Visit(KeyValue, [&](const Value &Found) { Result = Found; });
+        return Result;
     }
 
-    std::vector<std::pair<Key, Value>> &cbegin() {
-        return Nodes_.front();
+    bool Contains(const Key &KeyValue) const {
+        return Visit(KeyValue, [](const Value&) {});
     }
 
-    const std::vector<std::pair<Key, Value>> &cbegin() const {
-        return Nodes_.front();
+    /* Calls F(Key, Value) in key order for every entry in [Lower, Upper]. Entries inserted or
+    erased during the walk may or may not be seen. F runs under the entry's latch and must not
+    write to the same key.*/
+    template<typename Func> void ForEachInRange(const Key &Lower, const Key &Upper, Func &&F) const {
+        DS::Epoch::Guard Pin;
+        for(Node *Current = LowerBound(Lower); Current && !Compare_(Upper, Current->KeyValue);
+            Current = Pointer(Current->Tower[0].load(std::memory_order_acquire))) {
+            SpinlockGuard Guard(Current->ValueLock);
+            if(!Current->Deleted) F(Current->KeyValue, static_cast<const Value&>(Current->Val));
+        }
     }
 
-    std::vector<std::pair<Key, Value>> &cend() {
-        return Nodes_.back();
+    template<typename Func> void ForEach(Func &&F) const {
+        DS::Epoch::Guard Pin;
+        for(Node *Current = Pointer(Head_->Tower[0].load(std::memory_order_acquire)); Current;
+            Current = Pointer(Current->Tower[0].load(std::memory_order_acquire))) {
+            SpinlockGuard Guard(Current->ValueLock);
+            if(!Current->Deleted) F(Current->KeyValue, static_cast<const Value&>(Current->Val));
+        }
     }
 
-    const std::vector<std::pair<Key, Value>> &cend() const {
-        return Nodes_.back();
-    }
+    size_t Size() const { return Size_.load(std::memory_order_relaxed); }
+    bool Empty() const { return Size() == 0; }
 };
-}
\ No newline at end of file
+}
@@ -6,7 +6,6 @@
 #include <functional>
 #include <ostream>
 #include <string>
-#include <iostream> // For debug logging
 
 namespace AstralDB {
 
@@ -52,11 +51,9 @@ public:
 
     // Add a new root node
     void Add(const T& Value) {
-        std::cout << "[Tree::Add] Adding node (const T&). Current size: " << this->Size() << std::endl;
         Nodes_.push_back(std::make_unique<Node>(Value));
     }
     void Add(T&& Value) {
-        std::cout << "[Tree::Add] Adding node (T&&). Current size: " << this->Size() << std::endl;
         Nodes_.push_back(std::make_unique<Node>(std::move(Value)));
     }
 
@@ -211,7 +208,7 @@ public:
         return *this;
     }
 
-    Tree<T>& operator=(Tree<T>&& Other) noexcept {
+    Tree& operator=(Tree&& Other) noexcept {
         Nodes_ = std::move(Other.Nodes_);
         Compare_ = std::move(Other.Compare_);
         return *this;
@@ -3,42 +3,92 @@
 #include <array>
 #include <cstdint>
 #include <cstring>
+#include <span>
 #include <vector>
 #include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace AstralDB {
+/* XChaCha20 stream cipher (draft-irtf-cfrg-xchacha). HChaCha20 turns the key and the first 16 nonce
+bytes into a subkey, which runs ChaCha20 with the last 8 nonce bytes. The block counter takes words 12
+and 13, so it matches the draft's 32-bit counter and its 4 zero bytes, and keeps going past 2^32 blocks.
+
+The keystream is built several blocks at a time: 8 with AVX2, 4 with SSE2, otherwise 1. Each vector
+holds one state word for every block in the batch and is transposed back into block order at the end.
+It is then XORed into the data a vector at a time. The position is tracked in bytes, so calls may
+split the data anywhere and Seek may jump to any byte.*/
 class XChaCha20 {
 public:
-    XChaCha20(const std::array<uint8_t, 32> &key, const std::array<uint8_t, 24> &nonce, uint32_t counter = 0)
+    XChaCha20(const std::array<uint8_t, 32> &key, const std::array<uint8_t, 24> &nonce, uint64_t counter = 0)
         : Key(key), Nonce(nonce), Counter(counter), Initialized(false) {}
 
     void Encrypt(const std::vector<uint8_t>& Input, std::vector<uint8_t>& Output) {
-        Init();
-        Output.resize(Input.size());
-        size_t Offset = 0;
-        while(Offset < Input.size()) {
-            uint32_t Block[16];
-            ChaCha20Block(SubKey, Counter, ChaChaNonce, Block);
-            Counter++;
-            size_t BlockSize = std::min(static_cast<size_t>(64), Input.size() - Offset);
-            uint8_t* Keystream = reinterpret_cast<uint8_t*>(Block);
-            for(size_t i = 0; i < BlockSize; i++)
-                Output[Offset + i] = Input[Offset + i] ^ Keystream[i];
-            Offset += BlockSize;
-        }
+        Output = Input;
+        Apply(Output.data(), Output.size());
     }
 
     void Decrypt(const std::vector<uint8_t>& Input, std::vector<uint8_t>& Output) {
         Encrypt(Input, Output);
     }
 
+    // XORs the next Size bytes of keystream into Data in place
+    void Apply(uint8_t* Data, size_t Size) {
+        Init();
+        size_t Buffered = std::min(Size, Keystream.size() - Used);
+        Xor(Data, Keystream.data() + Used, Buffered);
+        Used += Buffered;
+        Data += Buffered;
+        Size -= Buffered;
+        for(; Size >= BatchBytes; Data += BatchBytes, Size -= BatchBytes) {
+            Blocks(SubKey, Counter, ChaChaNonce, Keystream.data());
+            Counter += Lanes;
+            Xor(Data, Keystream.data(), BatchBytes);
+        }
+        if(Size) {
+            Blocks(SubKey, Counter, ChaChaNonce, Keystream.data());
+            Counter += Lanes;
+            Xor(Data, Keystream.data(), Size);
+            Used = Size;
+        }
+    }
+
+    void Apply(std::span<uint8_t> Data) { Apply(Data.data(), Data.size()); }
+
+    // Moves to byte Offset of the keystream, counted from block 0
+    void Seek(uint64_t Offset) {
+        Init();
+        Counter = Offset / 64;
+        Used = Keystream.size();
+        if(size_t Skip = Offset % 64) {
+            Blocks(SubKey, Counter, ChaChaNonce, Keystream.data());
+            Counter += Lanes;
+            Used = Skip;
+        }
+    }
+
 private:
+#if defined(__AVX2__)
+    static constexpr size_t Lanes = 8;
+#elif defined(__SSE2__)
+    static constexpr size_t Lanes = 4;
+#else
+    static constexpr size_t Lanes = 1;
+#endif
+    static constexpr size_t BatchBytes = 64 * Lanes;
+
     std::array<uint8_t, 32> Key;
     std::array<uint8_t, 24> Nonce;
-    uint32_t Counter;
+    // Next block to generate; Keystream holds the batch before it, of which Used bytes are spent
+    uint64_t Counter;
     uint32_t SubKey[8];
-    uint32_t ChaChaNonce[3];
+    uint32_t ChaChaNonce[2];
     bool Initialized;
+    alignas(32) std::array<uint8_t, BatchBytes> Keystream{};
+    size_t Used = BatchBytes;
 
     void Init() {
         if(Initialized) return;
@@ -51,7 +101,6 @@ private:
         HChaCha20(KeyWords, NonceWords, SubKey);
         ChaChaNonce[0] = Load32LE(Nonce.data() + 16);
         ChaChaNonce[1] = Load32LE(Nonce.data() + 20);
-        ChaChaNonce[2] = 0;
         Initialized = true;
     }
 
@@ -62,6 +111,13 @@ private:
                (static_cast<uint32_t>(Src[3]) << 24);
     }
 
+    static void Store32LE(uint8_t* Dst, uint32_t Value) {
+        Dst[0] = static_cast<uint8_t>(Value);
+        Dst[1] = static_cast<uint8_t>(Value >> 8);
+        Dst[2] = static_cast<uint8_t>(Value >> 16);
+        Dst[3] = static_cast<uint8_t>(Value >> 24);
+    }
+
     static inline uint32_t Rotate(uint32_t V, int C) {
         return (V << C) | (V >> (32 - C));
     }
@@ -73,12 +129,48 @@ private:
         C += D; B ^= C; B = Rotate(B, 7);
     }
 
-    static void ChaCha20Block(const uint32_t Key[8], uint32_t Counter, const uint32_t Nonce[3], uint32_t Out[16]) {
+    static void Xor(uint8_t* Data, const uint8_t* Stream, size_t Size) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        for(; i + 32 <= Size; i += 32) {
+            __m256i Value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Data + i));
+            __m256i Mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Stream + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(Data + i), _mm256_xor_si256(Value, Mask));
+        }
+#elif defined(__SSE2__)
+        for(; i + 16 <= Size; i += 16) {
+            __m128i Value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Data + i));
+            __m128i Mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Stream + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(Data + i), _mm_xor_si128(Value, Mask));
+        }
+#endif
+        for(; i + 8 <= Size; i += 8) {
+            uint64_t Value, Mask;
+            std::memcpy(&Value, Data + i, 8);
+            std::memcpy(&Mask, Stream + i, 8);
+            Value ^= Mask;
+            std::memcpy(Data + i, &Value, 8);
+        }
+        for(; i < Size; i++) Data[i] ^= Stream[i];
+    }
+
+    // Writes blocks Counter .. Counter + Lanes - 1 of the keystream to Out
+    static void Blocks(const uint32_t Key[8], uint64_t Counter, const uint32_t Nonce[2], uint8_t* Out) {
+#if defined(__AVX2__)
+        Blocks8(Key, Counter, Nonce, Out);
+#elif defined(__SSE2__)
+        Blocks4(Key, Counter, Nonce, Out);
+#else
+        ChaCha20Block(Key, Counter, Nonce, Out);
+#endif
+    }
+
+    static void ChaCha20Block(const uint32_t Key[8], uint64_t Counter, const uint32_t Nonce[2], uint8_t Out[64]) {
         uint32_t State[16] = {
             0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
             Key[0],     Key[1],     Key[2],     Key[3],
             Key[4],     Key[5],     Key[6],     Key[7],
-            Counter,    Nonce[0],   Nonce[1],   Nonce[2]
+            static_cast<uint32_t>(Counter), static_cast<uint32_t>(Counter >> 32), Nonce[0], Nonce[1]
         };
         uint32_t Working[16];
         std::memcpy(Working, State, sizeof(State));
@@ -93,8 +185,126 @@ private:
             QuarterRound(Working[3], Working[4], Working[9],  Working[14]);
         }
         for(int i = 0; i < 16; i++)
-            Out[i] = Working[i] + State[i];
+            Store32LE(Out + 4 * i, Working[i] + State[i]);
+    }
+
+#if defined(__AVX2__)
+    static __m256i Rotate8x(__m256i V, int C) {
+        return _mm256_or_si256(_mm256_slli_epi32(V, C), _mm256_srli_epi32(V, 32 - C));
+    }
+
+    static void QuarterRound8x(__m256i &A, __m256i &B, __m256i &C, __m256i &D) {
+        // 16 and 8 bit rotations are byte shuffles
+        const __m256i Rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                               2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+        const __m256i Rot8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                              3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+        A = _mm256_add_epi32(A, B); D = _mm256_shuffle_epi8(_mm256_xor_si256(D, A), Rot16);
+        C = _mm256_add_epi32(C, D); B = Rotate8x(_mm256_xor_si256(B, C), 12);
+        A = _mm256_add_epi32(A, B); D = _mm256_shuffle_epi8(_mm256_xor_si256(D, A), Rot8);
+        C = _mm256_add_epi32(C, D); B = Rotate8x(_mm256_xor_si256(B, C), 7);
+    }
+
+    static void Blocks8(const uint32_t Key[8], uint64_t Counter, const uint32_t Nonce[2], uint8_t* Out) {
+        alignas(32) uint32_t Low[8], High[8];
+        for(int i = 0; i < 8; i++) {
+            Low[i] = static_cast<uint32_t>(Counter + i);
+            High[i] = static_cast<uint32_t>((Counter + i) >> 32);
+        }
+        __m256i State[16] = {
+            _mm256_set1_epi32(0x61707865), _mm256_set1_epi32(0x3320646e), _mm256_set1_epi32(0x79622d32), _mm256_set1_epi32(0x6b206574),
+            _mm256_set1_epi32(Key[0]), _mm256_set1_epi32(Key[1]), _mm256_set1_epi32(Key[2]), _mm256_set1_epi32(Key[3]),
+            _mm256_set1_epi32(Key[4]), _mm256_set1_epi32(Key[5]), _mm256_set1_epi32(Key[6]), _mm256_set1_epi32(Key[7]),
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(Low)), _mm256_load_si256(reinterpret_cast<const __m256i*>(High)),
+            _mm256_set1_epi32(Nonce[0]), _mm256_set1_epi32(Nonce[1])
+        };
+        __m256i X[16];
+        std::copy(State, State + 16, X);
+        for(int i = 0; i < 10; i++) {
+            QuarterRound8x(X[0], X[4], X[8],  X[12]);
+            QuarterRound8x(X[1], X[5], X[9],  X[13]);
+            QuarterRound8x(X[2], X[6], X[10], X[14]);
+            QuarterRound8x(X[3], X[7], X[11], X[15]);
+            QuarterRound8x(X[0], X[5], X[10], X[15]);
+            QuarterRound8x(X[1], X[6], X[11], X[12]);
+            QuarterRound8x(X[2], X[7], X[8],  X[13]);
+            QuarterRound8x(X[3], X[4], X[9],  X[14]);
+        }
+        for(int i = 0; i < 16; i++) X[i] = _mm256_add_epi32(X[i], State[i]);
+        /* Transpose. Within each 128-bit half, words 4g..4g+3 of four blocks are a 4x4 transpose, leaving
+        Y[g][k] with those words of block k below and of block k + 4 above. Pairing halves of two groups
+        then gives 32 contiguous bytes of one block.*/
+        __m256i Y[4][4];
+        for(int g = 0; g < 4; g++) {
+            __m256i T0 = _mm256_unpacklo_epi32(X[4 * g], X[4 * g + 1]);
+            __m256i T1 = _mm256_unpacklo_epi32(X[4 * g + 2], X[4 * g + 3]);
+            __m256i T2 = _mm256_unpackhi_epi32(X[4 * g], X[4 * g + 1]);
+            __m256i T3 = _mm256_unpackhi_epi32(X[4 * g + 2], X[4 * g + 3]);
+            Y[g][0] = _mm256_unpacklo_epi64(T0, T1);
+            Y[g][1] = _mm256_unpackhi_epi64(T0, T1);
+            Y[g][2] = _mm256_unpacklo_epi64(T2, T3);
+            Y[g][3] = _mm256_unpackhi_epi64(T2, T3);
+        }
+        for(int k = 0; k < 4; k++) {
+            auto Store = [&](int Block, int Half, __m256i Value) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(Out + 64 * Block + 32 * Half), Value);
+            };
+            Store(k, 0, _mm256_permute2x128_si256(Y[0][k], Y[1][k], 0x20));
+            Store(k, 1, _mm256_permute2x128_si256(Y[2][k], Y[3][k], 0x20));
+            Store(k + 4, 0, _mm256_permute2x128_si256(Y[0][k], Y[1][k], 0x31));
+            Store(k + 4, 1, _mm256_permute2x128_si256(Y[2][k], Y[3][k], 0x31));
+        }
+    }
+#elif defined(__SSE2__)
+    static __m128i Rotate4x(__m128i V, int C) {
+        return _mm_or_si128(_mm_slli_epi32(V, C), _mm_srli_epi32(V, 32 - C));
+    }
+
+    static void QuarterRound4x(__m128i &A, __m128i &B, __m128i &C, __m128i &D) {
+        A = _mm_add_epi32(A, B); D = Rotate4x(_mm_xor_si128(D, A), 16);
+        C = _mm_add_epi32(C, D); B = Rotate4x(_mm_xor_si128(B, C), 12);
+        A = _mm_add_epi32(A, B); D = Rotate4x(_mm_xor_si128(D, A), 8);
+        C = _mm_add_epi32(C, D); B = Rotate4x(_mm_xor_si128(B, C), 7);
+    }
+
+    static void Blocks4(const uint32_t Key[8], uint64_t Counter, const uint32_t Nonce[2], uint8_t* Out) {
+        alignas(16) uint32_t Low[4], High[4];
+        for(int i = 0; i < 4; i++) {
+            Low[i] = static_cast<uint32_t>(Counter + i);
+            High[i] = static_cast<uint32_t>((Counter + i) >> 32);
+        }
+        __m128i State[16] = {
+            _mm_set1_epi32(0x61707865), _mm_set1_epi32(0x3320646e), _mm_set1_epi32(0x79622d32), _mm_set1_epi32(0x6b206574),
+            _mm_set1_epi32(Key[0]), _mm_set1_epi32(Key[1]), _mm_set1_epi32(Key[2]), _mm_set1_epi32(Key[3]),
+            _mm_set1_epi32(Key[4]), _mm_set1_epi32(Key[5]), _mm_set1_epi32(Key[6]), _mm_set1_epi32(Key[7]),
+            _mm_load_si128(reinterpret_cast<const __m128i*>(Low)), _mm_load_si128(reinterpret_cast<const __m128i*>(High)),
+            _mm_set1_epi32(Nonce[0]), _mm_set1_epi32(Nonce[1])
+        };
+        __m128i X[16];
+        std::copy(State, State + 16, X);
+        for(int i = 0; i < 10; i++) {
+            QuarterRound4x(X[0], X[4], X[8],  X[12]);
+            QuarterRound4x(X[1], X[5], X[9],  X[13]);
+            QuarterRound4x(X[2], X[6], X[10], X[14]);
+            QuarterRound4x(X[3], X[7], X[11], X[15]);
+            QuarterRound4x(X[0], X[5], X[10], X[15]);
+            QuarterRound4x(X[1], X[6], X[11], X[12]);
+            QuarterRound4x(X[2], X[7], X[8],  X[13]);
+            QuarterRound4x(X[3], X[4], X[9],  X[14]);
+        }
+        // A 4x4 transpose per group of four words puts words 4g..4g+3 of block k in one vector
+        for(int g = 0; g < 4; g++) {
+            __m128i A = _mm_add_epi32(X[4 * g], State[4 * g]), B = _mm_add_epi32(X[4 * g + 1], State[4 * g + 1]);
+            __m128i C = _mm_add_epi32(X[4 * g + 2], State[4 * g + 2]), D = _mm_add_epi32(X[4 * g + 3], State[4 * g + 3]);
+            __m128i T0 = _mm_unpacklo_epi32(A, B), T1 = _mm_unpacklo_epi32(C, D);
+            __m128i T2 = _mm_unpackhi_epi32(A, B), T3 = _mm_unpackhi_epi32(C, D);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(Out + 16 * g), _mm_unpacklo_epi64(T0, T1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(Out + 64 + 16 * g), _mm_unpackhi_epi64(T0, T1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(Out + 128 + 16 * g), _mm_unpacklo_epi64(T2, T3));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(Out + 192 + 16 * g), _mm_unpackhi_epi64(T2, T3));
+        }
     }
+#endif
 
     static void HChaCha20(const uint32_t Key[8], const uint32_t Nonce[4], uint32_t SubKey[8]) {
         uint32_t State[16] = {
@@ -123,4 +333,4 @@ private:
         SubKey[7] = State[15];
     }
 };
-}
\ No newline at end of file
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace AstralDB {
+namespace DS {
+/* XXH32, the checksum the LZ4 frame format uses for its header, blocks and content. Four lanes take
+16-byte stripes; the tail is mixed in 4 bytes and then 1 byte at a time. Words are read little-endian
+whatever the host order, so checksums match other implementations.*/
+namespace XXHash32Detail {
+	inline constexpr uint32_t Prime1 = 0x9E3779B1u;
+	inline constexpr uint32_t Prime2 = 0x85EBCA77u;
+	inline constexpr uint32_t Prime3 = 0xC2B2AE3Du;
+	inline constexpr uint32_t Prime4 = 0x27D4EB2Fu;
+	inline constexpr uint32_t Prime5 = 0x165667B1u;
+
+	inline uint32_t Read32(const unsigned char *Source) {
+		uint32_t Value;
+		std::memcpy(&Value, Source, sizeof(Value));
+		return std::endian::native == std::endian::little ? Value : std::byteswap(Value);
+	}
+
+	inline uint32_t Round(uint32_t Lane, uint32_t Input) {
+		return std::rotl(Lane + Input * Prime2, 13) * Prime1;
+	}
+}
+
+inline uint32_t XXHash32(std::string_view Data, uint32_t Seed = 0) {
+	using namespace XXHash32Detail;
+	const auto *Cursor = reinterpret_cast<const unsigned char*>(Data.data());
+	const auto *End = Cursor + Data.size();
+	uint32_t Hash;
+	if(Data.size() >= 16) {
+		uint32_t Lanes[4] = {Seed + Prime1 + Prime2, Seed + Prime2, Seed, Seed - Prime1};
+		for(; End - Cursor >= 16; Cursor += 16)
+			for(int Lane = 0; Lane < 4; ++Lane) Lanes[Lane] = Round(Lanes[Lane], Read32(Cursor + 4 * Lane));
+		Hash = std::rotl(Lanes[0], 1) + std::rotl(Lanes[1], 7) + std::rotl(Lanes[2], 12) + std::rotl(Lanes[3], 18);
+	} else {
+		Hash = Seed + Prime5;
+	}
+	Hash += static_cast<uint32_t>(Data.size());
+	for(; End - Cursor >= 4; Cursor += 4) Hash = std::rotl(Hash + Read32(Cursor) * Prime3, 17) * Prime4;
+	for(; Cursor < End; ++Cursor) Hash = std::rotl(Hash + *Cursor * Prime5, 11) * Prime1;
+	Hash ^= Hash >> 15;
+	Hash *= Prime2;
+	Hash ^= Hash >> 13;
+	Hash *= Prime3;
+	Hash ^= Hash >> 16;
+	return Hash;
+}
+}
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace AstralDB {
+/* Fixed set of page frames caching a file of PageSize pages. A page table maps the pages in memory to
+their frames. A pinned page stays put, and an unpinned one can be replaced. Victims are picked by
+CLOCK: the hand sweeps the frames, giving any page used since its last pass a second chance.
+Dirty pages are written back when evicted or on Flush.
+
+Not thread-safe; the owner serializes every call.*/
+class BufferPool {
+public:
+    using PageId = uint32_t;
+    static constexpr size_t PageSize = 4096;
+
+private:
+    static constexpr PageId NoPage = UINT32_MAX;
+
+    struct Frame {
+        PageId Page = NoPage;
+        uint32_t Pins = 0;
+        bool Dirty = false;
+        bool Referenced = false;
+    };
+
+    std::filesystem::path Path_;
+    std::fstream File_;
+    std::unique_ptr<char[]> Memory_;
+    std::vector<Frame> Frames_;
+    std::unordered_map<PageId, uint32_t> PageTable_;
+    uint32_t Hand_ = 0;
+    PageId PageCount_ = 0;
+    size_t Hits_ = 0;
+    size_t Misses_ = 0;
+
+    char *FrameData(uint32_t Index) { return Memory_.get() + static_cast<size_t>(Index) * PageSize; }
+
+    void WriteBack(uint32_t Index) {
+        Frame &Target = Frames_[Index];
+        File_.seekp(static_cast<std::streamoff>(Target.Page) * PageSize);
+        File_.write(FrameData(Index), PageSize);
+        if(!File_) throw std::runtime_error("Cannot write page file " + Path_.string());
+        Target.Dirty = false;
+    }
+
+    // Frees a frame for a new page, writing its old page back first if needed
+    uint32_t Victim() {
+        for(size_t Step = 0; Step < 2 * Frames_.size(); ++Step) {
+            uint32_t Index = Hand_;
+            Hand_ = (Hand_ + 1) % Frames_.size();
+            Frame &Candidate = Frames_[Index];
+            if(Candidate.Pins) continue;
+            if(Candidate.Referenced) {
+                Candidate.Referenced = false;
+                continue;
+            }
+            if(Candidate.Page != NoPage) {
+                if(Candidate.Dirty) WriteBack(Index);
+                PageTable_.erase(Candidate.Page);
+            }
+            return Index;
+        }
+        throw std::runtime_error("Every buffer pool frame is pinned");
+    }
+
+    uint32_t Install(PageId Page) {
+        uint32_t Index = Victim();
+        Frames_[Index] = Frame{Page, 0, false, true};
+        PageTable_.emplace(Page, Index);
+        return Index;
+    }
+
+public:
+    // The file only holds pages for this session, so it starts out empty
+    BufferPool(std::filesystem::path Path, size_t Frames)
+        : Path_(std::move(Path)), Memory_(std::make_unique<char[]>(std::max<size_t>(Frames, 1) * PageSize)),
+          Frames_(std::max<size_t>(Frames, 1)) {
+        File_.open(Path_, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!File_) throw std::runtime_error("Cannot create page file " + Path_.string());
+        PageTable_.reserve(Frames_.size());
+    }
+
+    ~BufferPool() {
+        File_.close();
+        std::error_code Ignored;
+        std::filesystem::remove(Path_, Ignored);
+    }
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool &operator=(const BufferPool&) = delete;
+
+    // Adds a zeroed page at the end of the file and caches it; it reaches the file on eviction or Flush
+    PageId Allocate() {
+        PageId Page = PageCount_++;
+        uint32_t Index = Install(Page);
+        std::memset(FrameData(Index), 0, PageSize);
+        Frames_[Index].Dirty = true;
+        return Page;
+    }
+
+    // Pins Page in a frame, reading it in if it is not cached, and returns its bytes
+    char *Pin(PageId Page) {
+        if(Page >= PageCount_) throw std::runtime_error("Page is past the end of the page file");
+        uint32_t Index;
+        if(auto It = PageTable_.find(Page); It != PageTable_.end()) {
+            Index = It->second;
+            ++Hits_;
+        } else {
+            Index = Install(Page);
+            File_.seekg(static_cast<std::streamoff>(Page) * PageSize);
+            File_.read(FrameData(Index), PageSize);
+            if(!File_) throw std::runtime_error("Cannot read page file " + Path_.string());
+            ++Misses_;
+        }
+        Frame &Target = Frames_[Index];
+        ++Target.Pins;
+        Target.Referenced = true;
+        return FrameData(Index);
+    }
+
+    void Unpin(PageId Page, bool Dirty) {
+        auto It = PageTable_.find(Page);
+        if(It == PageTable_.end() || !Frames_[It->second].Pins) throw std::runtime_error("Page is not pinned");
+        Frame &Target = Frames_[It->second];
+        --Target.Pins;
+        Target.Dirty |= Dirty;
+    }
+
+    // Writes every dirty page back; the pages stay cached
+    void Flush() {
+        for(uint32_t Index = 0; Index < Frames_.size(); ++Index)
+            if(Frames_[Index].Page != NoPage && Frames_[Index].Dirty) WriteBack(Index);
+        File_.flush();
+    }
+
+    size_t FrameCount() const { return Frames_.size(); }
+    PageId PageCount() const { return PageCount_; }
+    size_t Hits() const { return Hits_; }
+    size_t Misses() const { return Misses_; }
+};
+
+// Where a record lives in a PageHeap; records longer than a page carry on into the pages after it
+struct RecordLocation {
+    BufferPool::PageId Page = 0;
+    uint32_t Offset = 0;
+    uint32_t Length = 0;
+};
+
+/* Heap of variable-length records stored in buffer pool pages. Only the heap allocates pages, so they
+come in order and the file reads as one run of bytes; a record is an extent of it and may span pages.
+Freed extents are merged with free neighbours and reused best-fit, the unused part of a larger one
+staying free, so a record rewritten over and over does not grow the file. Space freed at the end goes
+back to the tail.*/
+class PageHeap {
+    BufferPool Pool_;
+    // Bytes in use or free below the tail, which is where new space is taken from
+    uint64_t End_ = 0;
+    std::map<uint64_t, uint32_t> FreeByAddress_;
+    std::multimap<uint32_t, uint64_t> FreeBySize_;
+    uint64_t FreeBytes_ = 0;
+
+    static uint64_t AddressOf(const RecordLocation &Location) {
+        return static_cast<uint64_t>(Location.Page) * BufferPool::PageSize + Location.Offset;
+    }
+
+    static RecordLocation LocationOf(uint64_t Address, uint32_t Length) {
+        return {static_cast<BufferPool::PageId>(Address / BufferPool::PageSize), static_cast<uint32_t>(Address % BufferPool::PageSize), Length};
+    }
+
+    void AddFree(uint64_t Address, uint32_t Length) {
+        FreeByAddress_.emplace(Address, Length);
+        FreeBySize_.emplace(Length, Address);
+        FreeBytes_ += Length;
+    }
+
+    void RemoveFree(std::map<uint64_t, uint32_t>::iterator It) {
+        auto [First, Last] = FreeBySize_.equal_range(It->second);
+        for(; First != Last; ++First)
+            if(First->second == It->first) {
+                FreeBySize_.erase(First);
+                break;
+            }
+        FreeBytes_ -= It->second;
+        FreeByAddress_.erase(It);
+    }
+
+    // Takes Length bytes from the smallest free extent that holds them, or from the tail
+    uint64_t Take(uint32_t Length) {
+        if(auto It = FreeBySize_.lower_bound(Length); It != FreeBySize_.end()) {
+            uint64_t Address = It->second;
+            uint32_t Available = It->first;
+            RemoveFree(FreeByAddress_.find(Address));
+            if(Available > Length) AddFree(Address + Length, Available - Length);
+            return Address;
+        }
+        uint64_t Address = End_;
+        End_ += Length;
+        while(Pool_.PageCount() * static_cast<uint64_t>(BufferPool::PageSize) < End_) Pool_.Allocate();
+        return Address;
+    }
+
+public:
+    PageHeap(std::filesystem::path Path, size_t Frames) : Pool_(std::move(Path), Frames) {}
+
+    RecordLocation Append(std::string_view Bytes) {
+        uint32_t Length = static_cast<uint32_t>(Bytes.size());
+        uint64_t Address = Length ? Take(Length) : End_;
+        RecordLocation Location = LocationOf(Address, Length);
+        BufferPool::PageId Page = Location.Page;
+        size_t Offset = Location.Offset;
+        for(; !Bytes.empty(); ++Page, Offset = 0) {
+            size_t Count = std::min<size_t>(Bytes.size(), BufferPool::PageSize - Offset);
+            std::memcpy(Pool_.Pin(Page) + Offset, Bytes.data(), Count);
+            Pool_.Unpin(Page, true);
+            Bytes.remove_prefix(Count);
+        }
+        return Location;
+    }
+
+    // Gives a record's space back; the location must not be read again
+    void Free(const RecordLocation &Location) {
+        if(!Location.Length) return;
+        uint64_t Address = AddressOf(Location);
+        uint32_t Length = Location.Length;
+        auto Next = FreeByAddress_.lower_bound(Address);
+        if(Next != FreeByAddress_.begin()) {
+            auto Previous = std::prev(Next);
+            if(Previous->first + Previous->second == Address && Previous->second + uint64_t(Length) <= UINT32_MAX) {
+                Address = Previous->first;
+                Length += Previous->second;
+                RemoveFree(Previous);
+            }
+        }
+        Next = FreeByAddress_.lower_bound(Address + Length);
+        if(Next != FreeByAddress_.end() && Next->first == Address + Length && Next->second + uint64_t(Length) <= UINT32_MAX) {
+            Length += Next->second;
+            RemoveFree(Next);
+        }
+        if(Address + Length == End_) End_ = Address;
+        else AddFree(Address, Length);
+    }
+
+    void Read(const RecordLocation &Location, std::string &Out) {
+        Out.resize(Location.Length);
+        BufferPool::PageId Page = Location.Page;
+        size_t Offset = Location.Offset;
+        for(size_t Done = 0; Done < Location.Length; ++Page, Offset = 0) {
+            size_t Count = std::min<size_t>(Location.Length - Done, BufferPool::PageSize - Offset);
+            std::memcpy(Out.data() + Done, Pool_.Pin(Page) + Offset, Count);
+            Pool_.Unpin(Page, false);
+            Done += Count;
+        }
+    }
+
+    // Bytes below the tail that no record holds
+    uint64_t FreeBytes() const { return FreeBytes_; }
+    uint64_t UsedBytes() const { return End_ - FreeBytes_; }
+    void Flush() { Pool_.Flush(); }
+    const BufferPool &Pool() const { return Pool_; }
+};
+}
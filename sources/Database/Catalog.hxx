@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace AstralDB {
+/* Catalog section of the database file: foreign keys, ACLs and index pages, written after the rows.
+Numbers are decimal and strings are "<length>:<bytes>". The section goes through the same compression
+and encryption as the rows.*/
+class CatalogWriter {
+    std::string Buffer_;
+
+public:
+    void Number(uint64_t Value) {
+        Buffer_ += std::to_string(Value);
+        Buffer_ += ' ';
+    }
+
+    void String(std::string_view Value) {
+        Buffer_ += std::to_string(Value.size());
+        Buffer_ += ':';
+        Buffer_.append(Value);
+    }
+
+    size_t Size() const { return Buffer_.size(); }
+    std::string Take() { return std::move(Buffer_); }
+};
+
+class CatalogReader {
+    std::string_view Data_;
+    size_t Offset_ = 0;
+
+    uint64_t Digits(char Terminator) {
+        uint64_t Value = 0;
+        size_t Start = Offset_;
+        while(Offset_ < Data_.size() && Data_[Offset_] >= '0' && Data_[Offset_] <= '9')
+            Value = Value * 10 + static_cast<uint64_t>(Data_[Offset_++] - '0');
+        if(Offset_ == Start || Offset_ == Data_.size() || Data_[Offset_] != Terminator)
+            throw std::runtime_error("Malformed catalog section");
+        ++Offset_;
+        return Value;
+    }
+
+public:
+    explicit CatalogReader(std::string_view Data) : Data_(Data) {}
+
+    uint64_t Number() { return Digits(' '); }
+
+    std::string_view String() {
+        uint64_t Length = Digits(':');
+        if(Length > Data_.size() - Offset_)
+            throw std::runtime_error("Malformed catalog section");
+        std::string_view Value = Data_.substr(Offset_, Length);
+        Offset_ += Length;
+        return Value;
+    }
+
+    bool AtEnd() const { return Offset_ == Data_.size(); }
+};
+
+// FNV-1a, chainable through Seed
+inline uint64_t Checksum64(std::string_view Bytes, uint64_t Seed = 14695981039346656037ull) {
+    for(char Byte : Bytes) Seed = (Seed ^ static_cast<uint8_t>(Byte)) * 1099511628211ull;
+    return Seed;
+}
+
+/* Index pages hold an index's entries, cut into pages of about IndexPageSize bytes. A page is
+"<entry count> <checksum> <payload>". Each entry is a key followed by its row ordinals, which are the
+positions of its rows in the file's row order. Pages are checked one at a time while decoding, so a
+damaged page is caught before any of its ids are used.*/
+class IndexPageWriter {
+    static constexpr size_t IndexPageSize = 4096;
+
+    CatalogWriter Pages_;
+    CatalogWriter Page_;
+    uint64_t Entries_ = 0;
+
+    void Flush() {
+        if(!Entries_) return;
+        std::string Payload = Page_.Take();
+        Pages_.Number(Entries_);
+        Pages_.Number(Checksum64(Payload));
+        Pages_.String(Payload);
+        Page_ = CatalogWriter();
+        Entries_ = 0;
+    }
+
+public:
+    void Add(std::string_view Key, const std::vector<uint32_t> &Ordinals) {
+        Page_.String(Key);
+        Page_.Number(Ordinals.size());
+        for(uint32_t Ordinal : Ordinals) Page_.Number(Ordinal);
+        ++Entries_;
+        if(Page_.Size() >= IndexPageSize) Flush();
+    }
+
+    std::string Finish() {
+        Flush();
+        return Pages_.Take();
+    }
+};
+
+// Calls F(Key, Ordinals) for every entry in page order; returns false at the first page whose checksum fails
+template<typename Func> bool DecodeIndexPages(std::string_view Pages, Func &&F) {
+    CatalogReader Reader(Pages);
+    std::vector<uint32_t> Ordinals;
+    while(!Reader.AtEnd()) {
+        uint64_t Entries = Reader.Number();
+        uint64_t Checksum = Reader.Number();
+        std::string_view Payload = Reader.String();
+        if(Checksum64(Payload) != Checksum) return false;
+        CatalogReader Page(Payload);
+        for(uint64_t i = 0; i < Entries; ++i) {
+            std::string_view Key = Page.String();
+            Ordinals.resize(Page.Number());
+            for(auto &Ordinal : Ordinals) Ordinal = static_cast<uint32_t>(Page.Number());
+            F(Key, Ordinals);
+        }
+    }
+    return true;
+}
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <Database/MemoryBudget.hxx>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace AstralDB {
+/* Dictionary encoding of one low-cardinality column. Each distinct value is stored once and every row
+slot holds a 16-bit code, which RowStore keeps in place of the column's cells: a row gives up a map node
+with two strings for two bytes, and gets the cell back only while it is being read. SelectEquals looks
+its value up once and then compares integers down a dense array, and SyncToFile writes the codes instead
+of repeating the cells. Codes are not reused, so values that leave the column keep their code until
+Compact drops them.*/
+class ColumnDictionary {
+public:
+    using Code = uint16_t;
+    static constexpr Code NoCode = UINT16_MAX;
+
+    /* A table is analyzed once it holds MinRows rows and again whenever it doubles. A column is
+    encoded while it has at most MaxValues distinct values and at least MinRowsPerValue rows per value.*/
+    static constexpr size_t MinRows = 1024;
+    static constexpr size_t MaxValues = 4096;
+    static constexpr size_t MinRowsPerValue = 16;
+
+private:
+    // A deque keeps every value at a fixed address, so the lookup map can key on views into it
+    std::deque<std::string> Values_;
+    std::unordered_map<std::string_view, Code> Codes_;
+    std::vector<Code> Slots_;
+    size_t ValueBytes_ = 0;
+
+    // A stored value and its lookup entry
+    static size_t ValueBytes(const std::string &Value) {
+        return sizeof(std::string) + HeapBytes(Value) + sizeof(std::pair<std::string_view, Code>) + 2 * sizeof(void*);
+    }
+
+public:
+    ColumnDictionary() = default;
+    ColumnDictionary(ColumnDictionary&&) noexcept = default;
+    ColumnDictionary &operator=(ColumnDictionary&&) noexcept = default;
+    ColumnDictionary(const ColumnDictionary&) = delete;
+    ColumnDictionary &operator=(const ColumnDictionary&) = delete;
+
+    // Code for Value, adding it if it is new; NoCode once every code is taken
+    Code Encode(std::string_view Value) {
+        if(auto It = Codes_.find(Value); It != Codes_.end()) return It->second;
+        if(Values_.size() >= NoCode) return NoCode;
+        Code Next = static_cast<Code>(Values_.size());
+        const std::string &Stored = Values_.emplace_back(Value);
+        Codes_.emplace(Stored, Next);
+        ValueBytes_ += ValueBytes(Stored);
+        return Next;
+    }
+
+    Code Find(std::string_view Value) const {
+        auto It = Codes_.find(Value);
+        return It == Codes_.end() ? NoCode : It->second;
+    }
+
+    const std::string &Decode(Code Value) const { return Values_[Value]; }
+
+    // Records the value held by the row in Slot; false when the dictionary is full
+    bool Set(uint32_t Slot, std::string_view Value) {
+        Code Encoded = Encode(Value);
+        if(Encoded == NoCode) return false;
+        if(Slot >= Slots_.size()) Slots_.resize(Slot + 1, NoCode);
+        Slots_[Slot] = Encoded;
+        return true;
+    }
+
+    void Clear(uint32_t Slot) {
+        if(Slot < Slots_.size()) Slots_[Slot] = NoCode;
+    }
+
+    Code At(uint32_t Slot) const { return Slot < Slots_.size() ? Slots_[Slot] : NoCode; }
+
+    // Calls F(Slot) for every slot holding Value's code, in slot order
+    template<typename Func> void ForEachSlot(Code Value, Func &&F) const {
+        for(uint32_t Slot = 0; Slot < Slots_.size(); ++Slot)
+            if(Slots_[Slot] == Value) F(Slot);
+    }
+
+    // Calls F(Value) for every dictionary entry in code order
+    template<typename Func> void ForEachValue(Func &&F) const {
+        for(const auto &Value : Values_) F(Value);
+    }
+
+    // Drops the values no slot holds and renumbers the rest, keeping their order
+    void Compact() {
+        std::vector<Code> Renumbered(Values_.size(), NoCode);
+        for(Code Held : Slots_)
+            if(Held != NoCode) Renumbered[Held] = 0;
+        std::deque<std::string> Kept;
+        for(size_t i = 0; i < Values_.size(); ++i)
+            if(Renumbered[i] != NoCode) {
+                Renumbered[i] = static_cast<Code>(Kept.size());
+                Kept.push_back(std::move(Values_[i]));
+            }
+        for(Code &Held : Slots_)
+            if(Held != NoCode) Held = Renumbered[Held];
+        Values_ = std::move(Kept);
+        Codes_.clear();
+        ValueBytes_ = 0;
+        for(size_t i = 0; i < Values_.size(); ++i) {
+            Codes_.emplace(Values_[i], static_cast<Code>(i));
+            ValueBytes_ += ValueBytes(Values_[i]);
+        }
+    }
+
+    size_t Size() const { return Values_.size(); }
+    // Estimated footprint of the values and the codes, for the memory budget
+    size_t Bytes() const { return ValueBytes_ + Slots_.capacity() * sizeof(Code); }
+};
+}
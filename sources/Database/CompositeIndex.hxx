@@ -0,0 +1,169 @@
+#pragma once
+
+#include <DS/BPlusTree.hxx>
+#include <Database/RowStore.hxx>
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace AstralDB {
+/* Index over several columns of one table, kept in a B+Tree under a single byte-string key. Every key
+column is encoded so that plain byte order on the key matches column-by-column string order. The row id
+goes last, so every key is unique and rows with equal values sit next to each other. Equality on the
+leading columns plus a range on the next one is therefore a single contiguous run of leaves.
+
+Include columns are copied into the leaf next to the row id. A query that only asks for key and
+included columns is answered from the leaves alone, without reading the rows.
+
+A key part is 0x01 0x01 for a missing column. A present value is 0x02, then its bytes, then 0x01 0x01.
+Inside the value, 0x00 becomes 0x01 0x02 and 0x01 becomes 0x01 0x03. The terminator sorts below every
+byte a value can continue with, so a value sorts before all of its extensions, just as std::string does.*/
+class CompositeIndex {
+public:
+    using Row = std::unordered_map<std::string, std::string>;
+
+    struct Entry {
+        RowId Id;
+        std::vector<std::optional<std::string>> Included;
+    };
+
+private:
+    std::vector<std::string> Columns_;
+    std::vector<std::string> Include_;
+    BPlusTree<std::string, Entry> Tree_;
+
+    static void AppendValue(std::string &Key, std::string_view Value) {
+        for(char Byte : Value) {
+            if(Byte == '\x00') Key += "\x01\x02";
+            else if(Byte == '\x01') Key += "\x01\x03";
+            else Key += Byte;
+        }
+    }
+
+    static void AppendPart(std::string &Key, const std::string *Value) {
+        if(Value) {
+            Key += '\x02';
+            AppendValue(Key, *Value);
+        }
+        Key += "\x01\x01";
+    }
+
+    static const std::string *Cell(const Row &Values, const std::string &Column) {
+        auto It = Values.find(Column);
+        return It == Values.end() ? nullptr : &It->second;
+    }
+
+    std::string KeyFor(const Row &Values, RowId Id) const {
+        std::string Key;
+        for(const auto &Column : Columns_) AppendPart(Key, Cell(Values, Column));
+        uint64_t Packed = Id.Pack();
+        for(int Shift = 56; Shift >= 0; Shift -= 8) Key += static_cast<char>(Packed >> Shift);
+        return Key;
+    }
+
+    Entry EntryFor(const Row &Values, RowId Id) const {
+        Entry Result{Id, {}};
+        Result.Included.reserve(Include_.size());
+        for(const auto &Column : Include_) {
+            const std::string *Value = Cell(Values, Column);
+            Result.Included.push_back(Value ? std::optional<std::string>(*Value) : std::nullopt);
+        }
+        return Result;
+    }
+
+    // Adds the key columns held in Key to Out; missing columns stay out, as they do for a projected row
+    void DecodeKey(std::string_view Key, Row &Out, const std::vector<std::string> &Wanted) const {
+        size_t Offset = 0;
+        for(const auto &Column : Columns_) {
+            bool Present = Key[Offset] == '\x02';
+            std::string Value;
+            if(Present) {
+                for(++Offset; !(Key[Offset] == '\x01' && Key[Offset + 1] == '\x01'); ++Offset) {
+                    if(Key[Offset] == '\x01') Value += static_cast<char>(Key[++Offset] - 2);
+                    else Value += Key[Offset];
+                }
+            }
+            Offset += 2;
+            if(Present && std::find(Wanted.begin(), Wanted.end(), Column) != Wanted.end())
+                Out.emplace(Column, std::move(Value));
+        }
+    }
+
+public:
+    CompositeIndex(std::vector<std::string> Columns, std::vector<std::string> Include)
+        : Columns_(std::move(Columns)), Include_(std::move(Include)) {}
+
+    const std::vector<std::string> &Columns() const { return Columns_; }
+    const std::vector<std::string> &Include() const { return Include_; }
+    size_t Size() const { return Tree_.Size(); }
+
+    // True if the index stores Column, either in the key or as an included column
+    bool Holds(const std::string &Column) const {
+        return std::find(Columns_.begin(), Columns_.end(), Column) != Columns_.end() ||
+               std::find(Include_.begin(), Include_.end(), Column) != Include_.end();
+    }
+
+    // True if every one of Columns can be read from the leaves; an empty list or "*" asks for whole rows
+    bool Covers(const std::vector<std::string> &Columns) const {
+        if(Columns.empty()) return false;
+        return std::all_of(Columns.begin(), Columns.end(), [&](const std::string &Column) { return Holds(Column); });
+    }
+
+    void Insert(const Row &Values, RowId Id) { Tree_.Insert(KeyFor(Values, Id), EntryFor(Values, Id)); }
+    bool Erase(const Row &Values, RowId Id) { return Tree_.Delete(KeyFor(Values, Id)); }
+
+    // Replaces the contents with every row Rows visits as F(RowId, const Row&)
+    template<typename RowsType> void Build(const RowsType &Rows) {
+        std::vector<std::pair<std::string, Entry>> Entries;
+        Entries.reserve(Rows.Size());
+        Rows.ForEach([&](RowId Id, const Row &Values) { Entries.emplace_back(KeyFor(Values, Id), EntryFor(Values, Id)); });
+        std::sort(Entries.begin(), Entries.end(), [](const auto &Left, const auto &Right) { return Left.first < Right.first; });
+        Tree_.BulkLoad(std::move(Entries));
+    }
+
+    /* Calls F(Key, Entry) for every row whose first Equal.size() key columns equal Equal and, if either bound is
+    set, whose next key column lies in [Lower, Upper]. Rows come in key order. A row missing a bounded
+    column never matches a range.*/
+    template<typename Func> void Seek(const std::vector<std::string> &Equal, const std::optional<std::string> &Lower,
+                                      const std::optional<std::string> &Upper, Func &&F) const {
+        std::string Prefix;
+        for(const auto &Value : Equal) AppendPart(Prefix, &Value);
+        std::string Start = Prefix;
+        std::optional<std::string> End;
+        if(Lower || Upper) {
+            Start += '\x02';
+            if(Lower) AppendValue(Start, *Lower);
+        }
+        if(Upper) {
+            // Upper with its terminator bumped: every value <= Upper sorts below it, extensions of Upper sort above
+            End = Prefix + '\x02';
+            AppendValue(*End, *Upper);
+            *End += "\x01\x02";
+        } else if(!Prefix.empty()) {
+            // Prefix ends in a 0x01 terminator byte, so bumping it bounds every key that starts with Prefix
+            End = Prefix;
+            End->back() = '\x02';
+        }
+        Tree_.ForEachFrom(Start, [&](const std::string &Key, const Entry &Value) {
+            if(End && !(Key < *End)) return false;
+            F(static_cast<const std::string&>(Key), Value);
+            return true;
+        });
+    }
+
+    // Rebuilds the wanted columns of a row from its key and leaf entry
+    Row Materialize(const std::string &Key, const Entry &Value, const std::vector<std::string> &Wanted) const {
+        Row Result;
+        Result.reserve(Wanted.size());
+        DecodeKey(Key, Result, Wanted);
+        for(size_t i = 0; i < Include_.size(); ++i)
+            if(Value.Included[i] && std::find(Wanted.begin(), Wanted.end(), Include_[i]) != Wanted.end())
+                Result.emplace(Include_[i], *Value.Included[i]);
+        return Result;
+    }
+};
+}
@@ -1,6 +1,8 @@
 #include <Database/Database.hxx>
+#include <Database/Catalog.hxx>
+#include <Database/Spill.hxx>
+#include <Database/Storage.hxx>
 #include <IO/Task.hxx>
-#include <DS/LZ4.hxx>
 #include <optional>
 #include <sstream>
 #include <fstream>
@@ -10,6 +12,8 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <unordered_set>
+#include <memory_resource>
 #include <Database/IndexManagement.hxx>
 
 namespace AstralDB {
@@ -28,9 +32,15 @@ void Database::FlushWorker() noexcept {
 					}
 					Dirty_.store(false, std::memory_order_release);
 				}
+				TrimResident();
+				if(Heap_) Heap_->Flush();
 			}
 		} else {
 			std::this_thread::sleep_for(10ms);
+			if(!Paging_.load(std::memory_order_acquire)) continue;
+			// Queries fault evicted rows back in but cannot evict under a shared table, so that happens here
+			SpinlockGuard Guard(Lock_);
+			TrimResident();
 		}
 	}
 }
@@ -45,25 +55,32 @@ Database::~Database() {
 	StopFlushWorker_.store(true, std::memory_order_release);
 	if (FlushWorkerThread_.joinable())
 		FlushWorkerThread_.join();
+	for(const auto &[TableName, Bytes] : Resident_) MemoryBudget::Global().Release(Bytes);
 	if(Logger_) Logger_->Info("Database destroyed");
 }
 
-std::string Database::CompressData(const std::string &Data) {
-	return DS::LZ4Compress(Data.data());
-}
-
-std::string Database::DecompressData(const std::string &CompressedData) {
-	return DS::LZ4Decompress(CompressedData);
-}
-
-std::string Database::EncryptData(const std::string &Data) {
-	EncryptedString Encrypted(Data);
-	return std::string(Encrypted.Encrypted());
+/* Reads the key under the lock, so LoadFromFile can call it before taking the lock for the tables. The
+key file of this database's own path is read once and then kept in EncryptionKey_ like an explicit key.*/
+std::array<uint8_t, 32> Database::StorageKey(const std::filesystem::path &Path, bool Create) {
+	{
+		SpinlockGuard Guard(Lock_);
+		if(EncryptionKey_) return *EncryptionKey_;
+	}
+	std::array<uint8_t, 32> Key = Storage::LoadKeyFile(Path, Create);
+	if(Path == DbPath_) {
+		SpinlockGuard Guard(Lock_);
+		if(!EncryptionKey_) EncryptionKey_ = Key;
+		return *EncryptionKey_;
+	}
+	return Key;
 }
 
-std::string Database::DecryptData(const std::string &EncryptedData) {
-	EncryptedString Decrypted(EncryptedData, true);
-	return std::string(Decrypted.Encrypted());
+void Database::SetEncryptionKey(std::string_view Key) {
+	if(Key.size() != 32) throw std::invalid_argument("Key must be exactly 32 bytes");
+	std::array<uint8_t, 32> Bytes;
+	std::copy(Key.begin(), Key.end(), Bytes.begin());
+	SpinlockGuard Guard(Lock_);
+	EncryptionKey_ = Bytes;
 }
 
 void Database::SyncToFile() {
@@ -80,21 +97,53 @@ void Database::SyncToFile() {
 					 << Column.DefaultValue << "\n";
 		}
 	}
+	// Encoded columns write their dictionary once, length-prefixed, and then one line of codes per table
+	std::unordered_map<std::string, std::vector<std::pair<std::string, const ColumnDictionary*>>> Encoded;
+	for(const auto &[TableName, Rows] : Tables_)
+		Rows.ForEachEncoded([&](const std::string &ColumnName, const ColumnDictionary &Dictionary) {
+			Encoded[TableName].emplace_back(ColumnName, &Dictionary);
+		});
+	OutputStream << "DICTIONARIES " << Encoded.size() << "\n";
+	for(const auto &[TableName, Columns] : Encoded) {
+		OutputStream << TableName << "\n" << Columns.size() << "\n";
+		for(const auto &[ColumnName, Dictionary] : Columns) {
+			OutputStream << ColumnName << "\n" << Dictionary->Size() << "\n";
+			Dictionary->ForEachValue([&](const std::string &Value) { OutputStream << Value.size() << " " << Value << "\n"; });
+		}
+	}
 	OutputStream << Tables_.size() << "\n";
 	for(const auto &TablePair : Tables_) {
 		OutputStream << TablePair.first << "\n";  // Table name
-		OutputStream << TablePair.second.size() << "\n";  // Row count
-		for(const auto &Row : TablePair.second) {
-			OutputStream << Row.size() << "\n";  // Column count per row
+		OutputStream << TablePair.second.Size() << "\n";  // Row count
+		auto EncodedIt = Encoded.find(TablePair.first);
+		const auto *Columns = EncodedIt == Encoded.end() ? nullptr : &EncodedIt->second;
+		auto IsEncoded = [&](const std::string &ColumnName) {
+			return Columns && std::any_of(Columns->begin(), Columns->end(), [&](const auto &Entry) { return Entry.first == ColumnName; });
+		};
+		TablePair.second.ForEachStored([&](RowId, const Item &Row) {
+			size_t Plain = std::count_if(Row.begin(), Row.end(), [&](const auto &Column) { return !IsEncoded(Column.first); });
+			OutputStream << Plain << "\n";  // Column count per row
 			for (const auto &Column : Row) {
+				if(IsEncoded(Column.first)) continue;
 				OutputStream << Column.first << "\n";  // Column name
 				OutputStream << Column.second << "\n";  // Column value
 			}
+		});
+		if(!Columns) continue;
+		for(const auto &[ColumnName, Dictionary] : *Columns) {
+			TablePair.second.ForEachStored([&](RowId Id, const Item&) {
+				ColumnDictionary::Code Code = Dictionary->At(Id.Slot);
+				if(Code == ColumnDictionary::NoCode) OutputStream << "- ";
+				else OutputStream << Code << " ";
+			});
+			OutputStream << "\n";
 		}
 	}
+	OutputStream << "CATALOG\n" << SerializeCatalog();
 	std::string RawData = OutputStream.str();
-	std::string CompressedData = CompressData(RawData);
-	std::string EncryptedData = EncryptData(CompressedData);
+	// Lock_ is held here, so the key file is read straight into EncryptionKey_ on the first flush only
+	if(!EncryptionKey_) EncryptionKey_ = Storage::LoadKeyFile(DbPath_, true);
+	std::string EncryptedData = Storage::Seal(RawData, *EncryptionKey_);
 	std::ofstream File(DbPath_, std::ios::binary);
 	if(!File) {
 		if(Logger_) Logger_->Error("Failed to open file for writing in SyncToFile");
@@ -111,7 +160,10 @@ std::future<void> Database::CreateTable(const std::string &TableName, const Sche
 			if (TableSchemas_.find(TableName) != TableSchemas_.end())
 				throw std::runtime_error("Table already exists");
 			TableSchemas_[TableName] = Columns;
-			Tables_[TableName] = Table();
+			Tables_[TableName] = RowTable();
+			Tables_[TableName].AttachHeap(Heap_.get());
+			for(const auto &Column : Columns)
+				if(Column.IsUnique) Filters_[TableName][Column.Name];
 		}
 		Dirty_.store(true, std::memory_order_release);
 	});
@@ -122,30 +174,52 @@ std::future<void> Database::DropTable(const std::string &TableName) {
 		{
 			SpinlockGuard Guard(Lock_);
 			TableSchemas_.erase(TableName);
-			Tables_.erase(TableName);
+			if(auto TableIt = Tables_.find(TableName); TableIt != Tables_.end()) {
+				// Frees its evicted rows' records while the heap is known to be alive
+				TableIt->second.Clear();
+				Tables_.erase(TableIt);
+			}
 			Indexes_.erase(TableName);
+			PendingIndexes_.erase(TableName);
+			StoredIndexes_.erase(TableName);
+			EncodedIndexes_.erase(TableName);
+			Filters_.erase(TableName);
+			NextAnalysis_.erase(TableName);
+			CompositeIndexes_.erase(TableName);
 			ForeignKeys_.erase(TableName);
+			if(auto ResidentIt = Resident_.find(TableName); ResidentIt != Resident_.end()) {
+				MemoryBudget::Global().Release(ResidentIt->second);
+				Resident_.erase(ResidentIt);
+			}
 		}
 		Dirty_.store(true, std::memory_order_release);
 	});
 }
 
-std::future<void> Database::Insert(const std::string &TableName, const Item &Row) {
-	return RunAsync([this, TableName, Row]() {
+std::future<void> Database::Insert(const std::string &TableName, Item Row) {
+	return RunAsync([this, TableName, Row = std::move(Row)]() mutable {
 		{
 			SpinlockGuard Guard(Lock_);
 			if(Tables_.find(TableName) == Tables_.end())
 				throw std::runtime_error("Table does not exist");
+			LoadStoredIndexes(TableName);
+			// Without a buffer pool rows cannot leave memory, so a row that would take the process past its budget is refused
+			if(!Heap_ && MemoryBudget::Global().Available() < RowBytes(Row))
+				throw std::runtime_error("Insert exceeds the memory budget");
 			auto &TableRef = Tables_[TableName];
-			if(!TableRef.empty())
-				PREFETCH(TableRef.data());
-			TableRef.push_back(Row);
-			for (const auto& [ColumnName, Value] : Row) {
-				if (Indexes_[TableName].find(ColumnName) != Indexes_[TableName].end()) {
-					auto& Index = Indexes_[TableName][ColumnName];
-					std::get<BPlusTree<std::string, size_t>>(Index.Index()).Insert(Value, TableRef.size() - 1);
-				}
-			}
+			RowId Id = TableRef.Insert(std::move(Row));
+			// A row appended after every other keeps their ordinals; one filling a freed slot shifts those after it
+			if(Id.Slot + 1 != TableRef.SlotCount()) DropEncodedIndexes(TableName);
+			TableRef.View(Id, [&](const Item &Stored) {
+				for (const auto& [ColumnName, Value] : Stored)
+					IndexInsert(TableName, ColumnName, Value, Id);
+				if(auto CompositeIt = CompositeIndexes_.find(TableName); CompositeIt != CompositeIndexes_.end())
+					for(auto &Composite : CompositeIt->second) Composite.Insert(Stored, Id);
+			});
+			RefreshFilters(TableName);
+			auto NextIt = NextAnalysis_.try_emplace(TableName, ColumnDictionary::MinRows).first;
+			if(TableRef.Size() >= NextIt->second) AnalyzeColumns(TableName);
+			TrimResident();
 		}
 		Dirty_.store(true, std::memory_order_release);
 	});
@@ -156,17 +230,23 @@ std::future<void> Database::Delete(const std::string &TableName, const std::func
 		{
 			SpinlockGuard Guard(Lock_);
 			auto &TableRef = Tables_.at(TableName);
-			for (size_t i = 0; i < TableRef.size(); ++i) {
-				if (Condition(TableRef[i])) {
-					for (const auto& [ColumnName, Value] : TableRef[i]) {
-						if (Indexes_[TableName].find(ColumnName) != Indexes_[TableName].end()) {
-							auto& Index = Indexes_[TableName][ColumnName];
-							std::get<BPlusTree<std::string, size_t>>(Index.Index()).Remove(Value);
-						}
-					}
-				}
+			LoadStoredIndexes(TableName);
+			std::vector<RowId> Doomed;
+			TableRef.ForEach([&](RowId Id, const Item &Row) {
+				if (Condition(Row)) Doomed.push_back(Id);
+			});
+			auto CompositeIt = CompositeIndexes_.find(TableName);
+			for (RowId Id : Doomed) {
+				TableRef.View(Id, [&](const Item &Row) {
+					for (const auto& [ColumnName, Value] : Row)
+						IndexErase(TableName, ColumnName, Value, Id);
+					if(CompositeIt != CompositeIndexes_.end())
+						for(auto &Composite : CompositeIt->second) Composite.Erase(Row, Id);
+				});
+				TableRef.Erase(Id);
 			}
-			TableRef.erase(std::remove_if(TableRef.begin(), TableRef.end(), Condition), TableRef.end());
+			if(!Doomed.empty()) DropEncodedIndexes(TableName);
+			RefreshFilters(TableName);
 		}
 		Dirty_.store(true, std::memory_order_release);
 	});
@@ -182,57 +262,223 @@ std::future<void> Database::Update(const std::string &TableName,
 			auto TableIt = Tables_.find(TableName);
 			if(TableIt == Tables_.end())
 				throw std::runtime_error("Table not found");
+			LoadStoredIndexes(TableName);
 			auto &TableRef = TableIt->second;
-			for (size_t i = 0; i < TableRef.size(); ++i) {
-				auto& Row = TableRef[i];
-				if (Condition(Row)) {
-					for (const auto& [ColumnName, NewValue] : NewValues) {
-						if (Indexes_[TableName].find(ColumnName) != Indexes_[TableName].end()) {
-							auto& Index = Indexes_[TableName][ColumnName];
-							std::get<BPlusTree<std::string, size_t>>(Index.Index()).Remove(Row[ColumnName]);
-							std::get<BPlusTree<std::string, size_t>>(Index.Index()).Insert(NewValue, i);
+			// Composite keys span several columns, so a changed row leaves them whole and goes back in
+			std::vector<CompositeIndex*> Composites;
+			if(auto CompositeIt = CompositeIndexes_.find(TableName); CompositeIt != CompositeIndexes_.end())
+				for(auto &Composite : CompositeIt->second)
+					for(const auto &[ColumnName, NewValue] : NewValues)
+						if(Composite.Holds(ColumnName)) {
+							Composites.push_back(&Composite);
+							break;
 						}
-						Row[ColumnName] = NewValue;
+			// Matches are collected first: a scan only lends out evicted rows, and changing one brings it back in
+			std::vector<RowId> Matches;
+			TableRef.ForEach([&](RowId Id, const Item &Row) {
+				if (Condition(Row)) Matches.push_back(Id);
+			});
+			for (RowId Id : Matches) {
+				TableRef.Modify(Id, [&](Item &Row) {
+					for(auto *Composite : Composites) Composite->Erase(Row, Id);
+					for (const auto& [ColumnName, NewValue] : NewValues) {
+						// A row that lacked the column gains a value without giving one up
+						auto [Cell, Added] = Row.try_emplace(ColumnName);
+						if(!Added) IndexErase(TableName, ColumnName, Cell->second, Id);
+						IndexInsert(TableName, ColumnName, NewValue, Id);
+						Cell->second = NewValue;
 					}
-					Modified = true;
-				}
+					for(auto *Composite : Composites) Composite->Insert(Row, Id);
+				});
 			}
+			Modified = !Matches.empty();
+			RefreshFilters(TableName);
+			TrimResident();
 		}
 		if(Modified) Dirty_.store(true, std::memory_order_release);
 	});
 }
 
+Database::Item Database::Project(const Item &Row, const std::vector<std::string> &Columns) {
+	if(Columns.empty() || std::find(Columns.begin(), Columns.end(), "*") != Columns.end())
+		return Row;
+	Item Projected;
+	Projected.reserve(Columns.size());
+	for(const auto &Column : Columns) {
+		auto It = Row.find(Column);
+		if(It != Row.end()) Projected.emplace(It->first, It->second);
+	}
+	return Projected;
+}
+
+// Charges a result row to its query before keeping it
+void Database::Collect(Table &Result, Item Row, QueryMemory &Memory) {
+	Memory.ReserveResult(RowBytes(Row));
+	Result.push_back(std::move(Row));
+}
+
 std::future<Database::Table> Database::Select(const std::string &TableName, const std::function<bool(const Item&)> &Condition) const {
-	return RunAsync([this, TableName, Condition]() -> Table {
+	return Select(TableName, {}, Condition);
+}
+
+std::future<Database::Table> Database::Select(const std::string &TableName, const std::vector<std::string> &Columns,
+											  const std::function<bool(const Item&)> &Condition) const {
+	return RunAsync([this, TableName, Columns, Condition]() -> Table {
 		Table Result;
+		QueryMemory Memory;
 		{
 			SpinlockGuard Guard(Lock_);
 			auto TableIt = Tables_.find(TableName);
 			if(TableIt == Tables_.end())
 				throw std::runtime_error("Table does not exist.");
 			const auto &TableRef = TableIt->second;
-			if(!TableRef.empty()) PREFETCH(TableRef.data());
-			if(Indexes_.find(TableName) != Indexes_.end()) {
-				for (const auto &ColumnIndexes : Indexes_.at(TableName)) {
-					// Instead of iterating ColumnIndexes.second, get the BPlusTree and iterate its keys
-					const auto& indexVariant = ColumnIndexes.second.Index();
-					if (std::holds_alternative<BPlusTree<std::string, size_t>>(indexVariant)) {
-						const auto& bptree = std::get<BPlusTree<std::string, size_t>>(indexVariant);
-						for (const auto& key : bptree.GetAllKeys()) {
-							size_t RowIndex;
-							if (bptree.Search(key, RowIndex) && RowIndex < TableRef.size()) {
-								const auto &Row = TableRef[RowIndex];
-								if (Condition(Row))
-									Result.push_back(Row);
-							}
-						}
-					}
-				}
-			} else {
-				for(const auto &Row : TableRef)
-					if(Condition(Row)) Result.push_back(Row);
-			}
+			if(TableRef.Data()) PREFETCH(TableRef.Data());
+			// Late materialization: the condition reads the stored row in place and only survivors get projected
+			TableRef.ForEach([&](RowId, const Item &Row) {
+				if(Condition(Row)) Collect(Result, Project(Row, Columns), Memory);
+			});
+		}
+		return Result;
+	});
+}
+
+std::future<Database::Table> Database::SelectSorted(const std::string &TableName, const std::vector<std::string> &Columns,
+													const std::function<bool(const Item&)> &Condition, const std::string &OrderBy,
+													bool Descending) const {
+	return RunAsync([this, TableName, Columns, Condition, OrderBy, Descending]() -> Table {
+		Table Result;
+		QueryMemory Memory;
+		auto Less = [OrderBy, Descending](const Item &Left, const Item &Right) {
+			auto Key = [&](const Item &Row) -> const std::string* {
+				auto It = Row.find(OrderBy);
+				return It == Row.end() ? nullptr : &It->second;
+			};
+			const std::string *First = Key(Descending ? Right : Left);
+			const std::string *Second = Key(Descending ? Left : Right);
+			return Second && (!First || *First < *Second);
+		};
+		// The sort key travels with each row and is dropped afterwards if it was not asked for
+		std::vector<std::string> Kept = Columns;
+		bool DropKey = !Columns.empty() && std::find(Columns.begin(), Columns.end(), "*") == Columns.end() &&
+					   std::find(Columns.begin(), Columns.end(), OrderBy) == Columns.end();
+		if(DropKey) Kept.push_back(OrderBy);
+		ExternalSorter<decltype(Less)> Sorter(Memory, Less);
+		{
+			SpinlockGuard Guard(Lock_);
+			auto TableIt = Tables_.find(TableName);
+			if(TableIt == Tables_.end())
+				throw std::runtime_error("Table does not exist.");
+			TableIt->second.ForEach([&](RowId, const Item &Row) {
+				if(Condition(Row)) Sorter.Add(Project(Row, Kept));
+			});
+		}
+		if(Logger_ && Sorter.SpilledRuns())
+			Logger_->Info("Sort of " + TableName + " spilled " + std::to_string(Sorter.SpilledRuns()) + " runs to disk");
+		// The rows are copies by now, so merging runs without the lock
+		Sorter.Drain([&](Item &&Row) {
+			if(DropKey) Row.erase(OrderBy);
+			Collect(Result, std::move(Row), Memory);
+		});
+		return Result;
+	});
+}
+
+std::future<Database::Table> Database::SelectEquals(const std::string &TableName, const std::string &Column,
+													const std::string &Value, const std::vector<std::string> &Columns) const {
+	return RunAsync([this, TableName, Column, Value, Columns]() -> Table {
+		Table Result;
+		QueryMemory Memory;
+		SpinlockGuard Guard(Lock_);
+		auto TableIt = Tables_.find(TableName);
+		if(TableIt == Tables_.end())
+			throw std::runtime_error("Table does not exist.");
+		const auto &TableRef = TableIt->second;
+		if(const auto *Filter = FindFilter(TableName, Column); Filter && !Filter->MayContain(Value))
+			return Result;
+		if(const auto *Index = FindIndex(TableName, Column)) {
+			Index->ForEachMatch(Value, [&](RowId Id) {
+				TableRef.View(Id, [&](const Item &Row) { Collect(Result, Project(Row, Columns), Memory); });
+			});
+			return Result;
+		}
+		if(const auto *Dictionary = FindDictionary(TableName, Column)) {
+			// One dictionary lookup, then integer compares down the column's codes
+			ColumnDictionary::Code Code = Dictionary->Find(Value);
+			if(Code == ColumnDictionary::NoCode) return Result;
+			Dictionary->ForEachSlot(Code, [&](uint32_t Slot) {
+				TableRef.ViewSlot(Slot, [&](const Item &Row) { Collect(Result, Project(Row, Columns), Memory); });
+			});
+			return Result;
+		}
+		TableRef.ForEach([&](RowId, const Item &Row) {
+			auto It = Row.find(Column);
+			if(It != Row.end() && It->second == Value) Collect(Result, Project(Row, Columns), Memory);
+		});
+		return Result;
+	});
+}
+
+std::future<Database::Table> Database::SelectPrefix(const std::string &TableName, const std::string &Column,
+													const std::string &Prefix, const std::vector<std::string> &Columns) const {
+	return RunAsync([this, TableName, Column, Prefix, Columns]() -> Table {
+		Table Result;
+		QueryMemory Memory;
+		SpinlockGuard Guard(Lock_);
+		auto TableIt = Tables_.find(TableName);
+		if(TableIt == Tables_.end())
+			throw std::runtime_error("Table does not exist.");
+		const auto &TableRef = TableIt->second;
+		const auto *Index = FindIndex(TableName, Column);
+		if(Index && Index->Type() == IndexType::AdaptiveRadixTree) {
+			Index->ForEachPrefixMatch(Prefix, [&](RowId Id) {
+				TableRef.View(Id, [&](const Item &Row) { Collect(Result, Project(Row, Columns), Memory); });
+			});
+			return Result;
+		}
+		TableRef.ForEach([&](RowId, const Item &Row) {
+			auto It = Row.find(Column);
+			if(It != Row.end() && It->second.starts_with(Prefix)) Collect(Result, Project(Row, Columns), Memory);
+		});
+		return Result;
+	});
+}
+
+std::future<Database::Table> Database::SelectRange(const std::string &TableName, const Item &Equals, const std::string &RangeColumn,
+												   const std::optional<std::string> &Lower, const std::optional<std::string> &Upper,
+												   const std::vector<std::string> &Columns) const {
+	return RunAsync([this, TableName, Equals, RangeColumn, Lower, Upper, Columns]() -> Table {
+		Table Result;
+		QueryMemory Memory;
+		SpinlockGuard Guard(Lock_);
+		auto TableIt = Tables_.find(TableName);
+		if(TableIt == Tables_.end())
+			throw std::runtime_error("Table does not exist.");
+		const auto &TableRef = TableIt->second;
+		bool Ranged = !RangeColumn.empty();
+		if(const auto *Composite = FindCompositeIndex(TableName, Equals, RangeColumn)) {
+			std::vector<std::string> Leading;
+			Leading.reserve(Equals.size());
+			for(size_t i = 0; i < Equals.size(); ++i) Leading.push_back(Equals.at(Composite->Columns()[i]));
+			bool Covered = Composite->Covers(Columns);
+			// An open lower bound is "", which every present value meets while rows missing the column still fall out
+			Composite->Seek(Leading, Ranged ? std::optional<std::string>(Lower.value_or("")) : std::nullopt, Ranged ? Upper : std::nullopt,
+				[&](const std::string &Key, const CompositeIndex::Entry &Entry) {
+					if(Covered) Collect(Result, Composite->Materialize(Key, Entry, Columns), Memory);
+					else TableRef.View(Entry.Id, [&](const Item &Row) { Collect(Result, Project(Row, Columns), Memory); });
+				});
+			return Result;
 		}
+		TableRef.ForEach([&](RowId, const Item &Row) {
+			for(const auto &[Column, Value] : Equals) {
+				auto It = Row.find(Column);
+				if(It == Row.end() || It->second != Value) return;
+			}
+			if(Ranged) {
+				auto It = Row.find(RangeColumn);
+				if(It == Row.end() || (Lower && It->second < *Lower) || (Upper && *Upper < It->second)) return;
+			}
+			Collect(Result, Project(Row, Columns), Memory);
+		});
 		return Result;
 	});
 }
@@ -251,15 +497,20 @@ std::future<bool> Database::ValidateRow(const std::string &TableName, const Item
 					Valid = false;
 					break;
 				}
-				if(Column.IsUnique && Indexes_.find(TableName) != Indexes_.end()) {
-					auto ItCol = Indexes_.at(TableName).find(Column.Name);
-					if (ItCol != Indexes_.at(TableName).end() && Row.find(Column.Name) != Row.end()) {
-						if (std::get<BPlusTree<std::string, size_t>>(ItCol->second.Index()).Contains(Row.at(Column.Name))) {
-							Valid = false;
-							break;
-						}
-					}
+				auto ValueIt = Row.find(Column.Name);
+				if(!Column.IsUnique || ValueIt == Row.end()) continue;
+				// Most inserts carry new values, which the filter rules out before any index probe or scan
+				const auto *Filter = FindFilter(TableName, Column.Name);
+				if(Filter && !Filter->MayContain(ValueIt->second)) continue;
+				if(const auto *Index = FindIndex(TableName, Column.Name)) {
+					Valid = !Index->Contains(ValueIt->second);
+				} else if(auto TableIt = Tables_.find(TableName); TableIt != Tables_.end()) {
+					TableIt->second.ForEach([&](RowId, const Item &Existing) {
+						auto It = Existing.find(Column.Name);
+						if(It != Existing.end() && It->second == ValueIt->second) Valid = false;
+					});
 				}
+				if(!Valid) break;
 			}
 		}
 		return Valid;
@@ -272,15 +523,26 @@ std::future<bool> Database::LoadFromFile(std::filesystem::path &Path) {
 		if(!File) return false;
 		std::string EncryptedData((std::istreambuf_iterator<char>(File)),
 								  std::istreambuf_iterator<char>());
-		std::string CompressedData = DecryptData(EncryptedData);
-		std::string RawData = DecompressData(CompressedData);
+		std::string RawData = Storage::Open(EncryptedData, StorageKey(Path, false));
 		std::istringstream Input(RawData);
 		size_t SchemaCount;
 		Input >> SchemaCount;
 		{
 			SpinlockGuard Guard(Lock_);
 			TableSchemas_.clear();
+			for(auto &[TableName, Rows] : Tables_) Rows.Clear();
 			Tables_.clear();
+			Indexes_.clear();
+			PendingIndexes_.clear();
+			StoredIndexes_.clear();
+			EncodedIndexes_.clear();
+			Filters_.clear();
+			NextAnalysis_.clear();
+			CompositeIndexes_.clear();
+			ForeignKeys_.clear();
+			Acls_.clear();
+			for(const auto &[TableName, Bytes] : Resident_) MemoryBudget::Global().Release(Bytes);
+			Resident_.clear();
 			for (size_t i = 0; i < SchemaCount; ++i) {
 				std::string TableName;
 				Input >> TableName;
@@ -296,27 +558,97 @@ std::future<bool> Database::LoadFromFile(std::filesystem::path &Path) {
 				}
 				TableSchemas_[TableName] = NewSchema;
 			}
-			size_t TableCount;
-			Input >> TableCount;
+			// Dictionaries of encoded columns come first; files written before encoding go straight to the tables
+			std::unordered_map<std::string, std::vector<std::pair<std::string, std::vector<std::string>>>> Encoded;
+			std::string Token;
+			Input >> Token;
+			if(Token == "DICTIONARIES") {
+				size_t EncodedTables;
+				Input >> EncodedTables;
+				for(size_t i = 0; i < EncodedTables; ++i) {
+					std::string TableName;
+					size_t ColumnCount;
+					Input >> TableName >> ColumnCount;
+					auto &Columns = Encoded[TableName];
+					for(size_t j = 0; j < ColumnCount; ++j) {
+						auto &[ColumnName, Values] = Columns.emplace_back();
+						size_t ValueCount;
+						Input >> ColumnName >> ValueCount;
+						Values.resize(ValueCount);
+						for(auto &Value : Values) {
+							size_t Length;
+							Input >> Length;
+							Input.get();
+							Value.resize(Length);
+							Input.read(Value.data(), static_cast<std::streamsize>(Length));
+						}
+					}
+				}
+				Input >> Token;
+			}
+			size_t TableCount = std::stoull(Token);
 			for (size_t i = 0; i < TableCount; ++i) {
 				std::string TableName;
 				Input >> TableName;
 				size_t RowCount;
 				Input >> RowCount;
-				Table NewTable;
-				for(size_t j = 0; j < RowCount; ++j) {
+				std::vector<Item> Rows(RowCount);
+				for(auto &NewRow : Rows) {
 					size_t ItemCount;
 					Input >> ItemCount;
-					Item NewRow;
 					for(size_t k = 0; k < ItemCount; ++k) {
 						std::string Key, Value;
 						Input >> Key >> Value;
-						NewRow[Key] = Value;
+						NewRow.insert_or_assign(std::move(Key), std::move(Value));
+					}
+				}
+				if(auto EncodedIt = Encoded.find(TableName); EncodedIt != Encoded.end()) {
+					for(const auto &[ColumnName, Values] : EncodedIt->second) {
+						for(auto &NewRow : Rows) {
+							Input >> Token;
+							if(Token == "-") continue;
+							size_t Code = std::stoull(Token);
+							if(Code >= Values.size())
+								throw std::runtime_error("Corrupt dictionary code in " + TableName + "." + ColumnName);
+							NewRow[ColumnName] = Values[Code];
+						}
 					}
-					NewTable.push_back(NewRow);
 				}
-				Tables_[TableName] = NewTable;
+				RowTable NewTable;
+				NewTable.AttachHeap(Heap_.get());
+				NewTable.Reserve(RowCount);
+				// Columns that were encoded go back to codes as the rows come in
+				if(auto EncodedIt = Encoded.find(TableName); EncodedIt != Encoded.end())
+					for(const auto &[ColumnName, Values] : EncodedIt->second) NewTable.EncodeColumn(ColumnName);
+				for(auto &NewRow : Rows) NewTable.Insert(std::move(NewRow));
+				Tables_[TableName] = std::move(NewTable);
+				TrimResident();
+			}
+			// Files written before the catalog existed end after the rows
+			std::string Marker;
+			if(Input >> Marker && Marker == "CATALOG" && Input.get() == '\n') {
+				try {
+					RestoreCatalog(std::string_view(RawData).substr(static_cast<size_t>(Input.tellg())));
+				} catch(const std::runtime_error &Error) {
+					// The rows are intact; indexes can be rebuilt, so a damaged catalog only costs that
+					StoredIndexes_.clear();
+					Filters_.clear();
+					CompositeIndexes_.clear();
+					ForeignKeys_.clear();
+					Acls_.clear();
+					if(Logger_) Logger_->Error(std::string("Ignoring damaged catalog: ") + Error.what());
+				}
 			}
+			// Filters are not stored, only which columns have one; they are rebuilt from the rows
+			for(const auto &[TableName, Columns] : TableSchemas_)
+				for(const auto &Column : Columns)
+					if(Column.IsUnique) Filters_[TableName][Column.Name];
+			for(auto &[TableName, Columns] : Filters_)
+				for(auto &[ColumnName, Filter] : Columns) RebuildFilter(TableName, ColumnName, Filter);
+			for(const auto &[TableName, Rows] : Tables_) AnalyzeColumns(TableName);
+			// Composite indexes are stored as their column lists and rebuilt from the rows
+			for(auto &[TableName, Composites] : CompositeIndexes_)
+				for(auto &Composite : Composites) Composite.Build(Tables_[TableName]);
 		}
 		return true;
 	});
@@ -326,6 +658,7 @@ std::future<Database::Table> Database::JoinTables(const std::string &LeftTable,
 								  const std::function<bool(const Item&, const Item&)> &JoinCondition) const {
 	return RunAsync([this, LeftTable, RightTable, JoinCondition]() -> Table {
 		Table Result;
+		QueryMemory Memory;
 		{
 			SpinlockGuard Guard(Lock_);
 			auto LeftIt = Tables_.find(LeftTable);
@@ -334,16 +667,176 @@ std::future<Database::Table> Database::JoinTables(const std::string &LeftTable,
 				throw std::runtime_error("One or both tables do not exist.");
 			const auto &LeftData = LeftIt->second;
 			const auto &RightData = RightIt->second;
-			if(!LeftData.empty()) PREFETCH(LeftData.data());
-			if(!RightData.empty()) PREFETCH(RightData.data());
-			for(const auto &LeftRow : LeftData) {
-				for(const auto &RightRow : RightData) {
+			if(LeftData.Data()) PREFETCH(LeftData.Data());
+			if(RightData.Data()) PREFETCH(RightData.Data());
+			LeftData.ForEach([&](RowId, const Item &LeftRow) {
+				RightData.ForEach([&](RowId, const Item &RightRow) {
 					if(JoinCondition(LeftRow, RightRow)) {
-						Item JoinedRow = RightRow;
+						Item JoinedRow;
+						JoinedRow.reserve(RightRow.size() + LeftRow.size());
+						JoinedRow.insert(RightRow.begin(), RightRow.end());
 						JoinedRow.insert(LeftRow.begin(), LeftRow.end());
-						Result.push_back(JoinedRow);
+						Collect(Result, std::move(JoinedRow), Memory);
+					}
+				});
+			});
+		}
+		return Result;
+	});
+}
+
+std::future<Database::Table> Database::JoinTablesOn(const std::string &LeftTable, const std::string &RightTable,
+													const std::string &LeftColumn, const std::string &RightColumn) const {
+	return RunAsync([this, LeftTable, RightTable, LeftColumn, RightColumn]() -> Table {
+		Table Result;
+		QueryMemory Memory;
+		auto Emit = [&](const Item &LeftRow, const Item &RightRow) {
+			// Sized up front so merging in the left side never rehashes
+			Item JoinedRow;
+			JoinedRow.reserve(RightRow.size() + LeftRow.size());
+			JoinedRow.insert(RightRow.begin(), RightRow.end());
+			JoinedRow.insert(LeftRow.begin(), LeftRow.end());
+			Collect(Result, std::move(JoinedRow), Memory);
+		};
+		constexpr size_t EntryBytes = sizeof(std::pair<std::string_view, const Item*>) + 2 * sizeof(void*);
+		std::vector<RowId> LeftIds, RightIds;
+		size_t Partitions;
+		{
+			SpinlockGuard Guard(Lock_);
+			auto LeftIt = Tables_.find(LeftTable);
+			auto RightIt = Tables_.find(RightTable);
+			if(LeftIt == Tables_.end() || RightIt == Tables_.end())
+				throw std::runtime_error("One or both tables do not exist.");
+			const auto &RightData = RightIt->second;
+			const auto *Filter = FindFilter(RightTable, RightColumn);
+			const auto *Index = FindIndex(RightTable, RightColumn);
+			auto Probed = [&](const Item &LeftRow) -> const std::string* {
+				auto It = LeftRow.find(LeftColumn);
+				if(It == LeftRow.end() || (Filter && !Filter->MayContain(It->second))) return nullptr;
+				return &It->second;
+			};
+			if(Index) {
+				LeftIt->second.ForEach([&](RowId, const Item &LeftRow) {
+					if(const std::string *Key = Probed(LeftRow))
+						Index->ForEachMatch(*Key, [&](RowId Id) {
+							RightData.View(Id, [&](const Item &RightRow) { Emit(LeftRow, RightRow); });
+						});
+				});
+				return Result;
+			}
+			// Without an index the right side is hashed once and probed per left row
+			size_t BuildBytes = RightData.Size() * EntryBytes;
+			if(Memory.TryReserve(BuildBytes)) {
+				// Nodes come from the query's arena instead of one heap allocation per right row
+				std::pmr::unordered_multimap<std::string_view, const Item*> Build(Memory.Arena());
+				Build.reserve(RightData.Size());
+				// A scan may lend out a scratch copy of an evicted row, so the table keeps what the hash points at
+				std::pmr::vector<RowId> Ids(Memory.Arena());
+				Ids.reserve(RightData.Size());
+				RightData.ForEach([&](RowId Id, const Item&) { Ids.push_back(Id); });
+				for(RowId Id : Ids) {
+					const Item &Row = *RightData.Get(Id);
+					if(auto It = Row.find(RightColumn); It != Row.end()) Build.emplace(It->second, &Row);
+				}
+				LeftIt->second.ForEach([&](RowId, const Item &LeftRow) {
+					if(const std::string *Key = Probed(LeftRow))
+						for(auto [Begin, End] = Build.equal_range(*Key); Begin != End; ++Begin) Emit(LeftRow, *Begin->second);
+				});
+				RightData.Deflate();
+				Memory.Release(BuildBytes);
+				return Result;
+			}
+			/* Grace hash join: both sides are split by the hash of their join key into partitions sized to fit
+			what memory is left, written to spill files, and joined one partition at a time. A partition whose
+			right side still does not fit, because of a skewed key, is hashed in batches and its left side is
+			read once per batch. Only the row ids are taken here; the disk work happens without Lock_.*/
+			size_t RightBytes = 0;
+			RightData.ForEach([&](RowId Id, const Item &Row) {
+				RightBytes += RowBytes(Row) + EntryBytes;
+				RightIds.push_back(Id);
+			});
+			LeftIt->second.ForEach([&](RowId Id, const Item&) { LeftIds.push_back(Id); });
+			size_t Available = std::max<size_t>(Memory.Available(), 1);
+			Partitions = std::clamp<size_t>(RightBytes / Available * 2 + 1, 2, 64);
+		}
+		std::filesystem::path SpillDirectory = Memory.Budget().SpillDirectory();
+		std::vector<std::unique_ptr<SpillFile>> LeftParts, RightParts;
+		for(size_t i = 0; i < Partitions; ++i) {
+			LeftParts.push_back(std::make_unique<SpillFile>(SpillDirectory));
+			RightParts.push_back(std::make_unique<SpillFile>(SpillDirectory));
+		}
+		auto Partition = [&](const std::string &Key) { return std::hash<std::string>{}(Key) % Partitions; };
+		/* Rows are copied under Lock_ a batch at a time, as much as the query's memory allows, and written
+		out after it is released. A row erased in between is skipped, so the join sees each row as it was
+		when its batch was copied.*/
+		auto Spill = [&](const std::string &TableName, const std::vector<RowId> &Ids, auto &&KeyOf,
+						 std::vector<std::unique_ptr<SpillFile>> &Parts) {
+			std::vector<std::pair<size_t, Item>> Batch;
+			size_t BatchBytes = 0;
+			for(size_t Next = 0; Next < Ids.size();) {
+				{
+					SpinlockGuard Guard(Lock_);
+					auto TableIt = Tables_.find(TableName);
+					if(TableIt == Tables_.end())
+						throw std::runtime_error("One or both tables do not exist.");
+					for(; Next < Ids.size(); ++Next) {
+						const Item *Row = TableIt->second.Get(Ids[Next]);
+						const std::string *Key = Row ? KeyOf(*Row) : nullptr;
+						if(!Key) continue;
+						size_t Bytes = RowBytes(*Row);
+						if(!Memory.TryReserve(Bytes)) {
+							if(!Batch.empty()) break;
+							Memory.Reserve(Bytes);
+						}
+						BatchBytes += Bytes;
+						Batch.emplace_back(Partition(*Key), *Row);
 					}
+					TableIt->second.Deflate();
 				}
+				for(const auto &[Part, Row] : Batch) Parts[Part]->Write(Row);
+				Batch.clear();
+				Memory.Release(BatchBytes);
+				BatchBytes = 0;
+			}
+		};
+		Spill(RightTable, RightIds, [&](const Item &Row) -> const std::string* {
+			auto It = Row.find(RightColumn);
+			return It == Row.end() ? nullptr : &It->second;
+		}, RightParts);
+		// The filter is looked up again under each batch's lock, since it may be rebuilt or dropped in between
+		Spill(LeftTable, LeftIds, [&](const Item &Row) -> const std::string* {
+			auto It = Row.find(LeftColumn);
+			if(It == Row.end()) return nullptr;
+			const auto *Filter = FindFilter(RightTable, RightColumn);
+			return Filter && !Filter->MayContain(It->second) ? nullptr : &It->second;
+		}, LeftParts);
+		if(Logger_) Logger_->Info("Join of " + LeftTable + " and " + RightTable + " spilled to " + std::to_string(Partitions) + " partitions");
+		Item RightRow, LeftRow;
+		for(size_t i = 0; i < Partitions; ++i) {
+			if(!LeftParts[i]->Rows()) continue;
+			RightParts[i]->Rewind();
+			for(bool More = RightParts[i]->Read(RightRow); More;) {
+				std::vector<Item> Batch;
+				size_t BatchBytes = 0;
+				do {
+					size_t Bytes = RowBytes(RightRow) + EntryBytes;
+					if(!Memory.TryReserve(Bytes)) {
+						if(!Batch.empty()) break;
+						Memory.Reserve(Bytes);
+					}
+					BatchBytes += Bytes;
+					Batch.push_back(std::move(RightRow));
+					More = RightParts[i]->Read(RightRow);
+				} while(More);
+				// A batch's table is dropped before the next one is built, so it gets its own arena
+				std::pmr::monotonic_buffer_resource BatchArena;
+				std::pmr::unordered_multimap<std::string_view, const Item*> Build(&BatchArena);
+				Build.reserve(Batch.size());
+				for(const auto &Row : Batch) Build.emplace(Row.at(RightColumn), &Row);
+				LeftParts[i]->Rewind();
+				while(LeftParts[i]->Read(LeftRow))
+					for(auto [Begin, End] = Build.equal_range(LeftRow.at(LeftColumn)); Begin != End; ++Begin) Emit(LeftRow, *Begin->second);
+				Memory.Release(BatchBytes);
 			}
 		}
 		return Result;
@@ -354,6 +847,7 @@ std::future<void> Database::AddForeignKey(const std::string &TableName, const Fo
 	return RunAsync([this, TableName, Key]() {
 		SpinlockGuard Guard(Lock_);
 		ForeignKeys_[TableName].push_back(Key);
+		Dirty_.store(true, std::memory_order_release);
 	});
 }
 
@@ -433,7 +927,442 @@ const std::optional<User>& Database::CurrentUser() const {
 }
 
 // Helper: get or create index for a table/column
-IndexManagement<std::string, size_t>& Database::GetOrCreateIndex(const std::string& table, const std::string& column) {
+Database::ColumnIndex *Database::FindIndex(const std::string &TableName, const std::string &ColumnName) {
+	auto TableIt = Indexes_.find(TableName);
+	if(TableIt != Indexes_.end())
+		if(auto ColumnIt = TableIt->second.find(ColumnName); ColumnIt != TableIt->second.end())
+			return &ColumnIt->second;
+	return LoadStoredIndex(TableName, ColumnName);
+}
+
+const Database::ColumnIndex *Database::FindIndex(const std::string &TableName, const std::string &ColumnName) const {
+	return const_cast<Database*>(this)->FindIndex(TableName, ColumnName);
+}
+
+/* Both helpers expect Lock_ to be held; they keep the column's index and Bloom filter in step with its rows.
+IndexErase is only called for a value the row holds, so Live never counts a value twice or one it never had.*/
+void Database::IndexInsert(const std::string &TableName, const std::string &ColumnName, const std::string &Value, RowId Id) {
+	if(auto *Index = FindIndex(TableName, ColumnName)) {
+		Index->Insert(Value, Id);
+		ChargeResident(TableName, IndexEntryBytes(Value));
+		DropEncodedIndex(TableName, ColumnName);
+	}
+	if(auto TableIt = Filters_.find(TableName); TableIt != Filters_.end()) {
+		if(auto FilterIt = TableIt->second.find(ColumnName); FilterIt != TableIt->second.end()) {
+			ColumnFilter &Filter = FilterIt->second;
+			Filter.Filter.Insert(Value);
+			++Filter.Live;
+			++Filter.Added;
+		}
+	}
+	if(auto TableIt = PendingIndexes_.find(TableName); TableIt != PendingIndexes_.end())
+		if(auto LogIt = TableIt->second.find(ColumnName); LogIt != TableIt->second.end())
+			LogIt->second->push_back({true, Value, Id});
+}
+
+void Database::IndexErase(const std::string &TableName, const std::string &ColumnName, const std::string &Value, RowId Id) {
+	if(auto *Index = FindIndex(TableName, ColumnName); Index && Index->Erase(Value, Id)) {
+		ReleaseResident(TableName, IndexEntryBytes(Value));
+		DropEncodedIndex(TableName, ColumnName);
+	}
+	if(auto TableIt = Filters_.find(TableName); TableIt != Filters_.end()) {
+		if(auto FilterIt = TableIt->second.find(ColumnName); FilterIt != TableIt->second.end()) {
+			ColumnFilter &Filter = FilterIt->second;
+			if(Filter.Live) --Filter.Live;
+		}
+	}
+	if(auto TableIt = PendingIndexes_.find(TableName); TableIt != PendingIndexes_.end())
+		if(auto LogIt = TableIt->second.find(ColumnName); LogIt != TableIt->second.end())
+			LogIt->second->push_back({false, Value, Id});
+}
+
+size_t Database::IndexBytes(const ColumnIndex &Index) {
+	size_t Bytes = 0;
+	Index.ForEachEntry([&](const auto &Key, const ColumnIndex::Postings &List) { Bytes += IndexEntryBytes(Key) * List.Size(); });
+	return Bytes;
+}
+
+// Rows and index entries are already allocated when they are charged, so the charge never fails
+void Database::ChargeResident(const std::string &TableName, size_t Bytes) {
+	MemoryBudget::Global().Charge(Bytes);
+	Resident_[TableName] += Bytes;
+}
+
+void Database::ReleaseResident(const std::string &TableName, size_t Bytes) {
+	auto It = Resident_.find(TableName);
+	if(It == Resident_.end()) return;
+	Bytes = std::min(Bytes, It->second);
+	MemoryBudget::Global().Release(Bytes);
+	It->second -= Bytes;
+}
+
+// Evicts from every table in proportion to its share of the resident rows, so hot tables keep their rows cached
+void Database::TrimResident() {
+	if(!Heap_) return;
+	size_t Resident = 0;
+	for(const auto &[TableName, Rows] : Tables_) Resident += Rows.ResidentBytes();
+	if(Resident <= MaxResidentBytes_) return;
+	for(auto &[TableName, Rows] : Tables_)
+		Rows.Evict(static_cast<size_t>(static_cast<double>(Rows.ResidentBytes()) * MaxResidentBytes_ / Resident));
+}
+
+void Database::EnableBufferPool(size_t Frames, size_t ResidentBytes) {
+	SpinlockGuard Guard(Lock_);
+	if(Heap_) throw std::runtime_error("Buffer pool is already enabled");
+	Heap_ = std::make_unique<PageHeap>(DbPath_.string() + ".pages", Frames);
+	MaxResidentBytes_ = ResidentBytes;
+	Paging_.store(true, std::memory_order_release);
+	for(auto &[TableName, Rows] : Tables_) Rows.AttachHeap(Heap_.get());
+	TrimResident();
+	if(Logger_) Logger_->Info("Buffer pool of " + std::to_string(Heap_->Pool().FrameCount()) + " pages enabled, " +
+							  std::to_string(Heap_->Pool().PageCount()) + " pages written");
+}
+
+const DS::BloomFilter *Database::FindFilter(const std::string &TableName, const std::string &ColumnName) const {
+	auto TableIt = Filters_.find(TableName);
+	if(TableIt == Filters_.end()) return nullptr;
+	auto FilterIt = TableIt->second.find(ColumnName);
+	return FilterIt == TableIt->second.end() ? nullptr : &FilterIt->second.Filter;
+}
+
+// A composite index whose leading columns are exactly Equals' columns, in any order, followed by RangeColumn if it is set
+const CompositeIndex *Database::FindCompositeIndex(const std::string &TableName, const Item &Equals, const std::string &RangeColumn) const {
+	auto TableIt = CompositeIndexes_.find(TableName);
+	if(TableIt == CompositeIndexes_.end()) return nullptr;
+	size_t Leading = Equals.size() + !RangeColumn.empty();
+	for(const auto &Composite : TableIt->second) {
+		const auto &Columns = Composite.Columns();
+		if(Columns.size() < Leading) continue;
+		if(!RangeColumn.empty() && Columns[Equals.size()] != RangeColumn) continue;
+		if(std::all_of(Columns.begin(), Columns.begin() + Equals.size(),
+					   [&](const std::string &Column) { return Equals.contains(Column); }))
+			return &Composite;
+	}
+	return nullptr;
+}
+
+const ColumnDictionary *Database::FindDictionary(const std::string &TableName, const std::string &ColumnName) const {
+	auto TableIt = Tables_.find(TableName);
+	return TableIt == Tables_.end() ? nullptr : TableIt->second.Dictionary(ColumnName);
+}
+
+/* Counts distinct values per column, giving up on a column once it passes MaxValues. Columns that
+qualify are encoded; encoded ones that no longer qualify get their cells back, and those whose
+dictionary has filled up with values no row holds are compacted.*/
+void Database::AnalyzeColumns(const std::string &TableName) {
+	auto TableIt = Tables_.find(TableName);
+	if(TableIt == Tables_.end()) return;
+	RowTable &Rows = TableIt->second;
+	NextAnalysis_[TableName] = std::max(ColumnDictionary::MinRows, Rows.Size() * 2);
+	/* Copies, since a scan may hand out rows that are gone once the callback returns; MaxValues bounds them.
+	They live in an arena dropped with the analysis, and lookups take views so only new values are copied.*/
+	struct ViewHash {
+		using is_transparent = void;
+		size_t operator()(std::string_view Text) const { return std::hash<std::string_view>{}(Text); }
+	};
+	using ValueSet = std::pmr::unordered_set<std::pmr::string, ViewHash, std::equal_to<>>;
+	std::pmr::monotonic_buffer_resource Arena;
+	std::pmr::unordered_map<std::pmr::string, ValueSet, ViewHash, std::equal_to<>> Distinct(&Arena);
+	std::pmr::unordered_set<std::pmr::string, ViewHash, std::equal_to<>> Rejected(&Arena);
+	Rows.ForEach([&](RowId, const Item &Row) {
+		for(const auto &[ColumnName, Value] : Row) {
+			std::string_view Name = ColumnName;
+			if(Rejected.contains(Name)) continue;
+			auto SeenIt = Distinct.find(Name);
+			if(SeenIt == Distinct.end()) SeenIt = Distinct.emplace(Name, ValueSet()).first;
+			auto &Seen = SeenIt->second;
+			if(!Seen.contains(std::string_view(Value))) Seen.emplace(Value);
+			if(Seen.size() > ColumnDictionary::MaxValues) {
+				Rejected.emplace(Name);
+				Distinct.erase(SeenIt);
+			}
+		}
+	});
+	size_t Limit = Rows.Size() < ColumnDictionary::MinRows ? 0 : Rows.Size() / ColumnDictionary::MinRowsPerValue;
+	std::vector<std::pair<std::string, size_t>> Encoded;
+	Rows.ForEachEncoded([&](const std::string &ColumnName, const ColumnDictionary &Dictionary) {
+		Encoded.emplace_back(ColumnName, Dictionary.Size());
+	});
+	for(const auto &[Name, Values] : Encoded) {
+		auto It = Distinct.find(std::string_view(Name));
+		if(It == Distinct.end() || It->second.size() > Limit) Rows.DecodeColumn(Name);
+		else if(Values > 2 * It->second.size()) Rows.CompactColumn(Name);
+	}
+	for(const auto &[ColumnName, Seen] : Distinct) {
+		std::string Name(ColumnName);
+		if(Seen.size() > Limit || Rows.Dictionary(Name)) continue;
+		if(Rows.EncodeColumn(Name) && Logger_)
+			Logger_->Info("Dictionary-encoded " + TableName + "." + Name + " (" + std::to_string(Seen.size()) + " values)");
+	}
+}
+
+// Sizes the filter at twice the column's current values so it absorbs as many inserts before the next rebuild
+void Database::RebuildFilter(const std::string &TableName, const std::string &ColumnName, ColumnFilter &Filter) {
+	auto TableIt = Tables_.find(TableName);
+	size_t Count = 0;
+	if(TableIt != Tables_.end())
+		TableIt->second.ForEach([&](RowId, const Item &Row) { Count += Row.contains(ColumnName); });
+	Filter.Filter.Reset(Count * 2);
+	if(TableIt != Tables_.end()) {
+		TableIt->second.ForEach([&](RowId, const Item &Row) {
+			if(auto It = Row.find(ColumnName); It != Row.end()) Filter.Filter.Insert(It->second);
+		});
+	}
+	Filter.Live = Count;
+	Filter.Added = Count;
+}
+
+// Called with Lock_ held once a write has left its rows as they will stay
+void Database::RefreshFilters(const std::string &TableName) {
+	auto TableIt = Filters_.find(TableName);
+	if(TableIt == Filters_.end()) return;
+	for(auto &[ColumnName, Filter] : TableIt->second)
+		if(Filter.Added >= Filter.Filter.Capacity() || Filter.Added - Filter.Live > std::max<size_t>(Filter.Live, 64))
+			RebuildFilter(TableName, ColumnName, Filter);
+}
+
+// Hash of every (row ordinal, value) pair of the column, in row order; Entries receives the pair count
+uint64_t Database::ColumnChecksum(const RowTable &Rows, const std::string &ColumnName, uint64_t &Entries) {
+	uint64_t Checksum = Checksum64({});
+	uint64_t Ordinal = 0;
+	Entries = 0;
+	Rows.ForEach([&](RowId, const Item &Row) {
+		if(auto It = Row.find(ColumnName); It != Row.end()) {
+			uint64_t Header[2] = {Ordinal, It->second.size()};
+			Checksum = Checksum64(std::string_view(reinterpret_cast<const char*>(Header), sizeof(Header)), Checksum);
+			Checksum = Checksum64(It->second, Checksum);
+			++Entries;
+		}
+		++Ordinal;
+	});
+	return Checksum;
+}
+
+/* Decodes a stored index into Indexes_. Rows loaded from the file occupy slots in file order with
+generation 0, so a row ordinal is its RowId until the table is first written to.*/
+Database::ColumnIndex *Database::LoadStoredIndex(const std::string &TableName, const std::string &ColumnName) {
+	auto StoredTableIt = StoredIndexes_.find(TableName);
+	if(StoredTableIt == StoredIndexes_.end()) return nullptr;
+	auto StoredIt = StoredTableIt->second.find(ColumnName);
+	if(StoredIt == StoredTableIt->second.end()) return nullptr;
+	StoredIndex Stored = std::move(StoredIt->second);
+	StoredTableIt->second.erase(StoredIt);
+	if(StoredTableIt->second.empty()) StoredIndexes_.erase(StoredTableIt);
+	auto TableIt = Tables_.find(TableName);
+	if(TableIt == Tables_.end()) return nullptr;
+	const RowTable &Rows = TableIt->second;
+	uint64_t Entries = 0;
+	bool Valid = ColumnChecksum(Rows, ColumnName, Entries) == Stored.Checksum && Entries == Stored.Entries;
+	std::vector<std::pair<std::string, ColumnIndex::Postings>> Grouped;
+	try {
+		Valid = Valid && DecodeIndexPages(Stored.Pages, [&](std::string_view Key, const std::vector<uint32_t> &Ordinals) {
+			ColumnIndex::Postings List;
+			for(uint32_t Ordinal : Ordinals) List.Insert(RowId{Ordinal, 0});
+			Grouped.emplace_back(std::string(Key), std::move(List));
+		});
+	} catch(const std::runtime_error&) {
+		Valid = false;
+	}
+	auto &Slot = Indexes_[TableName][ColumnName];
+	if(Valid) {
+		Slot = ColumnIndex::FromGroups(std::move(Grouped), Stored.Type);
+		ChargeResident(TableName, IndexBytes(Slot));
+		// Slots still equal row ordinals here, so the pages just read are what the next flush would encode
+		ChargeResident(TableName, Stored.Pages.size());
+		EncodedIndexes_[TableName][ColumnName] = std::move(Stored);
+		if(Logger_) Logger_->Info("Loaded index on " + TableName + "." + ColumnName + " from disk");
+		return &Slot;
+	}
+	if(Logger_) Logger_->Warn("Stored index on " + TableName + "." + ColumnName + " does not match the table, rebuilding it");
+	std::vector<std::pair<std::string, RowId>> Pairs;
+	Rows.ForEach([&](RowId Id, const Item &Row) {
+		if(auto It = Row.find(ColumnName); It != Row.end()) Pairs.emplace_back(It->second, Id);
+	});
+	Slot = ColumnIndex::Build(std::move(Pairs), Stored.Type);
+	ChargeResident(TableName, IndexBytes(Slot));
+	return &Slot;
+}
+
+// Called before a table is written to, while its row ordinals still match the stored pages
+void Database::LoadStoredIndexes(const std::string &TableName) {
+	auto StoredIt = StoredIndexes_.find(TableName);
+	if(StoredIt == StoredIndexes_.end()) return;
+	std::vector<std::string> Columns;
+	for(const auto &Entry : StoredIt->second) Columns.push_back(Entry.first);
+	for(const auto &ColumnName : Columns) LoadStoredIndex(TableName, ColumnName);
+}
+
+void Database::DropEncodedIndex(const std::string &TableName, const std::string &ColumnName) {
+	auto TableIt = EncodedIndexes_.find(TableName);
+	if(TableIt == EncodedIndexes_.end()) return;
+	if(auto It = TableIt->second.find(ColumnName); It != TableIt->second.end()) {
+		ReleaseResident(TableName, It->second.Pages.size());
+		TableIt->second.erase(It);
+	}
+}
+
+void Database::DropEncodedIndexes(const std::string &TableName) {
+	auto TableIt = EncodedIndexes_.find(TableName);
+	if(TableIt == EncodedIndexes_.end()) return;
+	for(const auto &[ColumnName, Encoded] : TableIt->second) ReleaseResident(TableName, Encoded.Pages.size());
+	EncodedIndexes_.erase(TableIt);
+}
+
+/* Foreign keys, ACLs, every index as pages and the columns carrying Bloom filters. Stored indexes nobody
+touched are written back unchanged, and live indexes reuse their last encoding until they change, so a
+flush only encodes the indexes written to since the one before.
+
+The pages cannot be mapped and used in place after open, however they are laid out: Storage compresses
+and encrypts the whole file as one stream, so every byte is decrypted into memory on load anyway. The
+stored pages are instead kept as they are and decoded per index on first use.*/
+std::string Database::SerializeCatalog() {
+	CatalogWriter Catalog;
+	Catalog.Number(ForeignKeys_.size());
+	for(const auto &[TableName, Keys] : ForeignKeys_) {
+		Catalog.String(TableName);
+		Catalog.Number(Keys.size());
+		for(const auto &Key : Keys) {
+			Catalog.String(Key.ColumnName);
+			Catalog.String(Key.ReferencedTable);
+			Catalog.String(Key.ReferencedColumn);
+		}
+	}
+	Catalog.Number(Acls_.size());
+	for(const auto &[UserName, Grants] : Acls_) {
+		Catalog.String(UserName);
+		Catalog.Number(Grants.size());
+		for(const auto &[TableName, Perms] : Grants) {
+			Catalog.String(TableName);
+			Catalog.Number(static_cast<uint64_t>(Perms));
+		}
+	}
+	size_t IndexCount = 0;
+	for(const auto &[TableName, Columns] : Indexes_)
+		if(Tables_.contains(TableName)) IndexCount += Columns.size();
+	for(const auto &[TableName, Columns] : StoredIndexes_) IndexCount += Columns.size();
+	Catalog.Number(IndexCount);
+	for(const auto &[TableName, Columns] : Indexes_) {
+		auto TableIt = Tables_.find(TableName);
+		if(TableIt == Tables_.end()) continue;
+		const RowTable &Rows = TableIt->second;
+		auto &Encodings = EncodedIndexes_[TableName];
+		// Built only once an index of this table actually needs encoding
+		std::vector<uint32_t> SlotOrdinals;
+		for(const auto &[ColumnName, Index] : Columns) {
+			auto [EncodedIt, Missing] = Encodings.try_emplace(ColumnName);
+			StoredIndex &Encoded = EncodedIt->second;
+			if(Missing) {
+				if(SlotOrdinals.empty()) {
+					SlotOrdinals.resize(Rows.SlotCount());
+					uint32_t Ordinal = 0;
+					Rows.ForEach([&](RowId Id, const Item&) { SlotOrdinals[Id.Slot] = Ordinal++; });
+				}
+				IndexPageWriter Pages;
+				std::vector<uint32_t> Ordinals;
+				Index.ForEachEntry([&](const auto &Key, const ColumnIndex::Postings &List) {
+					Ordinals.clear();
+					for(RowId Id : List) Ordinals.push_back(SlotOrdinals[Id.Slot]);
+					Pages.Add(Key, Ordinals);
+				});
+				Encoded.Type = Index.Type();
+				Encoded.Checksum = ColumnChecksum(Rows, ColumnName, Encoded.Entries);
+				Encoded.Pages = Pages.Finish();
+				ChargeResident(TableName, Encoded.Pages.size());
+			}
+			Catalog.String(TableName);
+			Catalog.String(ColumnName);
+			Catalog.Number(static_cast<uint64_t>(Encoded.Type));
+			Catalog.Number(Encoded.Entries);
+			Catalog.Number(Encoded.Checksum);
+			Catalog.String(Encoded.Pages);
+		}
+	}
+	for(const auto &[TableName, Columns] : StoredIndexes_) {
+		for(const auto &[ColumnName, Stored] : Columns) {
+			Catalog.String(TableName);
+			Catalog.String(ColumnName);
+			Catalog.Number(static_cast<uint64_t>(Stored.Type));
+			Catalog.Number(Stored.Entries);
+			Catalog.Number(Stored.Checksum);
+			Catalog.String(Stored.Pages);
+		}
+	}
+	size_t FilterCount = 0;
+	for(const auto &[TableName, Columns] : Filters_) FilterCount += Columns.size();
+	Catalog.Number(FilterCount);
+	for(const auto &[TableName, Columns] : Filters_) {
+		for(const auto &[ColumnName, Filter] : Columns) {
+			Catalog.String(TableName);
+			Catalog.String(ColumnName);
+		}
+	}
+	size_t CompositeCount = 0;
+	for(const auto &[TableName, Composites] : CompositeIndexes_) CompositeCount += Composites.size();
+	Catalog.Number(CompositeCount);
+	for(const auto &[TableName, Composites] : CompositeIndexes_) {
+		for(const auto &Composite : Composites) {
+			Catalog.String(TableName);
+			Catalog.Number(Composite.Columns().size());
+			for(const auto &Column : Composite.Columns()) Catalog.String(Column);
+			Catalog.Number(Composite.Include().size());
+			for(const auto &Column : Composite.Include()) Catalog.String(Column);
+		}
+	}
+	return Catalog.Take();
+}
+
+// Expects Lock_ to be held; index pages are kept as they are and decoded on first use
+void Database::RestoreCatalog(std::string_view Data) {
+	CatalogReader Catalog(Data);
+	for(uint64_t i = 0, Tables = Catalog.Number(); i < Tables; ++i) {
+		auto &Keys = ForeignKeys_[std::string(Catalog.String())];
+		for(uint64_t j = 0, Count = Catalog.Number(); j < Count; ++j) {
+			ForeignKey Key;
+			Key.ColumnName = Catalog.String();
+			Key.ReferencedTable = Catalog.String();
+			Key.ReferencedColumn = Catalog.String();
+			Keys.push_back(std::move(Key));
+		}
+	}
+	for(uint64_t i = 0, Users = Catalog.Number(); i < Users; ++i) {
+		auto &Grants = Acls_[std::string(Catalog.String())];
+		for(uint64_t j = 0, Count = Catalog.Number(); j < Count; ++j) {
+			std::string TableName(Catalog.String());
+			Grants[TableName] = static_cast<Permissions>(Catalog.Number());
+		}
+	}
+	for(uint64_t i = 0, Indexes = Catalog.Number(); i < Indexes; ++i) {
+		std::string TableName(Catalog.String());
+		std::string ColumnName(Catalog.String());
+		StoredIndex Stored;
+		uint64_t Type = Catalog.Number();
+		if(Type > static_cast<uint64_t>(IndexType::Hash))
+			throw std::runtime_error("Unknown index type in catalog");
+		Stored.Type = static_cast<IndexType>(Type);
+		Stored.Entries = Catalog.Number();
+		Stored.Checksum = Catalog.Number();
+		Stored.Pages = Catalog.String();
+		StoredIndexes_[TableName][ColumnName] = std::move(Stored);
+	}
+	// Catalogs written before filters were tracked stop after the indexes
+	if(Catalog.AtEnd()) return;
+	for(uint64_t i = 0, Filters = Catalog.Number(); i < Filters; ++i) {
+		std::string TableName(Catalog.String());
+		Filters_[TableName][std::string(Catalog.String())];
+	}
+	if(Catalog.AtEnd()) return;
+	for(uint64_t i = 0, Composites = Catalog.Number(); i < Composites; ++i) {
+		std::string TableName(Catalog.String());
+		std::vector<std::string> Columns(Catalog.Number());
+		for(auto &Column : Columns) Column = Catalog.String();
+		std::vector<std::string> Include(Catalog.Number());
+		for(auto &Column : Include) Column = Catalog.String();
+		CompositeIndexes_[TableName].emplace_back(std::move(Columns), std::move(Include));
+	}
+}
+
+Database::ColumnIndex& Database::GetOrCreateIndex(const std::string& table, const std::string& column) {
+	if(auto *Stored = LoadStoredIndex(table, column)) return *Stored;
 	if (Indexes_[table].find(column) == Indexes_[table].end()) {
 		Indexes_[table].emplace(std::piecewise_construct,
 			std::forward_as_tuple(column),
@@ -442,26 +1371,117 @@ IndexManagement<std::string, size_t>& Database::GetOrCreateIndex(const std::stri
 	return Indexes_[table][column];
 }
 
-std::future<void> Database::AddIndex(const std::string &TableName, const std::string &ColumnName) {
+std::future<void> Database::AddIndex(const std::string &TableName, const std::string &ColumnName, IndexType Type) {
+	return RunAsync([this, TableName, ColumnName, Type]() {
+		std::vector<std::pair<std::string, RowId>> Pairs;
+		auto Log = std::make_shared<IndexChangeLog>();
+		{
+			SpinlockGuard Guard(Lock_);
+			auto TableIt = Tables_.find(TableName);
+			if(TableIt == Tables_.end())
+				throw std::runtime_error("Table does not exist");
+			Pairs.reserve(TableIt->second.Size());
+			TableIt->second.ForEach([&](RowId Id, const Item &Row) {
+				auto It = Row.find(ColumnName);
+				if(It != Row.end()) Pairs.emplace_back(It->second, Id);
+			});
+			PendingIndexes_[TableName][ColumnName] = Log;
+			if(auto StoredIt = StoredIndexes_.find(TableName); StoredIt != StoredIndexes_.end())
+				StoredIt->second.erase(ColumnName);
+		}
+		// Sorting and building run unlocked; writers append their index changes to Log meanwhile
+		size_t RowCount = Pairs.size();
+		ColumnIndex Built = ColumnIndex::Build(std::move(Pairs), Type);
+		SpinlockGuard Guard(Lock_);
+		auto PendingIt = PendingIndexes_.find(TableName);
+		if(PendingIt == PendingIndexes_.end()) return;
+		auto LogIt = PendingIt->second.find(ColumnName);
+		// The table or index was dropped, or a newer build superseded this one
+		if(LogIt == PendingIt->second.end() || LogIt->second != Log) return;
+		for(const auto &Change : *Log) {
+			if(Change.Insert) Built.Insert(Change.Key, Change.Id);
+			else Built.Erase(Change.Key, Change.Id);
+		}
+		PendingIt->second.erase(LogIt);
+		if(PendingIt->second.empty()) PendingIndexes_.erase(PendingIt);
+		auto &Slot = Indexes_[TableName][ColumnName];
+		ReleaseResident(TableName, IndexBytes(Slot));
+		ChargeResident(TableName, IndexBytes(Built));
+		Slot = std::move(Built);
+		DropEncodedIndex(TableName, ColumnName);
+		Dirty_.store(true, std::memory_order_release);
+		if(Logger_) Logger_->Info("Built index on " + TableName + "." + ColumnName + " (" + std::to_string(RowCount) + " rows)");
+	});
+}
+
+std::future<void> Database::RemoveIndex(const std::string &TableName, const std::string &ColumnName) {
 	return RunAsync([this, TableName, ColumnName]() {
 		SpinlockGuard Guard(Lock_);
-		auto& table = Tables_[TableName];
-		auto& index = GetOrCreateIndex(TableName, ColumnName);
-		for (size_t i = 0; i < table.size(); ++i) {
-			const auto& row = table[i];
-			auto it = row.find(ColumnName);
-			if (it != row.end()) {
-				// For now, always use BPlusTree
-				std::get<BPlusTree<std::string, size_t>>(index.Index()).Insert(it->second, i);
+		if(auto TableIt = Indexes_.find(TableName); TableIt != Indexes_.end()) {
+			if(auto IndexIt = TableIt->second.find(ColumnName); IndexIt != TableIt->second.end()) {
+				ReleaseResident(TableName, IndexBytes(IndexIt->second));
+				TableIt->second.erase(IndexIt);
 			}
 		}
+		DropEncodedIndex(TableName, ColumnName);
+		if(auto PendingIt = PendingIndexes_.find(TableName); PendingIt != PendingIndexes_.end())
+			PendingIt->second.erase(ColumnName);
+		if(auto StoredIt = StoredIndexes_.find(TableName); StoredIt != StoredIndexes_.end())
+			StoredIt->second.erase(ColumnName);
+		Dirty_.store(true, std::memory_order_release);
 	});
 }
 
-std::future<void> Database::RemoveIndex(const std::string &TableName, const std::string &ColumnName) {
+std::future<void> Database::AddCompositeIndex(const std::string &TableName, const std::vector<std::string> &Columns,
+											 const std::vector<std::string> &Include) {
+	return RunAsync([this, TableName, Columns, Include]() {
+		if(Columns.empty())
+			throw std::runtime_error("Composite index needs at least one column");
+		if(std::unordered_set<std::string>(Columns.begin(), Columns.end()).size() != Columns.size())
+			throw std::runtime_error("Composite index lists a column twice");
+		SpinlockGuard Guard(Lock_);
+		auto TableIt = Tables_.find(TableName);
+		if(TableIt == Tables_.end())
+			throw std::runtime_error("Table does not exist");
+		CompositeIndex Built(Columns, Include);
+		Built.Build(TableIt->second);
+		auto &Composites = CompositeIndexes_[TableName];
+		auto Existing = std::find_if(Composites.begin(), Composites.end(),
+									 [&](const CompositeIndex &Composite) { return Composite.Columns() == Columns; });
+		if(Existing != Composites.end()) *Existing = std::move(Built);
+		else Composites.push_back(std::move(Built));
+		Dirty_.store(true, std::memory_order_release);
+		if(Logger_) Logger_->Info("Built composite index on " + TableName + " (" + std::to_string(TableIt->second.Size()) + " rows)");
+	});
+}
+
+std::future<void> Database::RemoveCompositeIndex(const std::string &TableName, const std::vector<std::string> &Columns) {
+	return RunAsync([this, TableName, Columns]() {
+		SpinlockGuard Guard(Lock_);
+		auto TableIt = CompositeIndexes_.find(TableName);
+		if(TableIt == CompositeIndexes_.end()) return;
+		std::erase_if(TableIt->second, [&](const CompositeIndex &Composite) { return Composite.Columns() == Columns; });
+		if(TableIt->second.empty()) CompositeIndexes_.erase(TableIt);
+		Dirty_.store(true, std::memory_order_release);
+	});
+}
+
+std::future<void> Database::AddBloomFilter(const std::string &TableName, const std::string &ColumnName) {
 	return RunAsync([this, TableName, ColumnName]() {
 		SpinlockGuard Guard(Lock_);
-		Indexes_[TableName].erase(ColumnName);
+		if(Tables_.find(TableName) == Tables_.end())
+			throw std::runtime_error("Table does not exist");
+		RebuildFilter(TableName, ColumnName, Filters_[TableName][ColumnName]);
+		Dirty_.store(true, std::memory_order_release);
+	});
+}
+
+std::future<void> Database::RemoveBloomFilter(const std::string &TableName, const std::string &ColumnName) {
+	return RunAsync([this, TableName, ColumnName]() {
+		SpinlockGuard Guard(Lock_);
+		if(auto TableIt = Filters_.find(TableName); TableIt != Filters_.end())
+			TableIt->second.erase(ColumnName);
+		Dirty_.store(true, std::memory_order_release);
 	});
 }
 }
@@ -3,10 +3,16 @@
 #include <IO/Spinlock.hxx>
 #include <IO/Task.hxx>
 #include <IO/Logger.hxx>
+#include <DS/BloomFilter.hxx>
 #include <DS/EncryptedString.hxx>
 #include <Database/User.hxx>
+#include <Database/ColumnDictionary.hxx>
+#include <Database/CompositeIndex.hxx>
 #include <Database/IndexManagement.hxx>
+#include <Database/MemoryBudget.hxx>
+#include <Database/RowStore.hxx>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <filesystem>
@@ -15,6 +21,8 @@
 #include <atomic>
 #include <thread>
 #include <optional>
+#include <array>
+#include <memory>
 
 namespace AstralDB {
 #if defined(__GNUC__)
@@ -45,16 +53,68 @@ class Database {
     using Schema = std::vector<Column>;
     using Item = std::unordered_map<std::string, std::string>;
     using Table = std::vector<Item>;
-    using TablesMap = std::unordered_map<std::string, Table>;
+    using RowTable = RowStore<Item>;
+    using TablesMap = std::unordered_map<std::string, RowTable>;
+    using ColumnIndex = IndexManagement<std::string, RowId>;
 
     mutable Spinlock Lock_;
     std::unordered_map<std::string, Schema> TableSchemas_;
     TablesMap Tables_;
     std::filesystem::path DbPath_;
+    // Key for the database file; without one the key file next to the database is used
+    std::optional<std::array<uint8_t, 32>> EncryptionKey_;
     Logger* Logger_ = nullptr;
-    std::unordered_map<std::string, std::unordered_map<std::string, IndexManagement<std::string, size_t>>> Indexes_;
+    std::unordered_map<std::string, std::unordered_map<std::string, ColumnIndex>> Indexes_;
+
+    // Index changes made while an index is being built off-lock, replayed before it is swapped in
+    struct IndexChange {
+        bool Insert;
+        std::string Key;
+        RowId Id;
+    };
+    using IndexChangeLog = std::vector<IndexChange>;
+    std::unordered_map<std::string, std::unordered_map<std::string, std::shared_ptr<IndexChangeLog>>> PendingIndexes_;
+
+    /* Index pages read from the database file. Each one is decoded into a live index the first time it is
+    used. Checksum is the ColumnChecksum of the rows the pages were written against; when the table no
+    longer matches, the index is rebuilt from the rows instead. Writes to a table decode its stored
+    indexes first, so the pages never go stale.*/
+    struct StoredIndex {
+        IndexType Type;
+        uint64_t Entries;
+        uint64_t Checksum;
+        std::string Pages;
+    };
+    std::unordered_map<std::string, std::unordered_map<std::string, StoredIndex>> StoredIndexes_;
+    /* Last encoding of each live index, which SerializeCatalog writes again until the index changes.
+    Pages name rows by ordinal, so a write that shifts a table's rows drops every entry of that table.
+    The bytes are charged to the table like its indexes.*/
+    std::unordered_map<std::string, std::unordered_map<std::string, StoredIndex>> EncodedIndexes_;
     std::unordered_map<std::string, std::vector<ForeignKey>> ForeignKeys_;
 
+    /* Bloom filter over a column's values, kept for unique columns and any column given one with
+    AddBloomFilter. Removing a value cannot clear its bits, so the filter is rebuilt from the rows
+    once removed values outnumber live ones or it outgrows the size it was built for. The rebuild waits
+    until a write has finished with its rows, so the count it takes matches Live and Added exactly.*/
+    struct ColumnFilter {
+        DS::BloomFilter Filter;
+        size_t Live = 0;
+        size_t Added = 0;
+    };
+    std::unordered_map<std::string, std::unordered_map<std::string, ColumnFilter>> Filters_;
+
+    // Row count at which a table's columns are next analyzed for dictionary encoding; it doubles each time
+    std::unordered_map<std::string, size_t> NextAnalysis_;
+    // Multi-column indexes per table, kept current by every write to the table's rows
+    std::unordered_map<std::string, std::vector<CompositeIndex>> CompositeIndexes_;
+    // Bytes each table's index entries hold against the global memory budget; row stores charge their own rows
+    std::unordered_map<std::string, size_t> Resident_;
+    // Page file rows are evicted to once the resident rows of all tables pass MaxResidentBytes_
+    std::unique_ptr<PageHeap> Heap_;
+    size_t MaxResidentBytes_ = 0;
+    // Set once Heap_ exists, so the idle flush worker can skip taking Lock_ when nothing is ever evicted
+    std::atomic<bool> Paging_ = false;
+
     std::atomic<bool> Dirty_;
     std::atomic<bool> StopFlushWorker_;
     std::thread FlushWorkerThread_;
@@ -63,10 +123,30 @@ class Database {
 
     void FlushWorker() noexcept;
     void SyncToFile();
-    std::string CompressData(const std::string &Data);
-    std::string DecompressData(const std::string &CompressedData);
-    std::string EncryptData(const std::string &Data);
-    std::string DecryptData(const std::string &EncryptedData);
+    std::array<uint8_t, 32> StorageKey(const std::filesystem::path &Path, bool Create);
+    static Item Project(const Item &Row, const std::vector<std::string> &Columns);
+    static void Collect(Table &Result, Item Row, QueryMemory &Memory);
+    static size_t IndexBytes(const ColumnIndex &Index);
+    void ChargeResident(const std::string &TableName, size_t Bytes);
+    void ReleaseResident(const std::string &TableName, size_t Bytes);
+    void TrimResident();
+    ColumnIndex *FindIndex(const std::string &TableName, const std::string &ColumnName);
+    const ColumnIndex *FindIndex(const std::string &TableName, const std::string &ColumnName) const;
+    void IndexInsert(const std::string &TableName, const std::string &ColumnName, const std::string &Value, RowId Id);
+    void IndexErase(const std::string &TableName, const std::string &ColumnName, const std::string &Value, RowId Id);
+    const DS::BloomFilter *FindFilter(const std::string &TableName, const std::string &ColumnName) const;
+    void RebuildFilter(const std::string &TableName, const std::string &ColumnName, ColumnFilter &Filter);
+    void RefreshFilters(const std::string &TableName);
+    const CompositeIndex *FindCompositeIndex(const std::string &TableName, const Item &Equals, const std::string &RangeColumn) const;
+    const ColumnDictionary *FindDictionary(const std::string &TableName, const std::string &ColumnName) const;
+    void AnalyzeColumns(const std::string &TableName);
+    static uint64_t ColumnChecksum(const RowTable &Rows, const std::string &ColumnName, uint64_t &Entries);
+    ColumnIndex *LoadStoredIndex(const std::string &TableName, const std::string &ColumnName);
+    void LoadStoredIndexes(const std::string &TableName);
+    void DropEncodedIndex(const std::string &TableName, const std::string &ColumnName);
+    void DropEncodedIndexes(const std::string &TableName);
+    std::string SerializeCatalog();
+    void RestoreCatalog(std::string_view Data);
 public:
     explicit Database(const std::filesystem::path &DbPath, Logger* Logger = nullptr);
     ~Database();
@@ -77,25 +157,60 @@ public:
 
     std::future<void> CreateTable(const std::string &TableName, const Schema &Columns);
     std::future<void> DropTable(const std::string &TableName);
-    std::future<void> Insert(const std::string &TableName, const Item &Row);
+    // Takes the row by value so a caller that moves it in costs no copy on the way to the table
+    std::future<void> Insert(const std::string &TableName, Item Row);
     std::future<void> Delete(const std::string &TableName, const std::function<bool(const Item&)> &Condition);
     std::future<void> Update(const std::string &TableName,
                              const std::function<bool(const Item&)> &Condition,
                              const Item &NewValues);
     std::future<Table> Select(const std::string &TableName, const std::function<bool(const Item&)> &Condition) const;
+    // Only the requested columns of matching rows are copied out, an empty list or "*" selects all of them
+    std::future<Table> Select(const std::string &TableName, const std::vector<std::string> &Columns,
+                              const std::function<bool(const Item&)> &Condition) const;
+    /* Matching rows ordered by OrderBy, compared as strings, with rows missing it lowest. A sort larger
+    than the query's memory budget is written to disk as sorted runs and merged back.*/
+    std::future<Table> SelectSorted(const std::string &TableName, const std::vector<std::string> &Columns,
+                                    const std::function<bool(const Item&)> &Condition, const std::string &OrderBy,
+                                    bool Descending = false) const;
+    // Rows whose Column equals Value, answered from the column's index when there is one
+    std::future<Table> SelectEquals(const std::string &TableName, const std::string &Column, const std::string &Value,
+                                    const std::vector<std::string> &Columns = {}) const;
+    // Rows whose Column starts with Prefix, answered from a radix index on the column when there is one
+    std::future<Table> SelectPrefix(const std::string &TableName, const std::string &Column, const std::string &Prefix,
+                                    const std::vector<std::string> &Columns = {}) const;
+    /* Rows whose columns equal every value in Equals and, when RangeColumn is given, whose RangeColumn lies in
+    [Lower, Upper] (either bound may be left open). Values compare as strings. A composite index whose
+    leading columns are Equals' columns followed by RangeColumn answers it with one seek, and without
+    reading any row when it holds every requested column.*/
+    std::future<Table> SelectRange(const std::string &TableName, const Item &Equals, const std::string &RangeColumn = {},
+                                   const std::optional<std::string> &Lower = std::nullopt,
+                                   const std::optional<std::string> &Upper = std::nullopt,
+                                   const std::vector<std::string> &Columns = {}) const;
     std::future<bool> ValidateRow(const std::string &TableName, const Item &Row) const;
     std::future<bool> LoadFromFile(std::filesystem::path &Path);
 
     std::future<Table> JoinTables(const std::string &LeftTable, const std::string &RightTable,
                                   const std::function<bool(const Item&, const Item&)> &JoinCondition) const;
+    /* Equi-join on LeftColumn = RightColumn; left values the right column's filter rules out are never
+    probed. Without an index on RightColumn the right side is hashed, and when that hash table does not
+    fit the query's memory budget both sides are partitioned to disk and joined a partition at a time.*/
+    std::future<Table> JoinTablesOn(const std::string &LeftTable, const std::string &RightTable,
+                                    const std::string &LeftColumn, const std::string &RightColumn) const;
     std::future<void> AddForeignKey(const std::string &TableName, const ForeignKey &Key);
 
     std::future<void> AddUser(const User &User);
     std::future<void> RemoveUser(const User &User);
     std::future<void> SetCurrentUser(const User &User);
 
-    std::future<void> AddIndex(const std::string &TableName, const std::string &ColumnName);
+    std::future<void> AddIndex(const std::string &TableName, const std::string &ColumnName, IndexType Type = IndexType::BPlusTree);
     std::future<void> RemoveIndex(const std::string &TableName, const std::string &ColumnName);
+    // Index keyed on Columns in order, with Include columns copied into its leaves for index-only reads
+    std::future<void> AddCompositeIndex(const std::string &TableName, const std::vector<std::string> &Columns,
+                                        const std::vector<std::string> &Include = {});
+    std::future<void> RemoveCompositeIndex(const std::string &TableName, const std::vector<std::string> &Columns);
+    // Unique columns get a Bloom filter automatically; these add or drop one on any other column
+    std::future<void> AddBloomFilter(const std::string &TableName, const std::string &ColumnName);
+    std::future<void> RemoveBloomFilter(const std::string &TableName, const std::string &ColumnName);
 
     // Authentication
     bool AuthenticateUser(const std::string& Username, const std::string& Password);
@@ -112,11 +227,26 @@ public:
     const TablesMap &Tables() const;
     std::filesystem::path GetDbPath() const;
 
-    IndexManagement<std::string, size_t>& GetOrCreateIndex(const std::string& table, const std::string& column);
+    ColumnIndex& GetOrCreateIndex(const std::string& table, const std::string& column);
 
     bool ExportToCSV(std::filesystem::path Destination);
     bool ExportToJSON(std::filesystem::path Destination);
 
+    // Process-wide limits in bytes, 0 meaning none; queries over QueryLimit spill their sorts and joins to SpillDirectory
+    static void SetMemoryBudget(size_t Limit, size_t QueryLimit, const std::filesystem::path &SpillDirectory = {}) {
+        MemoryBudget::Global().SetLimits(Limit, QueryLimit);
+        MemoryBudget::Global().SetSpillDirectory(SpillDirectory);
+    }
+    static size_t MemoryUsed() { return MemoryBudget::Global().Used(); }
+
+    /* Keeps at most ResidentBytes of rows in memory, evicting the rest to a page file next to the database
+    cached by a pool of Frames pages. Indexes stay in memory. Call before the database is shared with
+    other threads.*/
+    void EnableBufferPool(size_t Frames, size_t ResidentBytes);
+
+    // Encrypts the database file with Key, 32 bytes, instead of the key file kept next to it
+    void SetEncryptionKey(std::string_view Key);
+
     void SetLogger(Logger* Logger) { Logger_ = Logger; }
     Logger* GetLogger() const { return Logger_; }
 };
@@ -0,0 +1,74 @@
+#include <Database/DatabaseRegistry.hxx>
+
+namespace AstralDB {
+DatabaseRegistry &DatabaseRegistry::Instance() {
+	static DatabaseRegistry Registry;
+	return Registry;
+}
+
+std::string DatabaseRegistry::KeyFor(const std::filesystem::path &Path) {
+	std::error_code Error;
+	auto Canonical = std::filesystem::weakly_canonical(std::filesystem::absolute(Path, Error), Error);
+	return Error ? Path.lexically_normal().string() : Canonical.string();
+}
+
+void DatabaseRegistry::Release(const std::string &Key) {
+	{
+		std::lock_guard<std::mutex> Guard(Lock_);
+		Open_.erase(Key);
+	}
+	Changed_.notify_all();
+}
+
+/* An entry marked Opening is a placeholder for a database being constructed by another caller. An entry
+whose handle has expired belongs to a database that is still closing: its deleter erases the entry only
+once the destructor, and with it the last flush, has finished. Acquire waits for either rather than
+opening a second Database that would write the same file alongside it.*/
+std::shared_ptr<Database> DatabaseRegistry::Acquire(const std::filesystem::path &Path, Logger* Logger) {
+	std::string Key = KeyFor(Path);
+	std::unique_lock<std::mutex> Guard(Lock_);
+	for(;;) {
+		auto It = Open_.find(Key);
+		if(It == Open_.end()) break;
+		if(!It->second.Opening)
+			if(auto Existing = It->second.Handle.lock())
+				return Existing;
+		Changed_.wait(Guard);
+	}
+	Open_[Key].Opening = true;
+	Guard.unlock();
+	// Loading happens here, outside the lock, so other paths and queries about them are never held up
+	Database *Opened;
+	try {
+		Opened = new Database(Path, Logger);
+	} catch(...) {
+		Release(Key);
+		throw;
+	}
+	std::shared_ptr<Database> Handle(Opened, [this, Key](Database* Db) {
+		delete Db;
+		Release(Key);
+	});
+	Guard.lock();
+	Open_[Key] = {Handle, false};
+	Guard.unlock();
+	Changed_.notify_all();
+	if(Logger) Logger->Info("Opened shared database handle for " + Key);
+	return Handle;
+}
+
+bool DatabaseRegistry::IsOpen(const std::filesystem::path &Path) const {
+	std::string Key = KeyFor(Path);
+	std::lock_guard<std::mutex> Guard(Lock_);
+	auto It = Open_.find(Key);
+	return It != Open_.end() && !It->second.Opening && !It->second.Handle.expired();
+}
+
+size_t DatabaseRegistry::OpenCount() const {
+	std::lock_guard<std::mutex> Guard(Lock_);
+	size_t Count = 0;
+	for(const auto &[Key, Slot] : Open_)
+		if(!Slot.Opening && !Slot.Handle.expired()) ++Count;
+	return Count;
+}
+}
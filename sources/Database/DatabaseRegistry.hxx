@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Database/Database.hxx>
+#include <IO/Logger.hxx>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace AstralDB {
+/* Process-wide table of open databases keyed by their canonical path.
+Handles are reference counted, so every session attached to the same file shares one
+in-memory copy and one flush worker, and the database closes once the last handle is gone.
+A path stays registered until its database has finished closing, so a file never has two writers.
+Databases are opened outside the lock; callers asking for a path that is opening or closing sleep on
+Changed_ until it settles.*/
+class DatabaseRegistry {
+    struct Entry {
+        std::weak_ptr<Database> Handle;
+        bool Opening = false;
+    };
+
+    mutable std::mutex Lock_;
+    std::condition_variable Changed_;
+    std::unordered_map<std::string, Entry> Open_;
+
+    DatabaseRegistry() = default;
+    static std::string KeyFor(const std::filesystem::path &Path);
+    void Release(const std::string &Key);
+public:
+    DatabaseRegistry(const DatabaseRegistry&) = delete;
+    DatabaseRegistry& operator=(const DatabaseRegistry&) = delete;
+
+    static DatabaseRegistry &Instance();
+
+    std::shared_ptr<Database> Acquire(const std::filesystem::path &Path, Logger* Logger = nullptr);
+    bool IsOpen(const std::filesystem::path &Path) const;
+    size_t OpenCount() const;
+};
+}
@@ -1,24 +1,178 @@
 #pragma once
 
+#include <DS/AdaptiveRadixTree.hxx>
 #include <DS/BPlusTree.hxx>
+#include <DS/ConcurrentBPlusTree.hxx>
+#include <DS/HashTable.hxx>
 #include <DS/SkipList.hxx>
 #include <DS/Tree.hxx>
+#include <DS/PostingList.hxx>
+#include <IO/Task.hxx>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <variant>
+#include <vector>
 
 namespace AstralDB {
 enum class IndexType {
     BPlusTree,
     SkipList,
-    Tree
+    Tree,
+    ConcurrentBPlusTree,
+    AdaptiveRadixTree,
+    Hash
 };
 
+/* Secondary index from a column value to every row holding it. Each distinct key owns a posting list
+of ids, so duplicate values never shadow each other and low-cardinality columns stay indexable.
+IndexType::ConcurrentBPlusTree and IndexType::SkipList can be read and written from many threads
+without outside locking; the skip list suits write-heavy tables since inserts never split nodes.
+IndexType::AdaptiveRadixTree suits string keys with long shared prefixes and answers prefix scans.
+IndexType::Hash is for columns only ever probed by equality and finds a key in O(1) probes.*/
 template<class Key, class Value> class IndexManagement {
-    std::variant<BPlusTree<Key, Value>, SkipList<Key, Value>, Tree<Key, Value>> Index_;
-    IndexType Type_;
+public:
+    using Postings = DS::PostingList<Value>;
+    using Ordered = BPlusTree<Key, Postings>;
+    using Concurrent = ConcurrentBPlusTree<Key, Postings>;
+    using LockFree = SkipList<Key, Postings>;
+    using Radix = AdaptiveRadixTree<Key, Postings>;
+    using Hashed = DS::HashTable<Key, Postings>;
+private:
+    std::variant<Ordered, LockFree, Tree<Key, Postings>, Concurrent, Radix, Hashed> Index_;
+    IndexType Type_ = IndexType::BPlusTree;
+
+    // Calls F with whichever posting-list tree backs the index
+    template<typename Func> decltype(auto) WithTree(Func &&F) {
+        if(auto *Tree = std::get_if<Ordered>(&Index_)) return F(*Tree);
+        if(auto *Tree = std::get_if<Concurrent>(&Index_)) return F(*Tree);
+        if(auto *List = std::get_if<LockFree>(&Index_)) return F(*List);
+        if(auto *Tree = std::get_if<Radix>(&Index_)) return F(*Tree);
+        if(auto *Table = std::get_if<Hashed>(&Index_)) return F(*Table);
+        throw std::runtime_error("Index type does not support posting lists");
+    }
+
+    template<typename Func> decltype(auto) WithTree(Func &&F) const {
+        if(auto *Tree = std::get_if<Ordered>(&Index_)) return F(*Tree);
+        if(auto *Tree = std::get_if<Concurrent>(&Index_)) return F(*Tree);
+        if(auto *List = std::get_if<LockFree>(&Index_)) return F(*List);
+        if(auto *Tree = std::get_if<Radix>(&Index_)) return F(*Tree);
+        if(auto *Table = std::get_if<Hashed>(&Index_)) return F(*Table);
+        throw std::runtime_error("Index type does not support posting lists");
+    }
+
+    // The concurrent structures share the Upsert/Update/Visit interface instead of handing out pointers
+    template<typename TreeType> static constexpr bool IsConcurrent =
+        std::is_same_v<std::decay_t<TreeType>, Concurrent> || std::is_same_v<std::decay_t<TreeType>, LockFree>;
 public:
     IndexManagement() = default;
+
+    explicit IndexManagement(IndexType Type) : Type_(Type) {
+        switch(Type) {
+            case IndexType::BPlusTree: break;
+            case IndexType::ConcurrentBPlusTree: Index_.template emplace<Concurrent>(); break;
+            case IndexType::SkipList: Index_.template emplace<LockFree>(); break;
+            case IndexType::AdaptiveRadixTree: Index_.template emplace<Radix>(); break;
+            case IndexType::Hash: Index_.template emplace<Hashed>(); break;
+            default: throw std::runtime_error("Index type does not support posting lists");
+        }
+    }
+
+    /* Builds an index from unordered (key, id) pairs: parallel sort, group ids per key, then bulk load
+    the B+Tree bottom-up. The concurrent structures have no bulk path and take the groups in key order.*/
+    static IndexManagement Build(std::vector<std::pair<Key, Value>> Pairs, IndexType Type = IndexType::BPlusTree) {
+        ParallelSort(Pairs.begin(), Pairs.end());
+        std::vector<std::pair<Key, Postings>> Grouped;
+        for(auto &[KeyValue, Id] : Pairs) {
+            if(Grouped.empty() || Grouped.back().first != KeyValue)
+                Grouped.emplace_back(std::move(KeyValue), Postings());
+            Grouped.back().second.Insert(Id);
+        }
+        return FromGroups(std::move(Grouped), Type);
+    }
+
+    // Loads posting lists that are already grouped per key; the ordered types need them in key order
+    static IndexManagement FromGroups(std::vector<std::pair<Key, Postings>> Grouped, IndexType Type = IndexType::BPlusTree) {
+        IndexManagement Result(Type);
+        Result.WithTree([&](auto &Tree) {
+            if constexpr(IsConcurrent<decltype(Tree)>) {
+                for(auto &[KeyValue, List] : Grouped)
+                    Tree.Upsert(KeyValue, [&](Postings &Slot) { Slot = std::move(List); });
+            } else {
+                Tree.BulkLoad(std::move(Grouped));
+            }
+        });
+        return Result;
+    }
+
     // Provide access to the underlying index
     auto& Index() { return Index_; }
     const auto& Index() const { return Index_; }
+    IndexType Type() const { return Type_; }
+
+    void Insert(const Key &KeyValue, const Value &Id) {
+        WithTree([&](auto &Tree) {
+            if constexpr(IsConcurrent<decltype(Tree)>) {
+                Tree.Upsert(KeyValue, [&](Postings &List) { List.Insert(Id); });
+            } else {
+                if(auto *List = Tree.GetPointer(KeyValue)) List->Insert(Id);
+                else Tree.Insert(KeyValue, Postings(Id));
+            }
+        });
+    }
+
+    // Drops Id from the key's postings and the key itself once nothing references it
+    bool Erase(const Key &KeyValue, const Value &Id) {
+        return WithTree([&](auto &Tree) {
+            if constexpr(IsConcurrent<decltype(Tree)>) {
+                bool Erased = false;
+                Tree.Update(KeyValue, [&](Postings &List) {
+                    Erased = List.Erase(Id);
+                    return List.Empty();
+                });
+                return Erased;
+            } else {
+                auto *List = Tree.GetPointer(KeyValue);
+                if(!List || !List->Erase(Id)) return false;
+                if(List->Empty()) Tree.Delete(KeyValue);
+                return true;
+            }
+        });
+    }
+
+    bool Contains(const Key &KeyValue) const {
+        return WithTree([&](const auto &Tree) { return Tree.Contains(KeyValue); });
+    }
+
+    // Calls F(Id) for every row indexed under KeyValue
+    template<typename Func> void ForEachMatch(const Key &KeyValue, Func &&F) const {
+        WithTree([&](const auto &Tree) {
+            if constexpr(IsConcurrent<decltype(Tree)>) {
+                Tree.Visit(KeyValue, [&](const Postings &List) {
+                    for(const auto &Id : List) F(Id);
+                });
+            } else if(const auto *List = Tree.Find(KeyValue)) {
+                for(const auto &Id : *List) F(Id);
+            }
+        });
+    }
+
+    // Calls F(Id) for every row whose key starts with Prefix, in key order; only radix indexes scan by prefix
+    template<typename Func> void ForEachPrefixMatch(const Key &Prefix, Func &&F) const {
+        const auto *Tree = std::get_if<Radix>(&Index_);
+        if(!Tree) throw std::runtime_error("Index type does not support prefix scans");
+        Tree->ForEachPrefix(Prefix, [&](const Key&, const Postings &List) {
+            for(const auto &Id : List) F(Id);
+        });
+    }
+
+    // Calls F(Key, Postings) for every key; hash indexes visit keys in no particular order
+    template<typename Func> void ForEachEntry(Func &&F) const {
+        WithTree([&](const auto &Tree) { Tree.ForEach(F); });
+    }
+
+    size_t DistinctKeys() const {
+        return WithTree([](const auto &Tree) { return Tree.Size(); });
+    }
 };
-}
\ No newline at end of file
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace AstralDB {
+/* Process-wide memory accounting. Stored rows and index entries are charged for as long as they live.
+Every query charges its results and working memory while it runs. A limit of 0 means unlimited.
+Operators that can spill (sorts, hash joins) ask before they grow and go to disk when refused. Rows
+and results cannot spill, so past the limit the write or the query is refused instead.*/
+class MemoryBudget {
+    std::atomic<size_t> Used_ = 0;
+    std::atomic<size_t> Limit_ = 0;
+    std::atomic<size_t> QueryLimit_ = 0;
+    std::filesystem::path SpillDirectory_;
+
+public:
+    static MemoryBudget &Global() {
+        static MemoryBudget Instance;
+        return Instance;
+    }
+
+    // Limits are only read when memory is reserved, so a change applies from the next reservation on
+    void SetLimits(size_t Limit, size_t QueryLimit) {
+        Limit_.store(Limit, std::memory_order_relaxed);
+        QueryLimit_.store(QueryLimit, std::memory_order_relaxed);
+    }
+
+    // Set before any query runs; spill files go to the system temporary directory otherwise
+    void SetSpillDirectory(std::filesystem::path Directory) { SpillDirectory_ = std::move(Directory); }
+    std::filesystem::path SpillDirectory() const {
+        return SpillDirectory_.empty() ? std::filesystem::temp_directory_path() : SpillDirectory_;
+    }
+
+    // Charges Bytes unless that would pass the limit
+    bool TryReserve(size_t Bytes) {
+        size_t Limit = Limit_.load(std::memory_order_relaxed);
+        size_t Current = Used_.load(std::memory_order_relaxed);
+        do {
+            if(Limit && Current + Bytes > Limit) return false;
+        } while(!Used_.compare_exchange_weak(Current, Current + Bytes, std::memory_order_relaxed));
+        return true;
+    }
+
+    // Charges memory that is already allocated and cannot be given back
+    void Charge(size_t Bytes) { Used_.fetch_add(Bytes, std::memory_order_relaxed); }
+    void Release(size_t Bytes) { Used_.fetch_sub(Bytes, std::memory_order_relaxed); }
+
+    size_t Used() const { return Used_.load(std::memory_order_relaxed); }
+    size_t Available() const {
+        size_t Limit = Limit_.load(std::memory_order_relaxed), Current = Used();
+        return !Limit ? SIZE_MAX : Limit > Current ? Limit - Current : 0;
+    }
+    size_t Limit() const { return Limit_.load(std::memory_order_relaxed); }
+    size_t QueryLimit() const { return QueryLimit_.load(std::memory_order_relaxed); }
+};
+
+/* Memory held by one running query. Working memory (sort buffers, hash tables) counts against both the
+query's limit and the global one, and operators spill rather than go past it. Result rows must be
+materialized anyway, so they only count against the global limit. Whatever is still charged is given
+back when the query ends, so an operator that throws halfway leaks nothing.
+
+Transient structures that die with the query, such as join hash tables, allocate from its arena. The
+arena only bumps a pointer and frees everything at once at the end, so it suits containers that grow
+and are then dropped whole; the bytes are still charged through TryReserve like any working memory.*/
+class QueryMemory {
+    static constexpr size_t InitialArena = 16 * 1024;
+
+    MemoryBudget &Budget_;
+    size_t Working_ = 0;
+    size_t Results_ = 0;
+    size_t Limit_;
+    std::pmr::monotonic_buffer_resource Arena_{InitialArena};
+
+public:
+    explicit QueryMemory(MemoryBudget &Budget = MemoryBudget::Global()) : Budget_(Budget), Limit_(Budget.QueryLimit()) {}
+    ~QueryMemory() { Budget_.Release(Working_ + Results_); }
+
+    QueryMemory(const QueryMemory&) = delete;
+    QueryMemory &operator=(const QueryMemory&) = delete;
+
+    // False when Bytes of working memory would take the query or the process past its limit; nothing is charged then
+    bool TryReserve(size_t Bytes) {
+        if(Limit_ && Working_ + Bytes > Limit_) return false;
+        if(!Budget_.TryReserve(Bytes)) return false;
+        Working_ += Bytes;
+        return true;
+    }
+
+    // For working memory an operator cannot do without, such as a single row; throws instead of growing past the limit
+    void Reserve(size_t Bytes) {
+        if(!TryReserve(Bytes)) throw std::runtime_error("Query exceeds its memory budget");
+    }
+
+    void Release(size_t Bytes) {
+        Budget_.Release(Bytes);
+        Working_ -= Bytes;
+    }
+
+    // Charges a result row; a result that would take the process past its limit fails the query
+    void ReserveResult(size_t Bytes) {
+        if(!Budget_.TryReserve(Bytes)) throw std::runtime_error("Query result exceeds the memory budget");
+        Results_ += Bytes;
+    }
+
+    size_t Used() const { return Working_ + Results_; }
+    size_t Available() const {
+        size_t Global = Budget_.Available();
+        return !Limit_ ? Global : std::min(Global, Limit_ > Working_ ? Limit_ - Working_ : 0);
+    }
+    MemoryBudget &Budget() const { return Budget_; }
+    std::pmr::memory_resource *Arena() { return &Arena_; }
+};
+
+/* Estimated heap footprint of a string, a row and an index entry. The estimates depend only on the
+contents, never on capacities or bucket counts, so a row is released for exactly what it was charged.*/
+inline size_t HeapBytes(const std::string &Value) {
+    // Short strings live inside the std::string itself
+    return Value.size() < sizeof(std::string) ? 0 : Value.size() + 1;
+}
+
+inline size_t RowBytes(const std::unordered_map<std::string, std::string> &Row) {
+    size_t Bytes = sizeof(Row) + Row.size() * (2 * sizeof(std::string) + 3 * sizeof(void*));
+    for(const auto &[Column, Value] : Row) Bytes += HeapBytes(Column) + HeapBytes(Value);
+    return Bytes;
+}
+
+inline size_t IndexEntryBytes(const std::string &Key) {
+    return sizeof(std::string) + HeapBytes(Key) + 2 * sizeof(uint64_t);
+}
+}
@@ -0,0 +1,513 @@
+#pragma once
+
+#include <Database/BufferPool.hxx>
+#include <Database/ColumnDictionary.hxx>
+#include <Database/MemoryBudget.hxx>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace AstralDB {
+// Stable handle to a stored row. The generation changes every time a slot is reused, so a stale id never aliases a new row
+struct RowId {
+    uint32_t Slot = UINT32_MAX;
+    uint32_t Generation = 0;
+
+    bool Valid() const { return Slot != UINT32_MAX; }
+    uint64_t Pack() const { return (static_cast<uint64_t>(Slot) << 32) | Generation; }
+    static RowId Unpack(uint64_t Packed) { return {static_cast<uint32_t>(Packed >> 32), static_cast<uint32_t>(Packed)}; }
+
+    friend bool operator==(const RowId&, const RowId&) = default;
+    friend auto operator<=>(const RowId&, const RowId&) = default;
+};
+
+/* Slot array of rows. Erasing frees the slot for reuse instead of shifting later rows down, so the
+RowIds held by indexes stay valid until their own row is erased.
+
+With a PageHeap attached, rows can also be evicted to disk. Evict writes cold rows out, chosen by CLOCK
+over the slots, and drops them from memory. A row that was read back and never changed keeps its
+record, so evicting it again costs no write; a changed row frees its old record when it is written
+out again, and erasing a row frees its record too. Lookups fault rows back in. Scans decode evicted rows
+into a scratch row instead, so a full scan never pulls the table into memory; references a scan hands
+out are only good inside its callback. Resident rows are charged to the global memory budget.
+
+Low-cardinality columns can be encoded: their cells leave the rows and each slot keeps a 16-bit code
+into the column's ColumnDictionary instead. Reads still see whole rows. Scans and View put the cells
+back only for the callback, and Get leaves them in the row until Deflate. Inserts and changes move them
+into the codes again, and a column that runs out of codes goes back to plain cells.*/
+template<class Row> class RowStore {
+    struct Entry {
+        Row Value;
+        RecordLocation Home;
+        uint32_t Generation = 0;
+        // Bytes charged to the memory budget while the row is resident
+        uint32_t Bytes = 0;
+        bool Live = false;
+        bool Resident = false;
+        // Home holds a copy of the row
+        bool Stored = false;
+        // The resident row differs from its copy at Home
+        bool Dirty = false;
+        bool Referenced = false;
+        // The encoded columns' cells are in Value
+        bool Inflated = false;
+    };
+
+    struct EncodedColumn {
+        std::string Name;
+        ColumnDictionary Codes;
+    };
+
+    // Lookups on a const store still fault evicted rows back in
+    mutable std::vector<Entry> Slots_;
+    std::vector<uint32_t> FreeSlots_;
+    size_t Live_ = 0;
+    mutable size_t ResidentBytes_ = 0;
+    PageHeap *Heap_ = nullptr;
+    uint32_t Hand_ = 0;
+    // Reads put cells back for a while, so even a const store changes these
+    mutable std::vector<EncodedColumn> Encoded_;
+    mutable size_t CodeBytes_ = 0;
+    // Slots Get has inflated since the last Deflate
+    mutable std::vector<uint32_t> Inflated_;
+
+    static void Encode(const Row &Value, std::string &Out) {
+        auto Append = [&](const std::string &Text) {
+            uint32_t Length = static_cast<uint32_t>(Text.size());
+            Out.append(reinterpret_cast<const char*>(&Length), sizeof(Length));
+            Out.append(Text);
+        };
+        Out.clear();
+        for(const auto &[Column, Cell] : Value) {
+            Append(Column);
+            Append(Cell);
+        }
+    }
+
+    static void Decode(std::string_view Bytes, Row &Out) {
+        auto Take = [&]() {
+            uint32_t Length;
+            std::memcpy(&Length, Bytes.data(), sizeof(Length));
+            std::string Text(Bytes.substr(sizeof(Length), Length));
+            Bytes.remove_prefix(sizeof(Length) + Length);
+            return Text;
+        };
+        Out.clear();
+        while(!Bytes.empty()) {
+            std::string Column = Take();
+            Out.emplace(std::move(Column), Take());
+        }
+    }
+
+    void Charge(Entry &Target) const {
+        Target.Bytes = static_cast<uint32_t>(RowBytes(Target.Value));
+        MemoryBudget::Global().Charge(Target.Bytes);
+        ResidentBytes_ += Target.Bytes;
+    }
+
+    void Uncharge(Entry &Target) const {
+        MemoryBudget::Global().Release(Target.Bytes);
+        ResidentBytes_ -= Target.Bytes;
+        Target.Bytes = 0;
+    }
+
+    // Brings the dictionaries' charge up to date with what they hold now
+    void ChargeCodes() const {
+        size_t Bytes = 0;
+        for(const auto &Column : Encoded_) Bytes += Column.Codes.Bytes();
+        if(Bytes > CodeBytes_) MemoryBudget::Global().Charge(Bytes - CodeBytes_);
+        else MemoryBudget::Global().Release(CodeBytes_ - Bytes);
+        CodeBytes_ = Bytes;
+    }
+
+    void AddCells(uint32_t Slot, Row &Value) const {
+        for(const auto &Column : Encoded_)
+            if(auto Held = Column.Codes.At(Slot); Held != ColumnDictionary::NoCode)
+                Value.insert_or_assign(Column.Name, Column.Codes.Decode(Held));
+    }
+
+    // Drops the cells whose codes Slot already holds
+    void RemoveCells(uint32_t Slot, Row &Value) const {
+        for(const auto &Column : Encoded_)
+            if(Column.Codes.At(Slot) != ColumnDictionary::NoCode) Value.erase(Column.Name);
+    }
+
+    // Moves a new or changed row's encoded cells into their codes
+    void StoreCodes(uint32_t Slot, Entry &Target) {
+        for(size_t i = 0; i < Encoded_.size();) {
+            auto &Column = Encoded_[i];
+            auto It = Target.Value.find(Column.Name);
+            if(It == Target.Value.end()) {
+                Column.Codes.Clear(Slot);
+            } else if(!Column.Codes.Set(Slot, It->second)) {
+                // A column that runs out of codes has stopped being low-cardinality; this row keeps its cell
+                Column.Codes.Clear(Slot);
+                DecodeAt(i);
+                continue;
+            } else {
+                Target.Value.erase(It);
+            }
+            ++i;
+        }
+        Target.Inflated = false;
+    }
+
+    // Gives the column at Index its cells back in every row and stops encoding it
+    void DecodeAt(size_t Index) {
+        EncodedColumn Column = std::move(Encoded_[Index]);
+        Encoded_.erase(Encoded_.begin() + static_cast<std::ptrdiff_t>(Index));
+        for(uint32_t Slot = 0; Slot < Slots_.size(); ++Slot) {
+            auto Held = Column.Codes.At(Slot);
+            if(!Slots_[Slot].Live || Held == ColumnDictionary::NoCode) continue;
+            // An evicted row's record may lack the cell, so it comes back in and is written out again
+            Entry &Target = Fault(Slot);
+            Uncharge(Target);
+            Target.Value.insert_or_assign(Column.Name, Column.Codes.Decode(Held));
+            Target.Dirty = true;
+            Charge(Target);
+        }
+        ChargeCodes();
+    }
+
+    /* Calls F(const Row&) on a resident row with its encoded cells in place, taking them out again
+    afterwards unless the row was already inflated.*/
+    template<typename Func> void Lend(uint32_t Slot, Func &&F) const {
+        Entry &Target = Slots_[Slot];
+        if(Encoded_.empty() || Target.Inflated) {
+            F(static_cast<const Row&>(Target.Value));
+            return;
+        }
+        AddCells(Slot, Target.Value);
+        Target.Inflated = true;
+        struct Restore {
+            const RowStore &Store;
+            uint32_t Slot;
+            ~Restore() {
+                Entry &Lent = Store.Slots_[Slot];
+                Store.RemoveCells(Slot, Lent.Value);
+                Lent.Inflated = false;
+            }
+        } Guard{*this, Slot};
+        F(static_cast<const Row&>(Target.Value));
+    }
+
+    Entry &Fault(uint32_t Slot) const {
+        Entry &Target = Slots_[Slot];
+        Target.Referenced = true;
+        if(Target.Resident) return Target;
+        std::string Bytes;
+        Heap_->Read(Target.Home, Bytes);
+        Decode(Bytes, Target.Value);
+        // Records written before a column was encoded still carry its cells
+        RemoveCells(Slot, Target.Value);
+        Target.Resident = true;
+        Target.Dirty = false;
+        Target.Inflated = false;
+        Charge(Target);
+        return Target;
+    }
+
+    void ReleaseAll() {
+        MemoryBudget::Global().Release(ResidentBytes_ + CodeBytes_);
+        ResidentBytes_ = 0;
+        CodeBytes_ = 0;
+    }
+
+    // Frees every record the rows hold in the heap, for a store that is being cleared or replaced
+    void FreeRecords() {
+        if(!Heap_) return;
+        for(auto &Target : Slots_)
+            if(Target.Live && Target.Stored) {
+                Heap_->Free(Target.Home);
+                Target.Stored = false;
+            }
+    }
+
+public:
+    RowStore() = default;
+    // Records are left in the heap, which may already be gone; Clear frees them while it is still there
+    ~RowStore() { ReleaseAll(); }
+
+    RowStore(RowStore &&Other) noexcept
+        : Slots_(std::move(Other.Slots_)), FreeSlots_(std::move(Other.FreeSlots_)), Live_(std::exchange(Other.Live_, 0)),
+          ResidentBytes_(std::exchange(Other.ResidentBytes_, 0)), Heap_(Other.Heap_), Hand_(std::exchange(Other.Hand_, 0)),
+          Encoded_(std::move(Other.Encoded_)), CodeBytes_(std::exchange(Other.CodeBytes_, 0)), Inflated_(std::move(Other.Inflated_)) {}
+
+    RowStore &operator=(RowStore &&Other) noexcept {
+        if(this != &Other) {
+            ReleaseAll();
+            FreeRecords();
+            Slots_ = std::move(Other.Slots_);
+            FreeSlots_ = std::move(Other.FreeSlots_);
+            Live_ = std::exchange(Other.Live_, 0);
+            ResidentBytes_ = std::exchange(Other.ResidentBytes_, 0);
+            Heap_ = Other.Heap_;
+            Hand_ = std::exchange(Other.Hand_, 0);
+            Encoded_ = std::move(Other.Encoded_);
+            CodeBytes_ = std::exchange(Other.CodeBytes_, 0);
+            Inflated_ = std::move(Other.Inflated_);
+        }
+        return *this;
+    }
+
+    RowStore(const RowStore&) = delete;
+    RowStore &operator=(const RowStore&) = delete;
+
+    // Lets rows be evicted to Heap; a null heap brings every evicted row back
+    void AttachHeap(PageHeap *Heap) {
+        if(!Heap && Heap_)
+            for(uint32_t Slot = 0; Slot < Slots_.size(); ++Slot)
+                if(Slots_[Slot].Live) Fault(Slot).Stored = false;
+        Heap_ = Heap;
+    }
+
+    RowId Insert(Row Value) {
+        uint32_t Slot;
+        if(!FreeSlots_.empty()) {
+            Slot = FreeSlots_.back();
+            FreeSlots_.pop_back();
+        } else {
+            Slot = static_cast<uint32_t>(Slots_.size());
+            Slots_.emplace_back();
+        }
+        Entry &Target = Slots_[Slot];
+        Target.Value = std::move(Value);
+        Target.Live = true;
+        Target.Resident = true;
+        Target.Stored = false;
+        Target.Dirty = true;
+        Target.Referenced = true;
+        StoreCodes(Slot, Target);
+        Charge(Target);
+        ++Live_;
+        if(!Encoded_.empty()) ChargeCodes();
+        return {Slot, Target.Generation};
+    }
+
+    bool Erase(RowId Id) {
+        if(!Contains(Id)) return false;
+        Entry &Target = Slots_[Id.Slot];
+        if(Target.Resident) Uncharge(Target);
+        if(Target.Stored) Heap_->Free(Target.Home);
+        for(auto &Column : Encoded_) Column.Codes.Clear(Id.Slot);
+        Target.Value = Row();
+        Target.Live = false;
+        Target.Resident = false;
+        Target.Stored = false;
+        Target.Inflated = false;
+        ++Target.Generation;
+        FreeSlots_.push_back(Id.Slot);
+        --Live_;
+        return true;
+    }
+
+    bool Contains(RowId Id) const {
+        return Id.Slot < Slots_.size() && Slots_[Id.Slot].Live && Slots_[Id.Slot].Generation == Id.Generation;
+    }
+
+    // The row with its encoded cells, which stay in it and are charged until Deflate
+    const Row *Get(RowId Id) const {
+        if(!Contains(Id)) return nullptr;
+        Entry &Target = Fault(Id.Slot);
+        if(!Encoded_.empty() && !Target.Inflated) {
+            Uncharge(Target);
+            AddCells(Id.Slot, Target.Value);
+            Target.Inflated = true;
+            Charge(Target);
+            Inflated_.push_back(Id.Slot);
+        }
+        return &Target.Value;
+    }
+
+    // Takes back the cells Get put into rows, so the references it handed out are done with
+    void Deflate() const {
+        for(uint32_t Slot : Inflated_) {
+            Entry &Target = Slots_[Slot];
+            if(!Target.Live || !Target.Resident || !Target.Inflated) continue;
+            Uncharge(Target);
+            RemoveCells(Slot, Target.Value);
+            Target.Inflated = false;
+            Charge(Target);
+        }
+        Inflated_.clear();
+    }
+
+    // Calls F(const Row&) on the whole row without leaving its encoded cells in it; false if it is gone
+    template<typename Func> bool View(RowId Id, Func &&F) const {
+        if(!Contains(Id)) return false;
+        Fault(Id.Slot);
+        Lend(Id.Slot, F);
+        return true;
+    }
+
+    // View of the live row in Slot whatever its generation, for column structures that are kept per slot
+    template<typename Func> bool ViewSlot(uint32_t Slot, Func &&F) const {
+        if(Slot >= Slots_.size() || !Slots_[Slot].Live) return false;
+        Fault(Slot);
+        Lend(Slot, F);
+        return true;
+    }
+
+    // Calls F(Row&) on the whole row, which is then resident and will be written out again when evicted
+    template<typename Func> bool Modify(RowId Id, Func &&F) {
+        if(!Contains(Id)) return false;
+        Entry &Target = Fault(Id.Slot);
+        Uncharge(Target);
+        if(!Target.Inflated) {
+            AddCells(Id.Slot, Target.Value);
+            Target.Inflated = true;
+        }
+        F(Target.Value);
+        StoreCodes(Id.Slot, Target);
+        Target.Dirty = true;
+        Charge(Target);
+        if(!Encoded_.empty()) ChargeCodes();
+        return true;
+    }
+
+    // Visits live rows in slot order as F(RowId, const Row&)
+    template<typename Func> void ForEach(Func &&F) const {
+        Row Scratch;
+        std::string Bytes;
+        for(uint32_t Slot = 0; Slot < Slots_.size(); ++Slot) {
+            const Entry &Target = Slots_[Slot];
+            if(!Target.Live) continue;
+            RowId Id{Slot, Target.Generation};
+            if(Target.Resident) {
+                Lend(Slot, [&](const Row &Value) { F(Id, Value); });
+            } else {
+                Heap_->Read(Target.Home, Bytes);
+                Decode(Bytes, Scratch);
+                AddCells(Slot, Scratch);
+                F(Id, static_cast<const Row&>(Scratch));
+            }
+        }
+    }
+
+    /* Visits live rows as they are kept, for writers that store the codes themselves: encoded cells are
+    usually missing, though an evicted row's record or an inflated row may still carry them.*/
+    template<typename Func> void ForEachStored(Func &&F) const {
+        Row Scratch;
+        std::string Bytes;
+        for(uint32_t Slot = 0; Slot < Slots_.size(); ++Slot) {
+            const Entry &Target = Slots_[Slot];
+            if(!Target.Live) continue;
+            if(Target.Resident) {
+                F(RowId{Slot, Target.Generation}, static_cast<const Row&>(Target.Value));
+            } else {
+                Heap_->Read(Target.Home, Bytes);
+                Decode(Bytes, Scratch);
+                F(RowId{Slot, Target.Generation}, static_cast<const Row&>(Scratch));
+            }
+        }
+    }
+
+    /* Keeps Column as codes in place of its cells from now on. Returns false, changing nothing, when it
+    has more distinct values than there are codes. Evicted rows lose the cell when they are read back.*/
+    bool EncodeColumn(const std::string &Column) {
+        if(Dictionary(Column)) return true;
+        ColumnDictionary Codes;
+        bool Fits = true;
+        ForEachStored([&](RowId Id, const Row &Value) {
+            if(auto It = Value.find(Column); Fits && It != Value.end()) Fits = Codes.Set(Id.Slot, It->second);
+        });
+        if(!Fits) return false;
+        for(uint32_t Slot = 0; Slot < Slots_.size(); ++Slot) {
+            Entry &Target = Slots_[Slot];
+            if(!Target.Live || !Target.Resident || Target.Inflated || Codes.At(Slot) == ColumnDictionary::NoCode) continue;
+            Uncharge(Target);
+            Target.Value.erase(Column);
+            Charge(Target);
+        }
+        Encoded_.push_back({Column, std::move(Codes)});
+        ChargeCodes();
+        return true;
+    }
+
+    // Puts Column's cells back into every row and stops encoding it
+    void DecodeColumn(const std::string &Column) {
+        for(size_t i = 0; i < Encoded_.size(); ++i)
+            if(Encoded_[i].Name == Column) {
+                DecodeAt(i);
+                return;
+            }
+    }
+
+    // Drops the values of Column no row holds any more
+    void CompactColumn(const std::string &Column) {
+        for(auto &Encoded : Encoded_)
+            if(Encoded.Name == Column) Encoded.Codes.Compact();
+        ChargeCodes();
+    }
+
+    const ColumnDictionary *Dictionary(const std::string &Column) const {
+        for(const auto &Encoded : Encoded_)
+            if(Encoded.Name == Column) return &Encoded.Codes;
+        return nullptr;
+    }
+
+    // Calls F(Name, const ColumnDictionary&) for every encoded column
+    template<typename Func> void ForEachEncoded(Func &&F) const {
+        for(const auto &Encoded : Encoded_) F(Encoded.Name, static_cast<const ColumnDictionary&>(Encoded.Codes));
+    }
+
+    /* Evicts rows until the resident ones take at most MaxBytes, sweeping with CLOCK: a row used since the
+    hand last passed is skipped once. Only call it while nobody holds a reference into the store.*/
+    size_t Evict(size_t MaxBytes) {
+        if(!Heap_ || Slots_.empty()) return 0;
+        size_t Evicted = 0;
+        std::string Bytes;
+        for(size_t Step = 0; ResidentBytes_ > MaxBytes && Step < 2 * Slots_.size(); ++Step) {
+            uint32_t Slot = Hand_;
+            Entry &Target = Slots_[Slot];
+            Hand_ = (Hand_ + 1) % Slots_.size();
+            if(!Target.Live || !Target.Resident) continue;
+            if(Target.Referenced) {
+                Target.Referenced = false;
+                continue;
+            }
+            if(Target.Inflated) {
+                RemoveCells(Slot, Target.Value);
+                Target.Inflated = false;
+            }
+            if(Target.Dirty || !Target.Stored) {
+                // The old copy is stale, so its space goes back to the heap for this one or others
+                if(Target.Stored) Heap_->Free(Target.Home);
+                Encode(Target.Value, Bytes);
+                Target.Home = Heap_->Append(Bytes);
+                Target.Stored = true;
+            }
+            Uncharge(Target);
+            Target.Value = Row();
+            Target.Resident = false;
+            ++Evicted;
+        }
+        return Evicted;
+    }
+
+    // Address of the first slot, for prefetching before a scan
+    const void *Data() const { return Slots_.empty() ? nullptr : Slots_.data(); }
+
+    void Reserve(size_t Count) { Slots_.reserve(Count); }
+
+    void Clear() {
+        ReleaseAll();
+        FreeRecords();
+        Encoded_.clear();
+        Inflated_.clear();
+        Slots_.clear();
+        FreeSlots_.clear();
+        Live_ = 0;
+        Hand_ = 0;
+    }
+
+    size_t Size() const { return Live_; }
+    bool Empty() const { return Live_ == 0; }
+    size_t SlotCount() const { return Slots_.size(); }
+    size_t ResidentBytes() const { return ResidentBytes_; }
+};
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <Database/MemoryBudget.hxx>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace AstralDB {
+/* Temporary file of rows, written by an operator that ran out of memory and read back in the order
+they were written. A row is its column count followed by length-prefixed names and values. The file
+is removed when the SpillFile is destroyed. Names carry the process id, so processes sharing a spill
+directory never open each other's files.*/
+class SpillFile {
+public:
+    using Row = std::unordered_map<std::string, std::string>;
+
+private:
+    std::filesystem::path Path_;
+    std::fstream Stream_;
+    size_t Rows_ = 0;
+
+    void WriteNumber(uint32_t Value) { Stream_.write(reinterpret_cast<const char*>(&Value), sizeof(Value)); }
+
+    void WriteString(const std::string &Value) {
+        WriteNumber(static_cast<uint32_t>(Value.size()));
+        Stream_.write(Value.data(), static_cast<std::streamsize>(Value.size()));
+    }
+
+    bool ReadNumber(uint32_t &Value) { return static_cast<bool>(Stream_.read(reinterpret_cast<char*>(&Value), sizeof(Value))); }
+
+    void ReadString(std::string &Value) {
+        uint32_t Length = 0;
+        if(!ReadNumber(Length)) throw std::runtime_error("Truncated spill file");
+        Value.resize(Length);
+        if(!Stream_.read(Value.data(), Length)) throw std::runtime_error("Truncated spill file");
+    }
+
+public:
+    explicit SpillFile(const std::filesystem::path &Directory) {
+        static std::atomic<uint64_t> Counter = 0;
+#if defined(_WIN32)
+        auto Process = _getpid();
+#else
+        auto Process = getpid();
+#endif
+        Path_ = Directory / ("astral-spill-" + std::to_string(Process) + "-" +
+                             std::to_string(Counter.fetch_add(1, std::memory_order_relaxed)));
+        Stream_.open(Path_, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!Stream_) throw std::runtime_error("Cannot create spill file " + Path_.string());
+    }
+
+    ~SpillFile() {
+        Stream_.close();
+        std::error_code Ignored;
+        std::filesystem::remove(Path_, Ignored);
+    }
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile &operator=(const SpillFile&) = delete;
+
+    void Write(const Row &Value) {
+        WriteNumber(static_cast<uint32_t>(Value.size()));
+        for(const auto &[Column, Cell] : Value) {
+            WriteString(Column);
+            WriteString(Cell);
+        }
+        if(!Stream_) throw std::runtime_error("Cannot write spill file " + Path_.string());
+        ++Rows_;
+    }
+
+    // Finishes writing and gives the descriptor back until Rewind reopens the file
+    void Close() {
+        Stream_.close();
+        if(Stream_.fail()) throw std::runtime_error("Cannot write spill file " + Path_.string());
+    }
+
+    // Starts reading from the first row; writing afterwards is not supported
+    void Rewind() {
+        if(!Stream_.is_open()) {
+            Stream_.open(Path_, std::ios::in | std::ios::binary);
+            if(!Stream_) throw std::runtime_error("Cannot reopen spill file " + Path_.string());
+            return;
+        }
+        Stream_.flush();
+        Stream_.clear();
+        Stream_.seekg(0);
+    }
+
+    // Reads the next row into Out; false once every row has been read
+    bool Read(Row &Out) {
+        uint32_t Columns = 0;
+        if(!ReadNumber(Columns)) return false;
+        Out.clear();
+        std::string Column, Cell;
+        for(uint32_t i = 0; i < Columns; ++i) {
+            ReadString(Column);
+            ReadString(Cell);
+            Out.emplace(std::move(Column), std::move(Cell));
+        }
+        return true;
+    }
+
+    size_t Rows() const { return Rows_; }
+};
+
+/* Sort that spills. Rows are buffered while the query's memory allows it. When it does not, the buffer
+is sorted and written out as a run, closed, and its memory is given back. Drain merges the runs, holding
+one row per run, so a sort never needs more memory than a single buffer. At most MergeFanIn runs are
+open at once: with more, passes merge groups of them into longer runs first.*/
+template<class Compare> class ExternalSorter {
+public:
+    using Row = SpillFile::Row;
+
+private:
+    QueryMemory &Memory_;
+    Compare Less_;
+    std::vector<Row> Buffer_;
+    size_t BufferBytes_ = 0;
+    std::vector<std::unique_ptr<SpillFile>> Runs_;
+
+    static constexpr size_t MergeFanIn = 64;
+
+    void SpillRun() {
+        std::sort(Buffer_.begin(), Buffer_.end(), Less_);
+        auto Run = std::make_unique<SpillFile>(Memory_.Budget().SpillDirectory());
+        for(const auto &Value : Buffer_) Run->Write(Value);
+        Run->Close();
+        Runs_.push_back(std::move(Run));
+        Buffer_.clear();
+        Memory_.Release(BufferBytes_);
+        BufferBytes_ = 0;
+    }
+
+    // Calls F(Row&&) for every row of Runs_[First, Last) in sorted order, holding the head of each run
+    template<typename Func> void MergeRuns(size_t First, size_t Last, Func &&F) {
+        std::vector<Row> Heads(Last - First);
+        auto Greater = [&](size_t Left, size_t Right) { return Less_(Heads[Right], Heads[Left]); };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(Greater)> Merge(Greater);
+        for(size_t i = 0; i < Heads.size(); ++i) {
+            Runs_[First + i]->Rewind();
+            if(Runs_[First + i]->Read(Heads[i])) Merge.push(i);
+        }
+        while(!Merge.empty()) {
+            size_t Run = Merge.top();
+            Merge.pop();
+            F(std::move(Heads[Run]));
+            if(Runs_[First + Run]->Read(Heads[Run])) Merge.push(Run);
+        }
+    }
+
+public:
+    explicit ExternalSorter(QueryMemory &Memory, Compare Less = {}) : Memory_(Memory), Less_(std::move(Less)) {}
+    ~ExternalSorter() { Memory_.Release(BufferBytes_); }
+
+    void Add(Row Value) {
+        size_t Bytes = RowBytes(Value);
+        if(!Memory_.TryReserve(Bytes)) {
+            if(!Buffer_.empty()) SpillRun();
+            Memory_.Reserve(Bytes);
+        }
+        BufferBytes_ += Bytes;
+        Buffer_.push_back(std::move(Value));
+    }
+
+    // Calls F(Row&&) for every row in sorted order; the sorter is empty afterwards
+    template<typename Func> void Drain(Func &&F) {
+        if(Runs_.empty()) {
+            std::sort(Buffer_.begin(), Buffer_.end(), Less_);
+            // Each row's charge goes with it, so F can charge it as a result without counting it twice
+            for(auto &Value : Buffer_) {
+                size_t Bytes = RowBytes(Value);
+                Memory_.Release(Bytes);
+                BufferBytes_ -= Bytes;
+                F(std::move(Value));
+            }
+            Buffer_.clear();
+            return;
+        }
+        if(!Buffer_.empty()) SpillRun();
+        while(Runs_.size() > MergeFanIn) {
+            std::vector<std::unique_ptr<SpillFile>> Merged;
+            for(size_t First = 0; First < Runs_.size(); First += MergeFanIn) {
+                size_t Last = std::min(First + MergeFanIn, Runs_.size());
+                if(Last - First == 1) {
+                    Merged.push_back(std::move(Runs_[First]));
+                    continue;
+                }
+                auto Run = std::make_unique<SpillFile>(Memory_.Budget().SpillDirectory());
+                MergeRuns(First, Last, [&](Row &&Value) { Run->Write(Value); });
+                Run->Close();
+                // Merged runs are removed straight away, so a pass never holds more than one group open
+                for(size_t i = First; i < Last; ++i) Runs_[i].reset();
+                Merged.push_back(std::move(Run));
+            }
+            Runs_ = std::move(Merged);
+        }
+        MergeRuns(0, Runs_.size(), F);
+        Runs_.clear();
+    }
+
+    size_t SpilledRuns() const { return Runs_.size(); }
+};
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <DS/Blake3.hxx>
+#include <DS/LZ4.hxx>
+#include <DS/XChaCha20.hxx>
+#include <IO/Task.hxx>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace AstralDB {
+/* On-disk form of a database file. The serialized database is cut into ChunkSize pieces, and each
+piece is compressed as its own LZ4 frame and then encrypted. Chunks share nothing, so they are sealed
+and opened in parallel.
+
+All the ciphertext forms a single XChaCha20 stream under one random nonce per write. Each chunk starts
+on a fresh keystream block, so its first counter is the number of blocks before it. Counters are
+64-bit, so no file is long enough to wrap one and reuse keystream. Each chunk's ciphertext carries a
+keyed BLAKE3 checksum, so damage is caught and pinned to a chunk before anything is decrypted. The
+file is:
+
+    "ASTRALDB" | version u32 | chunk count u32 | nonce[24] | (stored size u32, raw size u32, checksum[32]) per chunk | chunks
+
+Integers are little-endian. The index in front lets a reader find every chunk without decoding any.*/
+namespace Storage {
+    using Key = std::array<uint8_t, 32>;
+
+    inline constexpr std::string_view Magic = "ASTRALDB";
+    inline constexpr uint32_t Version = 2;
+    inline constexpr size_t ChunkSize = 1 << 20;
+    inline constexpr size_t NonceSize = 24;
+    inline constexpr size_t HeaderSize = Magic.size() + 8 + NonceSize;
+    inline constexpr size_t EntrySize = 8 + sizeof(Blake3::Digest);
+    inline constexpr std::string_view ChecksumContext = "AstralDB storage chunk checksum v2";
+
+    namespace Detail {
+        inline void Append32(std::string &Out, uint32_t Value) {
+            for(int Shift = 0; Shift < 32; Shift += 8) Out += static_cast<char>(Value >> Shift);
+        }
+
+        inline uint32_t Read32(std::string_view Data, size_t Offset) {
+            uint32_t Value = 0;
+            for(int i = 3; i >= 0; --i) Value = Value << 8 | static_cast<unsigned char>(Data[Offset + i]);
+            return Value;
+        }
+
+        inline uint64_t Blocks(size_t Bytes) { return (Bytes + 63) / 64; }
+
+        // Encrypts or decrypts a chunk in place, the keystream starting Counter blocks into the file's stream
+        inline void Cipher(std::string &Chunk, const Key &Secret, const std::array<uint8_t, NonceSize> &Nonce, uint64_t Counter) {
+            XChaCha20(Secret, Nonce, Counter).Apply(reinterpret_cast<uint8_t*>(Chunk.data()), Chunk.size());
+        }
+
+        // Checksums use their own key, derived from the encryption key
+        inline Blake3::Digest ChecksumKey(const Key &Secret) { return Blake3::DeriveKey(ChecksumContext, Secret); }
+
+        [[noreturn]] inline void Corrupt() { throw std::runtime_error("Corrupt database file"); }
+    }
+
+    inline std::string Seal(std::string_view Raw, const Key &Secret) {
+        using namespace Detail;
+        size_t Count = (Raw.size() + ChunkSize - 1) / ChunkSize;
+        std::array<uint8_t, NonceSize> Nonce;
+        {
+            std::random_device Device;
+            for(auto &Byte : Nonce) Byte = static_cast<uint8_t>(Device());
+        }
+        std::vector<std::string> Chunks(Count);
+        ParallelFor(Count, [&](size_t i) { Chunks[i] = DS::LZ4Compress(Raw.substr(i * ChunkSize, ChunkSize)); });
+        // Counters depend on the sizes of every earlier chunk, so encryption waits for all of compression
+        std::vector<uint64_t> Counters(Count);
+        for(size_t i = 1; i < Count; ++i) Counters[i] = Counters[i - 1] + Blocks(Chunks[i - 1].size());
+        Blake3::Digest Tagger = ChecksumKey(Secret);
+        std::vector<Blake3::Digest> Checksums(Count);
+        ParallelFor(Count, [&](size_t i) {
+            Cipher(Chunks[i], Secret, Nonce, Counters[i]);
+            Checksums[i] = Blake3::KeyedHash(Tagger, Chunks[i]);
+        });
+        std::string Out(Magic);
+        Append32(Out, Version);
+        Append32(Out, static_cast<uint32_t>(Count));
+        Out.append(reinterpret_cast<const char*>(Nonce.data()), Nonce.size());
+        size_t Total = 0;
+        for(size_t i = 0; i < Count; ++i) {
+            Append32(Out, static_cast<uint32_t>(Chunks[i].size()));
+            Append32(Out, static_cast<uint32_t>(std::min(ChunkSize, Raw.size() - i * ChunkSize)));
+            Out.append(reinterpret_cast<const char*>(Checksums[i].data()), Checksums[i].size());
+            Total += Chunks[i].size();
+        }
+        Out.reserve(Out.size() + Total);
+        for(const auto &Chunk : Chunks) Out += Chunk;
+        return Out;
+    }
+
+    inline std::string Open(std::string_view Stored, const Key &Secret) {
+        using namespace Detail;
+        if(Stored.size() < HeaderSize || Stored.substr(0, Magic.size()) != Magic) Corrupt();
+        if(Read32(Stored, Magic.size()) != Version) throw std::runtime_error("Unsupported database file version");
+        size_t Count = Read32(Stored, Magic.size() + 4);
+        std::array<uint8_t, NonceSize> Nonce;
+        std::memcpy(Nonce.data(), Stored.data() + Magic.size() + 8, NonceSize);
+        if((Stored.size() - HeaderSize) / EntrySize < Count) Corrupt();
+        std::vector<size_t> Offsets(Count + 1), RawOffsets(Count + 1);
+        std::vector<uint64_t> Counters(Count + 1);
+        Offsets[0] = HeaderSize + Count * EntrySize;
+        for(size_t i = 0; i < Count; ++i) {
+            size_t Size = Read32(Stored, HeaderSize + i * EntrySize), RawSize = Read32(Stored, HeaderSize + i * EntrySize + 4);
+            if(RawSize > ChunkSize) Corrupt();
+            Offsets[i + 1] = Offsets[i] + Size;
+            RawOffsets[i + 1] = RawOffsets[i] + RawSize;
+            Counters[i + 1] = Counters[i] + Blocks(Size);
+        }
+        if(Offsets[Count] != Stored.size()) Corrupt();
+        std::string Raw(RawOffsets[Count], '\0');
+        Blake3::Digest Tagger = ChecksumKey(Secret);
+        ParallelFor(Count, [&](size_t i) {
+            std::string_view Sealed = Stored.substr(Offsets[i], Offsets[i + 1] - Offsets[i]);
+            // A wrong key fails here as well, since the checksum key comes from it
+            Blake3::Digest Checksum = Blake3::KeyedHash(Tagger, Sealed);
+            if(std::memcmp(Checksum.data(), Stored.data() + HeaderSize + i * EntrySize + 8, Checksum.size()) != 0)
+                throw std::runtime_error("Checksum mismatch in chunk " + std::to_string(i) + " of the database file");
+            std::string Chunk(Sealed);
+            Cipher(Chunk, Secret, Nonce, Counters[i]);
+            std::string Plain = DS::LZ4Decompress(Chunk);
+            if(Plain.size() != RawOffsets[i + 1] - RawOffsets[i]) Corrupt();
+            std::memcpy(Raw.data() + RawOffsets[i], Plain.data(), Plain.size());
+        });
+        return Raw;
+    }
+
+    /* Reads the key kept next to a database file, creating it with a random key when asked to. The key
+    file is created readable by its owner only, so it never exists with wider permissions. Move it
+    elsewhere and use Database::SetEncryptionKey to keep the data and its key apart.*/
+    inline Key LoadKeyFile(const std::filesystem::path &DatabaseFile, bool Create) {
+        std::filesystem::path Path = DatabaseFile.string() + ".key";
+        Key Secret;
+        if(std::ifstream File(Path, std::ios::binary); File) {
+            if(!File.read(reinterpret_cast<char*>(Secret.data()), Secret.size()))
+                throw std::runtime_error("Key file " + Path.string() + " is damaged");
+            return Secret;
+        }
+        if(!Create) throw std::runtime_error("No encryption key for " + DatabaseFile.string());
+        std::random_device Device;
+        for(auto &Byte : Secret) Byte = static_cast<uint8_t>(Device());
+#if defined(_WIN32)
+        std::ofstream File(Path, std::ios::binary | std::ios::trunc);
+        if(!File) throw std::runtime_error("Cannot create key file " + Path.string());
+        std::filesystem::permissions(Path, std::filesystem::perms::owner_read | std::filesystem::perms::owner_write);
+        File.write(reinterpret_cast<const char*>(Secret.data()), Secret.size());
+        if(!File.flush()) throw std::runtime_error("Cannot write key file " + Path.string());
+#else
+        // O_EXCL also refuses a file or link someone else put there first
+        int Descriptor = open(Path.c_str(), O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        if(Descriptor < 0) throw std::runtime_error("Cannot create key file " + Path.string());
+        bool Written = write(Descriptor, Secret.data(), Secret.size()) == static_cast<ssize_t>(Secret.size()) && fsync(Descriptor) == 0;
+        close(Descriptor);
+        if(!Written) {
+            std::error_code Ignored;
+            std::filesystem::remove(Path, Ignored);
+            throw std::runtime_error("Cannot write key file " + Path.string());
+        }
+#endif
+        return Secret;
+    }
+}
+}
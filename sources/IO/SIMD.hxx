@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <cstddef>
 #include <cstring>
+#include <array>
+#include <type_traits>
 #if defined(__AVX2__)
 #include <immintrin.h>
 #elif defined(__SSE2__)
@@ -102,4 +104,191 @@ inline void SimdMul(float *Dst, const float *Src, size_t Count) {
     }
 }
 
-}
\ No newline at end of file
+// Character classes recognised by the SQL tokenizer
+enum CharClass : uint8_t {
+	CharSpace = 1 << 0,
+	CharDigit = 1 << 1,
+	CharIdentifier = 1 << 2
+};
+
+// Scalar lookup used for short tails and non-SIMD targets
+inline constexpr std::array<uint8_t, 256> CharClassTable = [] {
+	std::array<uint8_t, 256> Table{};
+	for(int C = 0; C < 256; ++C) {
+		uint8_t Class = 0;
+		if(C == ' ' || (C >= '\t' && C <= '\r')) Class |= CharSpace;
+		if(C >= '0' && C <= '9') Class |= CharDigit | CharIdentifier;
+		if((C >= 'a' && C <= 'z') || (C >= 'A' && C <= 'Z') || C == '_') Class |= CharIdentifier;
+		Table[C] = Class;
+	}
+	return Table;
+}();
+
+inline bool IsCharClass(char C, CharClass Class) {
+	return CharClassTable[static_cast<uint8_t>(C)] & Class;
+}
+
+namespace Detail {
+#if defined(__SSE2__)
+// Bytes >= 0x80 are negative under signed compares, so they never land inside an ASCII range
+inline __m128i InRange(__m128i V, char Low, char High) {
+	return _mm_and_si128(_mm_cmpgt_epi8(V, _mm_set1_epi8(Low - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(High + 1), V));
+}
+
+template<CharClass Class> inline __m128i Classify(__m128i V) {
+	if constexpr(Class == CharSpace)
+		return _mm_or_si128(InRange(V, '\t', '\r'), _mm_cmpeq_epi8(V, _mm_set1_epi8(' ')));
+	else if constexpr(Class == CharDigit)
+		return InRange(V, '0', '9');
+	else
+		return _mm_or_si128(_mm_or_si128(InRange(_mm_or_si128(V, _mm_set1_epi8(0x20)), 'a', 'z'), InRange(V, '0', '9')),
+							_mm_cmpeq_epi8(V, _mm_set1_epi8('_')));
+}
+#endif
+#if defined(__AVX2__)
+inline __m256i InRange(__m256i V, char Low, char High) {
+	return _mm256_and_si256(_mm256_cmpgt_epi8(V, _mm256_set1_epi8(Low - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(High + 1), V));
+}
+
+template<CharClass Class> inline __m256i Classify(__m256i V) {
+	if constexpr(Class == CharSpace)
+		return _mm256_or_si256(InRange(V, '\t', '\r'), _mm256_cmpeq_epi8(V, _mm256_set1_epi8(' ')));
+	else if constexpr(Class == CharDigit)
+		return InRange(V, '0', '9');
+	else
+		return _mm256_or_si256(_mm256_or_si256(InRange(_mm256_or_si256(V, _mm256_set1_epi8(0x20)), 'a', 'z'), InRange(V, '0', '9')),
+							   _mm256_cmpeq_epi8(V, _mm256_set1_epi8('_')));
+}
+#endif
+}
+
+// Returns the first position in [Begin, End) whose character is not of the given class
+template<CharClass Class> inline const char *SimdSkipClass(const char *Begin, const char *End) {
+#if defined(__AVX2__)
+	while(End - Begin >= 32) {
+		__m256i Data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Begin));
+		uint32_t Mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(Detail::Classify<Class>(Data)));
+		if(Mask) return Begin + __builtin_ctz(Mask);
+		Begin += 32;
+	}
+#endif
+#if defined(__SSE2__)
+	while(End - Begin >= 16) {
+		__m128i Data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Begin));
+		uint32_t Mask = ~static_cast<uint32_t>(_mm_movemask_epi8(Detail::Classify<Class>(Data))) & 0xFFFF;
+		if(Mask) return Begin + __builtin_ctz(Mask);
+		Begin += 16;
+	}
+#endif
+	while(Begin < End && IsCharClass(*Begin, Class)) ++Begin;
+	return Begin;
+}
+
+inline const char *SimdSkipWhitespace(const char *Begin, const char *End) { return SimdSkipClass<CharSpace>(Begin, End); }
+inline const char *SimdSkipDigits(const char *Begin, const char *End) { return SimdSkipClass<CharDigit>(Begin, End); }
+inline const char *SimdSkipIdentifier(const char *Begin, const char *End) { return SimdSkipClass<CharIdentifier>(Begin, End); }
+
+/* Counts the keys of a sorted array that are below Needle, or not above it when Inclusive. That is the
+lower (upper) bound index, computed branch-free over the whole array, which beats a binary search on
+the few dozen keys of a tree node.*/
+template<bool Inclusive, class T> inline size_t SimdCountBelow(const T *Keys, size_t Count, T Needle) {
+	static_assert(std::is_integral_v<T> && (sizeof(T) == 4 || sizeof(T) == 8), "Only 32 and 64-bit integer keys");
+	size_t I = 0;
+	size_t Result = 0;
+#if defined(__AVX2__)
+	if constexpr(sizeof(T) == 4) {
+		// Unsigned keys are biased into signed range because AVX2 only has signed compares
+		const __m256i Bias = _mm256_set1_epi32(std::is_signed_v<T> ? 0 : INT32_MIN);
+		const __m256i Target = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int32_t>(Needle)), Bias);
+		for(; I + 8 <= Count; I += 8) {
+			__m256i Data = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(Keys + I)), Bias);
+			__m256i Mask = Inclusive ? _mm256_cmpgt_epi32(Data, Target) : _mm256_cmpgt_epi32(Target, Data);
+			size_t Bits = __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(Mask)));
+			Result += Inclusive ? 8 - Bits : Bits;
+		}
+	} else {
+		const __m256i Bias = _mm256_set1_epi64x(std::is_signed_v<T> ? 0 : INT64_MIN);
+		const __m256i Target = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<int64_t>(Needle)), Bias);
+		for(; I + 4 <= Count; I += 4) {
+			__m256i Data = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(Keys + I)), Bias);
+			__m256i Mask = Inclusive ? _mm256_cmpgt_epi64(Data, Target) : _mm256_cmpgt_epi64(Target, Data);
+			size_t Bits = __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(Mask)));
+			Result += Inclusive ? 4 - Bits : Bits;
+		}
+	}
+#elif defined(__SSE2__)
+	// SSE2 has no 64-bit compare, so 64-bit keys fall through to the scalar loop
+	if constexpr(sizeof(T) == 4) {
+		const __m128i Bias = _mm_set1_epi32(std::is_signed_v<T> ? 0 : INT32_MIN);
+		const __m128i Target = _mm_xor_si128(_mm_set1_epi32(static_cast<int32_t>(Needle)), Bias);
+		for(; I + 4 <= Count; I += 4) {
+			__m128i Data = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Keys + I)), Bias);
+			__m128i Mask = Inclusive ? _mm_cmpgt_epi32(Data, Target) : _mm_cmpgt_epi32(Target, Data);
+			size_t Bits = __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(Mask)));
+			Result += Inclusive ? 4 - Bits : Bits;
+		}
+	}
+#endif
+	for(; I < Count; ++I)
+		Result += Inclusive ? !(Needle < Keys[I]) : (Keys[I] < Needle);
+	return Result;
+}
+
+template<class T> inline size_t SimdLowerBound(const T *Keys, size_t Count, T Needle) { return SimdCountBelow<false>(Keys, Count, Needle); }
+template<class T> inline size_t SimdUpperBound(const T *Keys, size_t Count, T Needle) { return SimdCountBelow<true>(Keys, Count, Needle); }
+
+/* Byte searches over the 16-slot key array of a radix tree node. Keys must point at 16 readable
+bytes; only the first Count take part. FindByte returns the matching slot or Count, ByteLowerBound
+the number of keys below Needle, with bytes compared unsigned.*/
+inline size_t SimdFindByte16(const uint8_t *Keys, size_t Count, uint8_t Needle) {
+	const uint32_t Valid = (1u << Count) - 1;
+#if defined(__SSE2__)
+	__m128i Data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Keys));
+	uint32_t Mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(Data, _mm_set1_epi8(static_cast<char>(Needle))))) & Valid;
+	return Mask ? __builtin_ctz(Mask) : Count;
+#else
+	for(size_t I = 0; I < Count; ++I)
+		if(Keys[I] == Needle) return I;
+	return Count;
+#endif
+}
+
+inline size_t SimdByteLowerBound16(const uint8_t *Keys, size_t Count, uint8_t Needle) {
+	const uint32_t Valid = (1u << Count) - 1;
+#if defined(__SSE2__)
+	// SSE2 only compares signed bytes, so both sides are flipped into signed range first
+	const __m128i Bias = _mm_set1_epi8(static_cast<char>(0x80));
+	__m128i Data = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Keys)), Bias);
+	__m128i Target = _mm_xor_si128(_mm_set1_epi8(static_cast<char>(Needle)), Bias);
+	return __builtin_popcount(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmplt_epi8(Data, Target))) & Valid);
+#else
+	size_t Result = 0;
+	for(size_t I = 0; I < Count; ++I) Result += Keys[I] < Needle;
+	return Result;
+#endif
+}
+
+/* Control-byte matching for one 16-slot hash table group. MatchByte16 returns a bitmask of the slots
+equal to Needle; MatchHighBit16 marks the slots whose top bit is set, which the table uses for free slots.*/
+inline uint32_t SimdMatchByte16(const uint8_t *Group, uint8_t Needle) {
+#if defined(__SSE2__)
+	__m128i Data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Group));
+	return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(Data, _mm_set1_epi8(static_cast<char>(Needle)))));
+#else
+	uint32_t Mask = 0;
+	for(size_t I = 0; I < 16; ++I) Mask |= static_cast<uint32_t>(Group[I] == Needle) << I;
+	return Mask;
+#endif
+}
+
+inline uint32_t SimdMatchHighBit16(const uint8_t *Group) {
+#if defined(__SSE2__)
+	return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Group))));
+#else
+	uint32_t Mask = 0;
+	for(size_t I = 0; I < 16; ++I) Mask |= static_cast<uint32_t>(Group[I] >> 7) << I;
+	return Mask;
+#endif
+}
+
+}
@@ -2,12 +2,72 @@
 
 #include <future>
 #include <coroutine>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <vector>
 
 namespace AstralDB {
 template <typename Function, typename... Args> auto RunAsync(Function&& f, Args&&... args) {
     return std::async(std::launch::async, std::forward<Function>(f), std::forward<Args>(args)...);
 }
 
+// Sorts one chunk per hardware thread concurrently, then merges neighbouring runs pairwise in parallel rounds
+template <typename Iterator, typename Compare = std::less<>>
+void ParallelSort(Iterator Begin, Iterator End, Compare Comp = {}, size_t MinChunk = 1 << 14) {
+    size_t Count = std::distance(Begin, End);
+    size_t Chunks = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), Count / (MinChunk ? MinChunk : 1));
+    if(Chunks < 2) {
+        std::sort(Begin, End, Comp);
+        return;
+    }
+    std::vector<Iterator> Bounds;
+    Bounds.reserve(Chunks + 1);
+    for(size_t i = 0; i <= Chunks; ++i)
+        Bounds.push_back(std::next(Begin, Count * i / Chunks));
+    std::vector<std::future<void>> Jobs;
+    for(size_t i = 0; i < Chunks; ++i)
+        Jobs.push_back(RunAsync([&, i]() { std::sort(Bounds[i], Bounds[i + 1], Comp); }));
+    for(auto &Job : Jobs) Job.get();
+    for(size_t Width = 1; Width < Chunks; Width *= 2) {
+        Jobs.clear();
+        for(size_t i = 0; i + Width < Chunks; i += 2 * Width) {
+            size_t Last = std::min(i + 2 * Width, Chunks);
+            Jobs.push_back(RunAsync([&, i, Width, Last]() { std::inplace_merge(Bounds[i], Bounds[i + Width], Bounds[Last], Comp); }));
+        }
+        for(auto &Job : Jobs) Job.get();
+    }
+}
+
+// Runs F(i) for every i below Count on up to one thread per core, the calling thread included; rethrows the first failure
+template <typename Func> void ParallelFor(size_t Count, Func &&F) {
+    std::atomic<size_t> Next = 0;
+    auto Work = [&]() {
+        for(size_t i; (i = Next.fetch_add(1, std::memory_order_relaxed)) < Count;) F(i);
+    };
+    size_t Threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), Count);
+    std::vector<std::future<void>> Jobs;
+    for(size_t i = 1; i < Threads; ++i) Jobs.push_back(RunAsync(Work));
+    std::exception_ptr Failure;
+    try {
+        Work();
+    } catch(...) {
+        Failure = std::current_exception();
+        Next.store(Count, std::memory_order_relaxed);
+    }
+    for(auto &Job : Jobs) {
+        try {
+            Job.get();
+        } catch(...) {
+            if(!Failure) Failure = std::current_exception();
+        }
+    }
+    if(Failure) std::rethrow_exception(Failure);
+}
+
 struct Task {
     struct promise_type {
         Task get_return_object() { return {}; }
@@ -1,10 +1,43 @@
 #include <SQL/SQL.hxx>
 #include <SQL/BytecodeInterpreter.hxx>
+#include <SQL/Scheduler.hxx>
+#include <SQL/Stream.hxx>
+#include <Database/DatabaseRegistry.hxx>
 #include <SQL/Bytecode.hxx>
 #include <IO/Logger.hxx>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <functional>
+
+/* Parses a script one statement at a time and hands each statement to Sink as soon as it is parsed.
+Nodes only live until Sink returns. Returns the number of statements that failed to parse, or -1 when
+the file cannot be read.*/
+static long StreamScript(const std::string &Path, AstralDB::Logger &Logger,
+						 const std::function<void(const AstralDB::SQL::AstNode &)> &Sink) {
+	AstralDB::SQL::StatementStream Stream(Path);
+	if(!Stream.IsOpen()) {
+		std::cout << "AstralDB: File " << Path << " does not exist\n";
+		return -1;
+	}
+	if(Stream.Empty()) {
+		std::cout << "AstralDB: File " << Path << " is empty\n";
+		return -1;
+	}
+	long Errors = 0;
+	AstralDB::SQL::AstContext Context;
+	while(auto Statement = Stream.Next()) {
+		Context.Reset();
+		try {
+			if(auto Node = AstralDB::SQL::Parser::ParseSingleStatement(*Statement, Context, &Logger))
+				Sink(*Node);
+		} catch(const std::exception &e) {
+			Logger.Error(std::string("Error parsing statement: ") + e.what());
+			++Errors;
+		}
+	}
+	return Errors;
+}
 
 int main(int Argc, char **Argv) {
 	bool Verbose = false;
@@ -43,7 +76,8 @@ int main(int Argc, char **Argv) {
 		} else if(Arg == "-q" || Arg == "--query") {
 			if(I + 1 < Argc) {
 				std::string_view Query(Argv[++I]);
-				AstralDB::SQL::Parser Parser(Query);
+				AstralDB::SQL::AstContext Context;
+				AstralDB::SQL::Parser Parser(Query, Context, &Logger);
 				Parser.DumpAST();
 				return 0;
 			} else {
@@ -52,17 +86,12 @@ int main(int Argc, char **Argv) {
 			}
 		} else if(Arg == "-c" || Arg == "--check") {
 			if(I + 1 < Argc) {
-				std::ifstream QueryFile(Argv[++I], std::ios::binary);
-				if(!QueryFile) {
-					std::cout << "AstralDB: File " << Argv[I] << " does not exist\n";
-					return -1;
-				}
-				std::string QueryTemp((std::istreambuf_iterator<char>(QueryFile)), std::istreambuf_iterator<char>());
-				if(QueryTemp.empty()) {
-					std::cout << "AstralDB: File " << Argv[I] << " is empty\n";
+				long Errors = StreamScript(Argv[++I], Logger, [](const AstralDB::SQL::AstNode &) {});
+				if(Errors < 0) return -1;
+				if(Errors > 0) {
+					std::cout << "AstralDB: " << Errors << " statement(s) failed to parse\n";
 					return -1;
 				}
-				AstralDB::SQL::Parser Parser(QueryTemp);
 				std::cout << "Query syntax OK\n";
 				return 0;
 			} else {
@@ -71,21 +100,24 @@ int main(int Argc, char **Argv) {
 			}
 		} else if(Arg == "-s") {
 			if(I + 1 < Argc) {
-				std::ifstream QueryFile(Argv[++I], std::ios::binary);
-				if(!QueryFile) {
-					std::cout << "AstralDB: File " << Argv[I] << " does not exist\n";
-					return -1;
+				size_t Executed = 0;
+				long Errors = 0;
+				{
+					// Statements execute on the scheduler while the next one is being parsed
+					auto Db = AstralDB::DatabaseRegistry::Instance().Acquire("astral.db", &Logger);
+					AstralDB::SQL::Scheduler Scheduler(Db, &Logger);
+					Errors = StreamScript(Argv[++I], Logger, [&](const AstralDB::SQL::AstNode &Statement) {
+						auto Plan = AstralDB::SQL::PlanStatement(Statement);
+						if(Logger.IsVerbose()) Logger.Info("Executing bytecode:\n" + AstralDB::SQL::Disassemble(Plan.Code));
+						Scheduler.Submit(std::move(Plan));
+						++Executed;
+					});
+					if(Errors < 0) return -1;
+					Scheduler.Wait();
 				}
-				std::string QueryTemp((std::istreambuf_iterator<char>(QueryFile)), std::istreambuf_iterator<char>());
-				if(QueryTemp.empty()) {
-					std::cout << "AstralDB: File " << Argv[I] << " is empty\n";
-					return -1;
-				}
-				AstralDB::SQL::Parser Parser(QueryTemp);
-				Parser.DumpAST();
-				AstralDB::SQL::Bytecode Code = AstralDB::SQL::BuildBytecode();
-				AstralDB::SQL::BytecodeInterpreter().Execute(Code);
-				std::cout << "Executed bytecode:\n" << AstralDB::SQL::Disassemble(Code) << "\n";
+				std::cout << "Executed " << Executed << " statement(s)";
+				if(Errors > 0) std::cout << ", " << Errors << " failed to parse";
+				std::cout << "\n";
 				return 0;
 			} else {
 				std::cout << "AstralDB: No file provided after -s\n";
@@ -115,25 +147,19 @@ int main(int Argc, char **Argv) {
 			}
 		} else if(Arg == "-cc" || Arg == "--compile") {
 			if(I + 1 < Argc) {
-				std::ifstream QueryFile(Argv[++I], std::ios::binary);
-				if(!QueryFile) {
-					std::cout << "AstralDB: File " << Argv[I] << " does not exist\n";
-					return -1;
-				}
-				std::string QueryTemp((std::istreambuf_iterator<char>(QueryFile)), std::istreambuf_iterator<char>());
-				if(QueryTemp.empty()) {
-					std::cout << "AstralDB: File " << Argv[I] << " is empty\n";
-					return -1;
-				}
-				AstralDB::SQL::Parser Parser(QueryTemp);
-				AstralDB::SQL::Bytecode Code = AstralDB::SQL::BuildBytecode();
 				std::ofstream Out("out.abc", std::ios::binary);
 				if(!Out) {
 					std::cout << "AstralDB: Could not open output file out.abc\n";
 					return -1;
 				}
-				// TODO: Proper bytecode serialization
-				Out << AstralDB::SQL::Disassemble(Code);
+				size_t Offset = 0;
+				long Errors = StreamScript(Argv[++I], Logger, [&](const AstralDB::SQL::AstNode &Statement) {
+					AstralDB::SQL::Bytecode Code = AstralDB::SQL::EmitBytecode(Statement);
+					// TODO: Proper bytecode serialization
+					Out << AstralDB::SQL::Disassemble(Code, Offset);
+					Offset += Code.size();
+				});
+				if(Errors < 0) return -1;
 				std::cout << "Bytecode written to out.abc (disassembled text, not binary)\n";
 				return 0;
 			} else {
@@ -159,18 +185,8 @@ int main(int Argc, char **Argv) {
 			// Feature not implemented, just print message
 		} else if(Arg[0] != '-') {
 			// Assume it's a query file
-			std::ifstream QueryFile(Arg.c_str(), std::ios::binary);
-			if(!QueryFile) {
-				std::cout << "AstralDB: File " << Arg << " does not exist\n";
-				return -1;
-			}
-			std::string QueryTemp((std::istreambuf_iterator<char>(QueryFile)), std::istreambuf_iterator<char>());
-			if(QueryTemp.empty()) {
-				std::cout << "AstralDB: File " << Arg << " is empty\n";
+			if(StreamScript(Arg, Logger, [](const AstralDB::SQL::AstNode &) {}) < 0)
 				return -1;
-			}
-			AstralDB::SQL::Parser Parser(QueryTemp);
-			Parser.DumpAST();
 			return 0;
 		}
 	}
@@ -3,8 +3,6 @@
 namespace AstralDB {
 namespace SQL {
 
-Tree<ASTNode> AST{};
-
 HybridAST::HybridAST()
 	: BPTreeRoot_(std::make_unique<BPTree>()), RadixRoot_(nullptr), UseRadix_(false) {}
 
@@ -21,14 +19,14 @@ void HybridAST::Add(const KeyType &Key, ValueType Node, size_t Depth) {
 
 bool HybridAST::Empty() const {
 	if(UseRadix_ && RadixRoot_) return RadixRoot_->Empty();
-	return BPTreeRoot_ ? BPTreeRoot_->GetAllKeys().empty() : true;
+	return BPTreeRoot_ ? BPTreeRoot_->Empty() : true;
 }
 
-ExpressionAST *HybridAST::Find(const KeyType &Key, size_t Depth) {
+const AstNode *HybridAST::Find(const KeyType &Key, size_t Depth) {
 	if(Depth < SwitchDepth && BPTreeRoot_) {
 		ValueType *Ptr = BPTreeRoot_->GetPointer(Key);
-		if(Ptr && Ptr->get())
-			return Ptr->get();
+		if(Ptr && *Ptr)
+			return *Ptr;
 	}
 	if(RadixRoot_) {
 		auto Result = RadixRoot_->Find(Key);
@@ -1,11 +1,17 @@
 #include <SQL/BytecodeInterpreter.hxx>
 #include <SQL/Bytecode.hxx>
+#include <Database/DatabaseRegistry.hxx>
 #include <iostream>
 #include <stdexcept>
 #include <memory>
 
 namespace AstralDB {
 namespace SQL {
+Database &BytecodeInterpreter::ActiveDatabase() {
+    if (Databases_.empty())
+        Databases_.push_back(DatabaseRegistry::Instance().Acquire(DefaultDatabasePath, Logger_));
+    return *Databases_[0];
+}
 
 void BytecodeInterpreter::Execute(const Bytecode &Code) {
     Reset();
@@ -121,10 +127,7 @@ bool BytecodeInterpreter::Step(const Bytecode &Code) {
         case Opcode::CREATE_TABLE: {
             if (inst.Operands.empty()) throw std::runtime_error("CREATE_TABLE requires table name operand");
             if (auto tableName = std::get_if<std::string>(&inst.Operands[0])) {
-                if (Databases_.empty()) {
-                    Databases_.push_back(std::make_unique<Database>(std::filesystem::path("astral.db")));
-                }
-                Databases_[0]->CreateTable(*tableName, {}).get();
+                ActiveDatabase().CreateTable(*tableName, {}).get();
             } else {
                 throw std::runtime_error("CREATE_TABLE expects string operand");
             }
@@ -134,10 +137,7 @@ bool BytecodeInterpreter::Step(const Bytecode &Code) {
         case Opcode::DROP_TABLE: {
             if (inst.Operands.empty()) throw std::runtime_error("DROP_TABLE requires table name operand");
             if (auto tableName = std::get_if<std::string>(&inst.Operands[0])) {
-                if (Databases_.empty()) {
-                    Databases_.push_back(std::make_unique<Database>(std::filesystem::path("astral.db")));
-                }
-                Databases_[0]->DropTable(*tableName).get();
+                ActiveDatabase().DropTable(*tableName).get();
             } else {
                 throw std::runtime_error("DROP_TABLE expects string operand");
             }
@@ -148,12 +148,9 @@ bool BytecodeInterpreter::Step(const Bytecode &Code) {
             if (inst.Operands.size() < 2) throw std::runtime_error("INSERT requires table name and value operand");
             if (auto tableName = std::get_if<std::string>(&inst.Operands[0])) {
                 if (auto value = std::get_if<std::string>(&inst.Operands[1])) {
-                    if (Databases_.empty()) {
-                        Databases_.push_back(std::make_unique<Database>(std::filesystem::path("astral.db")));
-                    }
                     std::unordered_map<std::string, std::string> row;
                     row["value"] = *value; // Demo: single column
-                    Databases_[0]->Insert(*tableName, row).get();
+                    ActiveDatabase().Insert(*tableName, row).get();
                 } else {
                     throw std::runtime_error("INSERT expects string value operand");
                 }
@@ -166,10 +163,7 @@ bool BytecodeInterpreter::Step(const Bytecode &Code) {
         case Opcode::DELETE: {
             if (inst.Operands.empty()) throw std::runtime_error("DELETE requires table name operand");
             if (auto tableName = std::get_if<std::string>(&inst.Operands[0])) {
-                if (Databases_.empty()) {
-                    Databases_.push_back(std::make_unique<Database>(std::filesystem::path("astral.db")));
-                }
-                Databases_[0]->Delete(*tableName, [](const std::unordered_map<std::string, std::string>&) { return true; }).get();
+                ActiveDatabase().Delete(*tableName, [](const std::unordered_map<std::string, std::string>&) { return true; }).get();
             } else {
                 throw std::runtime_error("DELETE expects string operand");
             }
@@ -181,12 +175,9 @@ bool BytecodeInterpreter::Step(const Bytecode &Code) {
             if (auto tableName = std::get_if<std::string>(&inst.Operands[0])) {
                 if (auto column = std::get_if<std::string>(&inst.Operands[1])) {
                     if (auto value = std::get_if<std::string>(&inst.Operands[2])) {
-                        if (Databases_.empty()) {
-                            Databases_.push_back(std::make_unique<Database>(std::filesystem::path("astral.db")));
-                        }
                         std::unordered_map<std::string, std::string> newValues;
                         newValues[*column] = *value;
-                        Databases_[0]->Update(*tableName, [](const std::unordered_map<std::string, std::string>&) { return true; }, newValues).get();
+                        ActiveDatabase().Update(*tableName, [](const std::unordered_map<std::string, std::string>&) { return true; }, newValues).get();
                     } else {
                         throw std::runtime_error("UPDATE expects string value operand");
                     }
@@ -200,12 +191,16 @@ bool BytecodeInterpreter::Step(const Bytecode &Code) {
             break;
         }
         case Opcode::SELECT: {
-            if (inst.Operands.empty()) throw std::runtime_error("SELECT requires column name operand");
-            if (auto Column = std::get_if<std::string>(&inst.Operands[0])) {
-                Push(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(new std::string(*Column))));
-            } else {
-                throw std::runtime_error("SELECT expects string column operand");
+            if (inst.Operands.empty()) throw std::runtime_error("SELECT requires table name operand");
+            auto tableName = std::get_if<std::string>(&inst.Operands[0]);
+            if (!tableName) throw std::runtime_error("SELECT expects string table name operand");
+            std::vector<std::string> Columns;
+            for (size_t i = 1; i < inst.Operands.size(); ++i) {
+                if (auto Column = std::get_if<std::string>(&inst.Operands[i])) Columns.push_back(*Column);
+                else throw std::runtime_error("SELECT expects string column operands");
             }
+            Result_ = ActiveDatabase().Select(*tableName, Columns, [](const std::unordered_map<std::string, std::string>&) { return true; }).get();
+            if (Logger_) Logger_->Info("Selected " + std::to_string(Result_.size()) + " row(s) from " + *tableName);
             ++Ic;
             break;
         }
@@ -362,8 +357,7 @@ bool BytecodeInterpreter::Step(const Bytecode &Code) {
             if (inst.Operands.size() < 2) throw std::runtime_error("GRANT requires user and permission operands");
             if (auto user = std::get_if<std::string>(&inst.Operands[0])) {
                 if (auto Perms = std::get_if<int64_t>(&inst.Operands[1])) {
-                    if (Databases_.empty()) Databases_.push_back(std::make_unique<Database>(std::filesystem::path("astral.db")));
-                    Databases_[0]->GrantPermission(*user, static_cast<Permissions>(*Perms)).get();
+                    ActiveDatabase().GrantPermission(*user, static_cast<Permissions>(*Perms)).get();
                 } else {
                     throw std::runtime_error("GRANT expects int64_t permission operand");
                 }
@@ -377,8 +371,7 @@ bool BytecodeInterpreter::Step(const Bytecode &Code) {
             if (inst.Operands.size() < 2) throw std::runtime_error("REVOKE requires user and permission operands");
             if (auto user = std::get_if<std::string>(&inst.Operands[0])) {
                 if (auto Perms = std::get_if<int64_t>(&inst.Operands[1])) {
-                    if (Databases_.empty()) Databases_.push_back(std::make_unique<Database>(std::filesystem::path("astral.db")));
-                    Databases_[0]->RevokePermission(*user, static_cast<Permissions>(*Perms)).get();
+                    ActiveDatabase().RevokePermission(*user, static_cast<Permissions>(*Perms)).get();
                 } else {
                     throw std::runtime_error("REVOKE expects int64_t permission operand");
                 }
@@ -66,11 +66,12 @@ inline void AppendInstruction(Bytecode &Code, const Instruction &Inst) {
     Code.push_back(Inst);
 }
 
-inline std::string Disassemble(const Bytecode &Code) {
+// BaseOffset numbers the instructions when a program is disassembled piecewise
+inline std::string Disassemble(const Bytecode &Code, size_t BaseOffset = 0) {
     std::ostringstream Out;
     for(size_t i = 0; i < Code.size(); ++i) {
         const Instruction &Inst = Code[i];
-        Out << i << ": " << static_cast<int>(Inst.Opcode);
+        Out << BaseOffset + i << ": " << static_cast<int>(Inst.Opcode);
         if(!Inst.Operands.empty()) {
             Out << " [";
             for(const auto &Operand : Inst.Operands) {
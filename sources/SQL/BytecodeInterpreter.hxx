@@ -19,8 +19,14 @@ class BytecodeInterpreter {
     std::vector<uint64_t> Registers_;
     std::vector<uint64_t> Stack_;
 
-    std::vector<std::unique_ptr<Database>> Databases_;
+    std::vector<std::shared_ptr<Database>> Databases_;
     Logger* Logger_ = nullptr;
+    // Rows of the last SELECT, holding only the columns it named
+    std::vector<std::unordered_map<std::string, std::string>> Result_;
+
+    static constexpr const char* DefaultDatabasePath = "astral.db";
+    // Attaches to the shared handle for the default database on first use
+    Database &ActiveDatabase();
 
     void CleanupStack() {
         for (auto Value : Stack_)
@@ -34,6 +40,11 @@ public:
         Registers_.resize(16, 0);
     }
 
+    // Runs against an already open database instead of lazily creating one
+    BytecodeInterpreter(std::shared_ptr<Database> Db, Logger* Logger = nullptr) : BytecodeInterpreter(Logger) {
+        if(Db) Databases_.push_back(std::move(Db));
+    }
+
     ~BytecodeInterpreter() {
         CleanupStack();
     }
@@ -47,6 +58,7 @@ public:
 
     void Reset() {
         CleanupStack();
+        Result_.clear();
         Ic = 0;
         Sp = 0;
         Bp = 0;
@@ -54,6 +66,8 @@ public:
         Registers_.assign(Registers_.size(), 0);
     }
 
+    const std::vector<std::unordered_map<std::string, std::string>> &Result() const { return Result_; }
+
     uintptr_t CurrentInstruction() const { return Ic; }
 
     uintptr_t StackBase() const { return Bp; }
@@ -1,168 +1,156 @@
 #include <SQL/SQL.hxx>
-#include <DS/HashTable.hxx>
-#include <DS/LZ4.hxx>
 #include <IO/Logger.hxx>
+#include <stdexcept>
+#include <string>
 
 namespace AstralDB {
 namespace SQL {
-Bytecode LiteralAST::EmitBytecode() const {
-    Bytecode Code;
-    AppendInstruction(Code, MakeInstruction(Opcode::PUSH, Value));
-    return Code;
-}
+static void EmitInto(Bytecode &Code, const AstNode &Node);
 
-Bytecode TableAST::EmitBytecode() const {
-    Bytecode Code;
-    AppendInstruction(Code, MakeInstruction(Opcode::PUSH, TableName));
-    return Code;
+static void EmitCondition(Bytecode &Code, const AstNode *Condition) {
+    if(!Condition) return;
+    AppendInstruction(Code, MakeInstruction(Opcode::WHERE));
+    EmitInto(Code, *Condition);
 }
 
-Bytecode CreateAST::EmitBytecode() const {
-    Bytecode Code;
-    AppendInstruction(Code, MakeInstruction(Opcode::CREATE_TABLE, TableName));
-    for(const auto &Column : Columns) {
-        AppendInstruction(Code, MakeInstruction(Opcode::PUSH, Column.Name));
-        AppendInstruction(Code, MakeInstruction(Opcode::PUSH, Column.Type));
-        for(auto Constraint : Column.Constraints)
-            AppendInstruction(Code, MakeInstruction(Opcode::PUSH, Constraint));
+// Appends straight into Code so nested expressions don't build temporary bytecode vectors
+static void EmitInto(Bytecode &Code, const AstNode &Node) {
+    switch(Node.Kind) {
+    case NodeKind::Literal:
+        AppendInstruction(Code, MakeInstruction(Opcode::PUSH, std::string(static_cast<const LiteralNode&>(Node).Value)));
+        break;
+    case NodeKind::Create: {
+        const auto &Create = static_cast<const CreateNode&>(Node);
+        AppendInstruction(Code, MakeInstruction(Opcode::CREATE_TABLE, std::string(Create.TableName)));
+        for(const auto &Column : Create.Columns) {
+            AppendInstruction(Code, MakeInstruction(Opcode::PUSH, std::string(Column.Name)));
+            AppendInstruction(Code, MakeInstruction(Opcode::PUSH, std::string(Column.Type)));
+            for(auto Constraint : Column.Constraints)
+                AppendInstruction(Code, MakeInstruction(Opcode::PUSH, std::string(Constraint)));
+        }
+        break;
+    }
+    case NodeKind::Select: {
+        // One instruction carries the table and then the projected columns, so the scan copies only those
+        const auto &Select = static_cast<const SelectNode&>(Node);
+        Instruction Scan = MakeInstruction(Opcode::SELECT, std::string(Select.TableName));
+        for(auto Column : Select.Columns)
+            Scan.Operands.emplace_back(std::string(Column));
+        AppendInstruction(Code, Scan);
+        break;
+    }
+    case NodeKind::Insert: {
+        const auto &Insert = static_cast<const InsertNode&>(Node);
+        AppendInstruction(Code, MakeInstruction(Opcode::PUSH, std::string(Insert.TableName)));
+        for(auto Column : Insert.Columns)
+            AppendInstruction(Code, MakeInstruction(Opcode::PUSH, std::string(Column)));
+        for(auto Value : Insert.Values)
+            AppendInstruction(Code, MakeInstruction(Opcode::PUSH, std::string(Value)));
+        break;
+    }
+    case NodeKind::Update: {
+        const auto &Update = static_cast<const UpdateNode&>(Node);
+        for(const auto &Assignment : Update.Assignments)
+            AppendInstruction(Code, MakeInstruction(Opcode::UPDATE, std::string(Update.TableName),
+                                                    std::string(Assignment.Column), std::string(Assignment.Value)));
+        EmitCondition(Code, Update.Condition);
+        AppendInstruction(Code, MakeInstruction(Opcode::HALT));
+        break;
+    }
+    case NodeKind::Delete: {
+        const auto &Delete = static_cast<const DeleteNode&>(Node);
+        AppendInstruction(Code, MakeInstruction(Opcode::DELETE, std::string(Delete.TableName)));
+        EmitCondition(Code, Delete.Condition);
+        AppendInstruction(Code, MakeInstruction(Opcode::HALT));
+        break;
+    }
+    case NodeKind::BinaryOp: {
+        const auto &BinaryOp = static_cast<const BinaryOpNode&>(Node);
+        EmitInto(Code, *BinaryOp.LHS);
+        EmitInto(Code, *BinaryOp.RHS);
+        if(OperatorPrecedence(BinaryOp.Op) < 0)
+            throw std::runtime_error("Unsupported binary operator");
+        AppendInstruction(Code, MakeInstruction(OperatorOpcode(BinaryOp.Op)));
+        break;
+    }
+    case NodeKind::Grant: {
+        const auto &Grant = static_cast<const GrantNode&>(Node);
+        AppendInstruction(Code, MakeInstruction(Opcode::GRANT, std::string(Grant.Username),
+                                                static_cast<int64_t>(Grant.Perms), std::string(Grant.TableName)));
+        break;
+    }
+    case NodeKind::Revoke: {
+        const auto &Revoke = static_cast<const RevokeNode&>(Node);
+        AppendInstruction(Code, MakeInstruction(Opcode::REVOKE, std::string(Revoke.Username),
+                                                static_cast<int64_t>(Revoke.Perms), std::string(Revoke.TableName)));
+        break;
+    }
     }
-    return Code;
-}
-
-Bytecode SelectAST::EmitBytecode() const {
-    Bytecode Code;
-    for(const auto &Column : Columns)
-        AppendInstruction(Code, MakeInstruction(Opcode::SELECT, Column));
-    AppendInstruction(Code, MakeInstruction(Opcode::PUSH, Table->TableName));
-    return Code;
 }
 
-Bytecode InsertAST::EmitBytecode() const {
+Bytecode EmitBytecode(const AstNode &Node) {
     Bytecode Code;
-    AppendInstruction(Code, MakeInstruction(Opcode::PUSH, Table->TableName));
-    for(const auto &Column : Columns)
-        AppendInstruction(Code, MakeInstruction(Opcode::PUSH, Column));
-    for(const auto &Value : Values)
-        AppendInstruction(Code, MakeInstruction(Opcode::PUSH, Value));
+    EmitInto(Code, Node);
     return Code;
 }
 
-Bytecode UpdateAST::EmitBytecode() const {
-    Bytecode Code;
-    for(const auto &Assignment : Assignments) {
-        AppendInstruction(Code, MakeInstruction(Opcode::UPDATE, TableName, Assignment.first, Assignment.second));
+void CollectTables(const AstNode &Node, TableSet &Reads, TableSet &Writes) {
+    switch(Node.Kind) {
+    case NodeKind::Create:
+        Writes.emplace_back(static_cast<const CreateNode&>(Node).TableName);
+        break;
+    case NodeKind::Select:
+        Reads.emplace_back(static_cast<const SelectNode&>(Node).TableName);
+        break;
+    case NodeKind::Insert:
+        Writes.emplace_back(static_cast<const InsertNode&>(Node).TableName);
+        break;
+    case NodeKind::Update:
+        Writes.emplace_back(static_cast<const UpdateNode&>(Node).TableName);
+        break;
+    case NodeKind::Delete:
+        Writes.emplace_back(static_cast<const DeleteNode&>(Node).TableName);
+        break;
+    case NodeKind::Grant: {
+        const auto &Grant = static_cast<const GrantNode&>(Node);
+        if(!Grant.TableName.empty()) Reads.emplace_back(Grant.TableName);
+        Writes.push_back(AclResource);
+        break;
     }
-    if(Condition) {
-        AppendInstruction(Code, MakeInstruction(Opcode::WHERE));
-        Bytecode CondCode = Condition->EmitBytecode();
-        Code.insert(Code.end(), CondCode.begin(), CondCode.end());
+    case NodeKind::Revoke: {
+        const auto &Revoke = static_cast<const RevokeNode&>(Node);
+        if(!Revoke.TableName.empty()) Reads.emplace_back(Revoke.TableName);
+        Writes.push_back(AclResource);
+        break;
     }
-    AppendInstruction(Code, MakeInstruction(Opcode::HALT));
-    return Code;
-}
-
-Bytecode DeleteAST::EmitBytecode() const {
-    Bytecode Code;
-    AppendInstruction(Code, MakeInstruction(Opcode::DELETE, TableName));
-    if(Condition) {
-        AppendInstruction(Code, MakeInstruction(Opcode::WHERE));
-        Bytecode CondCode = Condition->EmitBytecode();
-        Code.insert(Code.end(), CondCode.begin(), CondCode.end());
+    case NodeKind::Literal:
+    case NodeKind::BinaryOp:
+        break;
     }
-    AppendInstruction(Code, MakeInstruction(Opcode::HALT));
-    return Code;
-}
-
-Bytecode BinaryOpAST::EmitBytecode() const {
-	Bytecode Code;
-	Bytecode LHSCode = LHS->EmitBytecode();
-	Code.insert(Code.end(), LHSCode.begin(), LHSCode.end());
-	Bytecode RHSCode = RHS->EmitBytecode();
-	Code.insert(Code.end(), RHSCode.begin(), RHSCode.end());
-	Opcode OpCode;
-	if(Op == "+")
-		OpCode = Opcode::ADD;
-	else if(Op == "-")
-		OpCode = Opcode::SUB;
-	else if(Op == "*")
-		OpCode = Opcode::MUL;
-	else if(Op == "/")
-		OpCode = Opcode::DIV;
-	else if(Op == "%")
-		OpCode = Opcode::MOD;
-	else if(Op == "==")
-		OpCode = Opcode::EQ;
-	else if(Op == "=")
-		OpCode = Opcode::EQ;
-	else if(Op == "!=")
-		OpCode = Opcode::NE;
-	else if(Op == "<")
-		OpCode = Opcode::LT;
-	else if(Op == "<=")
-		OpCode = Opcode::LE;
-	else if(Op == ">")
-		OpCode = Opcode::GT;
-	else if(Op == ">=")
-		OpCode = Opcode::GE;
-	else
-		throw std::runtime_error("Unsupported binary operator: " + Op);
-	AppendInstruction(Code, MakeInstruction(OpCode));
-	return Code;
 }
 
-Bytecode GrantAST::EmitBytecode() const {
-    Bytecode Code;
-    AppendInstruction(Code, MakeInstruction(Opcode::GRANT, Username, static_cast<int64_t>(Perms), TableName));
-    return Code;
+StatementPlan PlanStatement(const AstNode &Statement) {
+    StatementPlan Plan;
+    EmitInto(Plan.Code, Statement);
+    CollectTables(Statement, Plan.Reads, Plan.Writes);
+    return Plan;
 }
 
-Bytecode RevokeAST::EmitBytecode() const {
-    Bytecode Code;
-    AppendInstruction(Code, MakeInstruction(Opcode::REVOKE, UserName, static_cast<int64_t>(Perms), TableName));
-    return Code;
+std::vector<StatementPlan> BuildStatements(const AstContext &Context, Logger* Logger) {
+    std::vector<StatementPlan> Plans;
+    Plans.reserve(Context.Size());
+    for(const auto *Statement : Context.Statements())
+        if(Statement) Plans.push_back(PlanStatement(*Statement));
+    if(Logger) Logger->Info("Built " + std::to_string(Plans.size()) + " statement plans");
+    return Plans;
 }
 
-Bytecode BuildBytecode(Logger* Logger) {
+Bytecode BuildBytecode(const AstContext &Context, Logger* Logger) {
     Bytecode Result;
-    int Counter = 0;
-    std::vector<Bytecode> BatchBytecodes;
-    std::vector<std::unique_ptr<ExpressionAST>> BatchAST;
-    for (auto &Statement : AST) {
-        if (Statement && Statement->Value) {
-            if(Logger) Logger->Info("Emitting bytecode for AST node");
-            Bytecode Dummy = Statement->Value->EmitBytecode();
-            for(auto &Inst : Dummy)
-                AppendInstruction(Result, Inst);
-            BatchBytecodes.push_back(Dummy);
-            BatchAST.push_back(std::move(Statement->Value));
-        }
-        if (Counter >= 35) {
-            if(Logger) Logger->Warn("Batching bytecode emission");
-            BPlusTree<Bytecode, std::unique_ptr<ExpressionAST>, 4, BytecodeComparator> Tree;
-            for(size_t i = 0; i < BatchBytecodes.size(); i++)
-                Tree.Insert(BatchBytecodes[i], std::move(BatchAST[i]));
-            std::vector<Bytecode> SortedBytecodes = Tree.GetAllKeys();
-            for(auto &BC : SortedBytecodes) {
-                for(auto &Inst : BC)
-                    AppendInstruction(Result, Inst);
-            }
-            BatchBytecodes.clear();
-            BatchAST.clear();
-            Counter = 0;
-        } else {
-            Counter++;
-        }
-    }
-    if(!BatchBytecodes.empty()) {
-        if(Logger) Logger->Warn("Final batch emission");
-        BPlusTree<Bytecode, std::unique_ptr<ExpressionAST>, 4, BytecodeComparator> Tree;
-        for(size_t i = 0; i < BatchBytecodes.size(); i++)
-            Tree.Insert(BatchBytecodes[i], std::move(BatchAST[i]));
-        std::vector<Bytecode> SortedBytecodes = Tree.GetAllKeys();
-        for(auto &BC : SortedBytecodes) {
-            for(auto &Inst : BC)
-                AppendInstruction(Result, Inst);
-        }
+    for(const auto *Statement : Context.Statements()) {
+        if(!Statement) continue;
+        if(Logger && Logger->IsVerbose()) Logger->Info("Emitting bytecode for AST node");
+        EmitInto(Result, *Statement);
     }
     if(Logger) Logger->Info("Bytecode build complete");
     return Result;
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <SQL/Bytecode.hxx>
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace AstralDB {
+namespace SQL {
+enum class Keyword : uint8_t {
+    NONE,
+    CREATE, INSERT, INTO, VALUES, UPDATE, SET, WHERE, DELETE, FROM, TABLE,
+    SELECT, GRANT, REVOKE, ON, TO, AND, OR,
+    PRIMARY, KEY, NOT, NULL_, UNIQUE, AUTO_INCREMENT,
+    TRUNCATE, REFERENCES, TRIGGER, ALL
+};
+
+enum class Operator : uint8_t {
+    NONE,
+    OR, AND,
+    EQ, NE, LT, LE, GT, GE,
+    ADD, SUB, MUL, DIV, MOD
+};
+
+/* Words are resolved once at tokenize time through a perfect hash whose seed is searched for at
+compile time, so the parser and codegen only ever compare enums.*/
+namespace Detail {
+struct WordEntry {
+    std::string_view Text;
+    Keyword Word;
+    Operator Op;
+    bool Reserved; // Reserved words tokenize as KEYWORD, the rest stay identifiers
+};
+
+inline constexpr std::array<WordEntry, 27> Words{{
+    {"CREATE", Keyword::CREATE, Operator::NONE, true},
+    {"INSERT", Keyword::INSERT, Operator::NONE, true},
+    {"INTO", Keyword::INTO, Operator::NONE, true},
+    {"VALUES", Keyword::VALUES, Operator::NONE, true},
+    {"UPDATE", Keyword::UPDATE, Operator::NONE, true},
+    {"SET", Keyword::SET, Operator::NONE, true},
+    {"WHERE", Keyword::WHERE, Operator::NONE, true},
+    {"DELETE", Keyword::DELETE, Operator::NONE, true},
+    {"FROM", Keyword::FROM, Operator::NONE, true},
+    {"TABLE", Keyword::TABLE, Operator::NONE, true},
+    {"SELECT", Keyword::SELECT, Operator::NONE, true},
+    {"GRANT", Keyword::GRANT, Operator::NONE, true},
+    {"REVOKE", Keyword::REVOKE, Operator::NONE, true},
+    {"ON", Keyword::ON, Operator::NONE, true},
+    {"TO", Keyword::TO, Operator::NONE, true},
+    {"AND", Keyword::AND, Operator::AND, true},
+    {"OR", Keyword::OR, Operator::OR, true},
+    {"PRIMARY", Keyword::PRIMARY, Operator::NONE, false},
+    {"KEY", Keyword::KEY, Operator::NONE, false},
+    {"NOT", Keyword::NOT, Operator::NONE, false},
+    {"NULL", Keyword::NULL_, Operator::NONE, false},
+    {"UNIQUE", Keyword::UNIQUE, Operator::NONE, false},
+    {"AUTO_INCREMENT", Keyword::AUTO_INCREMENT, Operator::NONE, false},
+    {"TRUNCATE", Keyword::TRUNCATE, Operator::NONE, false},
+    {"REFERENCES", Keyword::REFERENCES, Operator::NONE, false},
+    {"TRIGGER", Keyword::TRIGGER, Operator::NONE, false},
+    {"ALL", Keyword::ALL, Operator::NONE, false}
+}};
+
+inline constexpr size_t WordTableSize = 64;
+inline constexpr size_t MinWordLength = 2;
+inline constexpr size_t MaxWordLength = 14;
+
+constexpr uint32_t HashWord(std::string_view Text, uint32_t Seed) {
+    uint32_t Hash = 2166136261u ^ Seed;
+    for(char C : Text)
+        Hash = (Hash ^ static_cast<uint8_t>(C)) * 16777619u;
+    return Hash ^ (Hash >> 15);
+}
+
+constexpr bool IsPerfectSeed(uint32_t Seed) {
+    std::array<bool, WordTableSize> Used{};
+    for(const auto &Entry : Words) {
+        size_t Slot = HashWord(Entry.Text, Seed) & (WordTableSize - 1);
+        if(Used[Slot]) return false;
+        Used[Slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t FindPerfectSeed() {
+    for(uint32_t Seed = 0; Seed < 65536; ++Seed)
+        if(IsPerfectSeed(Seed)) return Seed;
+    return UINT32_MAX;
+}
+
+inline constexpr uint32_t WordSeed = FindPerfectSeed();
+static_assert(WordSeed != UINT32_MAX, "No collision-free seed for the keyword table, grow WordTableSize");
+
+constexpr std::array<int8_t, WordTableSize> BuildWordSlots() {
+    std::array<int8_t, WordTableSize> Slots{};
+    for(auto &Slot : Slots) Slot = -1;
+    for(size_t I = 0; I < Words.size(); ++I)
+        Slots[HashWord(Words[I].Text, WordSeed) & (WordTableSize - 1)] = static_cast<int8_t>(I);
+    return Slots;
+}
+
+inline constexpr auto WordSlots = BuildWordSlots();
+}
+
+// Returns the table entry for a keyword, constraint or word operator, or nullptr for plain identifiers
+constexpr const Detail::WordEntry *LookupWord(std::string_view Text) {
+    if(Text.size() < Detail::MinWordLength || Text.size() > Detail::MaxWordLength) return nullptr;
+    int8_t Index = Detail::WordSlots[Detail::HashWord(Text, Detail::WordSeed) & (Detail::WordTableSize - 1)];
+    if(Index < 0 || Detail::Words[Index].Text != Text) return nullptr;
+    return &Detail::Words[Index];
+}
+
+constexpr Operator LookupOperator(std::string_view Text) {
+    if(Text.size() == 1) {
+        switch(Text[0]) {
+        case '=': return Operator::EQ;
+        case '<': return Operator::LT;
+        case '>': return Operator::GT;
+        case '+': return Operator::ADD;
+        case '-': return Operator::SUB;
+        case '*': return Operator::MUL;
+        case '/': return Operator::DIV;
+        case '%': return Operator::MOD;
+        default: return Operator::NONE;
+        }
+    }
+    if(Text.size() == 2 && Text[1] == '=') {
+        switch(Text[0]) {
+        case '=': return Operator::EQ;
+        case '!': return Operator::NE;
+        case '<': return Operator::LE;
+        case '>': return Operator::GE;
+        default: return Operator::NONE;
+        }
+    }
+    return Operator::NONE;
+}
+
+constexpr bool IsConstraint(Keyword Word) {
+    switch(Word) {
+    case Keyword::PRIMARY: case Keyword::KEY: case Keyword::NOT:
+    case Keyword::NULL_: case Keyword::UNIQUE: case Keyword::AUTO_INCREMENT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+namespace Detail {
+struct OperatorInfo {
+    int Precedence;
+    Opcode Code;
+    std::string_view Text;
+};
+
+inline constexpr std::array<OperatorInfo, 14> Operators{{
+    {-1, Opcode::NOP, ""},
+    {1, Opcode::OR, "OR"}, {2, Opcode::AND, "AND"},
+    {3, Opcode::EQ, "="}, {3, Opcode::NE, "!="},
+    {4, Opcode::LT, "<"}, {4, Opcode::LE, "<="}, {4, Opcode::GT, ">"}, {4, Opcode::GE, ">="},
+    {5, Opcode::ADD, "+"}, {5, Opcode::SUB, "-"},
+    {6, Opcode::MUL, "*"}, {6, Opcode::DIV, "/"}, {6, Opcode::MOD, "%"}
+}};
+}
+
+// -1 for anything that is not a binary operator
+constexpr int OperatorPrecedence(Operator Op) { return Detail::Operators[static_cast<size_t>(Op)].Precedence; }
+constexpr Opcode OperatorOpcode(Operator Op) { return Detail::Operators[static_cast<size_t>(Op)].Code; }
+constexpr std::string_view OperatorText(Operator Op) { return Detail::Operators[static_cast<size_t>(Op)].Text; }
+
+static_assert([] {
+    for(const auto &Entry : Detail::Words)
+        if(Entry.Text.size() > Detail::MaxWordLength || LookupWord(Entry.Text) != &Entry) return false;
+    return true;
+}(), "Every keyword must resolve to its own table entry");
+static_assert(LookupWord("Users") == nullptr);
+static_assert(OperatorOpcode(LookupOperator("<=")) == Opcode::LE);
+static_assert(OperatorOpcode(LookupWord("AND")->Op) == Opcode::AND);
+static_assert(OperatorText(Operator::MOD) == "%");
+}
+}
@@ -1,91 +1,101 @@
 #include <SQL/SQL.hxx>
+#include <IO/SIMD.hxx>
 #include <Database/User.hxx>
 #include <cctype>
 #include <iostream>
 #include <stdexcept>
-#include <unordered_set>
 
 namespace AstralDB {
 namespace SQL {
 
-int Parser::GetTokenPrecedence(const Token &Token) {
-    static std::unordered_map<std::string, int> PrecedenceMap = {
-        {"OR", 1},
-        {"AND", 2},
-        {"=", 3}, {"!=", 3},
-        {"<", 4}, {"<=", 4}, {">", 4}, {">=", 4},
-        {"+", 5}, {"-", 5},
-        {"*", 6}, {"/", 6}, {"%", 6}
-    };
-    auto It = PrecedenceMap.find(Token.Value);
-    return (It != PrecedenceMap.end()) ? It->second : -1;
+Parser::Parser(std::string_view Query, AstContext &Context, Logger* Logger) : Query_(Query), Context_(Context), Logger_(Logger) {
+    bool Verbose = Logger_ && Logger_->IsVerbose();
+    if(Verbose) Logger_->Info("[Parser] Tokenizing " + std::to_string(Query_.size()) + " bytes");
+    Tokens_ = Tokenize();
+    if(Verbose) {
+        std::string Dump = "[Tokenizer] Produced " + std::to_string(Tokens_.size()) + " tokens:";
+        for(const auto &TokenItem : Tokens_)
+            Dump.append(" [").append(std::to_string(static_cast<int>(TokenItem.Type))).append(": ").append(TokenItem.Value).append("]");
+        Logger_->Info(Dump);
+    }
+    CurrentIndex_ = 0;
+    size_t Before = Context_.Size();
+    try {
+        BuildAST();
+    } catch(const std::exception &e) {
+        if(Logger_) Logger_->Error(std::string("[Parser] Parsing failed: ") + e.what());
+        throw;
+    }
+    if(Verbose) Logger_->Info("[Parser] Successfully parsed " + std::to_string(Context_.Size() - Before) + " statements");
 }
 
-bool Parser::IsConstraint(const std::string &TokenValue) {
-    static const std::unordered_set<std::string> Constraints = {
-        "PRIMARY", "KEY", "NOT", "NULL", "UNIQUE", "AUTO_INCREMENT"
-    };
-    return Constraints.find(TokenValue) != Constraints.end();
+const AstNode *Parser::ParseSingleStatement(std::string_view Statement, AstContext &Context, Logger* Logger) {
+    Parser Single(TokenizeOnly{}, Statement, Context, Logger);
+    if(Single.Tokens_.empty())
+        return nullptr;
+    const AstNode *Node = Single.ParseStatement();
+    // The statement must use up its tokens; anything past an optional ';' would otherwise be dropped silently
+    if(auto Next = Single.CurrentToken(); Next && Next->Value == ";")
+        Single.AdvanceToken();
+    if(auto Next = Single.CurrentToken())
+        throw std::runtime_error("Unexpected '" + std::string(Next->Value) + "' after statement");
+    Context.AddStatement(Node);
+    return Node;
 }
 
 TokenStream Parser::Tokenize() {
     TokenStream Tokens;
-    size_t Position = 0;
-    while(Position < Query_.size()) {
-        while(Position < Query_.size() && std::isspace(Query_[Position]))
-            Position++;
-        if(Position >= Query_.size()) break;
-        char CurrentChar = Query_[Position];
-        if(std::isdigit(CurrentChar)) {
-            size_t Start = Position;
-            while(Position < Query_.size() && std::isdigit(Query_[Position]))
-                Position++;
-            if(Position < Query_.size() && Query_[Position] == '.') {
-                Position++;
-                while(Position < Query_.size() && std::isdigit(Query_[Position]))
-                    Position++;
-            }
-            Tokens.push_back(Token{TokenType::LITERAL, std::string(Query_.substr(Start, Position - Start))});
+    const char *Begin = Query_.data();
+    const char *End = Begin + Query_.size();
+    const char *Cursor = Begin;
+    auto View = [](const char *From, const char *To) { return std::string_view(From, To - From); };
+    while(Cursor < End) {
+        Cursor = SimdSkipWhitespace(Cursor, End);
+        if(Cursor >= End) break;
+        char CurrentChar = *Cursor;
+        if(IsCharClass(CurrentChar, CharDigit)) {
+            const char *Start = Cursor;
+            Cursor = SimdSkipDigits(Cursor, End);
+            if(Cursor < End && *Cursor == '.')
+                Cursor = SimdSkipDigits(Cursor + 1, End);
+            Tokens.push_back(Token{TokenType::LITERAL, View(Start, Cursor)});
         }
         else if(CurrentChar == '\'' || CurrentChar == '\"') {
             char QuoteChar = CurrentChar;
-            Position++;
-            size_t Start = Position;
-            while(Position < Query_.size() && Query_[Position] != QuoteChar) {
-                if(Query_[Position] == '\\' && Position + 1 < Query_.size())
-                    Position += 2;
+            const char *Start = ++Cursor;
+            while(Cursor < End && *Cursor != QuoteChar) {
+                if(*Cursor == '\\' && Cursor + 1 < End)
+                    Cursor += 2;
                 else
-                    Position++;
+                    Cursor++;
             }
-            if(Position >= Query_.size())
+            if(Cursor >= End)
                 throw std::runtime_error("Unterminated string literal");
-            std::string Literal = std::string(Query_.substr(Start, Position - Start));
-            Tokens.push_back(Token{TokenType::LITERAL, Literal});
-            Position++;
+            Tokens.push_back(Token{TokenType::LITERAL, View(Start, Cursor)});
+            Cursor++;
         }
-        else if (std::isalnum(CurrentChar) || CurrentChar == '_') {
-            size_t Start = Position;
-            while(Position < Query_.size() && (std::isalnum(Query_[Position]) || Query_[Position] == '_'))
-                Position++;
-            std::string value = std::string(Query_.substr(Start, Position - Start));
-            TokenType type = IsKeyword(value) ? TokenType::KEYWORD : TokenType::IDENTIFIER;
-            Tokens.push_back(Token{type, value});
+        else if(IsCharClass(CurrentChar, CharIdentifier)) {
+            const char *Start = Cursor;
+            Cursor = SimdSkipIdentifier(Cursor, End);
+            std::string_view Value = View(Start, Cursor);
+            if(auto *Entry = LookupWord(Value))
+                Tokens.push_back(Token{Entry->Reserved ? TokenType::KEYWORD : TokenType::IDENTIFIER, Value, Entry->Word, Entry->Op});
+            else
+                Tokens.push_back(Token{TokenType::IDENTIFIER, Value});
         }
         else {
-            std::string OperatorStr;
-            if(Position + 1 < Query_.size()) {
-                std::string TwoChars = std::string(Query_.substr(Position, 2));
+            if(Cursor + 1 < End) {
+                std::string_view TwoChars = View(Cursor, Cursor + 2);
                 if(TwoChars == "<=" || TwoChars == ">=" || TwoChars == "!=" || TwoChars == "==") {
-                    OperatorStr = TwoChars;
-                    Position += 2;
-                    Tokens.push_back(Token{TokenType::PUNCTUATION, OperatorStr});
+                    Cursor += 2;
+                    Tokens.push_back(Token{TokenType::PUNCTUATION, TwoChars, Keyword::NONE, LookupOperator(TwoChars)});
                     continue;
                 }
             }
-            OperatorStr = std::string(1, CurrentChar);
-            Position++;
-            if(std::ispunct(CurrentChar))
-                Tokens.push_back(Token{TokenType::PUNCTUATION, OperatorStr});
+            std::string_view OperatorStr = View(Cursor, Cursor + 1);
+            Cursor++;
+            if(std::ispunct(static_cast<unsigned char>(CurrentChar)))
+                Tokens.push_back(Token{TokenType::PUNCTUATION, OperatorStr, Keyword::NONE, LookupOperator(OperatorStr)});
             else
                 Tokens.push_back(Token{TokenType::SYMBOL, OperatorStr});
         }
@@ -93,39 +103,26 @@ TokenStream Parser::Tokenize() {
     return Tokens;
 }
 
-Tree<ASTNode> Parser::BuildAST() const {
-    std::cout << "[BuildAST] Starting AST build. Token count: " << Tokens_.size() << std::endl;
-    Tree<ASTNode> Result;
-    ASTType Statements;
-    size_t Index = 0;
-    while(Index < Tokens_.size()) {
-        std::cout << "[BuildAST] Parsing statement at token index: " << Index << std::endl;
+void Parser::BuildAST() {
+    size_t Parsed = 0;
+    while(CurrentIndex_ < Tokens_.size()) {
+        size_t Index = CurrentIndex_;
         try {
-            auto Statement = const_cast<Parser*>(this)->ParseStatement();
-            if(Statement) {
-                std::cout << "[BuildAST] Parsed statement at index " << Index << std::endl;
-                Statements.push_back(std::move(Statement));
-            } else {
-                std::cerr << "[BuildAST] Failed to parse statement at index " << Index << std::endl;
+            auto Statement = ParseStatement();
+            if(!Statement)
                 throw std::runtime_error("Failed to parse statement.");
-            }
+            Context_.AddStatement(Statement);
+            ++Parsed;
         } catch (const std::exception& e) {
-            std::cerr << "[BuildAST] Error parsing statement at token " << Index << ": " << e.what() << '\n';
-            const_cast<Parser*>(this)->AdvanceToken();
+            if(Logger_) Logger_->Error("[BuildAST] Error parsing statement at token " + std::to_string(Index) + ": " + e.what());
+            AdvanceToken();
             continue;
         }
         // Defensive: advance token if not already advanced
-        const_cast<Parser*>(this)->AdvanceToken();
-        Index = const_cast<Parser*>(this)->CurrentIndex_;
+        AdvanceToken();
     }
-    if(Statements.empty())
+    if(!Parsed)
         throw std::runtime_error("No valid statements were parsed.");
-    for(auto&& Stmt : Statements) {
-        std::cout << "[BuildAST] Adding statement to AST tree." << std::endl;
-        Result.Add(std::move(Stmt));
-    }
-    std::cout << "[BuildAST] AST build complete. Node count: " << Result.Size() << std::endl;
-    return Result;
 }
 
 void Parser::DumpTokens() const {
@@ -134,7 +131,17 @@ void Parser::DumpTokens() const {
     std::cout << std::endl;
 }
 
-ASTNode Parser::ParsePrimary() {
+void Parser::DumpAST() const {
+    if(!Logger_ || !Logger_->IsVerbose()) return;
+    size_t Offset = 0;
+    for(const auto *Statement : Context_.Statements()) {
+        Bytecode Code = EmitBytecode(*Statement);
+        Logger_->Info("[Parser] Statement bytecode:\n" + Disassemble(Code, Offset));
+        Offset += Code.size();
+    }
+}
+
+const AstNode *Parser::ParsePrimary() {
     if(!CurrentToken())
         throw std::runtime_error("Unexpected end of input in primary expression");
     if(CurrentToken()->Value == "(") {
@@ -144,23 +151,26 @@ ASTNode Parser::ParsePrimary() {
             throw std::runtime_error("Expected ')' in primary expression");
         return Expr;
     }
-    auto Literal = std::make_unique<LiteralAST>(CurrentToken()->Value);
+    auto *Literal = Context_.Make<LiteralNode>();
+    Literal->Value = Intern(CurrentToken()->Value);
     AdvanceToken();
     return Literal;
 }
 
-ASTNode Parser::ParseCreateStatement() {
+const AstNode *Parser::ParseCreateStatement() {
     AdvanceToken(); // consume CREATE
-    if (!MatchKeyword("TABLE"))
+    if (!MatchKeyword(Keyword::TABLE))
         throw std::runtime_error("Expected 'TABLE' after 'CREATE'.");
     auto TableToken = CurrentToken();
     if(!TableToken)
         throw std::runtime_error("Expected table name after 'CREATE TABLE'.");
-    std::string TableName = TableToken->Value;
+    auto *Create = Context_.Make<CreateNode>();
+    Create->TableName = Intern(TableToken->Value);
     AdvanceToken();
     if(!MatchToken(TokenType::PUNCTUATION))
         throw std::runtime_error("Expected '(' after table name in 'CREATE TABLE'.");
     std::vector<ColumnDefinition> Columns;
+    std::vector<std::string_view> Constraints;
     while(true) {
         auto ColumnToken = CurrentToken();
         if(!ColumnToken)
@@ -169,19 +179,21 @@ ASTNode Parser::ParseCreateStatement() {
             AdvanceToken();
             break;
         }
-        std::string ColumnName = ColumnToken->Value;
+        ColumnDefinition Column{};
+        Column.Name = Intern(ColumnToken->Value);
         AdvanceToken();
         auto TypeToken = CurrentToken();
         if(!TypeToken)
             throw std::runtime_error("Expected data type after column name in 'CREATE TABLE'.");
-        std::string ColumnType = TypeToken->Value;
+        Column.Type = Intern(TypeToken->Value);
         AdvanceToken();
-        std::vector<std::string> Constraints;
-        while(CurrentToken() && IsConstraint(CurrentToken()->Value)) {
-            Constraints.push_back(CurrentToken()->Value);
+        Constraints.clear();
+        while(CurrentToken() && IsConstraint(CurrentToken()->Word)) {
+            Constraints.push_back(Intern(CurrentToken()->Value));
             AdvanceToken();
         }
-        Columns.emplace_back(ColumnName, ColumnType, Constraints);
+        Column.Constraints = Context_.Copy(Constraints);
+        Columns.push_back(Column);
         if(CurrentToken() && CurrentToken()->Value == ",") {
             AdvanceToken();
         } else if(CurrentToken() && CurrentToken()->Value == ")") {
@@ -191,40 +203,47 @@ ASTNode Parser::ParseCreateStatement() {
             throw std::runtime_error("Expected ',' or ')' in 'CREATE TABLE' statement.");
         }
     }
-    return std::make_unique<CreateAST>(TableName, Columns);
+    Create->Columns = Context_.Copy(Columns);
+    return Create;
 }
 
-ASTNode Parser::ParseSelectStatement() {
+const AstNode *Parser::ParseSelectStatement() {
     AdvanceToken();
-    std::vector<std::string> Columns;
+    std::vector<std::string_view> Columns;
     while(auto TokenOpt = CurrentToken()) {
-        if(TokenOpt->Value == "FROM") break;
-        std::string Col = TokenOpt->Value;
-        if(!Col.empty() && Col.back() == ',') Col.pop_back();
-        Columns.push_back(Col);
+        if(TokenOpt->Word == Keyword::FROM) break;
+        if(TokenOpt->Value == ",") {
+            AdvanceToken();
+            continue;
+        }
+        std::string_view Col = TokenOpt->Value;
+        if(!Col.empty() && Col.back() == ',') Col.remove_suffix(1);
+        Columns.push_back(Intern(Col));
         AdvanceToken();
     }
-    if(!MatchKeyword("FROM"))
+    if(!MatchKeyword(Keyword::FROM))
         throw std::runtime_error("Expected FROM in SELECT statement");
     if(auto TableToken = CurrentToken()) {
-        std::string TableName = TableToken->Value;
+        auto *Select = Context_.Make<SelectNode>();
+        Select->Columns = Context_.Copy(Columns);
+        Select->TableName = Intern(TableToken->Value);
         AdvanceToken();
-        auto TableAst = std::make_unique<TableAST>(TableName);
-        return std::make_unique<SelectAST>(Columns, std::move(TableAst));
+        return Select;
     }
     throw std::runtime_error("Expected table name after FROM in SELECT statement");
 }
 
-ASTNode Parser::ParseInsertStatement() {
+const AstNode *Parser::ParseInsertStatement() {
     AdvanceToken();
-    if(!MatchKeyword("INTO"))
+    if(!MatchKeyword(Keyword::INTO))
         throw std::runtime_error("Expected INTO after INSERT");
     auto TableToken = CurrentToken();
     if(!TableToken)
         throw std::runtime_error("Expected table name after INSERT INTO");
-    std::string TableName = TableToken->Value;
+    auto *Insert = Context_.Make<InsertNode>();
+    Insert->TableName = Intern(TableToken->Value);
     AdvanceToken();
-    std::vector<std::string> Columns;
+    std::vector<std::string_view> Columns;
     // Check if next token is '('
     if(CurrentToken() && CurrentToken()->Value == "(") {
         AdvanceToken();
@@ -233,219 +252,194 @@ ASTNode Parser::ParseInsertStatement() {
                 AdvanceToken();
                 break;
             }
-            std::string Col = TokenOpt->Value;
-            if(!Col.empty() && Col.back() == ',') Col.pop_back();
-            Columns.push_back(Col);
+            std::string_view Col = TokenOpt->Value;
+            if(!Col.empty() && Col.back() == ',') Col.remove_suffix(1);
+            Columns.push_back(Intern(Col));
             AdvanceToken();
         }
     }
     // Now expect VALUES
-    if(!MatchKeyword("VALUES"))
+    if(!MatchKeyword(Keyword::VALUES))
         throw std::runtime_error("Expected VALUES in INSERT statement");
     // Fix: Only advance if the next token is '('
     if(!CurrentToken() || CurrentToken()->Value != "(")
         throw std::runtime_error("Expected '(' before values in INSERT");
     AdvanceToken(); // consume '('
-    std::vector<std::string> Values;
+    std::vector<std::string_view> Values;
     while(auto TokenOpt = CurrentToken()) {
         if(TokenOpt->Value == ")") {
             AdvanceToken();
             break;
         }
-        std::string Val = TokenOpt->Value;
+        std::string_view Val = TokenOpt->Value;
         if (!Val.empty() && Val.back() == ',')
-            Val.pop_back();
-        Values.push_back(Val);
+            Val.remove_suffix(1);
+        Values.push_back(Intern(Val));
         AdvanceToken();
     }
-    auto TableAst = std::make_unique<TableAST>(TableName);
-    std::cout << "[ParseInsertStatement] Table: " << TableName << ", Columns: [";
-    for (const auto& c : Columns) std::cout << c << ", ";
-    std::cout << "] Values: [";
-    for (const auto& v : Values) std::cout << v << ", ";
-    std::cout << "]\n";
-    return std::make_unique<InsertAST>(std::move(TableAst), Columns, Values);
+    Insert->Columns = Context_.Copy(Columns);
+    Insert->Values = Context_.Copy(Values);
+    if(Logger_ && Logger_->IsVerbose())
+        Logger_->Info("[ParseInsertStatement] Table: " + std::string(Insert->TableName) + ", " + std::to_string(Columns.size()) +
+                      " columns, " + std::to_string(Values.size()) + " values");
+    return Insert;
 }
 
-ASTNode Parser::ParseUpdateStatement() {
+const AstNode *Parser::ParseUpdateStatement() {
     AdvanceToken();
     auto TableToken = CurrentToken();
     if(!TableToken)
         throw std::runtime_error("Expected table name after UPDATE");
-    std::string TableName = TableToken->Value;
+    auto *Update = Context_.Make<UpdateNode>();
+    Update->TableName = Intern(TableToken->Value);
     AdvanceToken();
-    if(!MatchKeyword("SET"))
+    if(!MatchKeyword(Keyword::SET))
         throw std::runtime_error("Expected SET in UPDATE statement");
-    std::vector<std::pair<std::string, std::string>> Assignments;
+    std::vector<Assignment> Assignments;
     while(auto TokenOpt = CurrentToken()) {
-        if(TokenOpt->Value == "WHERE") break;
-        std::string ColumnName = TokenOpt->Value;
+        if(TokenOpt->Word == Keyword::WHERE) break;
+        std::string_view ColumnName = Intern(TokenOpt->Value);
         AdvanceToken();
         if(!MatchToken(TokenType::PUNCTUATION))
             throw std::runtime_error("Expected '=' in assignment of UPDATE statement");
         auto ValueToken = CurrentToken();
         if (!ValueToken)
             throw std::runtime_error("Expected value in assignment of UPDATE statement");
-        std::string Value = ValueToken->Value;
+        Assignments.push_back({ColumnName, Intern(ValueToken->Value)});
         AdvanceToken();
-        Assignments.push_back({ColumnName, Value});
         if(CurrentToken() && CurrentToken()->Value == ",")
             AdvanceToken();
     }
-    std::unique_ptr<ExpressionAST> Condition = nullptr;
-    if(CurrentToken() && CurrentToken()->Value == "WHERE") {
-        AdvanceToken();
-        Condition = ParseBinaryOperation();
-    }
-    return std::make_unique<UpdateAST>(TableName, std::move(Assignments), std::move(Condition));
+    Update->Assignments = Context_.Copy(Assignments);
+    Update->Condition = ParseWhereClause();
+    return Update;
 }
 
-ASTNode Parser::ParseDeleteStatement() {
+const AstNode *Parser::ParseDeleteStatement() {
     AdvanceToken();
-    if(!MatchKeyword("FROM"))
+    if(!MatchKeyword(Keyword::FROM))
         throw std::runtime_error("Expected FROM in DELETE statement");
     auto TableToken = CurrentToken();
     if(!TableToken)
         throw std::runtime_error("Expected table name in DELETE statement");
-    std::string TableName = TableToken->Value;
+    auto *Delete = Context_.Make<DeleteNode>();
+    Delete->TableName = Intern(TableToken->Value);
     AdvanceToken();
-    std::unique_ptr<ExpressionAST> Condition = nullptr;
-    if(CurrentToken() && CurrentToken()->Value == "WHERE") {
-        AdvanceToken();
-        Condition = ParseBinaryOperation();
-    }
-    return std::make_unique<DeleteAST>(TableName, std::move(Condition));
+    Delete->Condition = ParseWhereClause();
+    return Delete;
 }
 
-ASTNode Parser::ParseGrantStatement() {
-    AdvanceToken(); // consume GRANT
+Permissions Parser::ParsePermission(std::string_view Statement) {
     // Expect permission type (SELECT, INSERT, UPDATE, DELETE, etc.)
-    if (!CurrentToken()) throw std::runtime_error("Expected permission after GRANT");
-    std::string PermissionString = CurrentToken()->Value;
+    if (!CurrentToken()) throw std::runtime_error("Expected permission after " + std::string(Statement));
     Permissions Perms;
-    if (PermissionString == "SELECT") Perms = Permissions::Select;
-    else if (PermissionString == "INSERT") Perms = Permissions::Insert;
-    else if (PermissionString == "UPDATE") Perms = Permissions::Update;
-    else if (PermissionString == "DELETE") Perms = Permissions::Delete;
-    else if (PermissionString == "TRUNCATE") Perms = Permissions::Truncate;
-    else if (PermissionString == "REFERENCES") Perms = Permissions::References;
-    else if (PermissionString == "TRIGGER") Perms = Permissions::Trigger;
-    else if (PermissionString == "ALL") Perms = Permissions::All;
-    else throw std::runtime_error("Unknown permission in GRANT: " + PermissionString);
+    switch(CurrentToken()->Word) {
+    case Keyword::SELECT: Perms = Permissions::Select; break;
+    case Keyword::INSERT: Perms = Permissions::Insert; break;
+    case Keyword::UPDATE: Perms = Permissions::Update; break;
+    case Keyword::DELETE: Perms = Permissions::Delete; break;
+    case Keyword::TRUNCATE: Perms = Permissions::Truncate; break;
+    case Keyword::REFERENCES: Perms = Permissions::References; break;
+    case Keyword::TRIGGER: Perms = Permissions::Trigger; break;
+    case Keyword::ALL: Perms = Permissions::All; break;
+    default:
+        throw std::runtime_error("Unknown permission in " + std::string(Statement) + ": " + std::string(CurrentToken()->Value));
+    }
     AdvanceToken();
-    if (!MatchKeyword("ON")) throw std::runtime_error("Expected ON after permission in GRANT");
-    std::string tableName;
+    return Perms;
+}
+
+const AstNode *Parser::ParseGrantStatement() {
+    AdvanceToken(); // consume GRANT
+    auto *Grant = Context_.Make<GrantNode>();
+    Grant->Perms = ParsePermission("GRANT");
+    if (!MatchKeyword(Keyword::ON)) throw std::runtime_error("Expected ON after permission in GRANT");
     if (CurrentToken() && CurrentToken()->Type == TokenType::IDENTIFIER) {
-        tableName = CurrentToken()->Value;
+        Grant->TableName = Intern(CurrentToken()->Value);
         AdvanceToken();
     }
-    if (!MatchKeyword("TO")) throw std::runtime_error("Expected TO after table in GRANT");
+    if (!MatchKeyword(Keyword::TO)) throw std::runtime_error("Expected TO after table in GRANT");
     if (!CurrentToken()) throw std::runtime_error("Expected user after TO in GRANT");
-    std::string Username = CurrentToken()->Value;
+    Grant->Username = Intern(CurrentToken()->Value);
     AdvanceToken();
-    return std::make_unique<GrantAST>(Username, Perms, tableName);
+    return Grant;
 }
 
-std::unique_ptr<ExpressionAST> Parser::ParseRevokeStatement() {
+const AstNode *Parser::ParseRevokeStatement() {
     AdvanceToken(); // consume REVOKE
-    // Expect permission type (SELECT, INSERT, UPDATE, DELETE, etc.)
-    if (!CurrentToken()) throw std::runtime_error("Expected permission after REVOKE");
-    std::string PermissionString = CurrentToken()->Value;
-    Permissions Perms;
-    if (PermissionString == "SELECT") Perms = Permissions::Select;
-    else if (PermissionString == "INSERT") Perms = Permissions::Insert;
-    else if (PermissionString == "UPDATE") Perms = Permissions::Update;
-    else if (PermissionString == "DELETE") Perms = Permissions::Delete;
-    else if (PermissionString == "TRUNCATE") Perms = Permissions::Truncate;
-    else if (PermissionString == "REFERENCES") Perms = Permissions::References;
-    else if (PermissionString == "TRIGGER") Perms = Permissions::Trigger;
-    else if (PermissionString == "ALL") Perms = Permissions::All;
-    else throw std::runtime_error("Unknown permission in REVOKE: " + PermissionString);
-    AdvanceToken();
-    if (!MatchKeyword("ON")) throw std::runtime_error("Expected ON after permission in REVOKE");
-    std::string tableName;
+    auto *Revoke = Context_.Make<RevokeNode>();
+    Revoke->Perms = ParsePermission("REVOKE");
+    if (!MatchKeyword(Keyword::ON)) throw std::runtime_error("Expected ON after permission in REVOKE");
     if (CurrentToken() && CurrentToken()->Type == TokenType::IDENTIFIER) {
-        tableName = CurrentToken()->Value;
+        Revoke->TableName = Intern(CurrentToken()->Value);
         AdvanceToken();
     }
-    if (!MatchKeyword("FROM")) throw std::runtime_error("Expected FROM after table in REVOKE");
+    if (!MatchKeyword(Keyword::FROM)) throw std::runtime_error("Expected FROM after table in REVOKE");
     if (!CurrentToken()) throw std::runtime_error("Expected user after FROM in REVOKE");
-    std::string Username = CurrentToken()->Value;
+    Revoke->Username = Intern(CurrentToken()->Value);
     AdvanceToken();
-    return std::make_unique<RevokeAST>(Username, Perms, tableName);
+    return Revoke;
 }
 
-std::unique_ptr<ExpressionAST> Parser::ParseWhereClause() {
-    if(CurrentToken() && CurrentToken()->Value == "WHERE") {
+const AstNode *Parser::ParseWhereClause() {
+    if(AtKeyword(Keyword::WHERE)) {
         AdvanceToken();
         return ParseBinaryOperation();
     }
     return nullptr;
 }
 
-std::unique_ptr<ExpressionAST> Parser::ParseBinaryOperation() {
+const AstNode *Parser::ParseBinaryOperation() {
     auto LHS = ParsePrimary();
-    return ParseBinaryOperation(0, std::move(LHS));
+    return ParseBinaryOperation(0, LHS);
 }
 
-std::unique_ptr<ExpressionAST> Parser::ParseStatement() {
-    std::cout << "[ParseStatement] Called at token index: " << CurrentIndex_ << std::endl;
+const AstNode *Parser::ParseStatement() {
     if(auto CurrentTok = CurrentToken()) {
-        std::cout << "[ParseStatement] First token: " << CurrentTok->Value << std::endl;
-        std::string FirstValue = CurrentTok->Value;
-        if(FirstValue == "SELECT")
-            return ParseSelectStatement();
-        else if(FirstValue == "INSERT")
-            return ParseInsertStatement();
-        else if(FirstValue == "UPDATE")
-            return ParseUpdateStatement();
-        else if(FirstValue == "DELETE")
-            return ParseDeleteStatement();
-        else if(FirstValue == "CREATE")
-            return ParseCreateStatement();
-        else if(FirstValue == "GRANT")
-            return ParseGrantStatement();
-        else if(FirstValue == "REVOKE")
-            return ParseRevokeStatement();
-        else
-            std::cerr << "[ParseStatement] Unknown statement type: " << FirstValue << std::endl;
+        switch(CurrentTok->Word) {
+        case Keyword::SELECT: return ParseSelectStatement();
+        case Keyword::INSERT: return ParseInsertStatement();
+        case Keyword::UPDATE: return ParseUpdateStatement();
+        case Keyword::DELETE: return ParseDeleteStatement();
+        case Keyword::CREATE: return ParseCreateStatement();
+        case Keyword::GRANT: return ParseGrantStatement();
+        case Keyword::REVOKE: return ParseRevokeStatement();
+        default:
+            throw std::runtime_error("Unknown statement type: " + std::string(CurrentTok->Value));
+        }
     }
     throw std::runtime_error("Empty query");
 }
 
-std::unique_ptr<ExpressionAST> Parser::ParseBinaryOperation(int MinPrec, std::unique_ptr<ExpressionAST> LHS) {
+const AstNode *Parser::ParseBinaryOperation(int MinPrec, const AstNode *LHS) {
     while(true) {
         if(!CurrentToken()) break;
         int CurrentPrec = GetTokenPrecedence(*CurrentToken());
         if(CurrentPrec < MinPrec) break;
-        std::string Op = CurrentToken()->Value;
+        Operator Op = CurrentToken()->Op;
         AdvanceToken();
         auto RHS = ParsePrimary();
         if (!RHS) {
-            std::cerr << "Error: Expected expression after operator \"" << Op << "\"\n";
+            if(Logger_) Logger_->Error("Expected expression after operator \"" + std::string(OperatorText(Op)) + "\"");
             return nullptr;
         }
         while(CurrentToken()) {
             int NextPrec = GetTokenPrecedence(*CurrentToken());
             if(NextPrec > CurrentPrec)
-                RHS = ParseBinaryOperation(CurrentPrec + 1, std::move(RHS));
+                RHS = ParseBinaryOperation(CurrentPrec + 1, RHS);
             else break;
         }
-        LHS = std::make_unique<BinaryOpAST>(std::move(LHS), Op, std::move(RHS));
+        auto *BinaryOp = Context_.Make<BinaryOpNode>();
+        BinaryOp->LHS = LHS;
+        BinaryOp->RHS = RHS;
+        BinaryOp->Op = Op;
+        LHS = BinaryOp;
     }
     return LHS;
 }
 
-std::unique_ptr<ExpressionAST> Parser::ParseExpression() {
+const AstNode *Parser::ParseExpression() {
     return ParseBinaryOperation();
 }
-
-bool Parser::IsKeyword(const std::string &Token) {
-    static const std::unordered_set<std::string> Keywords = {
-        "CREATE", "INSERT", "INTO", "VALUES", "UPDATE", "SET",
-        "WHERE", "DELETE", "FROM", "TABLE"
-    };
-    return Keywords.find(Token) != Keywords.end();
-}
 }
 }
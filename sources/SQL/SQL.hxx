@@ -3,12 +3,16 @@
 #include <IO/Logger.hxx>
 #include <Database/User.hxx>
 #include <SQL/Bytecode.hxx>
-#include <DS/Tree.hxx>
+#include <SQL/Keywords.hxx>
+#include <DS/Arena.hxx>
 #include <DS/BPlusTree.hxx>
 #include <DS/RadixTree.hxx>
+#include <cstdint>
 #include <cstdio>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <optional>
@@ -25,131 +29,145 @@ enum class TokenType {
     SYMBOL // Added SYMBOL
 };
 
+// Token values are views into the parsed query, which must outlive the parser
 struct Token {
     TokenType Type;
-    std::string Value;
+    std::string_view Value;
+    Keyword Word = Keyword::NONE; // Resolved at tokenize time for keywords and constraints
+    Operator Op = Operator::NONE;
 };
 
 using TokenStream = std::vector<Token>;
+using TableSet = std::vector<std::string>;
+
+// Pseudo-table written by GRANT/REVOKE so permission changes stay ordered
+inline constexpr const char* AclResource = "@acl";
+
+/* AST nodes are plain tagged structs allocated in an AstContext's arena. Strings and child lists
+are views into the same arena, so a whole parse is released in one go with its context.*/
+enum class NodeKind : uint8_t {
+    Literal,
+    Create,
+    Select,
+    Insert,
+    Update,
+    Delete,
+    BinaryOp,
+    Grant,
+    Revoke
+};
 
-struct ColumnDefinition {
-    std::string Name;
-    std::string Type;
-    std::vector<std::string> Constraints;
+struct AstNode {
+    NodeKind Kind;
 
-    ColumnDefinition(std::string name, std::string type, std::vector<std::string> constraints = {})
-        : Name(std::move(name)), Type(std::move(type)), Constraints(std::move(constraints)) {}
+    template<class T> const T *As() const { return Kind == T::StaticKind ? static_cast<const T*>(this) : nullptr; }
 };
 
-struct ExpressionAST {
-    virtual ~ExpressionAST() = default;
-    virtual Bytecode EmitBytecode() const = 0;
+struct ColumnDefinition {
+    std::string_view Name;
+    std::string_view Type;
+    std::span<const std::string_view> Constraints;
 };
 
-struct LiteralAST : public ExpressionAST {
-    std::string Value;
-
-    explicit LiteralAST(std::string Value) : Value(std::move(Value)) {}
-    Bytecode EmitBytecode() const override;
+struct Assignment {
+    std::string_view Column;
+    std::string_view Value;
 };
 
-struct TableAST : public ExpressionAST {
-    std::string TableName;
-
-    explicit TableAST(std::string Name) : TableName(std::move(Name)) {}
-    Bytecode EmitBytecode() const override;
+struct LiteralNode : AstNode {
+    static constexpr NodeKind StaticKind = NodeKind::Literal;
+    std::string_view Value;
 };
 
-/* ColumnAST : public ExpressionAST {
-    std::string ColumnName;
-public:
-    explicit ColumnAST(std::string ColumnName) : ColumnName(std::move(ColumnName)) {}
-};*/
-
-struct CreateAST : public ExpressionAST {
-    std::string TableName;
-    std::vector<ColumnDefinition> Columns;
-
-    explicit CreateAST(std::string TableName, std::vector<ColumnDefinition> Columns) : TableName(std::move(TableName)),
-                        Columns(std::move(Columns)) {}
-    Bytecode EmitBytecode() const override;
+struct CreateNode : AstNode {
+    static constexpr NodeKind StaticKind = NodeKind::Create;
+    std::string_view TableName;
+    std::span<const ColumnDefinition> Columns;
 };
 
-struct SelectAST : public ExpressionAST {
-    std::vector<std::string> Columns;
-    std::unique_ptr<TableAST> Table;
-
-    SelectAST(std::vector<std::string> Columns, std::unique_ptr<TableAST> Table)
-        : Columns(std::move(Columns)), Table(std::move(Table)) {}
-    Bytecode EmitBytecode() const override;
+struct SelectNode : AstNode {
+    static constexpr NodeKind StaticKind = NodeKind::Select;
+    std::span<const std::string_view> Columns;
+    std::string_view TableName;
 };
 
-struct InsertAST : public ExpressionAST {
-    std::unique_ptr<TableAST> Table;
-    std::vector<std::string> Columns;
-    std::vector<std::string> Values;
-public:
-    InsertAST(std::unique_ptr<TableAST> Table, std::vector<std::string> Columns, std::vector<std::string> Values)
-        : Table(std::move(Table)), Columns(std::move(Columns)), Values(std::move(Values)) {}
-    Bytecode EmitBytecode() const override;
+struct InsertNode : AstNode {
+    static constexpr NodeKind StaticKind = NodeKind::Insert;
+    std::string_view TableName;
+    std::span<const std::string_view> Columns;
+    std::span<const std::string_view> Values;
 };
 
-struct UpdateAST : public ExpressionAST {
-    std::string TableName;
-    std::vector<std::pair<std::string, std::string>> Assignments;
-    std::unique_ptr<ExpressionAST> Condition;
-
-    UpdateAST(std::string TableName, 
-              std::vector<std::pair<std::string, std::string>> Assignments,
-              std::unique_ptr<ExpressionAST> Condition)
-        : TableName(std::move(TableName)),  Assignments(std::move(Assignments)), 
-          Condition(std::move(Condition)) {}
-    Bytecode EmitBytecode() const override;
+struct UpdateNode : AstNode {
+    static constexpr NodeKind StaticKind = NodeKind::Update;
+    std::string_view TableName;
+    std::span<const Assignment> Assignments;
+    const AstNode *Condition;
 };
 
-struct DeleteAST : public ExpressionAST {
-    std::string TableName;
-    std::unique_ptr<ExpressionAST> Condition;
-
-    DeleteAST(std::string TableName, std::unique_ptr<ExpressionAST> Condition)
-        : TableName(std::move(TableName)), Condition(std::move(Condition)) {}
-    Bytecode EmitBytecode() const override;
+struct DeleteNode : AstNode {
+    static constexpr NodeKind StaticKind = NodeKind::Delete;
+    std::string_view TableName;
+    const AstNode *Condition;
 };
 
-struct BinaryOpAST : public ExpressionAST {
-    std::unique_ptr<ExpressionAST> LHS, RHS;
-    std::string Op;
-
-    BinaryOpAST(std::unique_ptr<ExpressionAST> LHS, std::string Op, std::unique_ptr<ExpressionAST> RHS)
-        : LHS(std::move(LHS)), RHS(std::move(RHS)), Op(std::move(Op)) {}
-    Bytecode EmitBytecode() const override;
+struct BinaryOpNode : AstNode {
+    static constexpr NodeKind StaticKind = NodeKind::BinaryOp;
+    const AstNode *LHS;
+    const AstNode *RHS;
+    Operator Op;
 };
 
-struct GrantAST : public ExpressionAST {
-    std::string Username;
+struct GrantNode : AstNode {
+    static constexpr NodeKind StaticKind = NodeKind::Grant;
+    std::string_view Username;
     Permissions Perms;
-    std::string TableName;
-    GrantAST(std::string User, Permissions Perms, std::string Table = "")
-        : Username(std::move(User)), Perms(Perms), TableName(std::move(Table)) {}
-    Bytecode EmitBytecode() const override;
+    std::string_view TableName;
 };
 
-struct RevokeAST : public ExpressionAST {
-    std::string UserName;
+struct RevokeNode : AstNode {
+    static constexpr NodeKind StaticKind = NodeKind::Revoke;
+    std::string_view Username;
     Permissions Perms;
-    std::string TableName;
-    RevokeAST(std::string User, Permissions Permissions, std::string Table = "")
-        : UserName(std::move(User)), Perms(Permissions), TableName(std::move(Table)) {}
-    Bytecode EmitBytecode() const override;
+    std::string_view TableName;
 };
 
-using ASTNode = std::unique_ptr<ExpressionAST>;
-using ASTType = std::vector<ASTNode>;
+// Owns every node and string of one parse; independent contexts can be parsed on different threads
+class AstContext {
+    DS::Arena Arena_;
+    std::vector<const AstNode*> Statements_;
+public:
+    explicit AstContext(size_t BlockSize = DS::Arena::DefaultBlockSize) : Arena_(BlockSize) {}
+    AstContext(const AstContext&) = delete;
+    AstContext &operator=(const AstContext&) = delete;
+
+    template<class T> T *Make() {
+        T *Node = Arena_.Create<T>();
+        Node->Kind = T::StaticKind;
+        return Node;
+    }
+
+    std::string_view Intern(std::string_view Text) { return Arena_.Intern(Text); }
+    template<class T> std::span<const T> Copy(const std::vector<T> &Items) { return Arena_.Copy(std::span<const T>(Items)); }
+
+    void AddStatement(const AstNode *Statement) { Statements_.push_back(Statement); }
+    const std::vector<const AstNode*> &Statements() const { return Statements_; }
+    size_t Size() const { return Statements_.size(); }
+    bool Empty() const { return Statements_.empty(); }
+
+    // Forgets all statements and recycles the arena for the next parse
+    void Reset() {
+        Statements_.clear();
+        Arena_.Reset();
+    }
+
+    size_t BytesUsed() const { return Arena_.BytesUsed(); }
+};
 
 // Hybrid AST structure: switches between BPlusTree and RadixTree based on depth
 class HybridAST {
 	using KeyType = std::string;
-	using ValueType = ASTNode;
+	using ValueType = const AstNode*;
 	using BPTree = BPlusTree<KeyType, ValueType>;
 	using RTree = DS::RadixTree<KeyType, ValueType>;
 
@@ -164,28 +182,28 @@ public:
 	template<typename Func>
 	void Traverse(Func &&F, size_t Depth = 0) const;
 	bool Empty() const;
-	ExpressionAST *Find(const KeyType &Key, size_t Depth = 0);
+	const AstNode *Find(const KeyType &Key, size_t Depth = 0);
 };
 
-extern Tree<ASTNode> AST;
-
 class Parser {
     std::string_view Query_;
     TokenStream Tokens_;
     size_t CurrentIndex_ = 0;
+    AstContext &Context_;
+    Logger* Logger_ = nullptr;
 
-    int GetTokenPrecedence(const Token &Token);
+    struct TokenizeOnly {};
+    Parser(TokenizeOnly, std::string_view Query, AstContext &Context, Logger* Logger)
+        : Query_(Query), Context_(Context), Logger_(Logger) { Tokens_ = Tokenize(); }
+
+    static int GetTokenPrecedence(const Token &Token) { return OperatorPrecedence(Token.Op); }
 
     bool IsEOF() { return CurrentIndex_ >= Tokens_.size(); }
 
     TokenStream Tokenize();
 
-    ASTNode ParsePrimary();
+    const AstNode *ParsePrimary();
 
-    bool IsConstraint(const std::string &TokenValue);
-    
-    bool IsKeyword(const std::string &TokenValue);
-    
     std::optional<Token> CurrentToken() const {
         if(CurrentIndex_ < Tokens_.size()) return Tokens_[CurrentIndex_];
         return std::nullopt;
@@ -204,14 +222,14 @@ class Parser {
     }
 
     bool MatchToken(const Token &Other) {
-        if(auto Token = CurrentToken(); MatchToken(Other.Type) && MatchKeyword(Other.Value))
+        if(MatchToken(Other.Type) && MatchKeyword(Other.Word))
             return true;
         return false;
     }
 
-    bool MatchKeyword(const std::string &ExpectedKeyword) {
+    bool MatchKeyword(Keyword ExpectedKeyword) {
         if (auto Token = CurrentToken()) {
-            if (Token->Type == TokenType::KEYWORD && Token->Value == ExpectedKeyword) {
+            if (Token->Type == TokenType::KEYWORD && Token->Word == ExpectedKeyword) {
                 AdvanceToken();
                 return true;
             }
@@ -219,7 +237,7 @@ class Parser {
         return false;
     }
 
-    bool MatchToken(TokenType ExpectedType, const std::string& ExpectedValue) {
+    bool MatchToken(TokenType ExpectedType, std::string_view ExpectedValue) {
         if (auto Token = CurrentToken()) {
             if (Token->Type == ExpectedType && Token->Value == ExpectedValue) {
                 AdvanceToken();
@@ -229,61 +247,50 @@ class Parser {
         return false;
     }
 
-    Tree<ASTNode> BuildAST() const;
-
-    ASTNode ParseExpression();
-    ASTNode ParseCreateStatement();
-    ASTNode ParseSelectStatement();
-    ASTNode ParseInsertStatement();
-    ASTNode ParseUpdateStatement();
-    ASTNode ParseDeleteStatement();
-    ASTNode ParseWhereClause();
-    ASTNode ParseBinaryOperation();
-    ASTNode ParseBinaryOperation(int MinPrec, ASTNode LHS);
-    ASTNode ParseGrantStatement();
-    ASTNode ParseRevokeStatement();
+    void BuildAST();
+
+    std::string_view Intern(std::string_view Text) { return Context_.Intern(Text); }
+    Permissions ParsePermission(std::string_view Statement);
+    bool AtKeyword(Keyword Expected) const { auto Token = CurrentToken(); return Token && Token->Word == Expected; }
+
+    const AstNode *ParseExpression();
+    const AstNode *ParseCreateStatement();
+    const AstNode *ParseSelectStatement();
+    const AstNode *ParseInsertStatement();
+    const AstNode *ParseUpdateStatement();
+    const AstNode *ParseDeleteStatement();
+    const AstNode *ParseWhereClause();
+    const AstNode *ParseBinaryOperation();
+    const AstNode *ParseBinaryOperation(int MinPrec, const AstNode *LHS);
+    const AstNode *ParseGrantStatement();
+    const AstNode *ParseRevokeStatement();
 public:
-    explicit Parser(std::string_view Query) : Query_(Query) {
-        std::cout << "[Parser] Initializing with query:\n\"" << Query << "\"\n";
-        // Tokenization phase
-        std::cout << "[Tokenizer] Starting tokenization...\n";
-        Tokens_ = Tokenize();
-        std::cout << "[Tokenizer] Produced " << Tokens_.size() << " tokens:\n";
-        for (const auto& token : Tokens_)
-            std::cout << "[" << static_cast<int>(token.Type) << ": " << token.Value << "] ";
-        std::cout << "\n";
-        CurrentIndex_ = 0;
-        // Parsing phase
-        try {
-            std::cout << "[Parser] Starting AST construction...\n";
-            // Parse all statements, not just one!
-            auto NewAST = BuildAST();
-            AST = std::move(NewAST);
-            std::cout << "[Parser] Successfully parsed all statements\n";
-        }
-        catch(const std::exception& e) {
-            std::cerr << "[ERROR] Parsing failed: " << e.what() << "\n";
-            throw;
-        }
-        // AST diagnostics
-        std::cout << "[AST] Final AST structure:\n";
-        DumpAST();
-        std::cout << "[AST] Construction completed successfully\n";
-    }
+    // Parses every statement in Query into Context, which owns the resulting nodes
+    Parser(std::string_view Query, AstContext &Context, Logger* Logger = nullptr);
 
-    std::unique_ptr<ExpressionAST> ParseStatement();
+    // Parses one statement into Context and returns it, or nullptr if it holds no tokens
+    static const AstNode *ParseSingleStatement(std::string_view Statement, AstContext &Context, Logger* Logger = nullptr);
+
+    const AstNode *ParseStatement();
 
     void DumpTokens() const;
 
-    void DumpAST() {
-        std::function<void(const Tree<ASTNode>::Node&, int)> DumpNode = [&](const Tree<ASTNode>::Node& Node, int Depth) {
-            std::cout << std::string(Depth * 2, ' ') << Node.Value->EmitBytecode() << '\n';
-            for (const auto& Child : Node.Children)
-                DumpNode(*Child, Depth + 1);
-        };
-    }
+    // Logs the bytecode of every parsed statement when verbose
+    void DumpAST() const;
 };
 
-Bytecode BuildBytecode(Logger* Logger = nullptr);
+// A single statement's bytecode along with the tables it reads and writes
+struct StatementPlan {
+    Bytecode Code;
+    TableSet Reads;
+    TableSet Writes;
+};
+
+Bytecode EmitBytecode(const AstNode &Node);
+void CollectTables(const AstNode &Node, TableSet &Reads, TableSet &Writes);
+
+Bytecode BuildBytecode(const AstContext &Context, Logger* Logger = nullptr);
+std::vector<StatementPlan> BuildStatements(const AstContext &Context, Logger* Logger = nullptr);
+StatementPlan PlanStatement(const AstNode &Statement);
 }
 }
\ No newline at end of file
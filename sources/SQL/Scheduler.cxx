@@ -0,0 +1,84 @@
+#include <SQL/Scheduler.hxx>
+#include <SQL/BytecodeInterpreter.hxx>
+#include <IO/Task.hxx>
+#include <thread>
+#include <chrono>
+
+namespace AstralDB {
+namespace SQL {
+Scheduler::Scheduler(std::shared_ptr<Database> Db, Logger* Logger, size_t MaxInFlight)
+    : Database_(std::move(Db)), Logger_(Logger), MaxInFlight_(MaxInFlight) {
+    if(!MaxInFlight_) MaxInFlight_ = std::max(4u, std::thread::hardware_concurrency() * 2);
+}
+
+Scheduler::~Scheduler() {
+    try {
+        Wait();
+    } catch(...) {
+        if(Logger_) Logger_->Error("Statement failed while tearing down scheduler");
+    }
+}
+
+void Scheduler::Retire(std::shared_future<void> &Done) {
+    try {
+        Done.get();
+    } catch(...) {
+        if(!FirstError_) FirstError_ = std::current_exception();
+    }
+}
+
+void Scheduler::Submit(StatementPlan Plan) {
+    std::vector<std::shared_future<void>> Dependencies;
+    for(const auto &Table : Plan.Reads) {
+        auto It = Tables_.find(Table);
+        if(It != Tables_.end() && It->second.LastWriter.valid())
+            Dependencies.push_back(It->second.LastWriter);
+    }
+    for(const auto &Table : Plan.Writes) {
+        auto It = Tables_.find(Table);
+        if(It == Tables_.end()) continue;
+        if(It->second.LastWriter.valid()) Dependencies.push_back(It->second.LastWriter);
+        Dependencies.insert(Dependencies.end(), It->second.Readers.begin(), It->second.Readers.end());
+    }
+    std::shared_future<void> Done = RunAsync([Db = Database_, Logger = Logger_, Code = std::move(Plan.Code),
+                                              Dependencies = std::move(Dependencies)]() {
+        // A failed dependency fails its dependents instead of letting them run out of order
+        for(const auto &Dependency : Dependencies) Dependency.get();
+        BytecodeInterpreter Interpreter(Db, Logger);
+        Interpreter.Execute(Code);
+    }).share();
+    for(const auto &Table : Plan.Reads) {
+        auto &Readers = Tables_[Table].Readers;
+        // Read-only streams never reset the reader list, so drop the ones that already finished
+        if(Readers.size() >= MaxInFlight_)
+            std::erase_if(Readers, [](const std::shared_future<void> &Reader) {
+                return Reader.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            });
+        Readers.push_back(Done);
+    }
+    for(const auto &Table : Plan.Writes) {
+        auto &State = Tables_[Table];
+        State.LastWriter = Done;
+        State.Readers.clear();
+    }
+    InFlight_.push_back(std::move(Done));
+    while(InFlight_.size() > MaxInFlight_) {
+        Retire(InFlight_.front());
+        InFlight_.pop_front();
+    }
+}
+
+void Scheduler::Wait() {
+    while(!InFlight_.empty()) {
+        Retire(InFlight_.front());
+        InFlight_.pop_front();
+    }
+    Tables_.clear();
+    if(FirstError_) {
+        auto Error = FirstError_;
+        FirstError_ = nullptr;
+        std::rethrow_exception(Error);
+    }
+}
+}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <SQL/SQL.hxx>
+#include <Database/Database.hxx>
+#include <IO/Logger.hxx>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace AstralDB {
+namespace SQL {
+/* Runs statements concurrently while preserving the textual order of conflicting ones.
+A statement waits for the last writer of every table it touches, and writers additionally
+wait for every reader since that write, so the dependency graph is built as statements arrive.*/
+class Scheduler {
+    struct TableState {
+        std::shared_future<void> LastWriter;
+        std::vector<std::shared_future<void>> Readers;
+    };
+
+    std::shared_ptr<Database> Database_;
+    Logger* Logger_ = nullptr;
+    size_t MaxInFlight_;
+    std::unordered_map<std::string, TableState> Tables_;
+    std::deque<std::shared_future<void>> InFlight_;
+    std::exception_ptr FirstError_;
+
+    void Retire(std::shared_future<void> &Done);
+public:
+    explicit Scheduler(std::shared_ptr<Database> Db, Logger* Logger = nullptr, size_t MaxInFlight = 0);
+    ~Scheduler();
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    void Submit(StatementPlan Plan);
+    // Blocks until every submitted statement finished, rethrowing the first failure
+    void Wait();
+};
+}
+}
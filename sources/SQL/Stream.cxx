@@ -0,0 +1,108 @@
+#include <SQL/Stream.hxx>
+#include <IO/SIMD.hxx>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace AstralDB {
+namespace SQL {
+StatementStream::StatementStream(const std::filesystem::path &Path, size_t ChunkSize) : ChunkSize_(ChunkSize) {
+	std::error_code Error;
+	FileSize_ = std::filesystem::file_size(Path, Error);
+	if(Error) return;
+#if defined(__unix__) || defined(__APPLE__)
+	if(FileSize_) {
+		int Descriptor = ::open(Path.c_str(), O_RDONLY);
+		if(Descriptor >= 0) {
+			void *Mapping = ::mmap(nullptr, FileSize_, PROT_READ, MAP_PRIVATE, Descriptor, 0);
+			::close(Descriptor);
+			if(Mapping != MAP_FAILED) {
+				::madvise(Mapping, FileSize_, MADV_SEQUENTIAL);
+				Mapped_ = static_cast<const char*>(Mapping);
+				Open_ = true;
+				return;
+			}
+		}
+	}
+#endif
+	File_.open(Path, std::ios::binary);
+	Open_ = static_cast<bool>(File_);
+}
+
+StatementStream::~StatementStream() {
+#if defined(__unix__) || defined(__APPLE__)
+	if(Mapped_) ::munmap(const_cast<char*>(Mapped_), FileSize_);
+#endif
+}
+
+bool StatementStream::Refill() {
+	if(Mapped_ || !File_) return false;
+	// Drop the consumed prefix so the buffer only ever holds the statement being scanned plus one chunk
+	if(Begin_) {
+		Buffer_.erase(0, Begin_);
+		ScanPos_ -= Begin_;
+		Begin_ = 0;
+	}
+	size_t OldSize = Buffer_.size();
+	Buffer_.resize(OldSize + ChunkSize_);
+	File_.read(Buffer_.data() + OldSize, ChunkSize_);
+	Buffer_.resize(OldSize + File_.gcount());
+	return Buffer_.size() > OldSize;
+}
+
+void StatementStream::ReleaseConsumed() {
+#if defined(__unix__) || defined(__APPLE__)
+	if(!Mapped_ || Begin_ - Released_ < ReleaseGranularity) return;
+	size_t PageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+	size_t Until = Begin_ / PageSize * PageSize;
+	if(Until > Released_) {
+		::madvise(const_cast<char*>(Mapped_) + Released_, Until - Released_, MADV_DONTNEED);
+		Released_ = Until;
+	}
+#endif
+}
+
+std::optional<std::string_view> StatementStream::Take(size_t End, size_t Resume) {
+	const char *Base = Data();
+	const char *First = SimdSkipWhitespace(Base + Begin_, Base + End);
+	const char *Last = Base + End;
+	while(Last > First && IsCharClass(Last[-1], CharSpace)) --Last;
+	Begin_ = ScanPos_ = Resume;
+	if(First == Last) return std::nullopt;
+	return std::string_view(First, Last - First);
+}
+
+std::optional<std::string_view> StatementStream::Next() {
+	if(!Open_) return std::nullopt;
+	ReleaseConsumed();
+	while(!Exhausted_) {
+		const char *Base = Data();
+		size_t Size = Available();
+		// Same quoting rules as the tokenizer: a ';' only ends a statement outside string literals
+		while(ScanPos_ < Size) {
+			char Current = Base[ScanPos_];
+			if(Escaped_) {
+				Escaped_ = false;
+			} else if(Quote_) {
+				if(Current == '\\') Escaped_ = true;
+				else if(Current == Quote_) Quote_ = 0;
+			} else if(Current == '\'' || Current == '"') {
+				Quote_ = Current;
+			} else if(Current == ';') {
+				if(auto Statement = Take(ScanPos_, ScanPos_ + 1)) return Statement;
+				continue;
+			}
+			++ScanPos_;
+		}
+		if(!Refill()) {
+			Exhausted_ = true;
+			if(auto Statement = Take(Available(), Available())) return Statement;
+		}
+	}
+	return std::nullopt;
+}
+}
+}
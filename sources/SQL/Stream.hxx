@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace AstralDB {
+namespace SQL {
+/* Splits a SQL script into statements without loading it whole.
+The file is mapped with sequential read-ahead where the platform allows it (consumed pages are
+dropped as the cursor moves on), otherwise it is read in fixed-size chunks. Views returned by
+Next() stay valid only until the following call.*/
+class StatementStream {
+    static constexpr size_t DefaultChunkSize = 1 << 20;
+    static constexpr size_t ReleaseGranularity = 64ull << 20;
+
+    std::ifstream File_;
+    std::string Buffer_;
+    const char *Mapped_ = nullptr;
+    size_t FileSize_ = 0;
+    size_t ChunkSize_;
+    size_t Begin_ = 0;
+    size_t ScanPos_ = 0;
+    size_t Released_ = 0;
+    char Quote_ = 0;
+    bool Escaped_ = false;
+    bool Open_ = false;
+    bool Exhausted_ = false;
+
+    const char *Data() const { return Mapped_ ? Mapped_ : Buffer_.data(); }
+    size_t Available() const { return Mapped_ ? FileSize_ : Buffer_.size(); }
+    bool Refill();
+    void ReleaseConsumed();
+    std::optional<std::string_view> Take(size_t End, size_t Resume);
+public:
+    explicit StatementStream(const std::filesystem::path &Path, size_t ChunkSize = DefaultChunkSize);
+    ~StatementStream();
+    StatementStream(const StatementStream&) = delete;
+    StatementStream& operator=(const StatementStream&) = delete;
+
+    bool IsOpen() const { return Open_; }
+    bool IsMapped() const { return Mapped_ != nullptr; }
+    bool Empty() const { return FileSize_ == 0; }
+    size_t Size() const { return FileSize_; }
+
+    // Next statement without its terminating ';', or nullopt once the script is exhausted
+    std::optional<std::string_view> Next();
+};
+}
+}
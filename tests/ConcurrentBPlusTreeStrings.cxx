@@ -0,0 +1,69 @@
+/* Concurrent string-key stress for ConcurrentBPlusTree. Writers insert and erase long string keys,
+so every key lives behind a pointer, while readers look keys up optimistically. Build it with
+-fsanitize=thread to check that readers never touch a key before it is fully constructed.
+Exits non-zero on a wrong answer.*/
+#include <DS/ConcurrentBPlusTree.hxx>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace AstralDB;
+
+static std::string KeyFor(uint64_t Number) {
+	// Longer than any small-string buffer, so the characters are heap-allocated too
+	return "concurrent-bplustree-key-" + std::to_string(Number) + "-padding-padding";
+}
+
+int main() {
+	constexpr uint64_t Writers = 4, Readers = 4, KeysPerWriter = 20000;
+	ConcurrentBPlusTree<std::string, uint64_t> Tree;
+	std::atomic<bool> Done = false;
+	std::atomic<uint64_t> Failures = 0;
+
+	std::vector<std::thread> Threads;
+	for(uint64_t Writer = 0; Writer < Writers; ++Writer)
+		Threads.emplace_back([&, Writer] {
+			// Keys interleave across writers so they land in the same leaves and shift each other's slots
+			for(uint64_t i = 0; i < KeysPerWriter; ++i) {
+				uint64_t Number = i * Writers + Writer;
+				Tree.Insert(KeyFor(Number), Number);
+				// Every odd key is erased again right away
+				if(Number % 2 && !Tree.Erase(KeyFor(Number))) ++Failures;
+			}
+		});
+	for(uint64_t Reader = 0; Reader < Readers; ++Reader)
+		Threads.emplace_back([&, Reader] {
+			uint64_t Number = Reader;
+			while(!Done.load(std::memory_order_acquire)) {
+				// A key that is found must carry its own number
+				if(auto Found = Tree.Find(KeyFor(Number)); Found && *Found != Number) ++Failures;
+				Number = (Number * 2654435761u + 1) % (Writers * KeysPerWriter);
+			}
+		});
+	for(uint64_t i = 0; i < Writers; ++i) Threads[i].join();
+	Done.store(true, std::memory_order_release);
+	for(uint64_t i = Writers; i < Threads.size(); ++i) Threads[i].join();
+
+	uint64_t Expected = Writers * KeysPerWriter / 2;
+	if(Tree.Size() != Expected) ++Failures;
+	for(uint64_t Number = 0; Number < Writers * KeysPerWriter; ++Number) {
+		auto Found = Tree.Find(KeyFor(Number));
+		if(Number % 2 ? Found.has_value() : (!Found || *Found != Number)) ++Failures;
+	}
+	uint64_t Previous = 0;
+	bool First = true;
+	std::string Last;
+	Tree.ForEach([&](const std::string &Key, uint64_t) {
+		if(!First && !(Last < Key)) ++Failures;
+		Last = Key;
+		First = false;
+		++Previous;
+	});
+	if(Previous != Expected) ++Failures;
+
+	std::printf("%s: %llu failure(s)\n", Failures ? "FAILED" : "passed", static_cast<unsigned long long>(Failures.load()));
+	return Failures ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+/* Parser::ParseSingleStatement, which the streaming script runner uses for every statement. A
+statement may end in one ';'. Any other tokens left after it must be reported, not silently dropped.
+Exits non-zero on a wrong answer.*/
+#include <SQL/SQL.hxx>
+#include <cstdio>
+#include <stdexcept>
+#include <string_view>
+
+using namespace AstralDB;
+
+static int Failures = 0;
+
+static void ExpectParses(std::string_view Statement) {
+	SQL::AstContext Context;
+	try {
+		if(!SQL::Parser::ParseSingleStatement(Statement, Context)) {
+			std::printf("no statement parsed from: %.*s\n", static_cast<int>(Statement.size()), Statement.data());
+			++Failures;
+		}
+	} catch(const std::exception &e) {
+		std::printf("unexpected error for: %.*s (%s)\n", static_cast<int>(Statement.size()), Statement.data(), e.what());
+		++Failures;
+	}
+}
+
+static void ExpectRejected(std::string_view Statement) {
+	SQL::AstContext Context;
+	try {
+		SQL::Parser::ParseSingleStatement(Statement, Context);
+		std::printf("accepted trailing tokens in: %.*s\n", static_cast<int>(Statement.size()), Statement.data());
+		++Failures;
+	} catch(const std::runtime_error&) {}
+}
+
+int main() {
+	ExpectParses("INSERT INTO t VALUES (1)");
+	ExpectParses("INSERT INTO t VALUES (1);");
+	ExpectParses("CREATE TABLE hello (phrase TEXT)");
+	ExpectParses("UPDATE hello SET phrase = 'Hello, World!' WHERE phrase = 'Hello, AstralDB!'");
+	ExpectParses("DELETE FROM hello WHERE phrase = 'Hello, World!'");
+	ExpectParses("SELECT phrase FROM hello");
+	ExpectRejected("INSERT INTO t VALUES (1) garbage");
+	ExpectRejected("INSERT INTO t VALUES (1); garbage");
+	ExpectRejected("INSERT INTO t VALUES (1);;");
+	std::printf("%s: %d failure(s)\n", Failures ? "FAILED" : "passed", Failures);
+	return Failures ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+/* RowStore with dictionary-encoded columns. Encoding a low-cardinality column must shrink what the
+store charges to the memory budget, and every read must still see whole rows: resident or evicted,
+after changes, and after the column runs out of codes and goes back to plain cells. Exits non-zero on
+a wrong answer.*/
+#include <Database/RowStore.hxx>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+using namespace AstralDB;
+using Item = std::unordered_map<std::string, std::string>;
+
+static int Failures = 0;
+
+static void Expect(bool Condition, const char *What) {
+	if(!Condition) {
+		std::printf("failed: %s\n", What);
+		++Failures;
+	}
+}
+
+static const char *Countries[] = {"United States", "Germany", "France", "Japan", "Brazil", "India", "China", "United Kingdom"};
+
+static Item Expected(size_t i) {
+	return {{"id", std::to_string(i)}, {"country", Countries[i % 8]}};
+}
+
+// Checks every row through a scan, View and Get
+static void ExpectWhole(const RowStore<Item> &Rows, const std::vector<RowId> &Ids, auto &&Want, const char *What) {
+	bool Same = true;
+	Rows.ForEach([&](RowId Id, const Item &Row) { Same = Same && Row == Want(Id.Slot); });
+	for(RowId Id : Ids) {
+		Rows.View(Id, [&](const Item &Row) { Same = Same && Row == Want(Id.Slot); });
+		Same = Same && *Rows.Get(Id) == Want(Id.Slot);
+	}
+	Rows.Deflate();
+	Expect(Same, What);
+}
+
+int main() {
+	constexpr size_t Count = 20000;
+	std::filesystem::path Path = std::filesystem::temp_directory_path() / "rowstore-encoding.pages";
+	std::filesystem::remove(Path);
+	{
+		PageHeap Heap(Path, 64);
+		RowStore<Item> Rows;
+		Rows.AttachHeap(&Heap);
+		std::vector<RowId> Ids;
+		for(size_t i = 0; i < Count; ++i) Ids.push_back(Rows.Insert(Expected(i)));
+
+		size_t Plain = MemoryBudget::Global().Used();
+		Expect(Rows.EncodeColumn("country"), "country fits in a dictionary");
+		size_t Encoded = MemoryBudget::Global().Used();
+		std::printf("charged %zu bytes plain, %zu encoded\n", Plain, Encoded);
+		Expect(Encoded * 3 < Plain * 2, "encoding saves at least a third");
+		Expect(Rows.ResidentBytes() + Rows.Dictionary("country")->Bytes() == Encoded, "charges add up");
+		ExpectWhole(Rows, Ids, Expected, "rows are whole after encoding");
+		Expect(MemoryBudget::Global().Used() == Encoded, "Deflate takes the cells out again");
+
+		// Rows evicted before and after the encoding come back whole
+		Rows.Evict(Rows.ResidentBytes() / 2);
+		for(size_t i = Count; i < Count + 1000; ++i) Ids.push_back(Rows.Insert(Expected(i)));
+		Rows.Evict(0);
+		auto Grown = [](uint32_t Slot) { return Expected(Slot); };
+		ExpectWhole(Rows, Ids, Grown, "evicted rows are whole");
+
+		Rows.Modify(Ids[3], [](Item &Row) { Row["country"] = "Chile"; });
+		Rows.Modify(Ids[4], [](Item &Row) { Row.erase("country"); });
+		auto Changed = [](uint32_t Slot) {
+			Item Row = Expected(Slot);
+			if(Slot == 3) Row["country"] = "Chile";
+			if(Slot == 4) Row.erase("country");
+			return Row;
+		};
+		ExpectWhole(Rows, Ids, Changed, "changed rows are whole");
+		Expect(Rows.Dictionary("country")->Size() == 9, "a new value takes a new code");
+
+		// Running out of codes hands the cells back to every row, the first new one refilling slot 5
+		constexpr uint32_t Added = Count + 1000;
+		Rows.Erase(Ids[5]);
+		auto Spare = [&](uint32_t Slot) { return Item{{"id", "x"}, {"country", "c" + std::to_string(Slot == 5 ? 0 : Slot - Added + 1)}}; };
+		Ids[5] = Rows.Insert(Spare(5));
+		while(Rows.Dictionary("country")) Rows.Insert(Spare(static_cast<uint32_t>(Rows.SlotCount())));
+		bool Restored = true;
+		Rows.ForEachStored([&](RowId Id, const Item &Row) { Restored = Restored && (Id.Slot == 4 || Row.contains("country")); });
+		Expect(Restored, "an overflowing column goes back to plain cells");
+		auto Decoded = [&](uint32_t Slot) { return Slot == 5 || Slot >= Added ? Spare(Slot) : Changed(Slot); };
+		ExpectWhole(Rows, Ids, Decoded, "rows are whole after the column is decoded");
+		Rows.Clear();
+		Expect(MemoryBudget::Global().Used() == 0, "Clear releases everything");
+	}
+	std::filesystem::remove(Path);
+	if(Failures) std::printf("%d failure(s)\n", Failures);
+	return Failures ? 1 : 0;
+}